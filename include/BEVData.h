@@ -34,4 +34,33 @@ struct BEVFeaturePacket {
     BEVFeatureMeta feature_meta; // 特征图元数据（压缩算法参数）
     SensorContext sensor_ctx;    // 传感器上下文（缓存策略参数）
     uint64_t timestamp;          // 纳秒级Unix时间戳（核心：时序排序与缓存淘汰）
-};
\ No newline at end of file
+};
+
+// 压缩块的键（时间戳 + 块在特征图中的行/列偏移 + 金字塔层级，偏移为该层内的坐标）
+struct BEVBlockKey {
+    uint64_t timestamp;
+    uint16_t x;
+    uint16_t y;
+    uint8_t level = 0;  // 0为原始分辨率
+
+    bool operator==(const BEVBlockKey& other) const {
+        return timestamp == other.timestamp && x == other.x && y == other.y && level == other.level;
+    }
+};
+
+// 压缩块的编码方式（取自块所属压缩流的流头）：随块数据一起保存在各级缓存、磁盘与上行报文中，
+// 读取方按它解码，不依赖自身压缩器的配置
+struct BEVBlockCodec {
+    uint8_t codec = 0;   // BEVCompressor::CODEC_*
+    float rate = 0.0f;   // 流头码率（CODEC_ZFP_BLOCK_RATE的块数据另带码率提升级数前缀）
+
+    bool operator==(const BEVBlockCodec& other) const { return codec == other.codec && rate == other.rate; }
+    bool operator!=(const BEVBlockCodec& other) const { return !(*this == other); }
+};
+
+// 块键哈希函数
+struct BEVBlockKeyHash {
+    std::size_t operator()(const BEVBlockKey& key) const {
+        return ((key.timestamp << 32) | (key.x << 16) | key.y) ^ (static_cast<std::size_t>(key.level) << 61);
+    }
+};
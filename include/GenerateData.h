@@ -1,15 +1,59 @@
 #pragma once
 #include "BEVData.h"
 #include <iostream>
+#include <fstream>
 #include <random>
 #include <filesystem>
 
 class BEVDataGenerator {
 public:
+    // 确定性场景配置：相同配置生成的数据逐位相同，与线程数和生成顺序无关
+    struct ScenarioConfig {
+        uint64_t seed = 1;
+        int rows = 256;
+        int cols = 256;
+        int data_type = 3;              // 背景：0-随机 1-渐变 2-空 3-道路网格（随自车运动）
+        float noise_level = 0.05f;      // 噪声标准差
+        int num_obstacles = 12;         // 世界坐标系中的障碍物数量
+        double fps = 25.0;              // 帧率（决定时间戳间隔与自车位移）
+        float cell_size = 0.5f;         // 每个单元对应的米数
+        uint64_t start_timestamp = 1700000000000000000ULL;  // 首帧时间戳（纳秒）
+        int threads = 0;                // 生成线程数，0表示使用OpenMP默认值
+        size_t batch_frames = 32;       // 每批并行生成的帧数，写盘与下一批的生成重叠
+    };
+
     // 生成BEV帧数据
     BEVFeaturePacket generate_bev_frame(int rows, int cols, int data_type, float noise_level);
     void save_multi_frames(const std::string& file_path, const std::vector<BEVFeaturePacket>& packets);
 
+    // 生成场景中的第frame_index帧（只依赖配置与帧序号，可以任意顺序、并行调用）
+    BEVFeaturePacket generate_scenario_frame(const ScenarioConfig& config, uint64_t frame_index) const;
+
+    // 并行生成num_frames帧并流式写入文件（格式与save_multi_frames相同），返回写入的字节数
+    uint64_t generate_to_file(const ScenarioConfig& config, uint32_t num_frames,
+                              const std::string& file_path) const;
+
+    // 按save_multi_frames的格式写入一帧
+    static void write_frame(std::ostream& out, const BEVFeaturePacket& packet);
+
+private:
+
+};
+
+// 顺序读取save_multi_frames/generate_to_file写出的多帧文件，每次只在内存中保留一帧
+class BEVFrameReader {
+public:
+    explicit BEVFrameReader(const std::string& file_path);
+
+    uint32_t num_frames() const { return num_frames_; }
+    uint32_t frames_read() const { return frames_read_; }
+
+    // 读取下一帧，已读完返回false；文件截断或数据损坏时抛出异常
+    bool next(BEVFeaturePacket& packet);
+
 private:
-    
-};
\ No newline at end of file
+    std::ifstream file_;
+    uint64_t remaining_bytes_ = 0;
+    uint32_t num_frames_ = 0;
+    uint32_t frames_read_ = 0;
+};
@@ -2,12 +2,20 @@
 #define BEV_CACHE_H
 
 #include <json/json.h>
+#include <array>
 #include <vector>
 #include <list>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <string>
 #include <eigen3/Eigen/Dense>
+#include "compressor.h"
+#include "disk_tier.h"
+#include "worker_pool.h"
 
 // 内存池接口
 class MemoryPool {
@@ -26,6 +34,9 @@ public:
     void* allocate(size_t size) override;
     void deallocate(void* ptr) override;
     
+    // 获取统计信息（无锁）
+    Json::Value getStats() const;
+    
 private:
     struct Block {
         bool in_use;
@@ -37,6 +48,25 @@ private:
     std::vector<char*> allocated_chunks_;
 
     mutable std::mutex mutex_;
+    
+    // 统计信息
+    std::atomic<uint64_t> total_blocks_{0};         // 已预分配的池块总数
+    std::atomic<uint64_t> pool_allocations_{0};     // 从池中分配的次数
+    std::atomic<uint64_t> pool_deallocations_{0};   // 归还池的次数
+    std::atomic<uint64_t> oversize_allocations_{0}; // 超过块大小、回退到operator new的次数
+};
+
+// 内容寻址的块数据：内容相同的压缩块只存一份，由引用它的缓存项共享（受BEVCache::cache_mutex_保护）
+struct BEVBlockPayload {
+    uint64_t hash = 0;
+    uint32_t refs = 0;                  // 引用此数据的缓存项数，降为0时释放
+    std::vector<uint8_t> bytes;         // 自有数据（拷贝插入）
+    std::shared_ptr<const uint8_t> shared; // 或：指向共享批次缓冲区中块数据的别名指针（持有整个缓冲区）
+    uint32_t shared_size = 0;
+    const void* buffer = nullptr;       // shared非空时为所在批次缓冲区的标识
+
+    const uint8_t* data() const { return shared ? shared.get() : bytes.data(); }
+    size_t size() const { return shared ? shared_size : bytes.size(); }
 };
 
 // BEV缓存项
@@ -45,10 +75,14 @@ struct BEVCacheItem {
     uint16_t x;
     uint16_t y;
     uint16_t rows;
-    std::vector<uint8_t> compressed_data;
+    uint16_t cols;
+    BEVBlockCodec codec;                // 块所属压缩流的编码方式（去重只比较数据，编码方式随缓存项保存）
+    BEVBlockPayload* payload = nullptr; // 由BEVCache的去重存储持有
+    uint64_t last_access = 0;           // 最近访问的逻辑时刻（淘汰时比较各层的空闲时长）
+    uint64_t generation = 0;            // 写入代次：同一键被替换、重新插入或从下级缓存提升后都不同
     
     // 用于LRU链表的迭代器
-    using LRUIterator = std::list<uint64_t>::iterator;
+    using LRUIterator = std::list<BEVBlockKey>::iterator;
     LRUIterator lru_iterator;
 };
 
@@ -58,66 +92,203 @@ public:
     // BEV缓存配置
     struct BEVCacheConfig {
         size_t max_cache_size = 1024; // 最大缓存项数
+        size_t max_cache_bytes = 0;   // 块数据内存上限（按去重后实际存储的字节数计），0表示只按项数限制
+        bool dedup = true;            // 内容寻址去重：相同的压缩块只存一份
+        double coarse_retention = 4.0; // 金字塔粗层的驻留倍数：第k层块的空闲时长按1/coarse_retention^k折算
         std::shared_ptr<MemoryPool> memory_pool; // 内存池
+        std::shared_ptr<DiskBlockStore> disk_tier; // 可选的磁盘二级缓存（接收淘汰块，内存未命中时回查）
+        std::shared_ptr<WorkerPool> decode_pool;   // retrieveFrame/retrieveRegion的解码线程池，为空时使用OpenMP
+        std::string snapshot_path;               // 快照文件路径（为空则不使用快照）
+        bool restore_snapshot = true;            // 构造时映射已有快照（热重启）
+        bool snapshot_on_shutdown = false;       // 析构时自动保存快照
+    };
+
+    // 缓存项的键与哈希函数
+    using CacheKey = BEVBlockKey;
+    using CacheKeyHash = BEVBlockKeyHash;
+
+    // 批量检索的单项结果
+    struct BatchEntry {
+        CacheKey key;
+        bool hit = false;
+        uint16_t rows = 0;
+        uint16_t cols = 0;
+        BEVBlockCodec codec;
+        std::vector<uint8_t> data;
     };
 
     explicit BEVCache(const BEVCacheConfig& config);
     ~BEVCache();
     
-    // 插入压缩数据包
+    // 插入压缩数据包（块偏移须在缓存键的16位范围内，数据格式错误时抛出异常）
     void insertPackets(const std::vector<uint8_t>& compressed_data);
+    // 零拷贝插入：共享持有整批压缩数据，各块只记录其在缓冲区中的位置（别名指针+长度），不逐块拷贝。
+    // 只要还有一个块被缓存引用，整个缓冲区就不会释放：缓冲区中已淘汰的块与块头计入pinned_buffer_bytes
+    // 并参与max_cache_bytes限制（缓冲区大于该上限时退回拷贝插入）；存活的块数据少于插入时的一半后，
+    // 剩余的块被拷贝出来，缓冲区随即释放
+    void insertPackets(std::shared_ptr<const std::vector<uint8_t>> compressed_data);
     
-    // 检索缓存项
+    // 检索缓存项（codec非空时同时给出块的编码方式，解码时传给BEVCompressor::decode_block）
     bool retrieve(uint64_t timestamp, uint16_t x, uint16_t y, 
-                  std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols);
+                  std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec = nullptr);
+    
+    // 批量检索：一次加锁解析所有键，结果与keys一一对应，返回命中数
+    size_t retrieveBatch(const std::vector<CacheKey>& keys, std::vector<BatchEntry>& results);
+    
+    // 按时间戳检索一组块（blocks为(x, y)块偏移），返回命中数
+    size_t retrieveBatch(uint64_t timestamp, const std::vector<std::pair<uint16_t, uint16_t>>& blocks,
+                         std::vector<BatchEntry>& results);
+    
+    // 从缓存重建整帧：frame需预先设置为帧尺寸，命中的块按各自的编码方式并行解码写入frame
+    // （compressor只提供块大小与解码内核），未命中的块保持原值并追加到misses（可为空），返回命中块数；
+    // 数据损坏、解码失败的块不抛出异常，同样计为未命中并追加到misses（其区域内容不确定）
+    size_t retrieveFrame(uint64_t timestamp, const BEVCompressor& compressor,
+                         Eigen::MatrixXf& frame, std::vector<CacheKey>* misses = nullptr);
+    
+    // 从缓存解码第level层中以(row, col)为左上角的区域（层内坐标），尺寸取region的预设尺寸；
+    // 只检索与区域相交的块，其余同retrieveFrame
+    size_t retrieveRegion(uint64_t timestamp, uint8_t level, int row, int col, const BEVCompressor& compressor,
+                          Eigen::MatrixXf& region, std::vector<CacheKey>* misses = nullptr);
+    
+    // 确认一次在缓存之外完成的命中（如预取器的解码缓冲区命中）：块仍在缓存中且写入代次与
+    // generation相同（generation为0时不比较）时更新其LRU位置并计入命中，不拷贝数据，返回true；
+    // 块已被淘汰或替换时不计入统计并返回false，调用方缓存的数据已过期，应改为重新检索
+    bool touch(uint64_t timestamp, uint16_t x, uint16_t y, uint64_t generation = 0);
+    
+    // 读取缓存项但不更新LRU顺序与命中统计（供预取等后台任务使用）；generation非空时给出缓存项的写入代次
+    bool peek(uint64_t timestamp, uint16_t x, uint16_t y,
+              std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec = nullptr,
+              uint64_t* generation = nullptr) const;
+    
+    // 将缓存内容（含LRU顺序）写入单个快照文件；未被访问过的旧快照条目一并保留。
+    // 只在收集块引用时短暂持有cache_mutex_，排序与写文件在锁外进行
+    void saveSnapshot(const std::string& path);
+    
+    // 以mmap方式加载快照：只校验文件头，条目在未命中时按需二分查找并提升到内存
+    bool loadSnapshot(const std::string& path);
+    
+    // 按LRU顺序从快照中预热最近使用的至多max_items个块（可在后台线程调用）
+    size_t warmFromSnapshot(size_t max_items);
+    
+    // 查找缓存中严格晚于给定时间戳的下一个时间戳
+    bool nextTimestamp(uint64_t timestamp, uint64_t& next) const;
     
     // 获取缓存命中率
     double getHitRate() const;
     
+    // 获取统计信息（无锁，可供后台统计线程周期性采样）
+    Json::Value getStats() const;
+    
     // 获取统计信息JSON
     std::string getStatsAsJSON() const;
     
 private:
-    // 缓存项的键
-    struct CacheKey {
-        uint64_t timestamp;
-        uint16_t x;
-        uint16_t y;
-        
-        bool operator==(const CacheKey& other) const {
-            return timestamp == other.timestamp && x == other.x && y == other.y;
-        }
-    };
-    
-    // 哈希函数
-    struct CacheKeyHash {
-        std::size_t operator()(const CacheKey& key) const {
-            return (key.timestamp << 32) | (key.x << 16) | key.y;
-        }
-    };
-    
     // 解析压缩数据并插入缓存
     void parseAndInsertPacket(const uint8_t* data, size_t size);
     
-    // 从缓存中移除最旧的项
+    // 在已持有cache_mutex_时查找并更新LRU，返回缓存项指针（未命中为nullptr）
+    BEVCacheItem* touchLocked(const CacheKey& key);
+    
+    // 在已持有cache_mutex_时插入缓存项（替换同键旧项，必要时淘汰）
+    // （owner非空时data位于owner之内，新建的块数据引用owner而不拷贝）
+    void insertItemLocked(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                          const uint8_t* data, size_t size,
+                          const std::shared_ptr<const std::vector<uint8_t>>& owner = nullptr);
+    // 解析压缩流并逐块插入（调用时持有cache_mutex_）
+    void insertStreamLocked(const std::vector<uint8_t>& compressed_data,
+                            const std::shared_ptr<const std::vector<uint8_t>>& owner);
+    
+    // 在已持有cache_mutex_时按内容查找或新建块数据并增加引用
+    BEVBlockPayload* acquirePayloadLocked(const uint8_t* data, size_t size,
+                                          const std::shared_ptr<const std::vector<uint8_t>>& owner);
+    // 在已持有cache_mutex_时减少引用，降为0时释放；take非空时先把数据取出（最后一个引用时直接移动）
+    void releasePayloadLocked(BEVBlockPayload* payload, std::vector<uint8_t>* take = nullptr);
+    // 在已持有cache_mutex_时释放引用已降为0的块数据
+    void freePayloadLocked(BEVBlockPayload* payload);
+    // 在已持有cache_mutex_时把共享缓冲区中仍存活的块拷贝为自有数据，不再引用该缓冲区
+    void compactSharedBufferLocked(const void* buffer);
+    
+    // 是否需要淘汰以腾出空间
+    bool overCapacityLocked() const;
+    
+    // 依次查询磁盘二级缓存与快照，命中后提升回内存（调用时不得持有cache_mutex_）
+    bool fetchFromLowerTiers(const CacheKey& key, std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols,
+                             BEVBlockCodec& codec);
+    bool hasLowerTiers() const;
+    
+    // 同键新块插入时，使内容或编码方式不同的快照条目失效，淘汰后不会再取回旧数据
+    void supersedeSnapshotEntry(const CacheKey& key, const BEVBlockCodec& codec, const uint8_t* data,
+                                size_t size) const;
+    
+    // 在已映射的快照中查找（只读，无需cache_mutex_）
+    bool fetchFromSnapshot(const CacheKey& key, std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols,
+                           BEVBlockCodec& codec) const;
+    
+    // 从缓存中移除最旧的项（金字塔各层按折算后的空闲时长比较）
     void evictOldestItem();
     
+    // 缓存块移除后更新时间戳索引
+    void releaseTimestamp(uint64_t timestamp);
+    
     // 内存池分配器
     std::shared_ptr<MemoryPool> memory_pool_;
     
+    // 磁盘二级缓存（可为空）
+    std::shared_ptr<DiskBlockStore> disk_tier_;
+    
+    // 整帧/区域解码的线程池（可为空）
+    std::shared_ptr<WorkerPool> decode_pool_;
+    
+    // 已映射的快照（可为空，通过std::atomic_load/atomic_store访问）
+    struct MappedSnapshot;
+    std::shared_ptr<const MappedSnapshot> snapshot_;
+    std::string snapshot_path_;
+    bool snapshot_on_shutdown_;
+    
     // 缓存存储
     std::unordered_map<CacheKey, BEVCacheItem, CacheKeyHash> cache_map_;
     
-    // LRU链表（最近使用的在尾部）
-    std::list<uint64_t> lru_list_;
+    // 各金字塔层的LRU链表（最近使用的在尾部），淘汰时比较各层链表头的折算空闲时长
+    std::array<std::list<CacheKey>, BEVCompressor::MAX_PYRAMID_LEVELS> lru_lists_;
+    std::array<double, BEVCompressor::MAX_PYRAMID_LEVELS> level_retention_;
+    uint64_t access_clock_ = 0;                 // 逻辑时钟：每次插入或命中加一
+    uint64_t generation_clock_ = 0;             // 写入代次计数：每次插入缓存项加一
+    
+    // 时间戳索引（时间戳 -> 该时间戳下的缓存块数），用于顺序访问预测
+    std::map<uint64_t, uint32_t> timestamp_index_;
+    
+    // 去重存储：内容哈希 -> 块数据（哈希冲突时同一哈希下有多份不同内容）
+    std::unordered_multimap<uint64_t, std::unique_ptr<BEVBlockPayload>> payloads_;
+    
+    // 零拷贝插入的批次缓冲区：仍被块数据引用的缓冲区及其存活情况
+    struct SharedBuffer {
+        size_t size = 0;                          // 缓冲区总字节数
+        size_t initial_bytes = 0;                 // 插入时引用的块数据字节数
+        size_t live_bytes = 0;                    // 仍存活的块数据字节数
+        std::unordered_set<BEVBlockPayload*> payloads; // 引用该缓冲区的块数据
+    };
+    std::unordered_map<const void*, SharedBuffer> shared_buffers_;
     
     // 缓存配置
     size_t max_cache_size_;
+    size_t max_cache_bytes_;
+    bool dedup_;
     
-    // 统计信息
-    mutable std::mutex stats_mutex_;
-    uint64_t total_hits_ = 0;
-    uint64_t total_misses_ = 0;
+    // 统计信息（原子计数，读取统计时不加锁）
+    std::atomic<uint64_t> total_hits_{0};
+    std::atomic<uint64_t> total_misses_{0};
+    std::atomic<uint64_t> total_evictions_{0};
+    std::atomic<uint64_t> disk_tier_hits_{0};
+    std::atomic<uint64_t> snapshot_hits_{0};
+    std::atomic<uint64_t> decode_errors_{0};   // 整帧/区域检索中解码失败（按未命中处理）的块数
+    std::atomic<size_t> cache_items_{0};
+    std::atomic<uint64_t> logical_bytes_{0};   // 所有缓存项的块数据字节数之和（去重前）
+    std::atomic<uint64_t> stored_bytes_{0};    // 去重后实际存储的字节数
+    std::atomic<uint64_t> unique_payloads_{0}; // 去重后的块数据份数
+    std::atomic<uint64_t> dedup_hits_{0};      // 插入时复用已有数据的次数
+    std::atomic<uint64_t> shared_payloads_{0}; // 引用共享批次缓冲区（零拷贝插入）的块数据份数
+    std::atomic<uint64_t> pinned_bytes_{0};    // 共享缓冲区中不属于存活块数据、但因缓冲区未释放而占用的字节数
+    std::atomic<uint64_t> compacted_buffers_{0}; // 拷出存活块后释放的共享缓冲区数
     
     // 互斥锁
     mutable std::mutex cache_mutex_;
@@ -1,34 +1,319 @@
 #pragma once
 #include <eigen3/Eigen/Dense>
+#include <json/json.h>
 #include <vector>
 #include <memory>
 #include "BEVData.h"
+#include "tiled_feature.h"
 #include <filesystem>
+#include <limits>
+
+class WorkerPool;
+class CompressedStreamView;
 
 class BEVCompressor {
 public:
     struct Config {
         int block_size = 16;          // 分块大小
         float compression_ratio = 5.0f; // 目标压缩比
-        bool lossless = false;        // 无损模式开关
-        const int ZFP_MODE_LOSSLESS = 0;  // 无损模式
-        const int ZFP_MODE_DEFAULT = 1;   // 默认（有损）模式
+        bool lossless = false;        // 无损模式：按lossless_codec逐位精确编码，忽略码率与误差上限
+        int lossless_codec = LOSSLESS_ZFP;  // 无损编码方式
+        bool fixed_kernels = true;    // 块大小为4/8/16/32时，整块走编译期特化的内核
+        bool verify = false;          // 校验模式：每块压缩后立即解码，统计重建误差
+        float error_bound = 0.0f;     // 块最大绝对误差上限：>0且开启校验时，超限块提高码率重新编码
+        int verify_interval = 1;      // 影子模式（error_bound为0）下每N个块校验一个，降低在线开销
+        int pyramid_levels = 1;       // 金字塔层数（含原始分辨率）：>1时每帧之后追加逐级2倍降采样的粗层
+        bool pyramid_max_pooling = false;  // 降采样取2x2最大值（占据栅格），否则取平均
+        static constexpr int ZFP_MODE_LOSSLESS = 0;  // ZFP可逆模式（无损）
+        static constexpr int ZFP_MODE_DEFAULT = 1;   // ZFP固定码率（有损）
+        static constexpr int LOSSLESS_ZFP = 0;       // ZFP可逆模式
+        static constexpr int LOSSLESS_SHUFFLE = 1;   // 异或差分+字节平面重排+LZ（见lossless_codec.h）
+    };
+
+    // 参数文件（params.json）：{"compressor": {"block_size", "compression_ratio", "lossless",
+    // "lossless_codec"（"zfp"或"shuffle"）, "fixed_kernels", "verify", "error_bound", "verify_interval",
+    // "pyramid_levels", "pyramid_max_pooling"}}，
+    // 缺省的字段取Config默认值；文件无法读取、格式错误或参数无效时抛出异常
+    static Config load_config(const std::string& path);
+    static Config config_from_json(const Json::Value& json);
+    static Json::Value config_to_json(const Config& config);
+
+    // 压缩流格式（小端）：
+    //   流头：uint32 magic, uint16 version, uint8 codec, uint8 pyramid_levels, float rate, uint32 num_packets
+    //   帧头：uint64 timestamp, uint32 rows, uint32 cols, uint32 nums_block
+    //   块头：uint32 row_offset, uint32 col_offset, uint32 block_rows, uint32 block_cols,
+    //         uint32 compressed_size，其后紧跟压缩数据
+    //   CODEC_ZFP_BLOCK_RATE流的块数据首字节为码率提升级数k，该块码率为escalated_rate(rate, k)
+    //   无损流（CODEC_ZFP_REVERSIBLE/CODEC_SHUFFLE_LZ）的块大小随数据变化，流头的rate不参与解码
+    //   pyramid_levels为L（>1）时每帧依次写出第0..L-1层共L条帧记录（时间戳相同，第k层尺寸为
+    //   原始尺寸除以2^k向上取整），num_packets为帧记录总数，第r条记录的层级为r % L；
+    //   pyramid_levels为0或1表示只有原始分辨率
+    static constexpr uint32_t STREAM_MAGIC = 0x5A564542;  // "BEVZ"
+    static constexpr uint16_t STREAM_VERSION = 2;
+    static constexpr uint8_t CODEC_ZFP_RATE = 0;          // ZFP固定码率
+    static constexpr uint8_t CODEC_ZFP_BLOCK_RATE = 1;    // ZFP固定码率，超出误差上限的块单独提高码率
+    static constexpr uint8_t CODEC_ZFP_REVERSIBLE = 2;    // ZFP可逆模式（无损）
+    static constexpr uint8_t CODEC_SHUFFLE_LZ = 3;        // 字节平面重排+LZ（无损）
+    static constexpr float MAX_BLOCK_RATE = 32.0f;        // 块码率上限（与原始float位宽相同）
+    static constexpr int MAX_PYRAMID_LEVELS = 8;
+    static constexpr size_t STREAM_HEADER_BYTES = 16;
+    static constexpr size_t FRAME_HEADER_BYTES = 20;
+    static constexpr size_t BLOCK_HEADER_BYTES = 20;
+
+    struct StreamHeader {
+        uint16_t version;
+        uint8_t codec;
+        uint8_t pyramid_levels;   // 每帧的层数（至少为1）
+        float rate;
+        uint32_t num_packets;     // 帧记录数（金字塔流中含各粗层）
+
+        int level_of(uint32_t record) const { return static_cast<int>(record % pyramid_levels); }
+        BEVBlockCodec block_codec() const { return BEVBlockCodec{codec, rate}; }
+    };
+
+    struct FrameHeader {
+        uint64_t timestamp;
+        uint32_t rows;
+        uint32_t cols;
+        uint32_t nums_block;
+    };
+
+    struct BlockHeader {
+        uint32_t row_offset;
+        uint32_t col_offset;
+        uint32_t block_rows;
+        uint32_t block_cols;
+        uint32_t compressed_size;
+    };
+
+    // 解析流/帧/块头并前移ptr；数据不完整或格式不符时抛出异常
+    // （read_block_header同时校验块数据完整且块位于帧范围内）
+    static StreamHeader read_stream_header(const uint8_t*& ptr, const uint8_t* end);
+    static FrameHeader read_frame_header(const uint8_t*& ptr, const uint8_t* end);
+    static BlockHeader read_block_header(const uint8_t*& ptr, const uint8_t* end, const FrameHeader& frame);
+
+    // 第level级提升后的码率：基础码率逐级翻倍，不超过MAX_BLOCK_RATE
+    static double escalated_rate(double rate, int level);
+
+    // 重建质量统计（块/帧/整个运行期间共用）
+    struct QualityStats {
+        uint64_t blocks = 0;              // 已校验的块数
+        uint64_t values = 0;              // 已校验的数值个数
+        uint64_t reencoded_blocks = 0;    // 因超出误差上限而提高码率重新编码的块数
+        uint64_t unresolved_blocks = 0;   // 码率升至上限仍超出误差上限的块数
+        double max_abs_error = 0.0;
+        double sum_squared_error = 0.0;
+        float value_min = std::numeric_limits<float>::max();     // 已校验原始数据的取值范围，
+        float value_max = std::numeric_limits<float>::lowest();  // 作为PSNR的峰值
+
+        double rmse() const;
+        // 以取值范围为峰值的PSNR（dB），无误差时为无穷大
+        double psnr_db() const;
+        void merge(const QualityStats& other);
+        Json::Value to_json() const;
     };
 
     explicit BEVCompressor(const Config& config);
+
+    const Config& get_config() const { return config_; }
+
+    // 构造时是否为当前block_size选中了固定尺寸内核（否则所有块走通用路径）
+    bool has_fixed_kernel() const { return kernel_ != nullptr; }
+
+    // 指定工作线程池后，compress按块行、decompress按块在池中并行：每帧只交给一个节点的线程，
+    // 输出与串行路径逐字节一致；为空时串行
+    void set_worker_pool(std::shared_ptr<WorkerPool> pool) { pool_ = std::move(pool); }
+    const std::shared_ptr<WorkerPool>& worker_pool() const { return pool_; }
+
+    // 校验模式下最近一次compress各帧的重建质量（与输入帧一一对应；未开启校验时为空）
+    const std::vector<QualityStats>& last_frame_quality() const { return frame_quality_; }
+    // 校验模式下本压缩器累计的重建质量
+    const QualityStats& run_quality() const { return run_quality_; }
     
     // 压缩接口：输入Eigen矩阵，输出压缩后的字节流
     std::vector<uint8_t> compress(const std::vector<BEVFeaturePacket>& matrix);
     
-    // 解压接口：输入字节流，输出Eigen矩阵
+    // 解压接口：输入字节流，输出Eigen矩阵（金字塔流只解码原始分辨率层）
     std::vector<BEVFeaturePacket> decompress(const std::vector<uint8_t>& compressed);
 
+    // 解码每帧第level层中[row, row+rows) x [col, col+cols)的区域（层内坐标，超出帧的部分被裁掉），
+    // 只解码与区域相交的块，其余块直接跳过；流中没有该层时抛出异常
+    std::vector<BEVFeaturePacket> decompress_region(const std::vector<uint8_t>& compressed, int level,
+                                                    int row, int col, int rows, int cols);
+    // 解码每帧的第level层
+    std::vector<BEVFeaturePacket> decompress_level(const std::vector<uint8_t>& compressed, int level);
+
+    // 2x2降采样（SIMD），奇数行/列的末尾按复制边缘处理
+    static Eigen::MatrixXf downsample(const Eigen::Ref<const Eigen::MatrixXf>& input, bool max_pooling);
+    // 第level层的尺寸
+    static int level_extent(int extent, int level) { return (extent + (1 << level) - 1) >> level; }
+
+    // 压缩分块存储的帧：输出格式与compress相同，每个块直接在其连续内存上压缩
+    // （块大小须与配置的block_size一致）
+    std::vector<uint8_t> compress(const std::vector<TiledFeaturePacket>& packets);
+
+    // 解压为分块存储：每个块直接解压到目标块的连续内存
+    std::vector<TiledFeaturePacket> decompress_tiled(const std::vector<uint8_t>& compressed);
+
+    // 本压缩器写出的块的编码方式（与compress写入流头的codec、rate相同）
+    BEVBlockCodec block_codec() const { return BEVBlockCodec{stream_codec(), config_.compression_ratio}; }
+
+    // 按本压缩器的配置解压单个块（size为压缩数据字节数，block需预先设置为块尺寸）；
+    // 块来自其他配置的写入方时应改用decode_block(BEVBlockCodec, ...)
+    void decompress_block(const uint8_t* data, size_t size, Eigen::Ref<Eigen::MatrixXf> block) const;
+    // 按流的编码方式解码单个块（CODEC_ZFP_BLOCK_RATE的码率前缀须已去掉，rate为该块的码率）
+    void decode_block(uint8_t codec, const uint8_t* data, size_t size, Eigen::Ref<Eigen::MatrixXf> block,
+                      double rate) const;
+    // 按块记录中原样保存的数据解码（codec取自块所属的流，码率前缀在此取出）
+    void decode_block(const BEVBlockCodec& codec, const uint8_t* data, size_t size,
+                      Eigen::Ref<Eigen::MatrixXf> block) const;
+
+    // 渐进式压缩单帧：每个块编码为基础层+若干细化层，第k层编码前k层重建结果的残差，
+    // 码率由layer_rates依次给出。数据按层优先排列，包含完整基础层的前缀都能解码出完整的低精度帧。
+    // 各层总以固定码率ZFP编码（与本压缩器的lossless配置无关），编码方式写入流头
+    std::vector<uint8_t> compress_progressive(const BEVFeaturePacket& packet,
+                                              const std::vector<float>& layer_rates);
+
+    // 不超过byte_budget的最长完整层前缀长度（按流头的layer_end在层边界截断，避免发送只覆盖部分块的残层）；
+    // 基础层都放不下时返回0，流头损坏时抛出异常
+    static size_t progressive_truncate_size(const std::vector<uint8_t>& stream, size_t byte_budget);
+
+    // 固定尺寸内核（实现见compressor.cpp）：整块拷贝到编译期尺寸的连续矩阵，
+    // 复用每线程的ZFP字段与流对象，码率不变时不重新设置流参数
+    struct BlockKernel {
+        int block_size;
+        // 压缩整块，压缩数据追加到out末尾，返回压缩字节数
+        size_t (*compress)(const float* src, Eigen::Index outer_stride, double rate, int mode,
+                           std::vector<uint8_t>& out);
+        // 把整块解压到dst（列主序，外层步长outer_stride），失败时抛出异常
+        void (*decompress)(const uint8_t* data, size_t size, float* dst, Eigen::Index outer_stride,
+                           double rate, int mode);
+    };
+
 private:
     Config config_;
+    const BlockKernel* kernel_ = nullptr;   // 构造时按block_size从分派表中选定
+    std::vector<QualityStats> frame_quality_;
+    QualityStats run_quality_;
+    uint64_t verify_counter_ = 0;           // 影子模式抽样计数
+    std::shared_ptr<WorkerPool> pool_;
     
-    // 压缩单个Eigen块
-    std::vector<uint8_t> compress_block(const Eigen::Ref<const Eigen::MatrixXf>& block);
-    
-    // 解压单个块到Eigen矩阵
-    void decompress_block(const uint8_t* data, Eigen::Ref<Eigen::MatrixXf> block);
+    // 压缩单个Eigen块（通用路径），mode为ZFP模式（Config::ZFP_MODE_*）
+    std::vector<uint8_t> compress_block(const Eigen::Ref<const Eigen::MatrixXf>& block, double rate, int mode);
+
+    // 压缩一个块并连同块头追加到out：整块优先走固定尺寸内核，直接写入out。
+    // quality非空时按校验配置解码核对，必要时提高码率重新编码；影子模式的抽样计数默认为verify_counter_
+    void append_compressed_block(std::vector<uint8_t>& out, const Eigen::Ref<const Eigen::MatrixXf>& block,
+                                 int i, int j, double rate, QualityStats* quality = nullptr,
+                                 uint64_t* sample_counter = nullptr);
+
+    // 把块数据压缩追加到out末尾，返回压缩字节数
+    size_t encode_block(std::vector<uint8_t>& out, const Eigen::Ref<const Eigen::MatrixXf>& block, double rate);
+
+    // 每个块数据是否带码率提升级数前缀（无损模式没有误差，不提升码率）
+    bool block_rate_codec() const { return !config_.lossless && config_.verify && config_.error_bound > 0; }
+    uint8_t stream_codec() const {
+        if (config_.lossless) {
+            return config_.lossless_codec == Config::LOSSLESS_SHUFFLE ? CODEC_SHUFFLE_LZ : CODEC_ZFP_REVERSIBLE;
+        }
+        return block_rate_codec() ? CODEC_ZFP_BLOCK_RATE : CODEC_ZFP_RATE;
+    }
+    // ZFP解码单个块（mode为Config::ZFP_MODE_*）
+    void decompress_zfp(const uint8_t* data, size_t size, Eigen::Ref<Eigen::MatrixXf> block, double rate,
+                        int mode) const;
+    // 压缩[row_begin, row_end)行中的所有块（行号为块大小的整数倍）追加到out
+    void append_block_rows(std::vector<uint8_t>& out, const Eigen::Ref<const Eigen::MatrixXf>& matrix,
+                           int row_begin, int row_end, QualityStats* quality, uint64_t& sample_counter);
+    // 写入一条帧记录（帧头+所有块）
+    void append_frame(std::vector<uint8_t>& out, uint64_t timestamp, const Eigen::Ref<const Eigen::MatrixXf>& matrix,
+                      QualityStats* quality);
+    // 在原始分辨率帧之后追加各粗层
+    void append_pyramid(std::vector<uint8_t>& out, uint64_t timestamp, const Eigen::Ref<const Eigen::MatrixXf>& matrix);
+    // 在工作线程池中解码视图中剩余的所有原始分辨率帧
+    void decompress_parallel(CompressedStreamView& view, std::vector<BEVFeaturePacket>& packets);
+    // 流级统计：汇入本帧质量并写入运行指标
+    void finish_frame_quality(const QualityStats& frame);
+
+    int zfp_mode() const { return config_.lossless ? Config::ZFP_MODE_LOSSLESS : Config::ZFP_MODE_DEFAULT; }
+};
+
+// 压缩流的只读视图：构造时解析并校验流头，之后按顺序遍历帧记录与每帧的块记录。
+// 头部逐字段按小端拷贝读出（不依赖对齐），块数据以指针+偏移直接引用底层缓冲区，不拷贝；
+// 视图不持有缓冲区，使用期间缓冲区须保持有效。当前帧的块未读完就调用next_frame时，
+// 剩余的块只校验头部后跳过。数据不完整或格式不符时抛出异常（与read_*_header相同）。
+class CompressedStreamView {
+public:
+    struct Frame {
+        BEVCompressor::FrameHeader header;
+        uint32_t record = 0;          // 帧记录序号
+        int level = 0;                // 金字塔层级
+        size_t offset = 0;            // 帧头在缓冲区中的偏移
+    };
+
+    struct Block {
+        BEVCompressor::BlockHeader header;
+        const uint8_t* data = nullptr;  // 块数据（header.compressed_size字节）
+        size_t offset = 0;              // 块数据在缓冲区中的偏移
+        uint32_t index = 0;             // 帧内序号
+    };
+
+    CompressedStreamView(const uint8_t* data, size_t size);
+    explicit CompressedStreamView(const std::vector<uint8_t>& buffer)
+        : CompressedStreamView(buffer.data(), buffer.size()) {}
+
+    const BEVCompressor::StreamHeader& header() const { return stream_; }
+    // 原始分辨率帧数（不含金字塔粗层）
+    uint32_t num_frames() const { return stream_.num_packets / stream_.pyramid_levels; }
+
+    // 前进到下一条帧记录，全部帧记录已读完时返回false
+    bool next_frame(Frame& frame);
+    // 读取当前帧的下一个块，当前帧的块已读完时返回false
+    bool next_block(Block& block);
+
+    // 已解析到的位置（相对缓冲区起点的字节数）
+    size_t position() const { return static_cast<size_t>(ptr_ - begin_); }
+
+private:
+    const uint8_t* begin_;
+    const uint8_t* ptr_;
+    const uint8_t* end_;
+    BEVCompressor::StreamHeader stream_;
+    BEVCompressor::FrameHeader frame_{};
+    uint32_t next_record_ = 0;
+    uint32_t next_block_ = 0;
+};
+
+// 渐进式流的增量解码器：数据可以分多次到达，每次feed后解码所有已完整到达的块记录，
+// 后续细化层的残差直接累加到当前帧上，实现原地细化
+class ProgressiveDecoder {
+public:
+    explicit ProgressiveDecoder(const BEVCompressor& compressor);
+
+    // 追加收到的字节，返回本次新解码的块记录数
+    size_t feed(const uint8_t* data, size_t size);
+
+    // 当前重建的帧（流头到达之前为空矩阵）
+    const BEVFeaturePacket& frame() const { return frame_; }
+
+    bool header_ready() const { return header_ready_; }
+    int num_layers() const { return static_cast<int>(layer_rates_.size()); }
+    // 已完整解码的层数
+    int layers_complete() const { return layer_; }
+
+    void reset();
+
+private:
+    bool parse_header();
+
+    const BEVCompressor& compressor_;
+    std::vector<uint8_t> buffer_;   // 尚未消费的字节
+    size_t consumed_ = 0;           // buffer_中已消费的字节数
+    bool header_ready_ = false;
+    BEVFeaturePacket frame_;
+    int block_size_ = 0;
+    uint8_t codec_ = 0;             // 流头记录的各层编码方式
+    std::vector<float> layer_rates_;
+    int layer_ = 0;                 // 当前正在解码的层
+    size_t block_index_ = 0;        // 当前层内下一个块的序号
+    Eigen::MatrixXf tile_;          // 解码临时块
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+#include "BEVData.h"
+#include <json/json.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 磁盘二级缓存：保存从BEVCache淘汰的压缩块
+// 日志结构存储：块追加写入固定大小上限的段文件（segment_<id>.log），内存中只保留
+// 紧凑索引（帧 -> 编码方式、帧范围与按网格排列的块位置）。写入由后台线程异步完成，尚未落盘的块
+// 同样可以被检索。超过总大小或存活时间的最旧段整体删除（GC）。启动时扫描已有
+// 段文件重建索引，进程重启后历史数据仍然可用。设置了存活时间时，后台线程空闲时也会
+// 定期检查并删除过期段，不依赖新段的创建。
+class DiskBlockStore {
+public:
+    struct Config {
+        std::string directory = "bev_l2";            // 段文件目录
+        size_t segment_bytes = 64ull << 20;          // 单段大小上限
+        size_t max_total_bytes = 4ull << 30;         // 所有段的总大小上限
+        uint64_t max_age_seconds = 0;                // 段最长保留时间（0为不限）
+        uint32_t gc_interval_ms = 1000;              // 设置了max_age_seconds时按时间GC的检查间隔
+        size_t max_pending_writes = 4096;            // 待写入队列上限，超出时丢弃最旧的待写块
+        bool recover_existing = true;                // 启动时是否加载已有段文件
+    };
+
+    explicit DiskBlockStore(const Config& config);
+    ~DiskBlockStore();
+
+    DiskBlockStore(const DiskBlockStore&) = delete;
+    DiskBlockStore& operator=(const DiskBlockStore&) = delete;
+
+    // 异步写入一个压缩块（不阻塞调用方），编码方式随块一起保存
+    void put(const BEVBlockKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+             std::vector<uint8_t>&& data);
+
+    // 检索一个压缩块（先查待写队列，再读段文件），codec非空时同时给出块的编码方式
+    bool get(const BEVBlockKey& key, std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols,
+             BEVBlockCodec* codec = nullptr);
+
+    // 阻塞直到待写队列清空
+    void flush();
+
+    // 按大小/时间删除最旧的段（当前写入段过期时先切换到新段再删除）
+    void collectGarbage();
+
+    Json::Value getStats() const;
+
+private:
+    // 段内记录头（紧随其后是压缩数据）
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t size;
+        uint64_t timestamp;
+        uint16_t x;
+        uint16_t y;
+        uint16_t rows;
+        uint16_t cols;
+        float rate;
+        uint8_t codec;
+        uint8_t level;
+        uint8_t reserved[2];
+    };
+
+    // 索引按帧（时间戳+金字塔层级）分组
+    struct FrameKey {
+        uint64_t timestamp;
+        uint8_t level;
+        bool operator==(const FrameKey& other) const {
+            return timestamp == other.timestamp && level == other.level;
+        }
+    };
+    struct FrameKeyHash {
+        std::size_t operator()(const FrameKey& key) const {
+            return key.timestamp ^ (static_cast<std::size_t>(key.level) << 61);
+        }
+    };
+
+    // 块位置：索引中每块只保存这12字节
+    struct BlockLocation {
+        uint32_t segment;
+        uint32_t offset;   // 压缩数据在段内的偏移（不小于记录头大小，0表示网格该格没有块）
+        uint32_t size;
+    };
+
+    // 帧索引：编码方式与帧范围每帧只存一份，块位置按网格行优先排列，块的行列数由
+    // 帧范围与块大小推出。块偏移都是块大小的整数倍，网格间距取已见非零偏移的最大公约数，
+    // 只有先见到的块恰好间隔更大时才需要按更小的间距重排。实测100帧256x256、16x16块时
+    // 每块约12.5字节（含帧索引与哈希桶，见getStats的index_bytes；旧索引每块28字节另加
+    // 每帧一个vector）。只淘汰了少数块的帧，其网格空格子同样占12字节
+    struct FrameIndex {
+        BEVBlockCodec codec;
+        uint16_t cell = 0;          // 网格间距，0表示只见过(0,0)处的块
+        uint16_t block_extent = 0;  // 已见块的最大边长（见过任一完整块后即为块大小）
+        uint32_t rows = 0;          // 已见块覆盖的帧范围
+        uint32_t cols = 0;
+        uint32_t blocks = 0;        // 已索引的块数
+        std::vector<BlockLocation> grid;
+    };
+
+    // 段文件描述符：检索在index_mutex_之外读取时持有引用，GC删除段后最后一个引用释放时才关闭
+    struct SegmentFile {
+        int fd = -1;
+        explicit SegmentFile(int fd) : fd(fd) {}
+        ~SegmentFile();
+        SegmentFile(const SegmentFile&) = delete;
+        SegmentFile& operator=(const SegmentFile&) = delete;
+    };
+
+    struct Segment {
+        std::shared_ptr<SegmentFile> file;
+        uint64_t bytes = 0;
+        std::chrono::system_clock::time_point created;
+        std::vector<FrameKey> frames;  // 段内出现过的帧（GC时据此清理索引）
+    };
+
+    struct PendingBlock {
+        BEVBlockKey key;
+        uint16_t rows;
+        uint16_t cols;
+        BEVBlockCodec codec;
+        std::vector<uint8_t> data;
+    };
+
+    void writerLoop();
+    void appendLocked(const PendingBlock& block);
+    void indexBlockLocked(const FrameKey& key, uint16_t x, uint16_t y, uint16_t rows, uint16_t cols,
+                          const BEVBlockCodec& codec, const BlockLocation& location);
+    // 块在帧网格中的序号，不在网格上时返回-1
+    static long cellIndex(const FrameIndex& frame, uint16_t x, uint16_t y);
+    void openNewSegmentLocked();
+    void dropSegmentLocked(uint32_t id);
+    void recoverSegments();
+    std::string segmentPath(uint32_t id) const;
+
+    Config config_;
+
+    // 段与索引（index_mutex_保护）
+    mutable std::mutex index_mutex_;
+    std::map<uint32_t, Segment> segments_;
+    uint32_t current_segment_ = 0;
+    uint64_t total_bytes_ = 0;
+    std::unordered_map<FrameKey, FrameIndex, FrameKeyHash> index_;
+
+    // 待写队列（pending_mutex_保护）
+    mutable std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    std::condition_variable drained_cv_;
+    std::deque<std::shared_ptr<PendingBlock>> pending_;
+    std::unordered_map<BEVBlockKey, std::shared_ptr<PendingBlock>, BEVBlockKeyHash> pending_map_;
+    bool writing_ = false;
+    bool stop_ = false;
+
+    std::atomic<uint64_t> blocks_written_{0};
+    std::atomic<uint64_t> blocks_dropped_{0};
+    std::atomic<uint64_t> lookups_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> segments_collected_{0};
+    std::atomic<uint64_t> indexed_blocks_{0};
+
+    std::thread writer_;
+};
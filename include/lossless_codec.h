@@ -0,0 +1,28 @@
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 字节平面重排+LZ的无损块编码（不依赖ZFP）
+// float的符号/指数字节变化缓慢，尾数低位接近随机：先把每个值与块内前一个值（列主序）按位异或，
+// 相邻值相近时高位字节变为0；再把4个字节拆成4个字节平面（先放所有值的第0字节，依此类推），
+// 0字节与重复字节在平面内连成长串，最后用LZ77压缩。各块独立编码，可以单独解码。
+// 块数据格式：uint8 模式（0-原样存放重排后的字节平面，1-LZ压缩），其后为数据；
+// LZ压缩不变小时原样存放，最坏只多1字节。
+class ShuffleLZCodec {
+public:
+    static constexpr uint8_t MODE_STORED = 0;
+    static constexpr uint8_t MODE_LZ = 1;
+
+    // 把块编码追加到out末尾，返回编码字节数
+    static size_t encode(const Eigen::Ref<const Eigen::MatrixXf>& block, std::vector<uint8_t>& out);
+    // 解码到block（需预先设置为块尺寸），数据损坏或长度不符时抛出异常
+    static void decode(const uint8_t* data, size_t size, Eigen::Ref<Eigen::MatrixXf> block);
+
+    // LZ77（LZ4风格的序列：token高4位字面量长度、低4位匹配长度-4，长度15时以255累加扩展，
+    // 匹配偏移为uint16）：把src压缩追加到out末尾，返回压缩字节数
+    static size_t lz_compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+    // 解压出恰好size字节到dst，数据损坏时抛出异常
+    static void lz_decompress(const uint8_t* data, size_t data_size, uint8_t* dst, size_t size);
+};
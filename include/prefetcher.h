@@ -0,0 +1,91 @@
+#pragma once
+#include "cache_system.h"
+#include "compressor.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// 预测式预取器
+// 识别按时间顺序前进的访问与同一帧内沿固定方向移动的块访问，
+// 在后台线程中从BEVCache读取预测的下一批块并提前解码到解码缓冲区，
+// 命中时调用方无需再同步读取和解压。
+class BEVPrefetcher {
+public:
+    struct Config {
+        size_t max_decoded_blocks = 512;  // 解码缓冲区容量（块数）
+        size_t max_pending_requests = 256; // 预取请求队列上限
+        int lookahead_frames = 2;         // 时间方向预取的帧数
+        int min_confidence = 2;           // 连续顺序访问达到该次数后才开始时间方向预取
+        bool prefetch_neighbors = true;   // 是否沿移动方向预取空间相邻块
+        int block_size = 16;              // 块边长，用于计算相邻块坐标
+    };
+
+    struct Stats {
+        uint64_t issued = 0;           // 已解码进入缓冲区的预取块数
+        uint64_t useful = 0;           // 被实际读取的预取块数
+        uint64_t wasted = 0;           // 未被读取即被淘汰、或读取时缓存中的块已被淘汰或替换的预取块数
+        uint64_t demand_fetches = 0;   // 同步读取解码的次数（预取未命中）
+        double accuracy = 0.0;         // 预取准确率 useful / (useful + wasted)
+        double latency_saved_ms = 0.0; // 估计节省的同步读取解码时间
+    };
+
+    BEVPrefetcher(BEVCache& cache, const BEVCompressor& compressor, const Config& config);
+    ~BEVPrefetcher();
+
+    BEVPrefetcher(const BEVPrefetcher&) = delete;
+    BEVPrefetcher& operator=(const BEVPrefetcher&) = delete;
+
+    // 获取解码后的块：优先从解码缓冲区读取，否则同步检索并解码
+    bool get(uint64_t timestamp, uint16_t x, uint16_t y, Eigen::MatrixXf& block);
+
+    Stats getStats() const;
+
+private:
+    using Key = BEVCache::CacheKey;
+    using KeyHash = BEVCache::CacheKeyHash;
+
+    struct DecodedBlock {
+        Eigen::MatrixXf data;
+        uint64_t generation = 0;  // 解码时缓存项的写入代次，交出前据此确认缓存中仍是同一份数据
+    };
+
+    // 根据本次访问更新访问模式并发出预取请求
+    void observe(const Key& key);
+    void enqueue(const Key& key);
+    void workerLoop();
+    bool fetchAndDecode(const Key& key, Eigen::MatrixXf& block, bool demand, uint64_t* generation = nullptr);
+
+    BEVCache& cache_;
+    const BEVCompressor& compressor_;
+    Config config_;
+
+    // 访问模式（仅在get中、持有pattern_mutex_时访问）
+    std::mutex pattern_mutex_;
+    bool has_last_ = false;
+    Key last_key_{0, 0, 0};
+    int sequential_count_ = 0;
+
+    // 解码缓冲区（FIFO淘汰）
+    mutable std::mutex buffer_mutex_;
+    std::unordered_map<Key, DecodedBlock, KeyHash> decoded_;
+    std::deque<Key> decoded_order_;
+
+    // 预取请求队列
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Key> pending_;
+    std::unordered_set<Key, KeyHash> pending_set_;
+    bool stop_ = false;
+
+    std::atomic<uint64_t> issued_{0};
+    std::atomic<uint64_t> useful_{0};
+    std::atomic<uint64_t> wasted_{0};
+    std::atomic<uint64_t> demand_fetches_{0};
+    std::atomic<double> fetch_cost_ms_{0.0};  // 单块同步读取+解码耗时的滑动平均
+
+    std::thread worker_;
+};
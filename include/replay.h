@@ -0,0 +1,81 @@
+#pragma once
+#include "cache_system.h"
+#include "compressor.h"
+#include "utils.h"
+#include <json/json.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 实时回放压测
+// 把录制或生成的多帧文件（save_multi_frames格式）按原始时间间隔（1x）、N倍速或不限速
+// 依次压缩并插入缓存，同时运行若干读线程模拟下游访问：
+//   LATEST          总是读取最新一帧（在线感知/规划）
+//   SLIDING_WINDOW  循环读取最近window_frames帧（时序融合）
+//   RANDOM_HISTORY  在已回放的全部帧中均匀随机读取（回溯查询，老帧可能已被淘汰）
+// 报告持续摄入速率、相对实时的滞后，以及各访问模式的整帧读取延迟分位数与块命中率，
+// 用于评估更多相机、更高帧率下的容量。
+class ReplayHarness {
+public:
+    enum class AccessPattern : uint8_t {
+        LATEST = 0,
+        SLIDING_WINDOW,
+        RANDOM_HISTORY,
+        COUNT
+    };
+    static constexpr size_t NUM_PATTERNS = static_cast<size_t>(AccessPattern::COUNT);
+
+    struct Config {
+        std::string input_path;                   // 多帧文件路径
+        double speed = 1.0;                       // 回放倍速，<=0表示不限速
+        uint32_t max_frames = 0;                  // 最多回放的帧数，0表示整个文件
+        BEVCompressor::Config compressor;
+        size_t cache_size = 4096;                 // 缓存块数
+        std::array<int, NUM_PATTERNS> reader_threads{{1, 1, 1}};  // 各访问模式的读线程数
+        uint32_t window_frames = 10;              // SLIDING_WINDOW的窗口帧数
+        uint32_t read_interval_us = 0;            // 读线程两次读取之间的间隔，0表示连续读取
+        uint64_t seed = 1;                        // RANDOM_HISTORY的随机种子
+    };
+
+    explicit ReplayHarness(const Config& config);
+
+    // 执行回放：阻塞到全部帧摄入完成、读线程退出，返回JSON报告
+    Json::Value run();
+
+    static const char* patternName(AccessPattern pattern);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // 已摄入帧的信息（下标小于ingested_的项对读线程可见）
+    struct FrameInfo {
+        uint64_t timestamp = 0;
+        uint32_t rows = 0;
+        uint32_t cols = 0;
+    };
+
+    // 单个访问模式的读取统计（各读线程本地累计，结束时合并）
+    struct ReaderStats {
+        uint64_t reads = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t blocks_hit = 0;
+        uint64_t blocks_missed = 0;
+        std::array<uint64_t, BEVMetrics::NUM_BUCKETS> buckets{};
+
+        void merge(const ReaderStats& other);
+    };
+
+    void readerLoop(AccessPattern pattern, int thread_index, BEVCache& cache, const BEVCompressor& compressor);
+
+    Config config_;
+    std::vector<FrameInfo> frames_;
+    std::atomic<uint32_t> ingested_{0};
+    std::atomic<bool> done_{false};
+
+    std::mutex stats_mutex_;
+    std::array<ReaderStats, NUM_PATTERNS> reader_stats_;
+};
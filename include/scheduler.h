@@ -0,0 +1,119 @@
+#pragma once
+#include "compressor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// 截止时间感知的压缩调度器
+// 每帧提交时记录截止时间（提交时刻 + 一个帧周期），工作线程根据剩余裕量
+// 选择压缩档位：裕量充足时正常压缩，不足时降低码率，已错过截止时间则退化为
+// 稀疏关键帧模式。待压缩队列有界，满时丢弃最旧帧，保证不给车端主循环引入无界延迟。
+// 正常档位的耗时估计只能由FULL帧更新：连续若干帧被降级后试探一次FULL，偶发的慢帧不会使估计永久偏高。
+// 降级档位固定为单层、有损、不校验的ZFP固定码率编码（无损、逐块提升码率与金字塔粗层都会抵消降码率的效果）。
+class CompressionScheduler {
+public:
+    // 压缩档位
+    enum class DegradeLevel : uint8_t {
+        FULL = 0,            // 正常码率
+        REDUCED_RATE = 1,    // 降低码率
+        KEY_FRAME_ONLY = 2   // 稀疏关键帧模式（降低码率，且非关键帧直接丢弃）
+    };
+
+    struct Config {
+        int target_fps = 25;               // 帧率，决定每帧的截止时间
+        size_t max_pending_frames = 4;     // 待压缩队列上限
+        float reduced_rate_scale = 0.5f;   // 降级档位的码率缩放系数
+        int key_frame_interval = 5;        // 关键帧模式下每N帧保留1帧
+        float cost_ewma_alpha = 0.2f;      // 压缩耗时估计的平滑系数
+        int full_probe_interval = 8;       // 连续N帧未以FULL压缩时，下一未迟到帧试探FULL（0为不试探）
+        BEVCompressor::Config compressor;  // 正常档位的压缩配置
+    };
+
+    // 单帧压缩结果
+    struct Result {
+        uint64_t timestamp;
+        DegradeLevel level;
+        float rate;                        // 实际使用的码率（解压时需使用compressorFor(level)）
+        bool late;                         // 是否错过截止时间
+        std::vector<uint8_t> data;
+    };
+
+    // 调度统计
+    struct Stats {
+        uint64_t submitted = 0;            // 提交帧数
+        uint64_t compressed = 0;           // 完成压缩的帧数
+        uint64_t late_frames = 0;          // 开始压缩时已错过截止时间的帧数
+        uint64_t degraded_frames = 0;      // 以非FULL档位压缩的帧数
+        uint64_t dropped_frames = 0;       // 被丢弃的帧数（队列溢出或非关键帧）
+        uint64_t failed_frames = 0;        // 压缩或结果回调抛出异常的帧数
+        double est_full_cost_ms = 0.0;     // 当前正常档位单帧耗时估计
+        double est_reduced_cost_ms = 0.0;  // 当前降级档位单帧耗时估计
+    };
+
+    using ResultCallback = std::function<void(Result&&)>;
+
+    CompressionScheduler(const Config& config, ResultCallback callback);
+    ~CompressionScheduler();
+
+    CompressionScheduler(const CompressionScheduler&) = delete;
+    CompressionScheduler& operator=(const CompressionScheduler&) = delete;
+
+    using Clock = std::chrono::steady_clock;
+
+    // 非阻塞提交（截止时间为提交时刻加一个帧周期）；队列已满时丢弃最旧的待压缩帧并返回false
+    bool submit(BEVFeaturePacket packet);
+    // 以指定的截止时间提交（如按传感器时间戳换算的截止时间）
+    bool submit(BEVFeaturePacket packet, Clock::time_point deadline);
+
+    // 阻塞直到所有已提交帧处理完毕
+    void flush();
+
+    Stats getStats() const;
+
+    // 获取与档位匹配的压缩器（解压降级帧时使用）
+    BEVCompressor& compressorFor(DegradeLevel level);
+
+private:
+    struct Job {
+        BEVFeaturePacket packet;
+        Clock::time_point deadline;
+    };
+
+    void workerLoop();
+    DegradeLevel chooseLevel(Clock::time_point now, Clock::time_point deadline) const;
+    void updateCostEstimate(std::atomic<double>& estimate, double cost_ms, bool replace);
+
+    Config config_;
+    Clock::duration frame_period_;
+    ResultCallback callback_;
+
+    BEVCompressor full_compressor_;
+    BEVCompressor reduced_compressor_;
+
+    std::deque<Job> pending_;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable idle_cv_;
+    bool busy_ = false;
+    bool stop_ = false;
+
+    uint64_t key_frame_counter_ = 0;       // 仅工作线程访问
+    int frames_since_full_ = 0;            // 连续未以FULL压缩的帧数（仅工作线程访问）
+
+    // 统计信息（无锁）
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> compressed_{0};
+    std::atomic<uint64_t> late_frames_{0};
+    std::atomic<uint64_t> degraded_frames_{0};
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> failed_frames_{0};
+    std::atomic<double> est_full_cost_ms_{0.0};
+    std::atomic<double> est_reduced_cost_ms_{0.0};
+
+    std::thread worker_;
+};
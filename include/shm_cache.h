@@ -0,0 +1,113 @@
+#pragma once
+#include "BEVData.h"
+#include "compressor.h"
+#include <json/json.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 跨进程共享内存的BEV块缓存
+// 训练数据加载、在线推理、日志记录等多个进程共用一份压缩块：写进程插入，读进程直接在映射的
+// 共享内存上读取（visit不拷贝），不经过IPC往返。整个缓存是一块连续区域（shm_open命名对象，
+// 或memfd_create匿名对象，经fork继承或传递fd共享），其中只存偏移量，不存指针，各进程可以映射到
+// 不同地址：
+//   区域头（进程间共享的读写锁、统计、空闲链表头）
+//   哈希桶 uint32[num_buckets]     链表头条目下标
+//   条目表 Entry[max_items]        块键、尺寸、编码方式、数据偏移、链表后继、CLOCK引用位
+//   页表   Page[num_pages]         slab页的尺寸类别、占用数、页内空闲链表
+//   数据区 num_pages × PAGE_SIZE   slab分配：每页切成同一尺寸类别（64B~64KB的2的幂）的块
+// 读操作持读锁（多个读者并行），读到的条目只置位CLOCK引用位（原子操作）；插入与淘汰持写锁。
+// 空间不足时按CLOCK算法淘汰：跳过并清除有引用位的条目，找到第一个无引用位的条目；它与待插入块
+// 尺寸类别相同（或只缺条目）时只淘汰它，否则淘汰它所在页的全部条目，使整页可供新的尺寸类别使用。
+// 进程在持锁期间崩溃会使锁无法释放（pthread读写锁没有robust属性），需重建区域。
+class SharedBEVCache {
+public:
+    using CacheKey = BEVBlockKey;
+
+    struct Config {
+        std::string name;                 // shm_open名称（如"/bev_cache"），为空时创建memfd匿名区域
+        size_t data_bytes = 64 << 20;     // 数据区大小（向上取整到整页）
+        uint32_t max_items = 65536;       // 条目容量
+        bool unlink_on_close = true;      // 创建者析构时删除命名对象（已映射的进程不受影响）
+    };
+
+    static constexpr uint32_t PAGE_SIZE = 64 * 1024;
+    static constexpr uint32_t MIN_CHUNK = 64;
+    static constexpr int NUM_CLASSES = 11;  // 64B, 128B, ..., 64KB
+
+    // 创建并初始化共享区域（命名对象已存在时抛出异常）
+    static std::unique_ptr<SharedBEVCache> create(const Config& config);
+    // 按名称映射已有区域
+    static std::unique_ptr<SharedBEVCache> open(const std::string& name);
+    // 映射继承或传入的文件描述符（memfd），fd由调用方负责关闭
+    static std::unique_ptr<SharedBEVCache> openFd(int fd);
+    // 删除命名对象
+    static void unlink(const std::string& name);
+
+    ~SharedBEVCache();
+    SharedBEVCache(const SharedBEVCache&) = delete;
+    SharedBEVCache& operator=(const SharedBEVCache&) = delete;
+
+    // 区域的文件描述符（memfd区域经fork继承后用openFd映射）
+    int fd() const { return fd_; }
+
+    // 插入压缩数据包的所有块（格式错误时抛出异常，已插入的块保留）；返回成功插入的块数，
+    // 单块超过最大尺寸类别或淘汰全部条目仍无法分配时跳过该块
+    size_t insertPackets(const std::vector<uint8_t>& compressed_data);
+    bool insert(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                const uint8_t* data, size_t size);
+
+    // 持读锁访问块数据（指向共享内存，不拷贝）：命中时调用fn并返回true，fn返回前数据保持有效；
+    // codec为块的编码方式（解码时传给BEVCompressor::decode_block）
+    using BlockVisitor = std::function<void(const uint8_t* data, size_t size, uint16_t rows, uint16_t cols,
+                                            const BEVBlockCodec& codec)>;
+    bool visit(const CacheKey& key, const BlockVisitor& fn);
+
+    // 拷贝出块数据（codec非空时同时给出块的编码方式）
+    bool retrieve(uint64_t timestamp, uint16_t x, uint16_t y,
+                  std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec = nullptr);
+
+    // 解码整帧（帧尺寸取frame的预设尺寸）：持读锁拷出命中的块，释放锁后按各块的编码方式解码；返回命中的块数，
+    // 未命中与解码失败（计入decode_errors）的块保持原值并加入misses
+    size_t retrieveFrame(uint64_t timestamp, const BEVCompressor& compressor,
+                         Eigen::MatrixXf& frame, std::vector<CacheKey>* misses = nullptr);
+
+    bool contains(const CacheKey& key);
+    size_t size() const;
+
+    Json::Value getStats() const;
+
+private:
+    struct Header;
+    struct Entry;
+    struct Page;
+
+    SharedBEVCache(int fd, void* base, size_t length, bool owner, std::string name, bool unlink_on_close);
+    static std::unique_ptr<SharedBEVCache> map(int fd, bool owner, const std::string& name, bool unlink_on_close);
+
+    // 以下均在持有写锁时调用（findLocked持读锁即可）
+    bool insertLocked(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                      const uint8_t* data, size_t size);
+    uint32_t findLocked(const CacheKey& key) const;
+    void removeLocked(uint32_t index);
+    bool evictLocked(int size_class);   // 为size_class腾出空间（-1表示只需空出条目）
+    void evictPageLocked(uint32_t page);
+    uint64_t allocateLocked(int size_class);
+    void freeLocked(uint64_t offset, int size_class);
+
+    Header* header() const { return header_; }
+    uint32_t* buckets() const;
+    Entry* entries() const;
+    Page* pages() const;
+    uint8_t* data() const;
+
+    int fd_;
+    void* base_;
+    size_t length_;
+    bool owner_;                        // 本进程创建了区域
+    std::string name_;
+    bool unlink_on_close_;
+    Header* header_;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <json/json.h>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 异步JSON统计日志
+// 采样线程按固定间隔调用各统计源生成一行JSON（NDJSON），通过无锁单生产者单消费者环形
+// 队列交给写线程落盘；写线程按文件大小轮转（path -> path.1 -> ... -> path.N）。
+// 队列满时丢弃本次快照并计数，采样与落盘都不会阻塞调用方的热路径。
+class StatsReporter {
+public:
+    struct Config {
+        std::string path = "bev_stats.jsonl";   // 日志文件路径
+        uint32_t interval_ms = 1000;            // 采样间隔
+        size_t max_file_bytes = 16 << 20;       // 单个文件上限，超出后轮转
+        int max_files = 5;                      // 保留的历史文件数
+        size_t queue_capacity = 64;             // 待写入快照的队列容量
+    };
+
+    // 统计源：返回当前统计的JSON，须线程安全且不长时间持锁
+    using Source = std::function<Json::Value()>;
+
+    explicit StatsReporter(const Config& config);
+    ~StatsReporter();
+
+    StatsReporter(const StatsReporter&) = delete;
+    StatsReporter& operator=(const StatsReporter&) = delete;
+
+    // 注册统计源（须在start()之前调用），输出中以name为键
+    void addSource(const std::string& name, Source source);
+
+    void start();
+    // 停止采样，写完队列中剩余的快照后返回
+    void stop();
+
+    // 请求立即采样一次（不阻塞，由采样线程执行）
+    void requestSnapshot();
+
+    uint64_t writtenSnapshots() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t droppedSnapshots() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // 无锁单生产者单消费者环形队列
+    class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity);
+        bool push(std::string&& line);
+        bool pop(std::string& line);
+    private:
+        std::vector<std::string> slots_;
+        alignas(64) std::atomic<size_t> head_{0};  // 消费者位置
+        alignas(64) std::atomic<size_t> tail_{0};  // 生产者位置
+    };
+
+    void samplerLoop();
+    void writerLoop();
+    std::string takeSnapshot();
+    void writeLine(const std::string& line);
+    void rotate();
+
+    Config config_;
+    std::vector<std::pair<std::string, Source>> sources_;
+    SpscQueue queue_;
+
+    std::ofstream file_;
+    size_t file_bytes_ = 0;
+    uint64_t sequence_ = 0;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> snapshot_requested_{false};
+    std::atomic<bool> sampler_done_{false};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    // 仅用于唤醒休眠线程，生产者不在持锁状态下通知
+    std::mutex sampler_wake_mutex_;
+    std::condition_variable sampler_wake_;
+    std::mutex writer_wake_mutex_;
+    std::condition_variable writer_wake_;
+
+    std::thread sampler_;
+    std::thread writer_;
+};
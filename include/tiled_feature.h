@@ -0,0 +1,59 @@
+#pragma once
+#include <eigen3/Eigen/Dense>
+#include <cstdint>
+#include <vector>
+
+// 分块存储的BEV特征图
+// MatrixXf按列主序存放，16x16块是跨步视图（每列之间相隔整幅图的行数），逐块压缩时
+// 每个块要跨越16个不连续的内存区域。TiledFeature把每个块存成一段连续内存（块内列主序，
+// 块按行优先顺序排列，与压缩流中块的顺序一致），压缩/解压可以直接在块上进行。
+// 边缘块按完整块大小分配，多余部分填0。
+class TiledFeature {
+public:
+    using TileMap = Eigen::Map<Eigen::MatrixXf, Eigen::Unaligned, Eigen::OuterStride<>>;
+    using ConstTileMap = Eigen::Map<const Eigen::MatrixXf, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+    TiledFeature() = default;
+    TiledFeature(int rows, int cols, int tile_size = 16);
+
+    // 与MatrixXf互相转换（按块并行，整块走固定尺寸的向量化拷贝）
+    static TiledFeature from_matrix(const Eigen::MatrixXf& matrix, int tile_size = 16);
+    void assign(const Eigen::MatrixXf& matrix);
+    void to_matrix(Eigen::MatrixXf& matrix) const;
+    Eigen::MatrixXf to_matrix() const;
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int tile_size() const { return tile_size_; }
+    int grid_rows() const { return grid_rows_; }
+    int grid_cols() const { return grid_cols_; }
+    int tile_count() const { return grid_rows_ * grid_cols_; }
+
+    // 第(ti, tj)个块的有效区域（边缘块尺寸小于tile_size）
+    int tile_rows(int ti) const { return std::min(tile_size_, rows_ - ti * tile_size_); }
+    int tile_cols(int tj) const { return std::min(tile_size_, cols_ - tj * tile_size_); }
+
+    TileMap tile(int ti, int tj);
+    ConstTileMap tile(int ti, int tj) const;
+
+    float* data() { return data_.data(); }
+    const float* data() const { return data_.data(); }
+
+private:
+    size_t tile_offset(int ti, int tj) const {
+        return (static_cast<size_t>(ti) * grid_cols_ + tj) * tile_size_ * tile_size_;
+    }
+
+    int rows_ = 0;
+    int cols_ = 0;
+    int tile_size_ = 16;
+    int grid_rows_ = 0;
+    int grid_cols_ = 0;
+    std::vector<float, Eigen::aligned_allocator<float>> data_;
+};
+
+// 分块存储的特征帧
+struct TiledFeaturePacket {
+    TiledFeature feature;
+    uint64_t timestamp = 0;
+};
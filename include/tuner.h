@@ -0,0 +1,58 @@
+#pragma once
+#include "compressor.h"
+#include <json/json.h>
+#include <string>
+#include <vector>
+
+// 压缩参数自动调优
+// 在样本帧上遍历 block_size × 码率 × 有损/无损 的组合，各组合由OpenMP线程并行评估
+// （耗时按线程CPU时间计，减少并行评估之间的相互干扰）。测量每帧压缩/解压耗时、压缩比与
+// 重建误差，标出Pareto最优的组合，并在延迟/误差约束下选出压缩比最高的一组参数，
+// 写成BEVCompressor::load_config可以直接加载的params.json。
+class CompressorTuner {
+public:
+    struct Options {
+        std::vector<int> block_sizes{4, 8, 16, 32};
+        std::vector<float> rates{2, 4, 6, 8, 12, 16, 24};  // 有损模式的码率（比特/值）
+        bool include_lossless = true;       // 同时评估无损模式（ZFP可逆模式）
+        double max_frame_latency_ms = 0;    // 单帧压缩+解压耗时上限，0表示不限
+        double max_rmse = 0;                // 均方根误差上限，0表示不限
+        double max_abs_error = 0;           // 最大绝对误差上限，0表示不限
+        int repeats = 3;                    // 每个组合重复测量的次数，耗时取最快一次
+        int threads = 0;                    // 并行评估的线程数，0表示使用OpenMP默认值
+    };
+
+    struct Candidate {
+        BEVCompressor::Config config;
+        double compress_ms = 0;             // 单帧平均压缩耗时
+        double decompress_ms = 0;           // 单帧平均解压耗时
+        double compress_mb_per_s = 0;
+        double decompress_mb_per_s = 0;
+        double ratio = 0;                   // 原始字节数 / 压缩字节数
+        double rmse = 0;
+        double max_abs_error = 0;
+        double psnr_db = 0;                 // 以样本值域为峰值；无误差时为无穷大（JSON中为null）
+        bool valid = false;                 // 评估成功（压缩或解压失败的组合不参与选择）
+        bool feasible = false;              // 满足约束
+        bool pareto = false;                // 在（压缩比、误差、耗时）上不被其他组合支配
+
+        double frame_ms() const { return compress_ms + decompress_ms; }
+        Json::Value to_json() const;
+    };
+
+    struct Result {
+        std::vector<Candidate> candidates;
+        int best = -1;                      // 最优组合在candidates中的下标，-1表示没有满足约束的组合
+        size_t num_samples = 0;
+    };
+
+    static Result tune(const std::vector<BEVFeaturePacket>& samples, const Options& options);
+
+    // 参数文件：compressor字段为最优参数，calibration字段记录约束、各组合测量值与Pareto前沿；
+    // 没有满足约束的组合时抛出异常
+    static Json::Value params_json(const Result& result, const Options& options);
+    static void write_params(const std::string& path, const Result& result, const Options& options);
+
+    // 从多帧文件中均匀抽取至多max_frames帧作为样本
+    static std::vector<BEVFeaturePacket> sample_frames(const std::string& path, uint32_t max_frames);
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include "BEVData.h"
+#include "compressor.h"
+#include <json/json.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 上行链路发送端
+class UplinkSink {
+public:
+    virtual ~UplinkSink() = default;
+    // 发送一个完整的包，失败返回false（由发送线程调用）
+    virtual bool send(const uint8_t* data, size_t size) = 0;
+};
+
+// UDP发送端：每个包一个数据报
+class UdpUplinkSink : public UplinkSink {
+public:
+    UdpUplinkSink(const std::string& host, uint16_t port);
+    ~UdpUplinkSink() override;
+    bool send(const uint8_t* data, size_t size) override;
+
+private:
+    int fd_ = -1;
+    sockaddr_in addr_{};
+};
+
+// 文件发送端：每个包前写uint32长度，便于离线回放与测试
+class FileUplinkSink : public UplinkSink {
+public:
+    explicit FileUplinkSink(const std::string& path);
+    bool send(const uint8_t* data, size_t size) override;
+
+private:
+    std::ofstream out_;
+};
+
+// 上行链路打包器
+// 把BEVCompressor::compress输出的字节流拆成不超过MTU的自包含包（包头带时间戳与流的编码方式，
+// 每个块带坐标，接收端不需要知道发送端的压缩配置），
+// 按令牌桶限速（bytes/s）发送。块的重要性由两部分加权：离自车位置越近越重要（ROI），
+// 与上一帧同位置压缩数据差异越大越重要（活跃度）；同一帧内高重要性的块先打包，
+// 队列中按包重要性优先发送。每个包有唯一序号，重传沿用原序号，接收端按序号去重即可。
+class UplinkPacketizer {
+public:
+    struct Config {
+        size_t mtu_bytes = 1400;                // 单包上限（含包头）
+        uint64_t bytes_per_second = 1 << 20;    // 令牌桶速率
+        size_t burst_bytes = 64 << 10;          // 令牌桶容量
+        size_t max_queued_bytes = 8 << 20;      // 待发送上限，超出时丢弃重要性最低的包
+        float ego_row = 128.0f;                 // 自车在特征图中的位置（单元坐标）
+        float ego_col = 128.0f;
+        float roi_weight = 1.0f;                // ROI权重
+        float activity_weight = 1.0f;           // 活跃度权重
+        size_t retransmit_history = 1024;       // 可重传的已发送包数量
+    };
+
+    // 包头（线上为紧凑小端布局，共28字节；codec/rate之后3字节保留为0）
+    struct PacketHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint64_t timestamp;
+        uint16_t block_count;
+        uint16_t flags;        // FLAG_RETRANSMIT等
+        float rate;            // 包内各块的编码方式（取自压缩流的流头），
+        uint8_t codec;         // 接收端按BEVBlockCodec{codec, rate}调用BEVCompressor::decode_block
+
+        BEVBlockCodec block_codec() const { return BEVBlockCodec{codec, rate}; }
+    };
+    static constexpr uint32_t PACKET_MAGIC = 0x32554542;  // "BEU2"（包头不带编码方式的旧格式为"BEVU"）
+    static constexpr size_t PACKET_HEADER_BYTES = 28;
+    static constexpr size_t BLOCK_HEADER_BYTES = BEVCompressor::BLOCK_HEADER_BYTES;
+    static constexpr uint16_t FLAG_RETRANSMIT = 1;
+
+    // 包内的一个块（块头与压缩流中的块头相同，data指向包缓冲区内部）
+    struct PacketBlock {
+        BEVCompressor::BlockHeader header;
+        const uint8_t* data;
+    };
+
+    UplinkPacketizer(const Config& config, std::shared_ptr<UplinkSink> sink);
+    ~UplinkPacketizer();
+
+    UplinkPacketizer(const UplinkPacketizer&) = delete;
+    UplinkPacketizer& operator=(const UplinkPacketizer&) = delete;
+
+    // 拆包并入队（不阻塞），返回生成的包数
+    size_t submit(const std::vector<uint8_t>& compressed);
+
+    // 按序号重传一个已发送的包（超出历史范围返回false）
+    bool retransmit(uint32_t sequence);
+
+    // 阻塞直到队列发完
+    void flush();
+
+    Json::Value getStats() const;
+
+    // 解析一个包（接收端使用），格式错误返回false
+    static bool parsePacket(const uint8_t* data, size_t size, PacketHeader& header,
+                            std::vector<PacketBlock>& blocks);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Packet {
+        uint32_t sequence;
+        uint64_t frame_id;     // 内部帧序号（用于送达延迟统计）
+        float priority;
+        size_t payload_bytes;  // 块压缩数据字节数（不含包头与块头）
+        bool retransmit;
+        std::vector<uint8_t> bytes;
+    };
+    using PacketPtr = std::shared_ptr<Packet>;
+
+    // 重要性高者在前，同等重要性按序号先后
+    struct PacketOrder {
+        bool operator()(const PacketPtr& a, const PacketPtr& b) const {
+            if (a->priority != b->priority) return a->priority > b->priority;
+            return a->sequence < b->sequence;
+        }
+    };
+
+    struct FrameState {
+        Clock::time_point submitted;
+        uint32_t remaining = 0;
+        bool sent_any = false;
+        bool dropped_any = false;
+    };
+
+    void senderLoop();
+    void enqueueLocked(PacketPtr packet);
+    void finishPacketLocked(const Packet& packet, bool sent);
+
+    Config config_;
+    std::shared_ptr<UplinkSink> sink_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable drained_cv_;
+    std::multiset<PacketPtr, PacketOrder> queue_;
+    size_t queued_bytes_ = 0;
+    bool sending_ = false;
+    bool stop_ = false;
+
+    uint32_t next_sequence_ = 0;
+    uint64_t next_frame_id_ = 0;
+    std::unordered_map<uint64_t, FrameState> frames_;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> last_payload_;  // (x<<32|y) -> 上一帧压缩数据
+    std::deque<PacketPtr> history_;
+
+    // 令牌桶（仅发送线程访问）
+    double tokens_ = 0;
+    Clock::time_point last_refill_;
+
+    // 统计（mutex_保护）
+    Clock::time_point first_submit_{};
+    Clock::time_point last_send_{};
+    uint64_t packets_sent_ = 0;
+    uint64_t bytes_sent_ = 0;
+    uint64_t payload_bytes_sent_ = 0;
+    uint64_t packets_dropped_ = 0;
+    uint64_t send_failures_ = 0;
+    uint64_t retransmissions_ = 0;
+    uint64_t oversize_packets_ = 0;
+    uint64_t frames_delivered_ = 0;
+    uint64_t frames_partial_ = 0;
+    uint64_t latency_total_ns_ = 0;
+    uint64_t latency_max_ns_ = 0;
+
+    std::thread sender_;
+};
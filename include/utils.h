@@ -1 +1,113 @@
-#pragma once
\ No newline at end of file
+#pragma once
+#include <json/json.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// 计时埋点的处理阶段
+enum class MetricStage : uint8_t {
+    BLOCK_COMPRESS = 0,  // 单块压缩
+    FRAME_COMPRESS,      // 单帧压缩
+    DECOMPRESS,          // 单帧解压
+    CACHE_INSERT,        // 缓存插入（一次insertPackets调用）
+    CACHE_RETRIEVE,      // 缓存检索（单键或批量）
+    CACHE_EVICT,         // 缓存淘汰
+    UPLINK_DELIVERY,     // 上行链路单帧送达（从提交到最后一个包发出）
+    BLOCK_VERIFY,        // 单块压缩后的解码校验（含超限重编码）
+    COUNT
+};
+
+// 运行时指标
+// 每个线程在首次记录时登记一份私有计数器，记录时只由所属线程写入（relaxed原子操作，
+// 无锁、无共享缓存行竞争）；线程退出时计数并入已退出线程的累计值并注销；
+// snapshot()汇总累计值与所有存活线程的计数器。reset()可与记录并发调用：它只清零累计值并推进
+// 重置代次，各线程在下次记录前自行清零私有计数器，此前snapshot()跳过代次落后的线程。
+// 延迟直方图为HDR风格的对数线性分桶：每个2的幂区间细分为16个子桶，相对误差不超过1/16。
+class BEVMetrics {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int NUM_BUCKETS = 64 * SUB_BUCKETS;
+    static constexpr size_t NUM_STAGES = static_cast<size_t>(MetricStage::COUNT);
+
+    // 单阶段汇总
+    struct StageSnapshot {
+        uint64_t count = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t p50_ns = 0;
+        uint64_t p99_ns = 0;
+        uint64_t p999_ns = 0;
+        uint64_t bytes_in = 0;
+        uint64_t bytes_out = 0;
+        std::array<uint64_t, NUM_BUCKETS> buckets{};
+    };
+
+    struct Snapshot {
+        std::array<StageSnapshot, NUM_STAGES> stages;
+        double compression_ratio = 0.0;  // 帧压缩的原始字节数 / 压缩后字节数
+        double max_abs_error = 0.0;      // 已记录的最大绝对误差
+        double rmse = 0.0;               // 已记录样本的均方根误差
+        uint64_t error_samples = 0;      // 参与误差统计的数值个数
+        double value_range = 0.0;        // 已记录数据的最大取值范围（PSNR峰值）
+        double psnr_db = 0.0;            // 以value_range为峰值的PSNR，无误差时为无穷大（JSON中为null）
+        uint64_t reencoded_blocks = 0;   // 超出误差上限而提高码率重新编码的块数
+        uint64_t unresolved_blocks = 0;  // 码率升至上限仍超出误差上限的块数
+
+        const StageSnapshot& stage(MetricStage s) const { return stages[static_cast<size_t>(s)]; }
+        Json::Value toJSON() const;
+    };
+
+    static void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    static void recordLatency(MetricStage stage, uint64_t ns);
+    static void recordBytes(MetricStage stage, uint64_t bytes_in, uint64_t bytes_out);
+    // 记录一批数值的重建误差（num_values个数值的最大绝对误差与平方误差和，value_range为这批数据的取值范围）
+    static void recordError(double max_abs_error, double sum_squared_error, uint64_t num_values,
+                            double value_range = 0.0);
+    static void recordReencode(uint64_t reencoded_blocks, uint64_t unresolved_blocks);
+
+    static Snapshot snapshot();
+    static void reset();
+    // 当前登记了私有计数器的存活线程数
+    static size_t registeredThreads();
+
+    static const char* stageName(MetricStage stage);
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+    // 按分桶计数求分位数（返回所在桶的上界，count为各桶之和）
+    static uint64_t percentile(const std::array<uint64_t, NUM_BUCKETS>& buckets, uint64_t count, double q);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+// 作用域计时器：构造时计时，析构时记入对应阶段；指标关闭时不读时钟
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricStage stage)
+        : stage_(stage), active_(BEVMetrics::enabled())
+    {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active_) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            BEVMetrics::recordLatency(stage_,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricStage stage_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <json/json.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// NUMA/核簇感知的工作线程池
+// 工作线程按节点（NUMA节点，或手动指定的big/little核簇）分组，并用pthread_setaffinity_np
+// 绑定到组内的CPU。runPartitioned把每帧整体分配给一个节点（连续的调用轮转节点），帧内的
+// 块只在该节点的工作线程之间划分，一帧的数据不会在节点之间来回搬运；工作线程写出的缓冲区
+// 按首次触碰（first-touch）策略落在本节点的内存上。
+// 每个工作线程有独立的任务队列，多个调用方可以同时提交，互不串行。
+class WorkerPool {
+public:
+    struct Config {
+        int threads = 0;                         // 工作线程数，0表示每个可用CPU一个
+        bool pin = true;                         // 把工作线程绑定到CPU
+        bool numa_aware = true;                  // 按节点分组；关闭时所有线程为一组，帧内的块可能跨节点
+        std::vector<std::vector<int>> nodes;     // 手动指定各节点/核簇的CPU（如big/little簇或用cpuset模拟），
+                                                 // 为空时从/sys/devices/system/node读取，并与进程亲和性取交集
+    };
+
+    // 处理第frame帧的[begin, end)项；slot为执行线程在本组内的序号（< maxSlots()），同一帧的不同slot互不重叠
+    using PartitionFn = std::function<void(size_t frame, int slot, size_t begin, size_t end)>;
+
+    explicit WorkerPool(const Config& config);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()); }
+    // 分组数（numa_aware关闭时为1）
+    int numGroups() const { return static_cast<int>(groups_.size()); }
+    // 单个分组的最大线程数（每帧输出缓冲区的槽位数）
+    int maxSlots() const { return max_slots_; }
+    int nodeOf(int worker) const { return workers_[worker]->node; }
+    int cpuOf(int worker) const { return workers_[worker]->cpu; }
+
+    // 按帧划分执行：第f帧有items_per_frame[f]项，阻塞到全部完成；任何一项抛出的异常在调用方重新抛出。
+    // 在工作线程内调用时（嵌套）直接在当前线程串行执行
+    void runPartitioned(const std::vector<size_t>& items_per_frame, const PartitionFn& fn);
+
+    // 在node节点的第一个工作线程上构造对象（内存池等），构造时写入的页按首次触碰落在该节点
+    template <typename T, typename... Args>
+    std::shared_ptr<T> constructOnNode(int node, Args&&... args) {
+        std::shared_ptr<T> result;
+        runOn(firstWorkerOfNode(node), [&] { result = std::make_shared<T>(std::forward<Args>(args)...); });
+        return result;
+    }
+
+    // 在指定工作线程上同步执行fn
+    void runOn(int worker, const std::function<void()>& fn);
+
+    // 当前线程在池中的序号，不是工作线程时返回-1
+    static int currentWorker();
+
+    // 统计：已分派的帧数、实际在多个节点的CPU上执行的帧数（每段开始时用sched_getcpu采样）、各线程的节点与CPU
+    Json::Value getStats() const;
+
+    // 进程可用的CPU按NUMA节点分组（读取失败时所有可用CPU为一组）
+    static std::vector<std::vector<int>> detectTopology();
+    // 解析内核cpulist格式（如"0-3,8,10-11"）
+    static std::vector<int> parseCpuList(const std::string& text);
+
+private:
+    // 一次runPartitioned/runOn调用的完成计数
+    struct Batch {
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        int remaining = 0;
+        std::exception_ptr error;
+
+        void finish(std::exception_ptr e);
+        void wait();
+    };
+
+    struct Task {
+        std::function<void()> fn;
+        Batch* batch;
+    };
+
+    struct Worker {
+        int index = 0;
+        int node = 0;                    // 物理节点（统计跨节点执行用）
+        int cpu = -1;                    // 绑定的CPU，-1表示未绑定
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    // 工作线程主循环：先绑定CPU，再通过ready报告就绪
+    void workerLoop(Worker& worker, Batch* ready);
+    // 当前线程所在CPU对应的节点（无法确定时取worker所属节点）
+    int currentNode(const Worker& worker) const;
+    void post(int worker, std::function<void()> fn, Batch& batch);
+    int firstWorkerOfNode(int node) const;
+
+    Config config_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::vector<int>> groups_;       // 各组的工作线程序号
+    std::vector<int> cpu_node_;                  // CPU -> 节点，-1为不在拓扑中，-2为被多个节点共用
+    int max_slots_ = 1;
+    std::atomic<bool> stop_{false};
+
+    std::atomic<uint64_t> next_group_{0};        // 帧到组的轮转起点
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> cross_node_frames_{0};
+};
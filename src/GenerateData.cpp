@@ -1,12 +1,162 @@
 #include "GenerateData.h"
 #include <fstream>
 #include <chrono>
+#include <cmath>
+#include <future>
 #include <thread>
+#include <omp.h>
 
 namespace fs = std::filesystem; 
 const float NS_TO_S_RATE = 1e-8f;  // 纳秒到秒的转换的比例因子
 const float ROTATION_RATE = 1e-10f;  // 车辆旋转速率（模拟）的比例因子
 
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+
+// SplitMix64：把(种子, 计数器)映射为互不相关的64位随机数
+uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// 像素级计数器哈希（lowbias32）：只有32位乘法与移位，逐像素循环可以直接向量化
+inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352DU;
+    x ^= x >> 15;
+    x *= 0x846CA68BU;
+    x ^= x >> 16;
+    return x;
+}
+
+// 随机流编号：不同用途的随机数来自不同的流，增减障碍物不会改变噪声
+enum RandomStream : uint64_t {
+    STREAM_EGO = 1,
+    STREAM_OBSTACLE = 2,
+    STREAM_BACKGROUND = 3,
+    STREAM_NOISE = 4,
+};
+
+uint64_t stream_bits(uint64_t seed, RandomStream stream, uint64_t counter) {
+    return mix64(mix64(seed ^ (static_cast<uint64_t>(stream) << 56)) + counter);
+}
+
+// [0,1)均匀分布
+double stream_unit(uint64_t seed, RandomStream stream, uint64_t counter) {
+    return (stream_bits(seed, stream, counter) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void validate_scenario(const BEVDataGenerator::ScenarioConfig& config) {
+    if (config.rows <= 0 || config.cols <= 0 || config.fps <= 0 || config.cell_size <= 0 ||
+        config.num_obstacles < 0 || config.noise_level < 0) {
+        throw std::invalid_argument("场景配置无效");
+    }
+    if (config.data_type < 0 || config.data_type > 3) {
+        throw std::invalid_argument("不支持的场景背景类型: " + std::to_string(config.data_type));
+    }
+}
+
+struct EgoState {
+    double x, y, yaw, speed;
+};
+
+// 自车轨迹为闭式表达，任意帧的位姿无需逐帧积分，各帧可以独立并行生成：
+//   x(t) = v0*t + dv/wv*(1 - cos(wv*t))      纵向：速度在v0附近起伏
+//   y(t) = amp*sin(wy*t)                      横向：缓弯
+// 航向角取速度方向
+struct EgoTrajectory {
+    double v0, dv, wv, amp, wy;
+
+    explicit EgoTrajectory(uint64_t seed) {
+        v0 = 10.0 + 8.0 * stream_unit(seed, STREAM_EGO, 0);                // 10-18m/s
+        dv = 3.0 * stream_unit(seed, STREAM_EGO, 1);
+        wv = TWO_PI / (30.0 + 60.0 * stream_unit(seed, STREAM_EGO, 2));
+        amp = 20.0 + 40.0 * stream_unit(seed, STREAM_EGO, 3);
+        wy = TWO_PI / (60.0 + 120.0 * stream_unit(seed, STREAM_EGO, 4));
+    }
+
+    EgoState at(double t) const {
+        const double vx = v0 + dv * std::sin(wv * t);
+        const double vy = amp * wy * std::cos(wy * t);
+        return {v0 * t + dv / wv * (1.0 - std::cos(wv * t)), amp * std::sin(wy * t),
+                std::atan2(vy, vx), std::hypot(vx, vy)};
+    }
+};
+
+// 障碍物在世界坐标系中匀速运动（约三分之一静止），在BEV中的位置由相对自车位姿投影得到。
+// 相对位置按大于视野外接圆的周期折回：离开视野的障碍物在另一侧重新出现，视野内的运动始终连续
+struct Obstacle {
+    double x0, y0, vx, vy;
+    float length, width, heading, value;
+};
+
+const float MAX_OBSTACLE_LENGTH = 6.0f;
+
+std::vector<Obstacle> make_obstacles(const BEVDataGenerator::ScenarioConfig& config,
+                                     const EgoTrajectory& ego, double wrap) {
+    std::vector<Obstacle> obstacles(config.num_obstacles);
+    for (int k = 0; k < config.num_obstacles; ++k) {
+        auto u = [&](uint64_t field) { return stream_unit(config.seed, STREAM_OBSTACLE, k * 8ULL + field); };
+        Obstacle& o = obstacles[k];
+        o.x0 = (u(0) - 0.5) * wrap;
+        o.y0 = (u(1) - 0.5) * wrap;
+        if (k % 3 == 0) {
+            o.vx = o.vy = 0.0;
+            o.heading = static_cast<float>(TWO_PI * u(2));
+        } else {
+            // 同向或对向行驶的车辆
+            const double speed = ego.v0 + (u(2) - 0.5) * 10.0;
+            const double heading = (u(3) < 0.7 ? 0.0 : TWO_PI / 2) + (u(4) - 0.5) * 0.2;
+            o.vx = speed * std::cos(heading);
+            o.vy = speed * std::sin(heading);
+            o.heading = static_cast<float>(heading);
+        }
+        o.length = static_cast<float>(3.5 + (MAX_OBSTACLE_LENGTH - 3.5) * u(5));
+        o.width = static_cast<float>(1.6 + 0.8 * u(6));
+        o.value = static_cast<float>(0.6 + 0.4 * u(7));
+    }
+    return obstacles;
+}
+
+// 折回到[-wrap/2, wrap/2)
+double wrap_offset(double value, double wrap) {
+    return value - wrap * std::floor(value / wrap + 0.5);
+}
+
+// 在自车坐标系下绘制一个有朝向的矩形（前向f、左向l，单位米）
+void draw_obstacle(Eigen::MatrixXf& feature, float cell, float f, float l, float heading,
+                   float length, float width, float value) {
+    const int rows = static_cast<int>(feature.rows()), cols = static_cast<int>(feature.cols());
+    const float c = std::cos(heading), s = std::sin(heading);
+    const float radius = 0.5f * std::hypot(length, width) / cell;
+    const float center_row = rows * 0.5f - f / cell, center_col = cols * 0.5f - l / cell;
+    const int i0 = std::max(0, static_cast<int>(std::floor(center_row - radius)));
+    const int i1 = std::min(rows - 1, static_cast<int>(std::ceil(center_row + radius)));
+    const int j0 = std::max(0, static_cast<int>(std::floor(center_col - radius)));
+    const int j1 = std::min(cols - 1, static_cast<int>(std::ceil(center_col + radius)));
+    for (int j = j0; j <= j1; ++j) {
+        const float dl = (cols * 0.5f - j - 0.5f) * cell - l;
+        for (int i = i0; i <= i1; ++i) {
+            const float df = (rows * 0.5f - i - 0.5f) * cell - f;
+            const float along = df * c + dl * s;
+            const float across = -df * s + dl * c;
+            if (std::abs(along) <= 0.5f * length && std::abs(across) <= 0.5f * width) {
+                feature(i, j) = std::max(feature(i, j), value);
+            }
+        }
+    }
+}
+
+// 像素级随机数：计数器为像素下标，与线程划分无关
+inline float pixel_uniform(uint32_t index, uint32_t key) {
+    return hash32(index * 0x9E3779B9U + key) * (1.0f / 4294967296.0f);
+}
+
+}  // namespace
+
 /**
  * @brief 生成带时间相关性的BEV帧数据
  * @param rows 矩阵行数
@@ -137,26 +287,7 @@ void BEVDataGenerator::save_multi_frames(const std::string& file_path, const std
     file.write(reinterpret_cast<const char*>(&num_packets), sizeof(num_packets));
 
     for (const auto& packet : packets) {
-        // 写入时间戳
-        file.write(reinterpret_cast<const char*>(&packet.timestamp), sizeof(packet.timestamp));
-        
-        // 写入传感器上下文
-        file.write(reinterpret_cast<const char*>(&packet.sensor_ctx.ego_speed), sizeof(packet.sensor_ctx.ego_speed));
-        file.write(reinterpret_cast<const char*>(&packet.sensor_ctx.health), sizeof(packet.sensor_ctx.health));
-        file.write(reinterpret_cast<const char*>(packet.sensor_ctx.ego_pose.data()), 
-                  packet.sensor_ctx.ego_pose.size() * sizeof(float));
-        
-        // 写入特征元数据
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.rows), sizeof(packet.feature_meta.rows));
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.cols), sizeof(packet.feature_meta.cols));
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.value_min), sizeof(packet.feature_meta.value_min));
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.value_max), sizeof(packet.feature_meta.value_max));
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.channel), sizeof(packet.feature_meta.channel));
-        file.write(reinterpret_cast<const char*>(&packet.feature_meta.is_normalized), sizeof(packet.feature_meta.is_normalized));
-        
-        // 写入矩阵数据
-        file.write(reinterpret_cast<const char*>(packet.feature.data()), 
-                  packet.feature.size() * sizeof(float));
+        write_frame(file, packet);
     }
 
     if (!file) {
@@ -164,79 +295,263 @@ void BEVDataGenerator::save_multi_frames(const std::string& file_path, const std
     }
 }
 
-int main(int argc, char** argv) {
-    const int target_fps = 25;             // BEV帧率
-    const std::chrono::milliseconds frame_time(1000/target_fps); 
+/**
+ * @brief 按save_multi_frames的格式写入一帧
+ */
+void BEVDataGenerator::write_frame(std::ostream& file, const BEVFeaturePacket& packet) {
+    // 写入时间戳
+    file.write(reinterpret_cast<const char*>(&packet.timestamp), sizeof(packet.timestamp));
 
-    // 可配置参数
-    int num_frames = 50;
-    int rows = 256;
-    int cols = 256;
-    int data_type = 0;      // 0-随机 1-渐变 2-稀疏
-    float noise_level = 0.2f;
-    const std::string output_file = "bev_test_data.bin";  // 测试数据保存路径
+    // 写入传感器上下文
+    file.write(reinterpret_cast<const char*>(&packet.sensor_ctx.ego_speed), sizeof(packet.sensor_ctx.ego_speed));
+    file.write(reinterpret_cast<const char*>(&packet.sensor_ctx.health), sizeof(packet.sensor_ctx.health));
+    file.write(reinterpret_cast<const char*>(packet.sensor_ctx.ego_pose.data()),
+              packet.sensor_ctx.ego_pose.size() * sizeof(float));
 
-    std::cout << "请输入文件参数：1-num_frames(default=50) 2-rows(default=256) 3-cols(default=256) 4-data_type(0-随机 1-渐变 2-稀疏,default=0) 5-noise_level(default=0.2)\n" << "输入（空格分隔，直接回车则用默认值）：" << std::endl;
-    
-    std::string line;
-    std::getline(std::cin, line);
-
-    std::istringstream iss(line);
-    std::vector<std::string> tokens;
-    std::string token;
-
-    while (iss >> token) {
-        tokens.push_back(token);
-    }
-
-    // 读取参数（按顺序）
-    if (tokens.size() >= 1 && !tokens[0].empty()) std::istringstream(tokens[0]) >> num_frames;
-    if (tokens.size() >= 2 && !tokens[1].empty()) std::istringstream(tokens[1]) >> rows;
-    if (tokens.size() >= 3 && !tokens[2].empty()) std::istringstream(tokens[2]) >> cols;
-    if (tokens.size() >= 4 && !tokens[3].empty()) std::istringstream(tokens[3]) >> data_type;
-    if (tokens.size() >= 5 && !tokens[4].empty()) std::istringstream(tokens[4]) >> noise_level;
-
-    std::cout << "生成中，请稍候..." << std::endl;
-
-    try {
-        BEVDataGenerator generator;
-        // 生成所有帧数据
-        std::vector<BEVFeaturePacket> all_frames;
-        all_frames.reserve(num_frames);  // 预分配内存，提高效率
-
-        for (int i = 0; i < num_frames; ++i) {
-            auto start = std::chrono::steady_clock::now();  // 记录循环开始时间 
-
-            BEVFeaturePacket frame = generator.generate_bev_frame(rows, cols, data_type, noise_level);
-            all_frames.push_back(std::move(frame));  // 移动语义，减少拷贝
-
-            auto end = std::chrono::steady_clock::now();    // 记录循环结束时间
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            if (elapsed < frame_time) {
-                // 如果执行太快，休眠剩余时间
-                std::this_thread::sleep_for(frame_time - elapsed);
-            } else {
-                // 如果执行太慢，可以输出警告或调整逻辑
-                std::cerr << "警告: 循环执行时间过长 (" 
-                        << elapsed.count() << "ms)" << std::endl;
+    // 写入特征元数据
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.rows), sizeof(packet.feature_meta.rows));
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.cols), sizeof(packet.feature_meta.cols));
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.value_min), sizeof(packet.feature_meta.value_min));
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.value_max), sizeof(packet.feature_meta.value_max));
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.channel), sizeof(packet.feature_meta.channel));
+    file.write(reinterpret_cast<const char*>(&packet.feature_meta.is_normalized), sizeof(packet.feature_meta.is_normalized));
+
+    // 写入矩阵数据
+    file.write(reinterpret_cast<const char*>(packet.feature.data()),
+              packet.feature.size() * sizeof(float));
+}
+
+/**
+ * @brief 生成确定性场景中的一帧
+ * @param config 场景配置（种子、尺寸、背景类型、障碍物数量等）
+ * @param frame_index 帧序号，时间戳为 start_timestamp + frame_index / fps
+ * @return 生成的数据包；同一(config, frame_index)的结果逐位相同
+ */
+BEVFeaturePacket BEVDataGenerator::generate_scenario_frame(const ScenarioConfig& config,
+                                                           uint64_t frame_index) const {
+    validate_scenario(config);
+    const int rows = config.rows, cols = config.cols;
+    const float cell = config.cell_size;
+    const double t = frame_index / config.fps;
+
+    const EgoTrajectory trajectory(config.seed);
+    const EgoState ego = trajectory.at(t);
+
+    BEVFeaturePacket packet;
+    packet.timestamp = config.start_timestamp + static_cast<uint64_t>(std::llround(t * 1e9));
+    packet.sensor_ctx.ego_speed = static_cast<float>(ego.speed);
+    packet.sensor_ctx.health = SensorHealth::NORMAL;
+    packet.sensor_ctx.ego_pose = {static_cast<float>(ego.x), static_cast<float>(ego.y),
+                                  static_cast<float>(ego.yaw)};
+    packet.feature_meta.rows = rows;
+    packet.feature_meta.cols = cols;
+    packet.feature_meta.value_min = config.data_type == 0 ? -1.0f : 0.0f;
+    packet.feature_meta.value_max = 1.0f;
+    packet.feature_meta.channel = 0;
+    packet.feature_meta.is_normalized = true;
+
+    packet.feature.resize(rows, cols);
+    float* data = packet.feature.data();
+    const uint32_t count = static_cast<uint32_t>(packet.feature.size());
+    const float cos_yaw = static_cast<float>(std::cos(ego.yaw));
+    const float sin_yaw = static_cast<float>(std::sin(ego.yaw));
+
+    switch (config.data_type) {
+        case 0: {  // 随机背景
+            const uint32_t key = static_cast<uint32_t>(stream_bits(config.seed, STREAM_BACKGROUND, frame_index));
+            #pragma omp simd
+            for (uint32_t k = 0; k < count; ++k) {
+                data[k] = pixel_uniform(k, key) * 2.0f - 1.0f;
             }
+            break;
+        }
+        case 1: {  // 渐变分布（模拟距离衰减）
+            const float scale = 2.0f / std::sqrt(static_cast<float>(rows) * rows + static_cast<float>(cols) * cols);
+            for (int j = 0; j < cols; ++j) {
+                const float dj = j - cols / 2.0f;
+                #pragma omp simd
+                for (int i = 0; i < rows; ++i) {
+                    const float di = i - rows / 2.0f;
+                    data[static_cast<size_t>(j) * rows + i] = std::max(0.0f, 1.0f - std::sqrt(di * di + dj * dj) * scale);
+                }
+            }
+            break;
+        }
+        case 2:  // 仅障碍物
+            packet.feature.setZero();
+            break;
+        case 3: {  // 道路网格：网格线固定在世界坐标系中，随自车位姿平移、旋转
+            const float spacing = cell * std::max(1, std::min(rows, cols) / 16);
+            // 先在double下把自车位置折回一个网格周期内，后续float运算不损失精度
+            const float ex = static_cast<float>(ego.x - spacing * std::floor(ego.x / spacing));
+            const float ey = static_cast<float>(ego.y - spacing * std::floor(ego.y / spacing));
+            for (int j = 0; j < cols; ++j) {
+                const float lateral = (cols * 0.5f - j - 0.5f) * cell;
+                const float base_x = ex - sin_yaw * lateral;
+                const float base_y = ey + cos_yaw * lateral;
+                #pragma omp simd
+                for (int i = 0; i < rows; ++i) {
+                    const float forward = (rows * 0.5f - i - 0.5f) * cell;
+                    const float wx = base_x + cos_yaw * forward;
+                    const float wy = base_y + sin_yaw * forward;
+                    const bool on_line = wx - spacing * std::floor(wx / spacing) < cell ||
+                                         wy - spacing * std::floor(wy / spacing) < cell;
+                    data[static_cast<size_t>(j) * rows + i] = on_line ? 0.8f : 0.0f;
+                }
+            }
+            break;
+        }
+    }
+
+    // 障碍物：折回周期取视野外接圆直径再留出最大障碍物尺寸，保证折回发生在视野之外
+    const double half_diagonal = 0.5 * std::hypot(rows, cols) * cell;
+    const double wrap = 2.0 * (half_diagonal + MAX_OBSTACLE_LENGTH);
+    for (const Obstacle& o : make_obstacles(config, trajectory, wrap)) {
+        const double rx = wrap_offset(o.x0 + o.vx * t - ego.x, wrap);
+        const double ry = wrap_offset(o.y0 + o.vy * t - ego.y, wrap);
+        const float f = static_cast<float>(cos_yaw * rx + sin_yaw * ry);
+        const float l = static_cast<float>(-sin_yaw * rx + cos_yaw * ry);
+        draw_obstacle(packet.feature, cell, f, l, o.heading - static_cast<float>(ego.yaw),
+                      o.length, o.width, o.value);
+    }
+
+    // 噪声：每个像素由两次32位哈希得到4个16位均匀数，求和近似正态分布（Irwin-Hall，n=4）
+    if (config.noise_level > 0) {
+        const uint32_t key = static_cast<uint32_t>(stream_bits(config.seed, STREAM_NOISE, frame_index));
+        const float scale = config.noise_level * std::sqrt(3.0f) / 65536.0f;
+        const float offset = 2.0f * config.noise_level * std::sqrt(3.0f);
+        const float lo = packet.feature_meta.value_min, hi = packet.feature_meta.value_max;
+        #pragma omp simd
+        for (uint32_t k = 0; k < count; ++k) {
+            const uint32_t a = hash32(2 * k * 0x9E3779B9U + key);
+            const uint32_t b = hash32((2 * k + 1) * 0x9E3779B9U + key);
+            const uint32_t sum = (a & 0xFFFFU) + (a >> 16) + (b & 0xFFFFU) + (b >> 16);
+            const float value = data[k] + static_cast<float>(sum) * scale - offset;
+            data[k] = std::min(hi, std::max(lo, value));
+        }
+    }
+    return packet;
+}
+
+/**
+ * @brief 并行生成场景并流式写入文件
+ * @param config 场景配置
+ * @param num_frames 帧数
+ * @param file_path 目标文件路径（格式与save_multi_frames相同）
+ * @return 写入的字节数
+ *
+ * 每批batch_frames帧由OpenMP并行生成，生成下一批的同时由写线程把上一批写盘，
+ * 内存中最多同时保留两批帧。
+ */
+uint64_t BEVDataGenerator::generate_to_file(const ScenarioConfig& config, uint32_t num_frames,
+                                            const std::string& file_path) const {
+    validate_scenario(config);
+    fs::path path(file_path);
+    if (!path.parent_path().empty()) {
+        fs::create_directories(path.parent_path());
+    }
+
+    // 大缓冲区减少写系统调用（须在open之前设置）
+    std::vector<char> io_buffer(8 << 20);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(io_buffer.data(), io_buffer.size());
+    file.open(file_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("无法打开文件写入: " + file_path);
+    }
+    file.write(reinterpret_cast<const char*>(&num_frames), sizeof(num_frames));
+
+    const int threads = config.threads > 0 ? config.threads : omp_get_max_threads();
+    const uint32_t batch = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(config.batch_frames, UINT32_MAX)));
+    std::vector<BEVFeaturePacket> generating, writing;
+    std::future<void> pending;
+
+    for (uint32_t first = 0; first < num_frames; first += std::min(batch, num_frames - first)) {
+        const int count = static_cast<int>(std::min(batch, num_frames - first));
+        generating.resize(count);
+        #pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (int k = 0; k < count; ++k) {
+            generating[k] = generate_scenario_frame(config, static_cast<uint64_t>(first) + k);
         }
 
-        // 写入多帧数据到单个文件
-        generator.save_multi_frames(output_file, all_frames);
+        // 上一批写完后才能交换缓冲区
+        if (pending.valid()) pending.get();
+        std::swap(generating, writing);
+        pending = std::async(std::launch::async, [&file, &writing] {
+            for (const BEVFeaturePacket& packet : writing) {
+                write_frame(file, packet);
+            }
+        });
+    }
+    if (pending.valid()) pending.get();
+
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("写入文件失败: " + file_path);
+    }
+    return static_cast<uint64_t>(file.tellp());
+}
 
-        // 输出统计信息
-        size_t total_data_size = num_frames * rows * cols * sizeof(float);
-        std::cout << "\n===== 生成完成 =====" << std::endl;
-        std::cout << "总帧数: " << num_frames << std::endl;
-        std::cout << "单帧尺寸: " << rows << "x" << cols << std::endl;
-        std::cout << "总数据量: " << total_data_size / (1024 * 1024) << " MB" << std::endl;
-        std::cout << "文件路径: " << fs::absolute(output_file) << std::endl;
+// ---------------- BEVFrameReader ----------------
 
-    } catch (const std::exception& e) {
-        std::cerr << "错误: " << e.what() << std::endl;
-        return 1;
+namespace {
+
+// 帧头字节数：时间戳 + 传感器上下文 + 特征元数据（逐字段写入，无填充）
+const uint64_t FRAME_RECORD_HEADER_BYTES = sizeof(uint64_t) + sizeof(float) + sizeof(uint8_t) + 3 * sizeof(float) +
+                                           2 * sizeof(uint32_t) + 2 * sizeof(float) + sizeof(uint8_t) + sizeof(bool);
+
+template <typename T>
+void read_field(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+}  // namespace
+
+BEVFrameReader::BEVFrameReader(const std::string& file_path)
+    : file_(file_path, std::ios::binary)
+{
+    if (!file_) {
+        throw std::runtime_error("无法打开文件读取: " + file_path);
+    }
+    const uint64_t file_size = fs::file_size(file_path);
+    read_field(file_, num_frames_);
+    if (!file_) {
+        throw std::runtime_error("帧文件头不完整: " + file_path);
     }
+    remaining_bytes_ = file_size - sizeof(num_frames_);
+}
 
-    return 0;
-}
\ No newline at end of file
+bool BEVFrameReader::next(BEVFeaturePacket& packet) {
+    if (frames_read_ >= num_frames_) {
+        return false;
+    }
+    if (remaining_bytes_ < FRAME_RECORD_HEADER_BYTES) {
+        throw std::runtime_error("读取第 " + std::to_string(frames_read_) + " 帧失败: 文件被截断");
+    }
+    read_field(file_, packet.timestamp);
+    read_field(file_, packet.sensor_ctx.ego_speed);
+    read_field(file_, packet.sensor_ctx.health);
+    file_.read(reinterpret_cast<char*>(packet.sensor_ctx.ego_pose.data()),
+               packet.sensor_ctx.ego_pose.size() * sizeof(float));
+    read_field(file_, packet.feature_meta.rows);
+    read_field(file_, packet.feature_meta.cols);
+    read_field(file_, packet.feature_meta.value_min);
+    read_field(file_, packet.feature_meta.value_max);
+    read_field(file_, packet.feature_meta.channel);
+    read_field(file_, packet.feature_meta.is_normalized);
+    remaining_bytes_ -= FRAME_RECORD_HEADER_BYTES;
+
+    // 先按剩余文件大小校验尺寸，避免损坏的帧头导致超大分配
+    const uint64_t data_bytes = static_cast<uint64_t>(packet.feature_meta.rows) * packet.feature_meta.cols * sizeof(float);
+    if (!file_ || data_bytes > remaining_bytes_) {
+        throw std::runtime_error("读取第 " + std::to_string(frames_read_) + " 帧失败: 文件被截断");
+    }
+    packet.feature.resize(packet.feature_meta.rows, packet.feature_meta.cols);
+    file_.read(reinterpret_cast<char*>(packet.feature.data()), data_bytes);
+    if (!file_) {
+        throw std::runtime_error("读取第 " + std::to_string(frames_read_) + " 帧失败");
+    }
+    remaining_bytes_ -= data_bytes;
+    ++frames_read_;
+    return true;
+}
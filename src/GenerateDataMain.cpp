@@ -0,0 +1,150 @@
+#include "GenerateData.h"
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// 确定性快速模式：GenerateData --seed 42 --duration 600 --rows 256 --cols 256 ...
+// 不按帧率休眠，多线程生成并流式写盘，同一组参数生成的文件逐字节相同
+int run_scenario(int argc, char** argv) {
+    BEVDataGenerator::ScenarioConfig config;
+    uint32_t num_frames = 0;
+    double duration_s = 60.0;
+    std::string output_file = "bev_test_data.bin";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "参数缺少取值: " << arg << std::endl;
+            return 1;
+        }
+        std::istringstream value(argv[++i]);
+        if (arg == "--seed") value >> config.seed;
+        else if (arg == "--frames") value >> num_frames;
+        else if (arg == "--duration") value >> duration_s;
+        else if (arg == "--rows") value >> config.rows;
+        else if (arg == "--cols") value >> config.cols;
+        else if (arg == "--type") value >> config.data_type;
+        else if (arg == "--noise") value >> config.noise_level;
+        else if (arg == "--obstacles") value >> config.num_obstacles;
+        else if (arg == "--fps") value >> config.fps;
+        else if (arg == "--cell") value >> config.cell_size;
+        else if (arg == "--threads") value >> config.threads;
+        else if (arg == "--batch") value >> config.batch_frames;
+        else if (arg == "--out") output_file = value.str();
+        else {
+            std::cerr << "未知参数: " << arg << "\n用法: GenerateData [--seed N] [--frames N | --duration 秒] "
+                      << "[--rows N] [--cols N] [--type 0-3] [--noise σ] [--obstacles N] [--fps N] "
+                      << "[--cell 米] [--threads N] [--batch N] [--out 路径]" << std::endl;
+            return 1;
+        }
+        if (!value) {
+            std::cerr << "参数取值无效: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (num_frames == 0) {
+        num_frames = static_cast<uint32_t>(std::llround(duration_s * config.fps));
+    }
+
+    try {
+        BEVDataGenerator generator;
+        auto start = std::chrono::steady_clock::now();
+        uint64_t bytes = generator.generate_to_file(config, num_frames, output_file);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "===== 生成完成 =====" << std::endl;
+        std::cout << "种子: " << config.seed << "  总帧数: " << num_frames
+                  << "（" << num_frames / config.fps << " 秒行驶）" << std::endl;
+        std::cout << "单帧尺寸: " << config.rows << "x" << config.cols << std::endl;
+        std::cout << "总数据量: " << bytes / (1024 * 1024) << " MB，耗时 " << elapsed << " 秒（"
+                  << num_frames / elapsed << " 帧/秒，" << bytes / elapsed / (1024 * 1024) << " MB/s）" << std::endl;
+        std::cout << "文件路径: " << fs::absolute(output_file) << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        return run_scenario(argc, argv);
+    }
+
+    const int target_fps = 25;             // BEV帧率
+    const std::chrono::milliseconds frame_time(1000/target_fps); 
+
+    // 可配置参数
+    int num_frames = 50;
+    int rows = 256;
+    int cols = 256;
+    int data_type = 0;      // 0-随机 1-渐变 2-稀疏
+    float noise_level = 0.2f;
+    const std::string output_file = "bev_test_data.bin";  // 测试数据保存路径
+
+    std::cout << "请输入文件参数：1-num_frames(default=50) 2-rows(default=256) 3-cols(default=256) 4-data_type(0-随机 1-渐变 2-稀疏,default=0) 5-noise_level(default=0.2)\n" << "输入（空格分隔，直接回车则用默认值）：" << std::endl;
+    
+    std::string line;
+    std::getline(std::cin, line);
+
+    std::istringstream iss(line);
+    std::vector<std::string> tokens;
+    std::string token;
+
+    while (iss >> token) {
+        tokens.push_back(token);
+    }
+
+    // 读取参数（按顺序）
+    if (tokens.size() >= 1 && !tokens[0].empty()) std::istringstream(tokens[0]) >> num_frames;
+    if (tokens.size() >= 2 && !tokens[1].empty()) std::istringstream(tokens[1]) >> rows;
+    if (tokens.size() >= 3 && !tokens[2].empty()) std::istringstream(tokens[2]) >> cols;
+    if (tokens.size() >= 4 && !tokens[3].empty()) std::istringstream(tokens[3]) >> data_type;
+    if (tokens.size() >= 5 && !tokens[4].empty()) std::istringstream(tokens[4]) >> noise_level;
+
+    std::cout << "生成中，请稍候..." << std::endl;
+
+    try {
+        BEVDataGenerator generator;
+        // 生成所有帧数据
+        std::vector<BEVFeaturePacket> all_frames;
+        all_frames.reserve(num_frames);  // 预分配内存，提高效率
+
+        for (int i = 0; i < num_frames; ++i) {
+            auto start = std::chrono::steady_clock::now();  // 记录循环开始时间 
+
+            BEVFeaturePacket frame = generator.generate_bev_frame(rows, cols, data_type, noise_level);
+            all_frames.push_back(std::move(frame));  // 移动语义，减少拷贝
+
+            auto end = std::chrono::steady_clock::now();    // 记录循环结束时间
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            if (elapsed < frame_time) {
+                // 如果执行太快，休眠剩余时间
+                std::this_thread::sleep_for(frame_time - elapsed);
+            } else {
+                // 如果执行太慢，可以输出警告或调整逻辑
+                std::cerr << "警告: 循环执行时间过长 (" 
+                        << elapsed.count() << "ms)" << std::endl;
+            }
+        }
+
+        // 写入多帧数据到单个文件
+        generator.save_multi_frames(output_file, all_frames);
+
+        // 输出统计信息
+        size_t total_data_size = num_frames * rows * cols * sizeof(float);
+        std::cout << "\n===== 生成完成 =====" << std::endl;
+        std::cout << "总帧数: " << num_frames << std::endl;
+        std::cout << "单帧尺寸: " << rows << "x" << cols << std::endl;
+        std::cout << "总数据量: " << total_data_size / (1024 * 1024) << " MB" << std::endl;
+        std::cout << "文件路径: " << fs::absolute(output_file) << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
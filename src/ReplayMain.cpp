@@ -0,0 +1,116 @@
+#include "replay.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// 回放压测入口：bev_replay <多帧文件> [选项]
+static void print_usage(const char* program) {
+    std::cerr << "用法: " << program << " <bin文件路径> [选项]\n"
+              << "  --speed X          回放倍速（1为实时，max为不限速，默认1）\n"
+              << "  --frames N         最多回放的帧数（默认全部）\n"
+              << "  --cache N          缓存块数（默认4096）\n"
+              << "  --ratio R          目标压缩比（默认16）\n"
+              << "  --block N          分块大小（默认16）\n"
+              << "  --params PATH      从参数文件加载压缩配置（覆盖--ratio/--block）\n"
+              << "  --latest N         LATEST读线程数（默认1）\n"
+              << "  --window N         SLIDING_WINDOW读线程数（默认1）\n"
+              << "  --window-frames N  滑动窗口帧数（默认10）\n"
+              << "  --random N         RANDOM_HISTORY读线程数（默认1）\n"
+              << "  --interval-us N    读线程两次读取的间隔（默认0，连续读取）\n"
+              << "  --seed N           随机读取的种子（默认1）\n"
+              << "  --report PATH      JSON报告输出路径（默认输出到标准输出）" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ReplayHarness::Config config;
+    config.input_path = argv[1];
+    config.compressor.block_size = 16;
+    config.compressor.compression_ratio = 16.0f;
+    std::string report_path;
+    std::string params_path;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "参数缺少取值: " << arg << std::endl;
+            return 1;
+        }
+        const std::string text = argv[++i];
+        std::istringstream value(text);
+        if (arg == "--speed") {
+            if (text == "max") config.speed = 0.0;
+            else value >> config.speed;
+        }
+        else if (arg == "--frames") value >> config.max_frames;
+        else if (arg == "--cache") value >> config.cache_size;
+        else if (arg == "--ratio") value >> config.compressor.compression_ratio;
+        else if (arg == "--block") value >> config.compressor.block_size;
+        else if (arg == "--params") params_path = text;
+        else if (arg == "--latest") value >> config.reader_threads[0];
+        else if (arg == "--window") value >> config.reader_threads[1];
+        else if (arg == "--window-frames") value >> config.window_frames;
+        else if (arg == "--random") value >> config.reader_threads[2];
+        else if (arg == "--interval-us") value >> config.read_interval_us;
+        else if (arg == "--seed") value >> config.seed;
+        else if (arg == "--report") report_path = text;
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (!value && arg != "--report" && arg != "--params") {
+            std::cerr << "参数取值无效: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        if (!params_path.empty()) {
+            config.compressor = BEVCompressor::load_config(params_path);
+        }
+        ReplayHarness harness(config);
+        Json::Value report = harness.run();
+
+        const Json::Value& ingest = report["ingest"];
+        std::cout << "===== 回放完成 =====" << std::endl;
+        std::cout << "帧数: " << report["frames"].asUInt() << "  数据时长: " << report["media_s"].asDouble()
+                  << " 秒  耗时: " << report["wall_s"].asDouble() << " 秒" << std::endl;
+        std::cout << "摄入: " << ingest["fps"].asDouble() << " 帧/秒, " << ingest["raw_mb_per_s"].asDouble()
+                  << " MB/s（原始）, 实时倍率 " << ingest["realtime_factor"].asDouble() << "x" << std::endl;
+        if (report.isMember("lag_ms")) {
+            const Json::Value& lag = report["lag_ms"];
+            std::cout << "滞后(ms): p50 " << lag["p50"].asDouble() << "  p99 " << lag["p99"].asDouble()
+                      << "  max " << lag["max"].asDouble() << "  结束时 " << lag["final"].asDouble() << std::endl;
+        }
+        for (const std::string& name : report["readers"].getMemberNames()) {
+            const Json::Value& entry = report["readers"][name];
+            if (entry["threads"].asInt() == 0) continue;
+            const Json::Value& latency = entry["latency_us"];
+            std::cout << name << ": " << entry["reads"].asUInt64() << " 次读取, 块命中率 "
+                      << entry["block_hit_rate"].asDouble() << ", 延迟(us) p50 " << latency["p50"].asDouble()
+                      << "  p99 " << latency["p99"].asDouble() << "  p999 " << latency["p999"].asDouble()
+                      << "  max " << latency["max"].asDouble() << std::endl;
+        }
+
+        Json::FastWriter writer;
+        if (report_path.empty()) {
+            std::cout << "Replay report: " << writer.write(report);
+        } else {
+            std::ofstream out(report_path);
+            if (!out) {
+                throw std::runtime_error("无法写入报告: " + report_path);
+            }
+            out << writer.write(report);
+            std::cout << "报告: " << report_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
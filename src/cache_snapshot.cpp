@@ -0,0 +1,395 @@
+#include "cache_system.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 快照文件布局：
+//   SnapshotHeader
+//   SnapshotEntry[entry_count]   按(timestamp, x, y)排序，加载后直接二分查找
+//   uint32_t[entry_count]        LRU顺序（条目下标，从最久未用到最近使用）
+//   压缩数据区
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'B', 'E', 'V', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 3;  // 3: 条目带块的编码方式
+
+const size_t SNAPSHOT_WRITE_CHUNK = 1 << 20;  // 写快照时的缓冲区大小
+
+// 完整写入（处理被信号打断或部分写入）
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 同步目录项，使其中的rename在掉电后仍然有效
+bool syncDirectory(const std::string& path) {
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entry_count;
+    uint64_t entries_offset;
+    uint64_t lru_offset;
+    uint64_t data_offset;
+    uint64_t file_size;
+};
+
+struct SnapshotEntry {
+    uint64_t timestamp;
+    uint16_t x;
+    uint16_t y;
+    uint16_t rows;
+    uint16_t cols;
+    uint32_t size;
+    float rate;       // 块的编码方式（BEVBlockCodec）
+    uint64_t offset;  // 相对文件起始
+    uint8_t codec;
+    uint8_t reserved2[7];
+};
+
+bool keyLess(const SnapshotEntry& entry, const BEVBlockKey& key) {
+    if (entry.timestamp != key.timestamp) return entry.timestamp < key.timestamp;
+    if (entry.x != key.x) return entry.x < key.x;
+    return entry.y < key.y;
+}
+
+// 待写入快照的块
+struct SnapshotSource {
+    BEVBlockKey key;
+    uint16_t rows;
+    uint16_t cols;
+    BEVBlockCodec codec;
+    const uint8_t* data;
+    uint32_t size;
+};
+
+}  // namespace
+
+struct BEVCache::MappedSnapshot {
+    void* base = MAP_FAILED;
+    size_t length = 0;
+    const SnapshotHeader* header = nullptr;
+    const SnapshotEntry* entries = nullptr;
+    const uint32_t* lru_order = nullptr;
+    size_t count = 0;
+    // 条目是否已被内存中内容不同的新块取代（取代后不再命中，也不写入下一个快照）
+    std::unique_ptr<std::atomic<uint8_t>[]> superseded;
+
+    ~MappedSnapshot() {
+        if (base != MAP_FAILED) {
+            ::munmap(base, length);
+        }
+    }
+
+    const SnapshotEntry* find(const BEVBlockKey& key) const {
+        const SnapshotEntry* it = locate(key);
+        if (!it || superseded[it - entries].load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return it;
+    }
+
+    // 按键查找条目（含已被取代的条目）
+    const SnapshotEntry* locate(const BEVBlockKey& key) const {
+        const SnapshotEntry* end = entries + count;
+        const SnapshotEntry* it = std::lower_bound(entries, end, key, keyLess);
+        if (it == end || it->timestamp != key.timestamp || it->x != key.x || it->y != key.y) {
+            return nullptr;
+        }
+        // 条目按需校验，损坏的条目视为未命中
+        if (it->offset > length || it->size > length - it->offset) {
+            return nullptr;
+        }
+        return it;
+    }
+
+    const uint8_t* payload(const SnapshotEntry& entry) const {
+        return static_cast<const uint8_t*>(base) + entry.offset;
+    }
+};
+
+void BEVCache::saveSnapshot(const std::string& path) {
+    std::shared_ptr<const MappedSnapshot> old_snapshot = std::atomic_load(&snapshot_);
+
+    // 写入期间钉住所引用的块数据（增加引用计数），块被淘汰也不会释放；结束时（含异常）在锁内解除。
+    // 引用共享缓冲区的块数据可能在此期间被拷出（缓冲区压缩），另外持有缓冲区以保证读取的数据有效
+    std::vector<BEVBlockPayload*> pinned;
+    std::vector<std::shared_ptr<const uint8_t>> buffers;
+    struct Unpin {
+        BEVCache* cache;
+        std::vector<BEVBlockPayload*>& pinned;
+        ~Unpin() {
+            std::lock_guard<std::mutex> lock(cache->cache_mutex_);
+            for (BEVBlockPayload* payload : pinned) {
+                if (--payload->refs == 0) {
+                    cache->freePayloadLocked(payload);
+                }
+            }
+        }
+    } unpin{this, pinned};
+
+    // 1. 收集块：旧快照中未进入内存的条目视为更久未用，排在内存LRU链表之前
+    //    （持锁期间只拷贝键、尺寸与数据引用）
+    std::vector<SnapshotSource> sources;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        sources.reserve(cache_map_.size() + (old_snapshot ? old_snapshot->count : 0));
+        if (old_snapshot) {
+            for (size_t i = 0; i < old_snapshot->count; ++i) {
+                uint32_t index = old_snapshot->lru_order[i];
+                if (index >= old_snapshot->count) continue;
+                const SnapshotEntry& entry = old_snapshot->entries[index];
+                BEVBlockKey key{entry.timestamp, entry.x, entry.y};
+                if (cache_map_.count(key) || !old_snapshot->find(key)) continue;
+                sources.push_back(SnapshotSource{key, entry.rows, entry.cols, BEVBlockCodec{entry.codec, entry.rate},
+                                                 old_snapshot->payload(entry), entry.size});
+            }
+        }
+        // 快照格式不含金字塔层级，只保存原始分辨率层
+        pinned.reserve(lru_lists_[0].size());
+        for (const CacheKey& key : lru_lists_[0]) {
+            const BEVCacheItem& item = cache_map_.at(key);
+            ++item.payload->refs;
+            pinned.push_back(item.payload);
+            if (item.payload->shared) {
+                buffers.push_back(item.payload->shared);
+            }
+            sources.push_back(SnapshotSource{key, item.rows, item.cols, item.codec, item.payload->data(),
+                                             static_cast<uint32_t>(item.payload->size())});
+        }
+    }
+
+    // 2. 按键排序生成索引，同时记录每个条目的LRU位置
+    const uint64_t count = sources.size();
+    std::vector<uint32_t> by_key(count);
+    for (uint32_t i = 0; i < count; ++i) by_key[i] = i;
+    std::sort(by_key.begin(), by_key.end(), [&sources](uint32_t a, uint32_t b) {
+        const BEVBlockKey& ka = sources[a].key;
+        const BEVBlockKey& kb = sources[b].key;
+        if (ka.timestamp != kb.timestamp) return ka.timestamp < kb.timestamp;
+        if (ka.x != kb.x) return ka.x < kb.x;
+        return ka.y < kb.y;
+    });
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.entry_count = count;
+    header.entries_offset = sizeof(SnapshotHeader);
+    header.lru_offset = header.entries_offset + count * sizeof(SnapshotEntry);
+    header.data_offset = header.lru_offset + count * sizeof(uint32_t);
+
+    std::vector<SnapshotEntry> entries(count);
+    std::vector<uint32_t> lru_order(count);  // lru位置 -> 排序后的条目下标
+    uint64_t offset = header.data_offset;
+    for (uint32_t i = 0; i < count; ++i) {
+        const SnapshotSource& src = sources[by_key[i]];
+        SnapshotEntry& entry = entries[i];
+        entry = SnapshotEntry{};
+        entry.timestamp = src.key.timestamp;
+        entry.x = src.key.x;
+        entry.y = src.key.y;
+        entry.rows = src.rows;
+        entry.cols = src.cols;
+        entry.size = src.size;
+        entry.rate = src.codec.rate;
+        entry.codec = src.codec.codec;
+        entry.offset = offset;
+        offset += src.size;
+        lru_order[by_key[i]] = i;
+    }
+    header.file_size = offset;
+
+    // 3. 写入临时文件并落盘后原子替换（旧文件可能仍被映射，替换不影响其内容）：
+    //    rename前fsync文件、rename后fsync目录，掉电后看到的要么是旧快照，要么是完整的新快照。
+    //    任何一步失败都删除临时文件
+    const std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("无法创建快照文件: " + tmp_path);
+    }
+    auto fail = [&](const std::string& message) {
+        ::close(fd);
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error(message);
+    };
+    std::vector<uint8_t> chunk;
+    chunk.reserve(SNAPSHOT_WRITE_CHUNK);
+    bool write_ok = true;
+    auto append = [&](const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        if (chunk.size() + size > SNAPSHOT_WRITE_CHUNK) {
+            write_ok = write_ok && writeAll(fd, chunk.data(), chunk.size());
+            chunk.clear();
+            if (size >= SNAPSHOT_WRITE_CHUNK) {
+                write_ok = write_ok && writeAll(fd, p, size);
+                return;
+            }
+        }
+        chunk.insert(chunk.end(), p, p + size);
+    };
+    append(&header, sizeof(header));
+    append(entries.data(), count * sizeof(SnapshotEntry));
+    append(lru_order.data(), count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; ++i) {
+        const SnapshotSource& src = sources[by_key[i]];
+        append(src.data, src.size);
+    }
+    write_ok = write_ok && writeAll(fd, chunk.data(), chunk.size());
+    if (!write_ok) {
+        fail("写入快照文件失败: " + tmp_path);
+    }
+    if (::fsync(fd) != 0) {
+        fail("同步快照文件失败: " + tmp_path);
+    }
+    if (::close(fd) != 0) {
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error("写入快照文件失败: " + tmp_path);
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp_path.c_str());
+        throw std::runtime_error("替换快照文件失败: " + path);
+    }
+    if (!syncDirectory(path)) {
+        throw std::runtime_error("同步快照目录失败: " + path);
+    }
+}
+
+bool BEVCache::loadSnapshot(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    auto snapshot = std::make_shared<MappedSnapshot>();
+    snapshot->length = static_cast<size_t>(st.st_size);
+    snapshot->base = ::mmap(nullptr, snapshot->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (snapshot->base == MAP_FAILED) {
+        return false;
+    }
+    // 访问模式为随机查找，避免内核整段预读
+    ::madvise(snapshot->base, snapshot->length, MADV_RANDOM);
+
+    // 只校验文件头与各区域边界，不遍历条目
+    const auto* header = static_cast<const SnapshotHeader*>(snapshot->base);
+    const uint64_t count = header->entry_count;
+    bool valid = std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+                 header->version == SNAPSHOT_VERSION &&
+                 header->file_size == snapshot->length &&
+                 count <= snapshot->length / sizeof(SnapshotEntry) &&
+                 header->entries_offset == sizeof(SnapshotHeader) &&
+                 header->lru_offset == header->entries_offset + count * sizeof(SnapshotEntry) &&
+                 header->data_offset == header->lru_offset + count * sizeof(uint32_t) &&
+                 header->data_offset <= snapshot->length;
+    if (!valid) {
+        return false;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(snapshot->base);
+    snapshot->header = header;
+    snapshot->entries = reinterpret_cast<const SnapshotEntry*>(base + header->entries_offset);
+    snapshot->lru_order = reinterpret_cast<const uint32_t*>(base + header->lru_offset);
+    snapshot->count = count;
+    snapshot->superseded.reset(new std::atomic<uint8_t>[count]());
+
+    std::atomic_store(&snapshot_, std::shared_ptr<const MappedSnapshot>(std::move(snapshot)));
+    return true;
+}
+
+size_t BEVCache::warmFromSnapshot(size_t max_items) {
+    std::shared_ptr<const MappedSnapshot> snapshot = std::atomic_load(&snapshot_);
+    if (!snapshot || snapshot->count == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    size_t room = max_cache_size_ > cache_map_.size() ? max_cache_size_ - cache_map_.size() : 0;
+    size_t n = std::min({max_items, room, snapshot->count});
+
+    // 从最近使用端选出n个尚未在内存中的块，再按从旧到新插入以保持原有的相对顺序
+    std::vector<const SnapshotEntry*> selected;
+    selected.reserve(n);
+    for (size_t i = snapshot->count; i-- > 0 && selected.size() < n;) {
+        uint32_t index = snapshot->lru_order[i];
+        if (index >= snapshot->count) continue;
+        const SnapshotEntry& entry = snapshot->entries[index];
+        CacheKey key{entry.timestamp, entry.x, entry.y};
+        if (cache_map_.count(key) || !snapshot->find(key)) continue;
+        selected.push_back(&entry);
+    }
+
+    size_t warmed = 0;
+    for (auto it = selected.rbegin(); it != selected.rend(); ++it) {
+        const SnapshotEntry& entry = **it;
+        CacheKey key{entry.timestamp, entry.x, entry.y};
+        insertItemLocked(key, entry.rows, entry.cols, BEVBlockCodec{entry.codec, entry.rate}, snapshot->payload(entry),
+                         entry.size);
+        ++warmed;
+    }
+    return warmed;
+}
+
+void BEVCache::supersedeSnapshotEntry(const CacheKey& key, const BEVBlockCodec& codec, const uint8_t* data,
+                                      size_t size) const {
+    std::shared_ptr<const MappedSnapshot> snapshot = std::atomic_load(&snapshot_);
+    if (!snapshot) {
+        return;
+    }
+    const SnapshotEntry* entry = snapshot->locate(key);
+    // 内容相同（如从快照提升回内存）时保留，淘汰后仍可从快照取回
+    if (entry && (entry->size != size || BEVBlockCodec{entry->codec, entry->rate} != codec ||
+                  std::memcmp(snapshot->payload(*entry), data, size) != 0)) {
+        snapshot->superseded[entry - snapshot->entries].store(1, std::memory_order_relaxed);
+    }
+}
+
+bool BEVCache::fetchFromSnapshot(const CacheKey& key, std::vector<uint8_t>& data,
+                                 uint16_t& rows, uint16_t& cols, BEVBlockCodec& codec) const {
+    std::shared_ptr<const MappedSnapshot> snapshot = std::atomic_load(&snapshot_);
+    if (!snapshot) {
+        return false;
+    }
+    const SnapshotEntry* entry = snapshot->find(key);
+    if (!entry) {
+        return false;
+    }
+    const uint8_t* payload = snapshot->payload(*entry);
+    data.assign(payload, payload + entry->size);
+    rows = entry->rows;
+    cols = entry->cols;
+    codec = BEVBlockCodec{entry->codec, entry->rate};
+    return true;
+}
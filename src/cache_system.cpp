@@ -1,8 +1,54 @@
 #include "cache_system.h"
+#include "utils.h"
+#include <algorithm>
 #include <iostream>
+#include <cmath>
 #include <cstring>
 #include <mutex>
 
+namespace {
+
+inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 块数据内容哈希（非加密）：每次读入8字节，4路独立累加以利用指令级并行，尾部按字节补齐；
+// 相同哈希时仍逐字节比较内容，冲突不影响正确性
+uint64_t hashPayload(const uint8_t* data, size_t size) {
+    const uint64_t K1 = 0x9e3779b97f4a7c15ULL;
+    const uint64_t K2 = 0xc2b2ae3d27d4eb4fULL;
+    uint64_t acc[4] = {K1, K2, K1 ^ K2, size * K1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, sizeof(word));
+            acc[lane] = rotl64(acc[lane] + word * K2, 31) * K1;
+        }
+    }
+    uint64_t h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = rotl64(h ^ (word * K2), 27) * K1 + K2;
+    }
+    for (; i < size; ++i) {
+        h = rotl64(h ^ (data[i] * K1), 11) * K2;
+    }
+    return mix64(h ^ size);
+}
+
+}  // namespace
+
 // SimpleMemoryPool实现
 SimpleMemoryPool::SimpleMemoryPool(size_t block_size, size_t initial_blocks)
     : block_size_(block_size + sizeof(Block))
@@ -23,6 +69,7 @@ SimpleMemoryPool::SimpleMemoryPool(size_t block_size, size_t initial_blocks)
     
     current->in_use = false;
     current->next = nullptr;
+    total_blocks_.store(initial_blocks, std::memory_order_relaxed);
 }
 
 SimpleMemoryPool::~SimpleMemoryPool() {
@@ -34,6 +81,7 @@ SimpleMemoryPool::~SimpleMemoryPool() {
 void* SimpleMemoryPool::allocate(size_t size) {
     if (size > block_size_ - sizeof(Block)) {
         // 请求的大小超过块大小，使用标准分配
+        oversize_allocations_.fetch_add(1, std::memory_order_relaxed);
         return ::operator new(size);
     }
     
@@ -56,12 +104,14 @@ void* SimpleMemoryPool::allocate(size_t size) {
         
         current->in_use = false;
         current->next = nullptr;
+        total_blocks_.fetch_add(1024, std::memory_order_relaxed);
     }
     
     // 从空闲链表获取块
     Block* block = free_list_;
     free_list_ = block->next;
     block->in_use = true;
+    pool_allocations_.fetch_add(1, std::memory_order_relaxed);
     
     // 返回块中数据部分的指针
     return reinterpret_cast<char*>(block) + sizeof(Block);
@@ -79,181 +129,626 @@ void SimpleMemoryPool::deallocate(void* ptr) {
     block->in_use = false;
     block->next = free_list_;
     free_list_ = block;
+    pool_deallocations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+Json::Value SimpleMemoryPool::getStats() const {
+    uint64_t allocations = pool_allocations_.load(std::memory_order_relaxed);
+    uint64_t deallocations = pool_deallocations_.load(std::memory_order_relaxed);
+    
+    Json::Value root;
+    root["block_size"] = static_cast<Json::UInt64>(block_size_ - sizeof(Block));
+    root["total_blocks"] = static_cast<Json::UInt64>(total_blocks_.load(std::memory_order_relaxed));
+    root["blocks_in_use"] = static_cast<Json::UInt64>(allocations >= deallocations ? allocations - deallocations : 0);
+    root["pool_allocations"] = static_cast<Json::UInt64>(allocations);
+    root["oversize_allocations"] = static_cast<Json::UInt64>(oversize_allocations_.load(std::memory_order_relaxed));
+    return root;
 }
 
 // BEVCache实现
 BEVCache::BEVCache(const BEVCacheConfig& config)
     : memory_pool_(config.memory_pool ? config.memory_pool : std::make_shared<SimpleMemoryPool>(1024)),
-      max_cache_size_(config.max_cache_size)
+      disk_tier_(config.disk_tier),
+      decode_pool_(config.decode_pool),
+      snapshot_path_(config.snapshot_path),
+      snapshot_on_shutdown_(config.snapshot_on_shutdown),
+      max_cache_size_(config.max_cache_size),
+      max_cache_bytes_(config.max_cache_bytes),
+      dedup_(config.dedup)
 {
+    for (int level = 0; level < BEVCompressor::MAX_PYRAMID_LEVELS; ++level) {
+        level_retention_[level] = std::pow(std::max(config.coarse_retention, 1.0), level);
+    }
+    // 热重启：映射上次的快照文件，索引按需查找，启动耗时与快照大小无关
+    if (!snapshot_path_.empty() && config.restore_snapshot) {
+        loadSnapshot(snapshot_path_);
+    }
 }
 
 BEVCache::~BEVCache() {
+    if (snapshot_on_shutdown_ && !snapshot_path_.empty()) {
+        try {
+            saveSnapshot(snapshot_path_);
+        } catch (const std::exception& e) {
+            std::cerr << "保存缓存快照失败: " << e.what() << std::endl;
+        }
+    }
+    
     // 清理缓存
     std::lock_guard<std::mutex> lock(cache_mutex_);
     cache_map_.clear();
-    lru_list_.clear();
+    for (auto& list : lru_lists_) {
+        list.clear();
+    }
+    timestamp_index_.clear();
+    payloads_.clear();
+    shared_buffers_.clear();
+    cache_items_.store(0, std::memory_order_relaxed);
 }
 
 void BEVCache::insertPackets(const std::vector<uint8_t>& compressed_data) {
+    ScopedTimer timer(MetricStage::CACHE_INSERT);
+    BEVMetrics::recordBytes(MetricStage::CACHE_INSERT, compressed_data.size(), 0);
     std::lock_guard<std::mutex> lock(cache_mutex_);
-    
-    const uint8_t* data_ptr = compressed_data.data();
-    size_t remaining_size = compressed_data.size();
-    
-    // 读取数据包数量
-    if (remaining_size < sizeof(uint32_t)) return;
-    
-    uint32_t num_packets = *reinterpret_cast<const uint32_t*>(data_ptr);
-    data_ptr += sizeof(uint32_t);
-    remaining_size -= sizeof(uint32_t);
+    insertStreamLocked(compressed_data, nullptr);
+}
+
+void BEVCache::insertPackets(std::shared_ptr<const std::vector<uint8_t>> compressed_data) {
+    if (!compressed_data) {
+        throw std::invalid_argument("压缩数据为空");
+    }
+    ScopedTimer timer(MetricStage::CACHE_INSERT);
+    BEVMetrics::recordBytes(MetricStage::CACHE_INSERT, compressed_data->size(), 0);
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    // 缓冲区本身就超过字节上限时零拷贝无法容纳：退回逐块拷贝，只保留放得下的块
+    const bool zero_copy = max_cache_bytes_ == 0 || compressed_data->size() <= max_cache_bytes_;
+    insertStreamLocked(*compressed_data, zero_copy ? compressed_data : nullptr);
+}
+
+void BEVCache::insertStreamLocked(const std::vector<uint8_t>& compressed_data,
+                                  const std::shared_ptr<const std::vector<uint8_t>>& owner) {
+    CompressedStreamView view(compressed_data);
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block block;
+    const BEVBlockCodec codec = view.header().block_codec();
     
     // 处理每个数据包
-    for (uint32_t i = 0; i < num_packets && remaining_size > 0; ++i) {
-        // 读取时间戳
-        if (remaining_size < sizeof(uint64_t)) break;
-        
-        uint64_t timestamp = *reinterpret_cast<const uint64_t*>(data_ptr);
-        data_ptr += sizeof(uint64_t);
-        remaining_size -= sizeof(uint64_t);
-        
-        // 读取块数量
-        if (remaining_size < sizeof(uint16_t)) break;
-        
-        uint16_t num_blocks = *reinterpret_cast<const uint16_t*>(data_ptr);
-        data_ptr += sizeof(uint16_t);
-        remaining_size -= sizeof(uint16_t);
+    while (view.next_frame(frame)) {
+        const uint8_t level = static_cast<uint8_t>(frame.level);
         
         // 处理每个块
-        for (uint16_t j = 0; j < num_blocks && remaining_size > 0; ++j) {
-            // 读取块头
-            if (remaining_size < 4 * sizeof(uint16_t)) break;
-            
-            uint16_t x = *reinterpret_cast<const uint16_t*>(data_ptr);
-            data_ptr += sizeof(uint16_t);
-            
-            uint16_t y = *reinterpret_cast<const uint16_t*>(data_ptr);
-            data_ptr += sizeof(uint16_t);
-            
-            uint16_t rows = *reinterpret_cast<const uint16_t*>(data_ptr);
-            data_ptr += sizeof(uint16_t);
-            
-            uint16_t block_size = *reinterpret_cast<const uint16_t*>(data_ptr);
-            data_ptr += sizeof(uint16_t);
-            
-            remaining_size -= 4 * sizeof(uint16_t);
-            
-            // 读取压缩数据
-            if (remaining_size < block_size) break;
-            
-            // 创建缓存项
-            BEVCacheItem item;
-            item.timestamp = timestamp;
-            item.x = x;
-            item.y = y;
-            item.rows = rows;
-            item.compressed_data.assign(data_ptr, data_ptr + block_size);
-            
-            // 更新数据指针
-            data_ptr += block_size;
-            remaining_size -= block_size;
+        while (view.next_block(block)) {
+            const BEVCompressor::BlockHeader& header = block.header;
+            if (header.row_offset > UINT16_MAX || header.col_offset > UINT16_MAX ||
+                header.block_rows > UINT16_MAX || header.block_cols > UINT16_MAX) {
+                throw std::out_of_range("块偏移超出缓存键范围");
+            }
             
-            // 生成键
-            CacheKey key = {timestamp, x, y};
+            // 创建缓存项（内容相同的块数据只存一份）
+            const CacheKey key{frame.header.timestamp, static_cast<uint16_t>(header.row_offset),
+                               static_cast<uint16_t>(header.col_offset), level};
+            insertItemLocked(key, static_cast<uint16_t>(header.block_rows),
+                             static_cast<uint16_t>(header.block_cols), codec, block.data, header.compressed_size,
+                             owner);
+        }
+    }
+}
+
+bool BEVCache::retrieve(uint64_t timestamp, uint16_t x, uint16_t y, 
+                       std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec) {
+    ScopedTimer timer(MetricStage::CACHE_RETRIEVE);
+    const CacheKey key{timestamp, x, y};
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        
+        // 查找缓存项并更新LRU
+        BEVCacheItem* item = touchLocked(key);
+        if (item) {
+            // 命中
+            total_hits_.fetch_add(1, std::memory_order_relaxed);
             
-            // 检查是否已存在
-            auto it = cache_map_.find(key);
-            if (it != cache_map_.end()) {
-                // 移除旧项
-                lru_list_.erase(it->second.lru_iterator);
-                cache_map_.erase(it);
+            // 返回数据
+            data.assign(item->payload->data(), item->payload->data() + item->payload->size());
+            BEVMetrics::recordBytes(MetricStage::CACHE_RETRIEVE, 0, data.size());
+            rows = item->rows;
+            cols = item->cols;
+            if (codec) *codec = item->codec;
+            return true;
+        }
+    }
+    
+    // 内存未命中：在锁外查询快照与磁盘二级缓存
+    BEVBlockCodec lower_codec;
+    if (fetchFromLowerTiers(key, data, rows, cols, lower_codec)) {
+        total_hits_.fetch_add(1, std::memory_order_relaxed);
+        if (codec) *codec = lower_codec;
+        return true;
+    }
+    
+    // 未命中
+    total_misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+size_t BEVCache::retrieveBatch(const std::vector<CacheKey>& keys, std::vector<BatchEntry>& results) {
+    ScopedTimer timer(MetricStage::CACHE_RETRIEVE);
+    results.resize(keys.size());
+    size_t hits = 0;
+    uint64_t bytes_out = 0;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            BatchEntry& entry = results[i];
+            entry.key = keys[i];
+            BEVCacheItem* item = touchLocked(keys[i]);
+            entry.hit = item != nullptr;
+            if (!item) {
+                entry.data.clear();
+                continue;
             }
-            
-            // 如果缓存已满，移除最旧的项
-            if (cache_map_.size() >= max_cache_size_) {
-                evictOldestItem();
+            entry.data.assign(item->payload->data(), item->payload->data() + item->payload->size());
+            entry.rows = item->rows;
+            entry.cols = item->cols;
+            entry.codec = item->codec;
+            bytes_out += entry.data.size();
+            ++hits;
+        }
+    }
+    
+    // 内存未命中的键在锁外逐个查询快照与磁盘二级缓存
+    if (hits < keys.size() && hasLowerTiers()) {
+        for (BatchEntry& entry : results) {
+            if (!entry.hit && fetchFromLowerTiers(entry.key, entry.data, entry.rows, entry.cols, entry.codec)) {
+                entry.hit = true;
+                bytes_out += entry.data.size();
+                ++hits;
             }
-            
-            // 将新项添加到LRU链表尾部（最近使用）
-            lru_list_.push_back(timestamp);
-            item.lru_iterator = --lru_list_.end();
-            
-            // 添加到缓存映射
-            cache_map_[key] = std::move(item);
         }
     }
+    BEVMetrics::recordBytes(MetricStage::CACHE_RETRIEVE, 0, bytes_out);
+    
+    // 统计信息整批更新一次
+    total_hits_.fetch_add(hits, std::memory_order_relaxed);
+    total_misses_.fetch_add(keys.size() - hits, std::memory_order_relaxed);
+    return hits;
 }
 
-bool BEVCache::retrieve(uint64_t timestamp, uint16_t x, uint16_t y, 
-                       std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols) {
-    std::lock_guard<std::mutex> lock(cache_mutex_);
+size_t BEVCache::retrieveBatch(uint64_t timestamp, const std::vector<std::pair<uint16_t, uint16_t>>& blocks,
+                               std::vector<BatchEntry>& results) {
+    std::vector<CacheKey> keys;
+    keys.reserve(blocks.size());
+    for (const auto& block : blocks) {
+        keys.push_back(CacheKey{timestamp, block.first, block.second});
+    }
+    return retrieveBatch(keys, results);
+}
+
+size_t BEVCache::retrieveFrame(uint64_t timestamp, const BEVCompressor& compressor,
+                               Eigen::MatrixXf& frame, std::vector<CacheKey>* misses) {
+    return retrieveRegion(timestamp, 0, 0, 0, compressor, frame, misses);
+}
+
+size_t BEVCache::retrieveRegion(uint64_t timestamp, uint8_t level, int row, int col,
+                                const BEVCompressor& compressor, Eigen::MatrixXf& region,
+                                std::vector<CacheKey>* misses) {
+    const int bs = compressor.get_config().block_size;
+    if (row < 0 || col < 0) {
+        throw std::invalid_argument("检索区域的起点不能为负");
+    }
+    
+    // 与区域相交的块
+    const int first_row = row / bs * bs;
+    const int first_col = col / bs * bs;
+    std::vector<CacheKey> keys;
+    keys.reserve(((row + region.rows() - first_row + bs - 1) / bs) * ((col + region.cols() - first_col + bs - 1) / bs));
+    for (int i = first_row; i < row + region.rows(); i += bs) {
+        for (int j = first_col; j < col + region.cols(); j += bs) {
+            keys.push_back(CacheKey{timestamp, static_cast<uint16_t>(i), static_cast<uint16_t>(j), level});
+        }
+    }
+    
+    std::vector<BatchEntry> entries;
+    size_t hits = retrieveBatch(keys, entries);
+    
+    // 并行解码：每个块写入region中互不重叠的区域
+    auto decode_entry = [&](const BatchEntry& entry) {
+        // 完全落在区域内的块直接解码到目标位置，部分相交的块先解码到临时矩阵再拷贝交集
+        if (entry.key.x >= row && entry.key.y >= col &&
+            entry.key.x + entry.rows <= row + region.rows() && entry.key.y + entry.cols <= col + region.cols()) {
+            compressor.decode_block(entry.codec, entry.data.data(), entry.data.size(),
+                                    region.block(entry.key.x - row, entry.key.y - col, entry.rows, entry.cols));
+            return;
+        }
+        Eigen::MatrixXf block(entry.rows, entry.cols);
+        compressor.decode_block(entry.codec, entry.data.data(), entry.data.size(), block);
+        const int r0 = std::max<int>(entry.key.x, row);
+        const int c0 = std::max<int>(entry.key.y, col);
+        const int r1 = std::min<int>(entry.key.x + entry.rows, row + region.rows());
+        const int c1 = std::min<int>(entry.key.y + entry.cols, col + region.cols());
+        if (r0 < r1 && c0 < c1) {
+            region.block(r0 - row, c0 - col, r1 - r0, c1 - c0) =
+                block.block(r0 - entry.key.x, c0 - entry.key.y, r1 - r0, c1 - c0);
+        }
+    };
+    // 异常不能逃出OpenMP并行区（会直接终止进程）：逐块捕获，解码失败的块在循环结束后按未命中处理
+    std::vector<uint8_t> failed(entries.size(), 0);
+    auto decode = [&](size_t k) {
+        if (!entries[k].hit) {
+            return;
+        }
+        try {
+            decode_entry(entries[k]);
+        } catch (const std::exception&) {
+            failed[k] = 1;
+        }
+    };
+    if (decode_pool_) {
+        // 整个区域交给一个节点的线程，块按行优先的连续区间划分
+        decode_pool_->runPartitioned({entries.size()}, [&](size_t, int, size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) decode(k);
+        });
+    } else {
+        const int num_entries = static_cast<int>(entries.size());
+        #pragma omp parallel for schedule(dynamic, 8)
+        for (int k = 0; k < num_entries; ++k) {
+            decode(static_cast<size_t>(k));
+        }
+    }
     
-    // 生成键
-    CacheKey key = {timestamp, x, y};
+    size_t decode_errors = 0;
+    for (size_t k = 0; k < entries.size(); ++k) {
+        if (failed[k]) {
+            entries[k].hit = false;
+            ++decode_errors;
+        }
+    }
+    if (decode_errors > 0) {
+        hits -= decode_errors;
+        total_hits_.fetch_sub(decode_errors, std::memory_order_relaxed);
+        total_misses_.fetch_add(decode_errors, std::memory_order_relaxed);
+        decode_errors_.fetch_add(decode_errors, std::memory_order_relaxed);
+    }
     
-    // 查找缓存项
+    if (misses) {
+        for (const BatchEntry& entry : entries) {
+            if (!entry.hit) {
+                misses->push_back(entry.key);
+            }
+        }
+    }
+    return hits;
+}
+
+BEVCacheItem* BEVCache::touchLocked(const CacheKey& key) {
     auto it = cache_map_.find(key);
     if (it == cache_map_.end()) {
-        // 未命中
-        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
-        total_misses_++;
-        return false;
+        return nullptr;
     }
     
-    // 命中
-    {
-        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
-        total_hits_++;
+    // 更新LRU链表（移到尾部表示最近使用）
+    BEVCacheItem& item = it->second;
+    std::list<CacheKey>& list = lru_lists_[key.level];
+    list.splice(list.end(), list, item.lru_iterator);
+    item.last_access = ++access_clock_;
+    return &item;
+}
+
+void BEVCache::insertItemLocked(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                                const uint8_t* data, size_t size,
+                                const std::shared_ptr<const std::vector<uint8_t>>& owner) {
+    // 检查是否已存在
+    auto it = cache_map_.find(key);
+    if (it != cache_map_.end()) {
+        // 移除旧项
+        lru_lists_[key.level].erase(it->second.lru_iterator);
+        releasePayloadLocked(it->second.payload);
+        cache_map_.erase(it);
+        releaseTimestamp(key.timestamp);
+    }
+    
+    if (key.level == 0) {
+        supersedeSnapshotEntry(key, codec, data, size);
     }
     
-    // 获取缓存项
-    const BEVCacheItem& item = it->second;
+    // 先取得块数据的引用：淘汰时与新块内容相同的数据不会被释放
+    BEVBlockPayload* payload = acquirePayloadLocked(data, size, owner);
     
-    // 更新LRU链表（移到尾部表示最近使用）
-    lru_list_.erase(item.lru_iterator);
-    lru_list_.push_back(timestamp);
-    const_cast<BEVCacheItem&>(item).lru_iterator = --lru_list_.end();
+    // 如果缓存已满，移除最旧的项
+    while (!cache_map_.empty() && overCapacityLocked()) {
+        evictOldestItem();
+    }
+    
+    // 将新项添加到LRU链表尾部（最近使用）
+    std::list<CacheKey>& list = lru_lists_[key.level];
+    list.push_back(key);
+    BEVCacheItem& item = cache_map_[key];
+    item.timestamp = key.timestamp;
+    item.x = key.x;
+    item.y = key.y;
+    item.rows = rows;
+    item.cols = cols;
+    item.codec = codec;
+    item.payload = payload;
+    item.last_access = ++access_clock_;
+    item.generation = ++generation_clock_;
+    item.lru_iterator = --list.end();
+    ++timestamp_index_[key.timestamp];
+    cache_items_.store(cache_map_.size(), std::memory_order_relaxed);
+}
+
+bool BEVCache::overCapacityLocked() const {
+    return cache_map_.size() >= max_cache_size_ ||
+           (max_cache_bytes_ > 0 && stored_bytes_.load(std::memory_order_relaxed) +
+                                    pinned_bytes_.load(std::memory_order_relaxed) > max_cache_bytes_);
+}
+
+BEVBlockPayload* BEVCache::acquirePayloadLocked(const uint8_t* data, size_t size,
+                                                const std::shared_ptr<const std::vector<uint8_t>>& owner) {
+    const uint64_t hash = hashPayload(data, size);
+    if (dedup_) {
+        auto range = payloads_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            BEVBlockPayload* payload = it->second.get();
+            if (payload->size() == size && std::memcmp(payload->data(), data, size) == 0) {
+                ++payload->refs;
+                dedup_hits_.fetch_add(1, std::memory_order_relaxed);
+                logical_bytes_.store(logical_bytes_.load(std::memory_order_relaxed) + size,
+                                     std::memory_order_relaxed);
+                return payload;
+            }
+        }
+    }
+    
+    auto payload = std::make_unique<BEVBlockPayload>();
+    payload->hash = hash;
+    payload->refs = 1;
+    if (owner) {
+        payload->shared = std::shared_ptr<const uint8_t>(owner, data);
+        payload->shared_size = static_cast<uint32_t>(size);
+        payload->buffer = owner.get();
+        shared_payloads_.fetch_add(1, std::memory_order_relaxed);
+        // 首次引用时整个缓冲区计为占用，之后每个块数据从中转为存活字节
+        SharedBuffer& buffer = shared_buffers_[owner.get()];
+        if (buffer.payloads.empty()) {
+            buffer.size = owner->size();
+            pinned_bytes_.fetch_add(buffer.size, std::memory_order_relaxed);
+        }
+        buffer.payloads.insert(payload.get());
+        buffer.initial_bytes += size;
+        buffer.live_bytes += size;
+        pinned_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    } else {
+        payload->bytes.assign(data, data + size);
+    }
+    BEVBlockPayload* raw = payload.get();
+    payloads_.emplace(hash, std::move(payload));
+    logical_bytes_.store(logical_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    stored_bytes_.store(stored_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    unique_payloads_.store(payloads_.size(), std::memory_order_relaxed);
+    return raw;
+}
+
+void BEVCache::releasePayloadLocked(BEVBlockPayload* payload, std::vector<uint8_t>* take) {
+    const size_t size = payload->size();
+    if (take) {
+        if (payload->shared) {
+            take->assign(payload->data(), payload->data() + size);
+        } else if (payload->refs == 1) {
+            *take = std::move(payload->bytes);
+        } else {
+            *take = payload->bytes;
+        }
+    }
+    logical_bytes_.store(logical_bytes_.load(std::memory_order_relaxed) - size, std::memory_order_relaxed);
+    if (--payload->refs > 0) {
+        return;
+    }
+    freePayloadLocked(payload);
+}
+
+void BEVCache::freePayloadLocked(BEVBlockPayload* payload) {
+    // erase之后payload已被销毁，先取出需要的字段
+    const size_t size = payload->size();
+    const void* shared_buffer = payload->buffer;
+    if (payload->shared) {
+        shared_payloads_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    auto range = payloads_.equal_range(payload->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.get() == payload) {
+            payloads_.erase(it);
+            break;
+        }
+    }
+    stored_bytes_.store(stored_bytes_.load(std::memory_order_relaxed) - size, std::memory_order_relaxed);
+    unique_payloads_.store(payloads_.size(), std::memory_order_relaxed);
+    
+    if (shared_buffer) {
+        auto it = shared_buffers_.find(shared_buffer);
+        SharedBuffer& buffer = it->second;
+        buffer.payloads.erase(payload);
+        buffer.live_bytes -= size;
+        if (buffer.payloads.empty()) {
+            // 最后一个块已释放，缓冲区随之释放
+            pinned_bytes_.fetch_sub(buffer.size - size, std::memory_order_relaxed);
+            shared_buffers_.erase(it);
+        } else if (buffer.live_bytes * 2 < buffer.initial_bytes) {
+            // 大部分块已淘汰：拷出剩余的块，不再为少数块占住整个缓冲区
+            pinned_bytes_.fetch_add(size, std::memory_order_relaxed);
+            compactSharedBufferLocked(shared_buffer);
+        } else {
+            pinned_bytes_.fetch_add(size, std::memory_order_relaxed);
+        }
+    }
+}
+
+void BEVCache::compactSharedBufferLocked(const void* buffer_id) {
+    auto it = shared_buffers_.find(buffer_id);
+    if (it == shared_buffers_.end()) {
+        return;
+    }
+    for (BEVBlockPayload* payload : it->second.payloads) {
+        payload->bytes.assign(payload->data(), payload->data() + payload->size());
+        payload->shared.reset();
+        payload->shared_size = 0;
+        payload->buffer = nullptr;
+        shared_payloads_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    pinned_bytes_.fetch_sub(it->second.size - it->second.live_bytes, std::memory_order_relaxed);
+    shared_buffers_.erase(it);
+    compacted_buffers_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BEVCache::hasLowerTiers() const {
+    return disk_tier_ || std::atomic_load(&snapshot_);
+}
+
+bool BEVCache::fetchFromLowerTiers(const CacheKey& key, std::vector<uint8_t>& data,
+                                   uint16_t& rows, uint16_t& cols, BEVBlockCodec& codec) {
+    // 快照与磁盘只保存原始分辨率层
+    if (key.level != 0) {
+        return false;
+    }
+    // 先查磁盘：磁盘保存的是淘汰时的最新数据，快照可能早于它（如快照之后又重新插入并淘汰）
+    if (disk_tier_ && disk_tier_->get(key, data, rows, cols, &codec)) {
+        disk_tier_hits_.fetch_add(1, std::memory_order_relaxed);
+    } else if (fetchFromSnapshot(key, data, rows, cols, codec)) {
+        snapshot_hits_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        return false;
+    }
     
-    // 返回数据
-    data = item.compressed_data;
-    rows = item.rows;
-    cols = 16; // 假设列数固定为16，根据实际情况调整
+    // 提升回内存缓存（期间若已被其他线程插入则保留较新的内存数据）
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_map_.find(key) == cache_map_.end()) {
+        insertItemLocked(key, rows, cols, codec, data.data(), data.size());
+    }
+    return true;
+}
+
+bool BEVCache::touch(uint64_t timestamp, uint16_t x, uint16_t y, uint64_t generation) {
+    const CacheKey key{timestamp, x, y};
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = cache_map_.find(key);
+    if (it == cache_map_.end() || (generation != 0 && it->second.generation != generation)) {
+        return false;
+    }
+    touchLocked(key);
+    total_hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool BEVCache::peek(uint64_t timestamp, uint16_t x, uint16_t y,
+                    std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec,
+                    uint64_t* generation) const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
     
+    auto it = cache_map_.find(CacheKey{timestamp, x, y});
+    if (it == cache_map_.end()) {
+        return false;
+    }
+    
+    data.assign(it->second.payload->data(), it->second.payload->data() + it->second.payload->size());
+    rows = it->second.rows;
+    cols = it->second.cols;
+    if (codec) *codec = it->second.codec;
+    if (generation) *generation = it->second.generation;
+    return true;
+}
+
+bool BEVCache::nextTimestamp(uint64_t timestamp, uint64_t& next) const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    
+    auto it = timestamp_index_.upper_bound(timestamp);
+    if (it == timestamp_index_.end()) {
+        return false;
+    }
+    next = it->first;
     return true;
 }
 
 double BEVCache::getHitRate() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    uint64_t total = total_hits_ + total_misses_;
-    return total > 0 ? static_cast<double>(total_hits_) / total : 0.0;
+    uint64_t hits = total_hits_.load(std::memory_order_relaxed);
+    uint64_t total = hits + total_misses_.load(std::memory_order_relaxed);
+    return total > 0 ? static_cast<double>(hits) / total : 0.0;
 }
 
-std::string BEVCache::getStatsAsJSON() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    
+Json::Value BEVCache::getStats() const {
+    // 只读取原子计数器，不获取任何锁，可在任意线程随时调用
     Json::Value root;
-    root["total_hits"] = static_cast<Json::UInt64>(total_hits_);
-    root["total_misses"] = static_cast<Json::UInt64>(total_misses_);
+    root["total_hits"] = static_cast<Json::UInt64>(total_hits_.load(std::memory_order_relaxed));
+    root["total_misses"] = static_cast<Json::UInt64>(total_misses_.load(std::memory_order_relaxed));
+    root["total_evictions"] = static_cast<Json::UInt64>(total_evictions_.load(std::memory_order_relaxed));
     root["hit_rate"] = getHitRate();
-    root["cache_size"] = static_cast<Json::UInt64>(cache_map_.size());
+    root["cache_size"] = static_cast<Json::UInt64>(cache_items_.load(std::memory_order_relaxed));
     root["max_cache_size"] = static_cast<Json::UInt64>(max_cache_size_);
-    
+    // 去重：逻辑字节数（各缓存项之和）/ 实际存储字节数
+    const uint64_t logical = logical_bytes_.load(std::memory_order_relaxed);
+    const uint64_t stored = stored_bytes_.load(std::memory_order_relaxed);
+    root["logical_bytes"] = static_cast<Json::UInt64>(logical);
+    root["stored_bytes"] = static_cast<Json::UInt64>(stored);
+    root["unique_payloads"] = static_cast<Json::UInt64>(unique_payloads_.load(std::memory_order_relaxed));
+    root["dedup_hits"] = static_cast<Json::UInt64>(dedup_hits_.load(std::memory_order_relaxed));
+    root["shared_payloads"] = static_cast<Json::UInt64>(shared_payloads_.load(std::memory_order_relaxed));
+    root["pinned_buffer_bytes"] = static_cast<Json::UInt64>(pinned_bytes_.load(std::memory_order_relaxed));
+    root["compacted_buffers"] = static_cast<Json::UInt64>(compacted_buffers_.load(std::memory_order_relaxed));
+    root["dedup_ratio"] = stored > 0 ? static_cast<double>(logical) / stored : 1.0;
+    if (max_cache_bytes_ > 0) {
+        root["max_cache_bytes"] = static_cast<Json::UInt64>(max_cache_bytes_);
+    }
+    root["decode_errors"] = static_cast<Json::UInt64>(decode_errors_.load(std::memory_order_relaxed));
+    root["snapshot_hits"] = static_cast<Json::UInt64>(snapshot_hits_.load(std::memory_order_relaxed));
+    if (disk_tier_) {
+        root["disk_tier_hits"] = static_cast<Json::UInt64>(disk_tier_hits_.load(std::memory_order_relaxed));
+        root["disk_tier"] = disk_tier_->getStats();
+    }
+    return root;
+}
+
+std::string BEVCache::getStatsAsJSON() const {
     Json::FastWriter writer;
-    return writer.write(root);
+    return writer.write(getStats());
 }
 
 void BEVCache::evictOldestItem() {
-    if (lru_list_.empty()) return;
+    // 各层LRU链表头部即该层最久未使用的块；粗层的空闲时长按驻留倍数折算，驻留更久
+    int victim = -1;
+    double victim_idle = -1.0;
+    for (int level = 0; level < BEVCompressor::MAX_PYRAMID_LEVELS; ++level) {
+        if (lru_lists_[level].empty()) continue;
+        const BEVCacheItem& head = cache_map_.at(lru_lists_[level].front());
+        const double idle = static_cast<double>(access_clock_ - head.last_access) / level_retention_[level];
+        if (idle > victim_idle) {
+            victim = level;
+            victim_idle = idle;
+        }
+    }
+    if (victim < 0) return;
+    ScopedTimer timer(MetricStage::CACHE_EVICT);
     
-    // 获取最旧的时间戳
-    uint64_t oldest_timestamp = lru_list_.front();
+    CacheKey oldest = lru_lists_[victim].front();
+    lru_lists_[victim].pop_front();
     
-    // 查找最旧的项并移除
-    for (auto it = cache_map_.begin(); it != cache_map_.end(); ++it) {
-        if (it->second.timestamp == oldest_timestamp) {
-            lru_list_.erase(it->second.lru_iterator);
-            cache_map_.erase(it);
-            break;
-        }
+    auto it = cache_map_.find(oldest);
+    if (it == cache_map_.end()) return;
+    
+    // 淘汰的原始分辨率块交给磁盘二级缓存（异步写入）；磁盘格式不含层级，粗层直接丢弃
+    if (disk_tier_ && oldest.level == 0) {
+        std::vector<uint8_t> data;
+        releasePayloadLocked(it->second.payload, &data);
+        disk_tier_->put(oldest, it->second.rows, it->second.cols, it->second.codec, std::move(data));
+    } else {
+        releasePayloadLocked(it->second.payload);
     }
-}    
\ No newline at end of file
+    cache_map_.erase(it);
+    releaseTimestamp(oldest.timestamp);
+    total_evictions_.fetch_add(1, std::memory_order_relaxed);
+    cache_items_.store(cache_map_.size(), std::memory_order_relaxed);
+}
+
+void BEVCache::releaseTimestamp(uint64_t timestamp) {
+    auto it = timestamp_index_.find(timestamp);
+    if (it != timestamp_index_.end() && --it->second == 0) {
+        timestamp_index_.erase(it);
+    }
+}
@@ -1,86 +1,725 @@
 #include "compressor.h"
+#include "lossless_codec.h"
+#include "worker_pool.h"
+#include "utils.h"
 #include <zfp.h>
 // #include <eigen3/Eigen/Core>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
-BEVCompressor::BEVCompressor(const Config& config) : config_(config) {}
+namespace {
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// 写入流头（标识、版本、编码方式、码率、数据包数量）
+void append_stream_header(std::vector<uint8_t>& compressed_data, uint8_t codec, int pyramid_levels,
+                          float rate, uint32_t num_packets) {
+    append(compressed_data, BEVCompressor::STREAM_MAGIC);
+    append(compressed_data, BEVCompressor::STREAM_VERSION);
+    append(compressed_data, codec);
+    append(compressed_data, static_cast<uint8_t>(pyramid_levels > 1 ? pyramid_levels : 0));
+    append(compressed_data, rate);
+    append(compressed_data, num_packets);
+}
+
+void append_frame_header(std::vector<uint8_t>& compressed_data, uint64_t timestamp,
+                         uint32_t rows, uint32_t cols, uint32_t nums_block) {
+    append(compressed_data, timestamp);
+    append(compressed_data, rows);
+    append(compressed_data, cols);
+    append(compressed_data, nums_block);
+}
+
+// 校验流头的编码方式
+void check_codec(const BEVCompressor::StreamHeader& stream) {
+    if (stream.codec > BEVCompressor::CODEC_SHUFFLE_LZ) {
+        throw std::runtime_error("不支持的压缩编码: " + std::to_string(stream.codec));
+    }
+}
+
+// CODEC_ZFP_BLOCK_RATE的块数据：跳过首字节的码率提升级数，返回该块的码率
+double strip_rate_prefix(const uint8_t*& data, size_t& size, double rate) {
+    if (size == 0) {
+        throw std::runtime_error("压缩数据格式错误：块数据缺少码率前缀");
+    }
+    const int level = data[0];
+    ++data;
+    --size;
+    return BEVCompressor::escalated_rate(rate, level);
+}
+
+// 设置ZFP流参数：无损为可逆模式（逐位精确，压缩大小随数据变化），否则为固定码率
+void configure_zfp_stream(zfp_stream* stream, double rate, int mode) {
+    if (mode == BEVCompressor::Config::ZFP_MODE_LOSSLESS) {
+        zfp_stream_set_reversible(stream);
+    } else {
+        zfp_stream_set_rate(stream, rate, zfp_type_float, 2, mode);
+    }
+}
+
+// ---------------- 在线质量校验 ----------------
+
+// 误差核：逐列（列内连续）比较原始块与重建块，SIMD归约出最大绝对误差、平方误差和与原始取值范围。
+// 列内用float累加（单列不超过数千个数值），列间用double累加
+BEVCompressor::QualityStats measure_block_error(const Eigen::Ref<const Eigen::MatrixXf>& original,
+                                                const Eigen::Ref<const Eigen::MatrixXf>& decoded) {
+    const Eigen::Index rows = original.rows();
+    float max_abs = 0.0f;
+    float lo = std::numeric_limits<float>::max();
+    float hi = std::numeric_limits<float>::lowest();
+    double sum_squared = 0.0;
+    for (Eigen::Index c = 0; c < original.cols(); ++c) {
+        const float* a = original.data() + c * original.outerStride();
+        const float* b = decoded.data() + c * decoded.outerStride();
+        float column_squared = 0.0f;
+        #pragma omp simd reduction(max:max_abs, hi) reduction(min:lo) reduction(+:column_squared)
+        for (Eigen::Index r = 0; r < rows; ++r) {
+            const float diff = a[r] - b[r];
+            max_abs = std::max(max_abs, std::fabs(diff));
+            column_squared += diff * diff;
+            lo = std::min(lo, a[r]);
+            hi = std::max(hi, a[r]);
+        }
+        sum_squared += column_squared;
+    }
+
+    BEVCompressor::QualityStats stats;
+    stats.blocks = 1;
+    stats.values = static_cast<uint64_t>(original.size());
+    stats.max_abs_error = max_abs;
+    stats.sum_squared_error = sum_squared;
+    stats.value_min = lo;
+    stats.value_max = hi;
+    return stats;
+}
+
+// ---------------- 固定尺寸块内核 ----------------
+
+// 每线程复用的ZFP对象：字段固定指向N x N的连续块，流参数只在码率或模式变化时重新设置
+template <int N>
+class FixedBlockState {
+public:
+    using Tile = Eigen::Matrix<float, N, N>;
+
+    FixedBlockState() {
+        field_ = zfp_field_2d(tile.data(), zfp_type_float, N, N);
+        stream_ = zfp_stream_open(nullptr);
+        if (!field_ || !stream_) {
+            throw std::runtime_error("ZFP字段或流创建失败");
+        }
+    }
+
+    ~FixedBlockState() {
+        zfp_stream_close(stream_);
+        zfp_field_free(field_);
+    }
+
+    FixedBlockState(const FixedBlockState&) = delete;
+    FixedBlockState& operator=(const FixedBlockState&) = delete;
+
+    static FixedBlockState& local() {
+        thread_local FixedBlockState state;
+        return state;
+    }
+
+    // 设置码率并缓存整块压缩结果的上界
+    void configure(double rate, int mode) {
+        if (rate != rate_ || mode != mode_) {
+            configure_zfp_stream(stream_, rate, mode);
+            max_bytes_ = zfp_stream_maximum_size(stream_, field_);
+            rate_ = rate;
+            mode_ = mode;
+        }
+    }
+
+    size_t max_bytes() const { return max_bytes_; }
+
+    // 在buffer上压缩/解压tile，返回压缩字节数（失败为0）
+    size_t compress(uint8_t* buffer, size_t capacity) {
+        bitstream* bit = stream_open(buffer, capacity);
+        if (!bit) {
+            throw std::runtime_error("比特流创建失败");
+        }
+        zfp_stream_set_bit_stream(stream_, bit);
+        zfp_stream_rewind(stream_);
+        size_t bytes = zfp_compress(stream_, field_);
+        if (bytes) {
+            bytes = stream_size(bit);
+        }
+        zfp_stream_set_bit_stream(stream_, nullptr);
+        stream_close(bit);
+        return bytes;
+    }
+
+    bool decompress(const uint8_t* data, size_t size) {
+        bitstream* bit = stream_open(const_cast<uint8_t*>(data), size);
+        if (!bit) {
+            throw std::runtime_error("比特流创建失败");
+        }
+        zfp_stream_set_bit_stream(stream_, bit);
+        zfp_stream_rewind(stream_);
+        bool success = zfp_decompress(stream_, field_) != 0;
+        zfp_stream_set_bit_stream(stream_, nullptr);
+        stream_close(bit);
+        return success;
+    }
+
+    alignas(64) Tile tile;
+
+private:
+    zfp_field* field_ = nullptr;
+    zfp_stream* stream_ = nullptr;
+    double rate_ = -1.0;
+    int mode_ = -1;
+    size_t max_bytes_ = 0;
+};
+
+template <int N>
+using StridedTile = Eigen::Map<const Eigen::Matrix<float, N, N>, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+template <int N>
+size_t compress_fixed_block(const float* src, Eigen::Index outer_stride, double rate, int mode,
+                            std::vector<uint8_t>& out) {
+    FixedBlockState<N>& state = FixedBlockState<N>::local();
+    state.configure(rate, mode);
+    // 固定尺寸：Eigen把跨步块的收集展开为逐列的向量化拷贝
+    state.tile = StridedTile<N>(src, Eigen::OuterStride<>(outer_stride));
+
+    const size_t offset = out.size();
+    out.resize(offset + state.max_bytes());
+    const size_t bytes = state.compress(out.data() + offset, state.max_bytes());
+    if (!bytes) {
+        out.resize(offset);
+        throw std::runtime_error("块压缩失败");
+    }
+    out.resize(offset + bytes);
+    return bytes;
+}
+
+template <int N>
+void decompress_fixed_block(const uint8_t* data, size_t size, float* dst, Eigen::Index outer_stride,
+                            double rate, int mode) {
+    FixedBlockState<N>& state = FixedBlockState<N>::local();
+    state.configure(rate, mode);
+    if (!state.decompress(data, size)) {
+        throw std::runtime_error("ZFP解压失败");
+    }
+    Eigen::Map<Eigen::Matrix<float, N, N>, Eigen::Unaligned, Eigen::OuterStride<>>(
+        dst, Eigen::OuterStride<>(outer_stride)) = state.tile;
+}
+
+// 分派表：生产环境使用的块大小
+template <int N>
+constexpr BEVCompressor::BlockKernel make_kernel() {
+    return {N, &compress_fixed_block<N>, &decompress_fixed_block<N>};
+}
+
+const BEVCompressor::BlockKernel FIXED_KERNELS[] = {
+    make_kernel<4>(),
+    make_kernel<8>(),
+    make_kernel<16>(),
+    make_kernel<32>(),
+};
+
+}  // namespace
+
+BEVCompressor::BEVCompressor(const Config& config) : config_(config) {
+    if (config_.fixed_kernels) {
+        for (const BlockKernel& kernel : FIXED_KERNELS) {
+            if (kernel.block_size == config_.block_size) {
+                kernel_ = &kernel;
+                break;
+            }
+        }
+    }
+}
+
+double BEVCompressor::escalated_rate(double rate, int level) {
+    if (level <= 0) {
+        return rate;
+    }
+    return std::max(rate, std::min(std::ldexp(rate, level), static_cast<double>(MAX_BLOCK_RATE)));
+}
+
+double BEVCompressor::QualityStats::rmse() const {
+    return values > 0 ? std::sqrt(sum_squared_error / values) : 0.0;
+}
+
+double BEVCompressor::QualityStats::psnr_db() const {
+    const double error = rmse();
+    if (error <= 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    const double peak = value_max > value_min ? static_cast<double>(value_max) - value_min : 1.0;
+    return 20.0 * std::log10(peak / error);
+}
+
+void BEVCompressor::QualityStats::merge(const QualityStats& other) {
+    blocks += other.blocks;
+    values += other.values;
+    reencoded_blocks += other.reencoded_blocks;
+    unresolved_blocks += other.unresolved_blocks;
+    max_abs_error = std::max(max_abs_error, other.max_abs_error);
+    sum_squared_error += other.sum_squared_error;
+    value_min = std::min(value_min, other.value_min);
+    value_max = std::max(value_max, other.value_max);
+}
+
+Json::Value BEVCompressor::QualityStats::to_json() const {
+    Json::Value json;
+    json["blocks"] = static_cast<Json::UInt64>(blocks);
+    json["values"] = static_cast<Json::UInt64>(values);
+    json["reencoded_blocks"] = static_cast<Json::UInt64>(reencoded_blocks);
+    json["unresolved_blocks"] = static_cast<Json::UInt64>(unresolved_blocks);
+    json["max_abs_error"] = max_abs_error;
+    json["rmse"] = rmse();
+    const double psnr = psnr_db();
+    json["psnr_db"] = std::isfinite(psnr) ? Json::Value(psnr) : Json::Value();
+    return json;
+}
+
+BEVCompressor::Config BEVCompressor::config_from_json(const Json::Value& json) {
+    // 既接受完整的参数文件（取"compressor"字段），也接受单独的压缩参数对象
+    const Json::Value& params = json.isMember("compressor") ? json["compressor"] : json;
+    if (!params.isObject()) {
+        throw std::runtime_error("压缩参数格式错误：应为JSON对象");
+    }
+    Config config;
+    config.block_size = params.get("block_size", config.block_size).asInt();
+    config.compression_ratio = params.get("compression_ratio", config.compression_ratio).asFloat();
+    config.lossless = params.get("lossless", config.lossless).asBool();
+    const std::string lossless_codec = params.get("lossless_codec", "zfp").asString();
+    if (lossless_codec == "zfp") {
+        config.lossless_codec = Config::LOSSLESS_ZFP;
+    } else if (lossless_codec == "shuffle") {
+        config.lossless_codec = Config::LOSSLESS_SHUFFLE;
+    } else {
+        throw std::runtime_error("压缩参数无效：lossless_codec=" + lossless_codec);
+    }
+    config.fixed_kernels = params.get("fixed_kernels", config.fixed_kernels).asBool();
+    config.verify = params.get("verify", config.verify).asBool();
+    config.error_bound = params.get("error_bound", config.error_bound).asFloat();
+    config.verify_interval = params.get("verify_interval", config.verify_interval).asInt();
+    config.pyramid_levels = params.get("pyramid_levels", config.pyramid_levels).asInt();
+    config.pyramid_max_pooling = params.get("pyramid_max_pooling", config.pyramid_max_pooling).asBool();
+    if (config.block_size <= 0 || config.block_size > UINT16_MAX || !(config.compression_ratio > 0)) {
+        throw std::runtime_error("压缩参数无效：block_size=" + std::to_string(config.block_size) +
+                                 " compression_ratio=" + std::to_string(config.compression_ratio));
+    }
+    if (!(config.error_bound >= 0) || config.verify_interval <= 0) {
+        throw std::runtime_error("校验参数无效：error_bound=" + std::to_string(config.error_bound) +
+                                 " verify_interval=" + std::to_string(config.verify_interval));
+    }
+    if (config.pyramid_levels < 1 || config.pyramid_levels > MAX_PYRAMID_LEVELS) {
+        throw std::runtime_error("金字塔层数无效：pyramid_levels=" + std::to_string(config.pyramid_levels));
+    }
+    return config;
+}
+
+Json::Value BEVCompressor::config_to_json(const Config& config) {
+    Json::Value params;
+    params["block_size"] = config.block_size;
+    params["compression_ratio"] = config.compression_ratio;
+    params["lossless"] = config.lossless;
+    params["lossless_codec"] = config.lossless_codec == Config::LOSSLESS_SHUFFLE ? "shuffle" : "zfp";
+    params["fixed_kernels"] = config.fixed_kernels;
+    params["verify"] = config.verify;
+    params["error_bound"] = config.error_bound;
+    params["verify_interval"] = config.verify_interval;
+    params["pyramid_levels"] = config.pyramid_levels;
+    params["pyramid_max_pooling"] = config.pyramid_max_pooling;
+    return params;
+}
+
+BEVCompressor::Config BEVCompressor::load_config(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("无法打开参数文件: " + path);
+    }
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errors;
+    if (!Json::parseFromStream(builder, in, &root, &errors)) {
+        throw std::runtime_error("参数文件解析失败: " + path + ": " + errors);
+    }
+    return config_from_json(root);
+}
+
+BEVCompressor::StreamHeader BEVCompressor::read_stream_header(const uint8_t*& ptr, const uint8_t* end) {
+    if (end - ptr < static_cast<ptrdiff_t>(STREAM_HEADER_BYTES)) {
+        throw std::runtime_error("压缩数据不完整：缺少流头");
+    }
+    if (load<uint32_t>(ptr) != STREAM_MAGIC) {
+        throw std::runtime_error("压缩数据格式错误：流头标识不匹配");
+    }
+    StreamHeader header;
+    header.version = load<uint16_t>(ptr + 4);
+    header.codec = load<uint8_t>(ptr + 6);
+    header.pyramid_levels = std::max<uint8_t>(load<uint8_t>(ptr + 7), 1);
+    header.rate = load<float>(ptr + 8);
+    header.num_packets = load<uint32_t>(ptr + 12);
+    if (header.version != STREAM_VERSION) {
+        throw std::runtime_error("不支持的压缩流版本: " + std::to_string(header.version));
+    }
+    if (header.pyramid_levels > MAX_PYRAMID_LEVELS || header.num_packets % header.pyramid_levels != 0) {
+        throw std::runtime_error("压缩数据格式错误：金字塔层数无效");
+    }
+    ptr += STREAM_HEADER_BYTES;
+    return header;
+}
+
+BEVCompressor::FrameHeader BEVCompressor::read_frame_header(const uint8_t*& ptr, const uint8_t* end) {
+    if (end - ptr < static_cast<ptrdiff_t>(FRAME_HEADER_BYTES)) {
+        throw std::runtime_error("压缩数据不完整：缺少帧头");
+    }
+    FrameHeader header;
+    header.timestamp = load<uint64_t>(ptr);
+    header.rows = load<uint32_t>(ptr + 8);
+    header.cols = load<uint32_t>(ptr + 12);
+    header.nums_block = load<uint32_t>(ptr + 16);
+    ptr += FRAME_HEADER_BYTES;
+    return header;
+}
+
+BEVCompressor::BlockHeader BEVCompressor::read_block_header(const uint8_t*& ptr, const uint8_t* end,
+                                                           const FrameHeader& frame) {
+    if (end - ptr < static_cast<ptrdiff_t>(BLOCK_HEADER_BYTES)) {
+        throw std::runtime_error("压缩数据不完整：缺少块头");
+    }
+    BlockHeader header = load<BlockHeader>(ptr);
+    ptr += BLOCK_HEADER_BYTES;
+    if (static_cast<uint64_t>(end - ptr) < header.compressed_size) {
+        throw std::runtime_error("压缩数据不完整：块数据缺失");
+    }
+    if (header.block_rows == 0 || header.block_cols == 0 ||
+        static_cast<uint64_t>(header.row_offset) + header.block_rows > frame.rows ||
+        static_cast<uint64_t>(header.col_offset) + header.block_cols > frame.cols) {
+        throw std::runtime_error("压缩数据格式错误：块超出帧范围");
+    }
+    return header;
+}
+
+CompressedStreamView::CompressedStreamView(const uint8_t* data, size_t size)
+    : begin_(data), ptr_(data), end_(data + size)
+{
+    stream_ = BEVCompressor::read_stream_header(ptr_, end_);
+}
+
+bool CompressedStreamView::next_frame(Frame& frame) {
+    // 跳过当前帧未读的块
+    Block skipped;
+    while (next_block(skipped)) {
+    }
+    if (next_record_ >= stream_.num_packets) {
+        return false;
+    }
+    frame.offset = position();
+    frame_ = BEVCompressor::read_frame_header(ptr_, end_);
+    frame.header = frame_;
+    frame.record = next_record_;
+    frame.level = stream_.level_of(next_record_);
+    ++next_record_;
+    next_block_ = 0;
+    return true;
+}
+
+bool CompressedStreamView::next_block(Block& block) {
+    if (next_block_ >= frame_.nums_block) {
+        return false;
+    }
+    block.header = BEVCompressor::read_block_header(ptr_, end_, frame_);
+    block.data = ptr_;
+    block.offset = position();
+    block.index = next_block_++;
+    ptr_ += block.header.compressed_size;
+    return true;
+}
 
 std::vector<uint8_t> BEVCompressor::compress(const std::vector<BEVFeaturePacket>& packets) {
     std::vector<uint8_t> compressed_data;
-    const int bs = config_.block_size;
     
-    // 写入数据包数量
-    uint32_t num_packets = packets.size();
-    compressed_data.insert(compressed_data.end(), 
-                          reinterpret_cast<uint8_t*>(&num_packets),
-                          reinterpret_cast<uint8_t*>(&num_packets + 1));
+    // 写入流头（含帧记录数量）
+    append_stream_header(compressed_data, stream_codec(), config_.pyramid_levels, config_.compression_ratio,
+                         static_cast<uint32_t>(packets.size() * config_.pyramid_levels));
+    frame_quality_.clear();
     
     // 遍历每个数据包
-    std::cout << "timestamp[0]" << packets[0].timestamp << std::endl;
     for (const auto& packet : packets) {
+        ScopedTimer frame_timer(MetricStage::FRAME_COMPRESS);
+        const size_t frame_start = compressed_data.size();
         const Eigen::MatrixXf& matrix = packet.feature;
-        // 打印matrix信息（调试用）
-        // std::cout << "Matrix size: " << matrix.rows() << "x" << matrix.cols() << std::endl;
-        // for (int i = 0; i < 10; ++i) {
-        //     for (int j = 0; j < 10; ++j) {
-        //         std::cout << matrix(i,j) << " ";
-        //     }
-        //     std::cout << "\n";
-        // }
+        QualityStats quality;
         
-        // 写入时间戳
-        uint64_t timestamp = static_cast<uint64_t>(packet.timestamp);
-        compressed_data.insert(compressed_data.end(), 
-                              reinterpret_cast<const uint8_t*>(&timestamp),
-                              reinterpret_cast<const uint8_t*>(&timestamp + 1));
-        
-        uint16_t nums_block = matrix.rows() * matrix.cols() / ( bs * bs);
-        compressed_data.insert(compressed_data.end(), 
-                              reinterpret_cast<const uint8_t*>(&nums_block),
-                              reinterpret_cast<const uint8_t*>(&nums_block + 1));
-        // 遍历所有块
-        for (int i = 0; i < matrix.rows(); i += bs) {
-            for (int j = 0; j < matrix.cols(); j += bs) {
-                // 处理边缘块（如果不足block_size）
-                int block_rows = std::min<int>(bs, matrix.rows() - i);
-                int block_cols = std::min<int>(bs, matrix.cols() - j);
-                
-                // 使用Eigen的block()获取子矩阵视图
-                auto block = matrix.block(i, j, block_rows, block_cols);
-                auto compressed_block = compress_block(block);
-                // std::cout << "compressed_block.size():" << compressed_block.size() << std::endl;
-                // throw std::runtime_error("结束调试！");
-
-                // 写入块头信息（位置+大小+行数+列数）
-                uint16_t header[4] = {
-                    static_cast<uint16_t>(i), 
-                    static_cast<uint16_t>(j),
-                    static_cast<uint16_t>(block_rows),
-                    static_cast<uint16_t>(compressed_block.size())
-                };
-                compressed_data.insert(
-                    compressed_data.end(), 
-                    reinterpret_cast<uint8_t*>(header), 
-                    reinterpret_cast<uint8_t*>(header + 4)
-                );
-                
-                // 写入压缩数据
-                compressed_data.insert(
-                    compressed_data.end(), 
-                    compressed_block.begin(), 
-                    compressed_block.end()
-                );
+        append_frame(compressed_data, static_cast<uint64_t>(packet.timestamp), matrix,
+                     config_.verify ? &quality : nullptr);
+        append_pyramid(compressed_data, static_cast<uint64_t>(packet.timestamp), matrix);
+        BEVMetrics::recordBytes(MetricStage::FRAME_COMPRESS,
+                                matrix.size() * sizeof(float),
+                                compressed_data.size() - frame_start);
+        if (config_.verify) {
+            finish_frame_quality(quality);
+        }
+    }
+    return compressed_data;
+}
+
+void BEVCompressor::append_frame(std::vector<uint8_t>& out, uint64_t timestamp,
+                                 const Eigen::Ref<const Eigen::MatrixXf>& matrix, QualityStats* quality) {
+    const int bs = config_.block_size;
+    
+    // 写入帧头（时间戳、帧尺寸、块数量）
+    const uint32_t grid_rows = (matrix.rows() + bs - 1) / bs;
+    const uint32_t grid_cols = (matrix.cols() + bs - 1) / bs;
+    append_frame_header(out, timestamp, static_cast<uint32_t>(matrix.rows()), static_cast<uint32_t>(matrix.cols()),
+                        grid_rows * grid_cols);
+    
+    if (!pool_ || pool_->size() < 2 || grid_rows < 2) {
+        append_block_rows(out, matrix, 0, static_cast<int>(matrix.rows()), quality, verify_counter_);
+        return;
+    }
+    
+    // 并行：帧交给一个节点，块行按该节点的线程数切成连续区间，各线程写入自己的缓冲区
+    // （在工作线程上首次触碰，落在本节点内存），再按顺序拼接；抽样计数按块序号预留，结果与串行一致
+    const int slots = pool_->maxSlots();
+    std::vector<std::vector<uint8_t>> chunks(slots);
+    std::vector<QualityStats> chunk_quality(slots);
+    const uint64_t first_sample = verify_counter_;
+    pool_->runPartitioned({grid_rows}, [&](size_t, int slot, size_t begin, size_t end) {
+        uint64_t counter = first_sample + begin * grid_cols;
+        append_block_rows(chunks[slot], matrix, static_cast<int>(begin) * bs, static_cast<int>(end) * bs,
+                          quality ? &chunk_quality[slot] : nullptr, counter);
+    });
+    verify_counter_ += static_cast<uint64_t>(grid_rows) * grid_cols;
+    
+    size_t total = out.size();
+    for (const std::vector<uint8_t>& chunk : chunks) total += chunk.size();
+    out.reserve(total);
+    for (int s = 0; s < slots; ++s) {
+        out.insert(out.end(), chunks[s].begin(), chunks[s].end());
+        if (quality) quality->merge(chunk_quality[s]);
+    }
+}
+
+void BEVCompressor::append_block_rows(std::vector<uint8_t>& out, const Eigen::Ref<const Eigen::MatrixXf>& matrix,
+                                      int row_begin, int row_end, QualityStats* quality, uint64_t& sample_counter) {
+    const int bs = config_.block_size;
+    row_end = std::min<int>(row_end, matrix.rows());
+    
+    // 遍历所有块
+    for (int i = row_begin; i < row_end; i += bs) {
+        for (int j = 0; j < matrix.cols(); j += bs) {
+            // 处理边缘块（如果不足block_size）
+            int block_rows = std::min<int>(bs, matrix.rows() - i);
+            int block_cols = std::min<int>(bs, matrix.cols() - j);
+            
+            // 使用Eigen的block()获取子矩阵视图
+            append_compressed_block(out, matrix.block(i, j, block_rows, block_cols), i, j,
+                                    config_.compression_ratio, quality, &sample_counter);
+        }
+    }
+}
+
+void BEVCompressor::append_pyramid(std::vector<uint8_t>& out, uint64_t timestamp,
+                                   const Eigen::Ref<const Eigen::MatrixXf>& matrix) {
+    if (config_.pyramid_levels <= 1) {
+        return;
+    }
+    // 各层由上一层降采样得到，块大小不变：第k层的块数约为原始分辨率的1/4^k
+    Eigen::MatrixXf level = downsample(matrix, config_.pyramid_max_pooling);
+    for (int k = 1; k < config_.pyramid_levels; ++k) {
+        if (k > 1) {
+            level = downsample(level, config_.pyramid_max_pooling);
+        }
+        append_frame(out, timestamp, level, nullptr);
+    }
+}
+
+Eigen::MatrixXf BEVCompressor::downsample(const Eigen::Ref<const Eigen::MatrixXf>& input, bool max_pooling) {
+    const Eigen::Index rows = input.rows();
+    const Eigen::Index out_rows = (rows + 1) / 2;
+    const Eigen::Index out_cols = (input.cols() + 1) / 2;
+    Eigen::MatrixXf output(out_rows, out_cols);
+    Eigen::VectorXf merged(rows);
+
+    // 先合并相邻两列（列内连续，逐元素向量化），再合并列内相邻两个元素
+    for (Eigen::Index c = 0; c < out_cols; ++c) {
+        const float* a = input.data() + 2 * c * input.outerStride();
+        const float* b = 2 * c + 1 < input.cols() ? a + input.outerStride() : a;
+        float* m = merged.data();
+        float* o = output.data() + c * out_rows;
+        if (max_pooling) {
+            #pragma omp simd
+            for (Eigen::Index r = 0; r < rows; ++r) {
+                m[r] = std::max(a[r], b[r]);
+            }
+            #pragma omp simd
+            for (Eigen::Index r = 0; r < rows / 2; ++r) {
+                o[r] = std::max(m[2 * r], m[2 * r + 1]);
+            }
+            if (rows % 2) {
+                o[out_rows - 1] = m[rows - 1];
+            }
+        } else {
+            #pragma omp simd
+            for (Eigen::Index r = 0; r < rows; ++r) {
+                m[r] = a[r] + b[r];
+            }
+            #pragma omp simd
+            for (Eigen::Index r = 0; r < rows / 2; ++r) {
+                o[r] = 0.25f * (m[2 * r] + m[2 * r + 1]);
+            }
+            if (rows % 2) {
+                o[out_rows - 1] = 0.5f * m[rows - 1];
             }
         }
     }
-    std::cout << "Compressed " << compressed_data.size() << " bytes." << std::endl;
+    return output;
+}
+
+
+std::vector<uint8_t> BEVCompressor::compress(const std::vector<TiledFeaturePacket>& packets) {
+    std::vector<uint8_t> compressed_data;
+    const int bs = config_.block_size;
+
+    append_stream_header(compressed_data, stream_codec(), config_.pyramid_levels, config_.compression_ratio,
+                         static_cast<uint32_t>(packets.size() * config_.pyramid_levels));
+    frame_quality_.clear();
+
+    for (const auto& packet : packets) {
+        ScopedTimer frame_timer(MetricStage::FRAME_COMPRESS);
+        const size_t frame_start = compressed_data.size();
+        const TiledFeature& feature = packet.feature;
+        QualityStats quality;
+        if (feature.tile_size() != bs) {
+            throw std::invalid_argument("分块大小与压缩配置的block_size不一致");
+        }
+
+        append_frame_header(compressed_data, packet.timestamp, static_cast<uint32_t>(feature.rows()),
+                            static_cast<uint32_t>(feature.cols()), static_cast<uint32_t>(feature.tile_count()));
+
+        // 块顺序与compress(MatrixXf)一致：行优先
+        for (int ti = 0; ti < feature.grid_rows(); ++ti) {
+            for (int tj = 0; tj < feature.grid_cols(); ++tj) {
+                append_compressed_block(compressed_data, feature.tile(ti, tj), ti * bs, tj * bs,
+                                        config_.compression_ratio, config_.verify ? &quality : nullptr);
+            }
+        }
+        if (config_.pyramid_levels > 1) {
+            append_pyramid(compressed_data, packet.timestamp, feature.to_matrix());
+        }
+        BEVMetrics::recordBytes(MetricStage::FRAME_COMPRESS,
+                                static_cast<uint64_t>(feature.rows()) * feature.cols() * sizeof(float),
+                                compressed_data.size() - frame_start);
+        if (config_.verify) {
+            finish_frame_quality(quality);
+        }
+    }
     return compressed_data;
 }
 
+void BEVCompressor::append_compressed_block(std::vector<uint8_t>& out,
+                                            const Eigen::Ref<const Eigen::MatrixXf>& block,
+                                            int i, int j, double rate, QualityStats* quality,
+                                            uint64_t* sample_counter) {
+    // 先写块头占位，压缩数据直接追加在块头之后，再回填压缩大小
+    const size_t header_pos = out.size();
+    BEVCompressor::BlockHeader header = {
+        static_cast<uint32_t>(i), static_cast<uint32_t>(j),
+        static_cast<uint32_t>(block.rows()), static_cast<uint32_t>(block.cols()), 0
+    };
+    append(out, header);
+    const size_t payload_pos = out.size();
+    const bool prefixed = block_rate_codec();
+    if (prefixed) {
+        append(out, uint8_t{0});
+    }
+    size_t bytes = encode_block(out, block, rate);
+
+    // 误差上限生效时逐块校验，影子模式按间隔抽样
+    uint64_t& counter = sample_counter ? *sample_counter : verify_counter_;
+    const bool check = quality &&
+        (prefixed || counter++ % static_cast<uint64_t>(config_.verify_interval) == 0);
+    if (check) {
+        ScopedTimer timer(MetricStage::BLOCK_VERIFY);
+        thread_local Eigen::MatrixXf decoded;
+        decoded.resize(block.rows(), block.cols());
+        const uint8_t codec = prefixed ? CODEC_ZFP_RATE : stream_codec();
+        decode_block(codec, out.data() + out.size() - bytes, bytes, decoded, rate);
+        QualityStats stats = measure_block_error(block, decoded);
+
+        // 超出误差上限：逐级提高码率重新编码，直到满足上限或码率达到上限
+        int level = 0;
+        while (prefixed && stats.max_abs_error > config_.error_bound) {
+            const double next_rate = escalated_rate(rate, level + 1);
+            if (next_rate <= escalated_rate(rate, level) || level + 1 > UINT8_MAX) {
+                stats.unresolved_blocks = 1;
+                break;
+            }
+            ++level;
+            out.resize(payload_pos);
+            append(out, static_cast<uint8_t>(level));
+            bytes = encode_block(out, block, next_rate);
+            decode_block(CODEC_ZFP_RATE, out.data() + out.size() - bytes, bytes, decoded, next_rate);
+            stats = measure_block_error(block, decoded);
+        }
+        stats.reencoded_blocks = level > 0 ? 1 : 0;
+        quality->merge(stats);
+    }
+
+    header.compressed_size = static_cast<uint32_t>(out.size() - payload_pos);
+    std::memcpy(out.data() + header_pos, &header, sizeof(header));
+}
+
+size_t BEVCompressor::encode_block(std::vector<uint8_t>& out, const Eigen::Ref<const Eigen::MatrixXf>& block,
+                                   double rate) {
+    const int bs = config_.block_size;
+    if (config_.lossless && config_.lossless_codec == Config::LOSSLESS_SHUFFLE) {
+        ScopedTimer timer(MetricStage::BLOCK_COMPRESS);
+        const size_t bytes = ShuffleLZCodec::encode(block, out);
+        BEVMetrics::recordBytes(MetricStage::BLOCK_COMPRESS, block.size() * sizeof(float), bytes);
+        return bytes;
+    }
+    if (kernel_ && block.rows() == bs && block.cols() == bs) {
+        ScopedTimer timer(MetricStage::BLOCK_COMPRESS);
+        const size_t bytes = kernel_->compress(block.data(), block.outerStride(), rate, zfp_mode(), out);
+        BEVMetrics::recordBytes(MetricStage::BLOCK_COMPRESS, block.size() * sizeof(float), bytes);
+        return bytes;
+    }
+    const std::vector<uint8_t> data = compress_block(block, rate, zfp_mode());
+    out.insert(out.end(), data.begin(), data.end());
+    return data.size();
+}
+
+void BEVCompressor::finish_frame_quality(const QualityStats& frame) {
+    frame_quality_.push_back(frame);
+    run_quality_.merge(frame);
+    if (frame.blocks > 0) {
+        BEVMetrics::recordError(frame.max_abs_error, frame.sum_squared_error, frame.values,
+                                static_cast<double>(frame.value_max) - frame.value_min);
+    }
+    if (frame.reencoded_blocks > 0 || frame.unresolved_blocks > 0) {
+        BEVMetrics::recordReencode(frame.reencoded_blocks, frame.unresolved_blocks);
+    }
+}
 
 std::vector<uint8_t> BEVCompressor::compress_block(
-    const Eigen::Ref<const Eigen::MatrixXf>& block) 
+    const Eigen::Ref<const Eigen::MatrixXf>& block, double rate, int mode)
 {
+    ScopedTimer timer(MetricStage::BLOCK_COMPRESS);
+
     // 1. 检查块尺寸合法性
     if (block.rows() <= 0 || block.cols() <= 0) {
         throw std::invalid_argument("压缩块尺寸无效（行数或列数为0）");
@@ -98,6 +737,8 @@ std::vector<uint8_t> BEVCompressor::compress_block(
     if (!field) {
         throw std::runtime_error("ZFP字段创建失败");
     }
+    // 块通常是列主序大矩阵中的跨步视图：x方向（行）步长为1，y方向（列）步长为外层步长
+    zfp_field_set_stride_2d(field, block.innerStride(), block.outerStride());
 
     // 3. 配置ZFP压缩流
     zfp_stream* stream = zfp_stream_open(nullptr);
@@ -106,15 +747,8 @@ std::vector<uint8_t> BEVCompressor::compress_block(
         throw std::runtime_error("ZFP流创建失败");
     }
 
-    // 设置压缩率：根据配置选择无损/有损模式
-    int flags = config_.lossless ? config_.ZFP_MODE_LOSSLESS :config_.ZFP_MODE_DEFAULT;
-    zfp_stream_set_rate(
-        stream, 
-        config_.compression_ratio,  // 压缩率（比特/值）
-        type, 
-        2,  // 2D数据
-        flags
-    );
+    // 设置压缩率（比特/值）：按调用方给出的无损/有损模式
+    configure_zfp_stream(stream, rate, mode);
 
     // 4. 分配压缩缓冲区（预计算最大所需大小）
     size_t bufsize = zfp_stream_maximum_size(stream, field);
@@ -134,17 +768,17 @@ std::vector<uint8_t> BEVCompressor::compress_block(
     }
     zfp_stream_set_bit_stream(stream, bit);
 
-    // 执行压缩（返回压缩后的块数，2D场景应为1）
-    size_t compressed_blocks = zfp_compress(stream, field);
-    if (!compressed_blocks) {
+    // 执行压缩（返回压缩后的字节数，失败时为0）
+    size_t compressed_bytes = zfp_compress(stream, field);
+    if (!compressed_bytes) {
         stream_close(bit);
         zfp_stream_close(stream);
         zfp_field_free(field);
         throw std::runtime_error("块压缩失败");
     }
 
-    // 6. 获取实际压缩大小（裁剪缓冲区到有效长度）
-    size_t actual_size = stream_size(bit) / 8;  // 比特流大小转换为字节
+    // 6. 获取实际压缩大小（裁剪缓冲区到有效长度，stream_size已是字节数）
+    size_t actual_size = stream_size(bit);
     buffer.resize(actual_size);
 
     // 7. 释放资源（按顺序释放，避免内存泄漏）
@@ -152,90 +786,249 @@ std::vector<uint8_t> BEVCompressor::compress_block(
     zfp_stream_close(stream);  // 再关闭压缩流
     zfp_field_free(field);     // 最后释放字段
 
+    BEVMetrics::recordBytes(MetricStage::BLOCK_COMPRESS, block.size() * sizeof(float), buffer.size());
     return buffer;
 }
 
 std::vector<BEVFeaturePacket> BEVCompressor::decompress(const std::vector<uint8_t>& compressed) {
     std::vector<BEVFeaturePacket> packets;
-    const uint8_t* ptr = compressed.data();
-    const uint8_t* end = compressed.data() + compressed.size();
-    std::cout << "Decompressing " << compressed.size() << " bytes..." << std::endl;
 
-    // 读取数据包数量
-    if (ptr + sizeof(uint32_t) > end) {
-        throw std::runtime_error("压缩数据不完整：缺少数据包数量");
+    // 读取流头（码率以流中记录的为准）
+    CompressedStreamView view(compressed);
+    const StreamHeader& stream = view.header();
+    check_codec(stream);
+    packets.reserve(view.num_frames());
+    if (pool_ && pool_->size() > 1) {
+        decompress_parallel(view, packets);
+        return packets;
     }
-    uint32_t num_packets = *reinterpret_cast<const uint32_t*>(ptr);
-    // std::cout << "num_packets:" << num_packets << std::endl;
-    ptr += sizeof(uint32_t);
 
-    packets.reserve(num_packets);
-
-    // 逐个解压缩数据包
-    for (uint32_t p = 0; p < num_packets; ++p) {
+    // 逐个解压缩数据包（金字塔的粗层直接跳过）
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block record;
+    while (view.next_frame(frame)) {
+        if (frame.level != 0) {
+            continue;
+        }
+        ScopedTimer frame_timer(MetricStage::DECOMPRESS);
         BEVFeaturePacket packet;
+        packet.timestamp = frame.header.timestamp;
+        packet.feature = Eigen::MatrixXf::Zero(frame.header.rows, frame.header.cols);
 
-        // 读取时间戳（替代frame_id）
-        if (ptr + sizeof(uint64_t) > end) {
-            throw std::runtime_error("压缩数据不完整：缺少时间戳");
+        // 解压缩所有块：直接解压到帧中对应的跨步视图
+        while (view.next_block(record)) {
+            auto block = packet.feature.block(record.header.row_offset, record.header.col_offset,
+                                              record.header.block_rows, record.header.block_cols);
+            decode_block(stream.block_codec(), record.data, record.header.compressed_size, block);
         }
-        packet.timestamp = *reinterpret_cast<const uint64_t*>(ptr);
-        // std::cout << "timestamp:" << packet.timestamp << std::endl;
-        ptr += sizeof(uint64_t);
 
-        // 读取blocks的数量
-        if (ptr + sizeof(uint16_t) > end) {
-            throw std::runtime_error("压缩数据不完整：缺少block数量");
+        BEVMetrics::recordBytes(MetricStage::DECOMPRESS,
+                                static_cast<uint64_t>(view.position() - frame.offset),
+                                packet.feature.size() * sizeof(float));
+        packets.push_back(std::move(packet));
+    }
+
+    return packets;
+}
+
+void BEVCompressor::decompress_parallel(CompressedStreamView& view, std::vector<BEVFeaturePacket>& packets) {
+    ScopedTimer timer(MetricStage::DECOMPRESS);
+    const StreamHeader& stream = view.header();
+    
+    // 先顺序解析所有帧头与块头（只读头部，跳过块数据），校验完整后再并行解码
+    std::vector<std::vector<CompressedStreamView::Block>> frames;
+    std::vector<size_t> items;
+    std::vector<uint64_t> frame_bytes;
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block record;
+    while (view.next_frame(frame)) {
+        if (frame.level != 0) {
+            continue;
         }
-        uint16_t nums_blocks = *reinterpret_cast<const uint16_t*>(ptr);
-        // std::cout << "nums_blocks:" << nums_blocks << std::endl;
-        ptr += sizeof(uint16_t);
-
-
-        // 初始化特征矩阵（假设所有块大小一致）
-        packet.feature = Eigen::MatrixXf::Zero(256, 256);  // 需根据实际情况调整尺寸
-
-        // 解压缩所有块
-        for (int i=0; i<nums_blocks; ++i) { // 块头包含4个uint16_t
-            // 读取块头（行偏移、列偏移、块行数、压缩大小）
-            uint16_t row_offset = *reinterpret_cast<const uint16_t*>(ptr);
-            ptr += sizeof(uint16_t);
-            uint16_t col_offset = *reinterpret_cast<const uint16_t*>(ptr);
-            ptr += sizeof(uint16_t);
-            uint16_t block_rows = *reinterpret_cast<const uint16_t*>(ptr);
-            ptr += sizeof(uint16_t);
-            uint16_t block_size = *reinterpret_cast<const uint16_t*>(ptr);
-            ptr += sizeof(uint16_t);
-            
-            // std::cout << block_rows << std::endl;
+        std::vector<CompressedStreamView::Block> blocks;
+        blocks.reserve(frame.header.nums_block);
+        uint64_t covered = 0;
+        while (view.next_block(record)) {
+            blocks.push_back(record);
+            covered += static_cast<uint64_t>(record.header.block_rows) * record.header.block_cols;
+        }
+        
+        // 帧矩阵不在这里清零：未初始化的大块内存尚未触碰，物理页由解码它的工作线程首次写入时
+        // 分配在该线程的节点上；块未覆盖整帧（非本压缩器写出的流）时才清零
+        BEVFeaturePacket packet;
+        packet.timestamp = frame.header.timestamp;
+        packet.feature.resize(frame.header.rows, frame.header.cols);
+        if (covered != static_cast<uint64_t>(frame.header.rows) * frame.header.cols) {
+            packet.feature.setZero();
+        }
+        packets.push_back(std::move(packet));
+        items.push_back(blocks.size());
+        frame_bytes.push_back(static_cast<uint64_t>(view.position() - frame.offset));
+        frames.push_back(std::move(blocks));
+    }
+    
+    pool_->runPartitioned(items, [&](size_t f, int, size_t begin, size_t end) {
+        Eigen::MatrixXf& feature = packets[f].feature;
+        for (size_t b = begin; b < end; ++b) {
+            const CompressedStreamView::Block& block_record = frames[f][b];
+            const BlockHeader& header = block_record.header;
+            auto block = feature.block(header.row_offset, header.col_offset, header.block_rows, header.block_cols);
+            decode_block(stream.block_codec(), block_record.data, header.compressed_size, block);
+        }
+    });
+    
+    for (size_t f = 0; f < packets.size(); ++f) {
+        BEVMetrics::recordBytes(MetricStage::DECOMPRESS, frame_bytes[f], packets[f].feature.size() * sizeof(float));
+    }
+}
 
-            // 确保指针不越界
-            if (ptr + block_size > end) {
-                throw std::runtime_error("压缩数据不完整：块数据缺失");
-            }
+std::vector<BEVFeaturePacket> BEVCompressor::decompress_region(const std::vector<uint8_t>& compressed, int level,
+                                                              int row, int col, int rows, int cols) {
+    if (row < 0 || col < 0 || rows < 0 || cols < 0) {
+        throw std::invalid_argument("解码区域无效");
+    }
+    std::vector<BEVFeaturePacket> packets;
+    CompressedStreamView view(compressed);
+    const StreamHeader& stream = view.header();
+    check_codec(stream);
+    if (level < 0 || level >= stream.pyramid_levels) {
+        throw std::out_of_range("压缩流中没有第" + std::to_string(level) + "层");
+    }
+    packets.reserve(view.num_frames());
 
-            // 获取目标块（处理边缘块）
-            int block_cols = config_.block_size;
-            if (col_offset + block_cols > packet.feature.cols()) {
-                block_cols = packet.feature.cols() - col_offset;
-            }
+    Eigen::MatrixXf decoded;
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block record;
+    while (view.next_frame(frame)) {
+        if (frame.level != level) {
+            continue;
+        }
+        ScopedTimer frame_timer(MetricStage::DECOMPRESS);
 
-            auto block = packet.feature.block(row_offset, col_offset, block_rows, block_cols);
+        // 区域按帧尺寸裁剪
+        const int64_t r0 = std::min<int64_t>(row, frame.header.rows);
+        const int64_t c0 = std::min<int64_t>(col, frame.header.cols);
+        const int64_t r1 = std::min<int64_t>(static_cast<int64_t>(row) + rows, frame.header.rows);
+        const int64_t c1 = std::min<int64_t>(static_cast<int64_t>(col) + cols, frame.header.cols);
+        BEVFeaturePacket packet;
+        packet.timestamp = frame.header.timestamp;
+        packet.feature = Eigen::MatrixXf::Zero(r1 - r0, c1 - c0);
 
-            // 解压块
-            decompress_block(ptr, block);
-            ptr += block_size;
+        uint64_t decoded_bytes = 0;
+        while (view.next_block(record)) {
+            const BlockHeader& header = record.header;
+            const int64_t br0 = std::max<int64_t>(header.row_offset, r0);
+            const int64_t bc0 = std::max<int64_t>(header.col_offset, c0);
+            const int64_t br1 = std::min<int64_t>(static_cast<int64_t>(header.row_offset) + header.block_rows, r1);
+            const int64_t bc1 = std::min<int64_t>(static_cast<int64_t>(header.col_offset) + header.block_cols, c1);
+            if (br0 >= br1 || bc0 >= bc1) {
+                continue;
+            }
+            decoded_bytes += header.compressed_size;
+            if (br1 - br0 == header.block_rows && bc1 - bc0 == header.block_cols) {
+                // 整块位于区域内：直接解码到目标位置
+                auto block = packet.feature.block(br0 - r0, bc0 - c0, header.block_rows, header.block_cols);
+                decode_block(stream.block_codec(), record.data, header.compressed_size, block);
+            } else {
+                decoded.resize(header.block_rows, header.block_cols);
+                decode_block(stream.block_codec(), record.data, header.compressed_size, decoded);
+                packet.feature.block(br0 - r0, bc0 - c0, br1 - br0, bc1 - bc0) =
+                    decoded.block(br0 - header.row_offset, bc0 - header.col_offset, br1 - br0, bc1 - bc0);
+            }
         }
 
+        // 输入字节只计实际解码的块数据
+        BEVMetrics::recordBytes(MetricStage::DECOMPRESS, decoded_bytes, packet.feature.size() * sizeof(float));
         packets.push_back(std::move(packet));
     }
+    return packets;
+}
+
+std::vector<BEVFeaturePacket> BEVCompressor::decompress_level(const std::vector<uint8_t>& compressed, int level) {
+    return decompress_region(compressed, level, 0, 0, std::numeric_limits<int>::max(),
+                             std::numeric_limits<int>::max());
+}
 
+std::vector<TiledFeaturePacket> BEVCompressor::decompress_tiled(const std::vector<uint8_t>& compressed) {
+    std::vector<TiledFeaturePacket> packets;
+    const int bs = config_.block_size;
+
+    CompressedStreamView view(compressed);
+    const StreamHeader& stream = view.header();
+    check_codec(stream);
+    packets.reserve(view.num_frames());
+
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block record;
+    while (view.next_frame(frame)) {
+        if (frame.level != 0) {
+            continue;
+        }
+        ScopedTimer frame_timer(MetricStage::DECOMPRESS);
+        TiledFeaturePacket packet;
+        packet.timestamp = frame.header.timestamp;
+        packet.feature = TiledFeature(static_cast<int>(frame.header.rows), static_cast<int>(frame.header.cols), bs);
+
+        while (view.next_block(record)) {
+            const BlockHeader& header = record.header;
+            const int ti = static_cast<int>(header.row_offset / bs);
+            const int tj = static_cast<int>(header.col_offset / bs);
+            if (header.row_offset % bs || header.col_offset % bs ||
+                static_cast<int>(header.block_rows) != packet.feature.tile_rows(ti) ||
+                static_cast<int>(header.block_cols) != packet.feature.tile_cols(tj)) {
+                throw std::runtime_error("块位置与block_size不一致");
+            }
+            auto tile = packet.feature.tile(ti, tj);
+            decode_block(stream.block_codec(), record.data, header.compressed_size, tile);
+        }
+
+        BEVMetrics::recordBytes(MetricStage::DECOMPRESS,
+                                static_cast<uint64_t>(view.position() - frame.offset),
+                                static_cast<uint64_t>(frame.header.rows) * frame.header.cols * sizeof(float));
+        packets.push_back(std::move(packet));
+    }
     return packets;
 }
 
-void BEVCompressor::decompress_block(const uint8_t* data, Eigen::Ref<Eigen::MatrixXf> block) {
-    // 创建ZFP解压流
-    bitstream* bit = stream_open(const_cast<uint8_t*>(data), block.size() * sizeof(float));
+void BEVCompressor::decompress_block(const uint8_t* data, size_t size,
+                                     Eigen::Ref<Eigen::MatrixXf> block) const {
+    decode_block(block_codec(), data, size, block);
+}
+
+void BEVCompressor::decode_block(const BEVBlockCodec& codec, const uint8_t* data, size_t size,
+                                 Eigen::Ref<Eigen::MatrixXf> block) const {
+    // 带码率前缀时先取出该块的码率
+    const double rate = codec.codec == CODEC_ZFP_BLOCK_RATE ? strip_rate_prefix(data, size, codec.rate) : codec.rate;
+    decode_block(codec.codec, data, size, block, rate);
+}
+
+void BEVCompressor::decode_block(uint8_t codec, const uint8_t* data, size_t size,
+                                 Eigen::Ref<Eigen::MatrixXf> block, double rate) const {
+    switch (codec) {
+    case CODEC_SHUFFLE_LZ:
+        ShuffleLZCodec::decode(data, size, block);
+        break;
+    case CODEC_ZFP_REVERSIBLE:
+        decompress_zfp(data, size, block, rate, Config::ZFP_MODE_LOSSLESS);
+        break;
+    default:
+        decompress_zfp(data, size, block, rate, Config::ZFP_MODE_DEFAULT);
+        break;
+    }
+}
+
+void BEVCompressor::decompress_zfp(const uint8_t* data, size_t size,
+                                   Eigen::Ref<Eigen::MatrixXf> block, double rate, int mode) const {
+    if (kernel_ && block.rows() == config_.block_size && block.cols() == config_.block_size) {
+        kernel_->decompress(data, size, block.data(), block.outerStride(), rate, mode);
+        return;
+    }
+
+    // 创建ZFP解压流（以实际压缩大小为界，避免越界读取）
+    bitstream* bit = stream_open(const_cast<uint8_t*>(data), size);
+    if (!bit) {
+        throw std::runtime_error("比特流创建失败");
+    }
     zfp_stream* stream = zfp_stream_open(bit);
     
     // 创建ZFP字段（描述解压数据的结构）
@@ -245,24 +1038,20 @@ void BEVCompressor::decompress_block(const uint8_t* data, Eigen::Ref<Eigen::Matr
         static_cast<size_t>(block.rows()),
         static_cast<size_t>(block.cols())
     );
+    zfp_field_set_stride_2d(field, block.innerStride(), block.outerStride());
 
     // 设置解压参数（需与压缩时一致）
-    zfp_stream_set_rate(
-        stream,
-        config_.compression_ratio,
-        zfp_type_float,
-        2,  // 2D数据
-        config_.lossless ? config_.ZFP_MODE_LOSSLESS : config_.ZFP_MODE_DEFAULT
-    );
+    configure_zfp_stream(stream, rate, mode);
 
     // 执行解压
     bool success = zfp_decompress(stream, field);
-    if (!success) {
-        throw std::runtime_error("ZFP解压失败");
-    }
 
     // 释放资源
     zfp_field_free(field);
     zfp_stream_close(stream);
     stream_close(bit);
+
+    if (!success) {
+        throw std::runtime_error("ZFP解压失败");
+    }
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "disk_tier.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+// 记录头带块的编码方式与金字塔层级；旧格式（"VB2L"）的记录没有编码方式，无法可靠解码，恢复时按损坏处理
+const uint32_t RECORD_MAGIC = 0x4C334256;  // "VB3L"
+
+// 完整写入（处理被信号打断或部分写入）
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool preadAll(int fd, uint8_t* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, data, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+}  // namespace
+
+DiskBlockStore::SegmentFile::~SegmentFile() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+DiskBlockStore::DiskBlockStore(const Config& config) : config_(config) {
+    fs::create_directories(config_.directory);
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (config_.recover_existing) {
+        recoverSegments();
+    }
+    openNewSegmentLocked();
+    writer_ = std::thread(&DiskBlockStore::writerLoop, this);
+}
+
+DiskBlockStore::~DiskBlockStore() {
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        stop_ = true;
+    }
+    pending_cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    // 段文件随segments_析构关闭
+}
+
+std::string DiskBlockStore::segmentPath(uint32_t id) const {
+    return (fs::path(config_.directory) / ("segment_" + std::to_string(id) + ".log")).string();
+}
+
+void DiskBlockStore::put(const BEVBlockKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                         std::vector<uint8_t>&& data) {
+    auto block = std::make_shared<PendingBlock>(PendingBlock{key, rows, cols, codec, std::move(data)});
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_.push_back(block);
+        pending_map_[key] = block;
+        // 磁盘跟不上时丢弃最旧的待写块，不反压内存缓存
+        if (pending_.size() > config_.max_pending_writes) {
+            auto dropped = pending_.front();
+            pending_.pop_front();
+            auto it = pending_map_.find(dropped->key);
+            if (it != pending_map_.end() && it->second == dropped) {
+                pending_map_.erase(it);
+            }
+            blocks_dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    pending_cv_.notify_one();
+}
+
+bool DiskBlockStore::get(const BEVBlockKey& key, std::vector<uint8_t>& data, uint16_t& rows, uint16_t& cols,
+                         BEVBlockCodec* codec) {
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+
+    // 1. 尚未落盘的块
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto it = pending_map_.find(key);
+        if (it != pending_map_.end()) {
+            data = it->second->data;
+            rows = it->second->rows;
+            cols = it->second->cols;
+            if (codec) *codec = it->second->codec;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // 2. 段文件：持锁只查索引并取得段文件引用，读取在锁外进行，不阻塞写入线程与其他检索
+    std::shared_ptr<SegmentFile> file;
+    BlockLocation found{};
+    uint16_t found_rows = 0, found_cols = 0;
+    BEVBlockCodec found_codec;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        auto frame = index_.find(FrameKey{key.timestamp, key.level});
+        if (frame == index_.end()) {
+            return false;
+        }
+        const FrameIndex& index = frame->second;
+        const long cell = cellIndex(index, key.x, key.y);
+        if (cell < 0 || index.grid[cell].offset == 0) {
+            return false;
+        }
+        auto segment = segments_.find(index.grid[cell].segment);
+        if (segment == segments_.end()) {
+            return false;
+        }
+        file = segment->second.file;
+        found = index.grid[cell];
+        // 完整块的边长即块大小；边缘块延伸到帧范围的边界为止
+        found_rows = static_cast<uint16_t>(std::min<uint32_t>(index.block_extent, index.rows - key.x));
+        found_cols = static_cast<uint16_t>(std::min<uint32_t>(index.block_extent, index.cols - key.y));
+        found_codec = index.codec;
+    }
+
+    data.resize(found.size);
+    if (!preadAll(file->fd, data.data(), found.size, found.offset)) {
+        return false;
+    }
+    rows = found_rows;
+    cols = found_cols;
+    if (codec) *codec = found_codec;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DiskBlockStore::flush() {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    drained_cv_.wait(lock, [this] { return pending_.empty() && !writing_; });
+}
+
+void DiskBlockStore::collectGarbage() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    auto now = std::chrono::system_clock::now();
+    // 当前写入段过期时先切换到新段，否则长时间没有新段时过期数据永远不会删除
+    if (config_.max_age_seconds > 0 && segments_[current_segment_].bytes > 0 &&
+        now - segments_[current_segment_].created > std::chrono::seconds(config_.max_age_seconds)) {
+        openNewSegmentLocked();
+    }
+    // 当前写入段永不删除
+    while (segments_.size() > 1) {
+        const auto& oldest = *segments_.begin();
+        bool over_size = total_bytes_ > config_.max_total_bytes;
+        bool too_old = config_.max_age_seconds > 0 &&
+            now - oldest.second.created > std::chrono::seconds(config_.max_age_seconds);
+        if (!over_size && !too_old) {
+            break;
+        }
+        dropSegmentLocked(oldest.first);
+    }
+}
+
+Json::Value DiskBlockStore::getStats() const {
+    Json::Value root;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        root["segments"] = static_cast<Json::UInt64>(segments_.size());
+        root["total_bytes"] = static_cast<Json::UInt64>(total_bytes_);
+        root["indexed_frames"] = static_cast<Json::UInt64>(index_.size());
+        // 索引的内存占用（按元素计，不含哈希表节点的分配开销）
+        size_t index_bytes = index_.bucket_count() * sizeof(void*);
+        for (const auto& frame : index_) {
+            index_bytes += sizeof(frame) + frame.second.grid.capacity() * sizeof(BlockLocation);
+        }
+        root["index_bytes"] = static_cast<Json::UInt64>(index_bytes);
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        root["pending_writes"] = static_cast<Json::UInt64>(pending_.size());
+    }
+    uint64_t lookups = lookups_.load(std::memory_order_relaxed);
+    uint64_t hits = hits_.load(std::memory_order_relaxed);
+    root["indexed_blocks"] = static_cast<Json::UInt64>(indexed_blocks_.load(std::memory_order_relaxed));
+    root["blocks_written"] = static_cast<Json::UInt64>(blocks_written_.load(std::memory_order_relaxed));
+    root["blocks_dropped"] = static_cast<Json::UInt64>(blocks_dropped_.load(std::memory_order_relaxed));
+    root["segments_collected"] = static_cast<Json::UInt64>(segments_collected_.load(std::memory_order_relaxed));
+    root["lookups"] = static_cast<Json::UInt64>(lookups);
+    root["hits"] = static_cast<Json::UInt64>(hits);
+    root["hit_rate"] = lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+    return root;
+}
+
+void DiskBlockStore::writerLoop() {
+    for (;;) {
+        std::shared_ptr<PendingBlock> block;
+        {
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            auto ready = [this] { return stop_ || !pending_.empty(); };
+            if (config_.max_age_seconds > 0) {
+                // 按时间GC：空闲时定期醒来检查过期段
+                if (!pending_cv_.wait_for(lock, std::chrono::milliseconds(config_.gc_interval_ms), ready)) {
+                    lock.unlock();
+                    collectGarbage();
+                    continue;
+                }
+            } else {
+                pending_cv_.wait(lock, ready);
+            }
+            if (pending_.empty()) {
+                return;  // stop_且已写完
+            }
+            block = pending_.front();
+            pending_.pop_front();
+            writing_ = true;
+        }
+
+        bool rolled = false;
+        {
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            uint32_t before = current_segment_;
+            appendLocked(*block);
+            rolled = current_segment_ != before;
+        }
+        if (rolled) {
+            collectGarbage();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            // 写入完成后才从待写表移除，期间get仍可命中
+            auto it = pending_map_.find(block->key);
+            if (it != pending_map_.end() && it->second == block) {
+                pending_map_.erase(it);
+            }
+            writing_ = false;
+        }
+        drained_cv_.notify_all();
+    }
+}
+
+void DiskBlockStore::appendLocked(const PendingBlock& block) {
+    const size_t record_bytes = sizeof(RecordHeader) + block.data.size();
+    if (segments_[current_segment_].bytes > 0 &&
+        segments_[current_segment_].bytes + record_bytes > config_.segment_bytes) {
+        openNewSegmentLocked();
+    }
+    Segment& segment = segments_[current_segment_];
+
+    RecordHeader header{};
+    header.magic = RECORD_MAGIC;
+    header.size = static_cast<uint32_t>(block.data.size());
+    header.timestamp = block.key.timestamp;
+    header.x = block.key.x;
+    header.y = block.key.y;
+    header.rows = block.rows;
+    header.cols = block.cols;
+    header.rate = block.codec.rate;
+    header.codec = block.codec.codec;
+    header.level = block.key.level;
+
+    std::vector<uint8_t> record(record_bytes);
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), block.data.data(), block.data.size());
+    if (!writeAll(segment.file->fd, record.data(), record.size())) {
+        blocks_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const BlockLocation location{current_segment_, static_cast<uint32_t>(segment.bytes + sizeof(RecordHeader)),
+                                 header.size};
+    segment.bytes += record_bytes;
+    total_bytes_ += record_bytes;
+    const FrameKey frame{block.key.timestamp, block.key.level};
+    if (segment.frames.empty() || !(segment.frames.back() == frame)) {
+        segment.frames.push_back(frame);
+    }
+    indexBlockLocked(frame, block.key.x, block.key.y, block.rows, block.cols, block.codec, location);
+    blocks_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+long DiskBlockStore::cellIndex(const FrameIndex& frame, uint16_t x, uint16_t y) {
+    if (frame.cell == 0) {
+        return x == 0 && y == 0 && !frame.grid.empty() ? 0 : -1;
+    }
+    if (x % frame.cell != 0 || y % frame.cell != 0) {
+        return -1;
+    }
+    const uint32_t grid_rows = (frame.rows - 1) / frame.cell + 1;
+    const uint32_t grid_cols = (frame.cols - 1) / frame.cell + 1;
+    const uint32_t r = x / frame.cell, c = y / frame.cell;
+    if (r >= grid_rows || c >= grid_cols) {
+        return -1;
+    }
+    return static_cast<long>(r * grid_cols + c);
+}
+
+void DiskBlockStore::indexBlockLocked(const FrameKey& key, uint16_t x, uint16_t y, uint16_t rows, uint16_t cols,
+                                      const BEVBlockCodec& codec, const BlockLocation& location) {
+    FrameIndex& frame = index_[key];
+    if (frame.blocks > 0 && frame.codec != codec) {
+        // 同一帧以其他编码方式重新写入：旧块属于被替换的内容，其索引作废
+        indexed_blocks_.fetch_sub(frame.blocks, std::memory_order_relaxed);
+        frame = FrameIndex();
+    }
+    frame.codec = codec;
+    frame.block_extent = std::max({frame.block_extent, rows, cols});
+
+    // 网格间距或帧范围变化时按新网格重排已有的块位置
+    FrameIndex resized;
+    resized.cell = static_cast<uint16_t>(std::gcd(std::gcd(frame.cell, x), y));
+    resized.rows = std::max<uint32_t>(frame.rows, static_cast<uint32_t>(x) + rows);
+    resized.cols = std::max<uint32_t>(frame.cols, static_cast<uint32_t>(y) + cols);
+    if (frame.grid.empty() || resized.cell != frame.cell || resized.rows != frame.rows ||
+        resized.cols != frame.cols) {
+        const uint32_t grid_rows = resized.cell ? (resized.rows - 1) / resized.cell + 1 : 1;
+        const uint32_t grid_cols = resized.cell ? (resized.cols - 1) / resized.cell + 1 : 1;
+        resized.grid.resize(static_cast<size_t>(grid_rows) * grid_cols, BlockLocation{});
+        const uint32_t old_cols = frame.cell ? (frame.cols - 1) / frame.cell + 1 : 1;
+        for (size_t i = 0; i < frame.grid.size(); ++i) {
+            if (frame.grid[i].offset != 0) {
+                const uint16_t bx = static_cast<uint16_t>(i / old_cols * frame.cell);
+                const uint16_t by = static_cast<uint16_t>(i % old_cols * frame.cell);
+                resized.grid[cellIndex(resized, bx, by)] = frame.grid[i];
+            }
+        }
+        frame.cell = resized.cell;
+        frame.rows = resized.rows;
+        frame.cols = resized.cols;
+        frame.grid.swap(resized.grid);
+    }
+
+    // 同一个块再次写入时覆盖旧位置
+    BlockLocation& slot = frame.grid[cellIndex(frame, x, y)];
+    if (slot.offset == 0) {
+        ++frame.blocks;
+        indexed_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot = location;
+}
+
+void DiskBlockStore::openNewSegmentLocked() {
+    uint32_t id = segments_.empty() ? 0 : segments_.rbegin()->first + 1;
+    int fd = ::open(segmentPath(id).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("无法创建段文件: " + segmentPath(id));
+    }
+    Segment segment;
+    segment.file = std::make_shared<SegmentFile>(fd);
+    segment.created = std::chrono::system_clock::now();
+    segments_[id] = std::move(segment);
+    current_segment_ = id;
+}
+
+void DiskBlockStore::dropSegmentLocked(uint32_t id) {
+    auto it = segments_.find(id);
+    if (it == segments_.end()) {
+        return;
+    }
+    for (const FrameKey& key : it->second.frames) {
+        auto frame = index_.find(key);
+        if (frame == index_.end()) {
+            continue;
+        }
+        FrameIndex& index = frame->second;
+        for (BlockLocation& location : index.grid) {
+            if (location.offset != 0 && location.segment == id) {
+                location = BlockLocation{};
+                --index.blocks;
+                indexed_blocks_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        if (index.blocks == 0) {
+            index_.erase(frame);
+        }
+    }
+    // 正在锁外读取该段的检索仍持有文件引用，最后一个引用释放时才关闭
+    ::unlink(segmentPath(id).c_str());
+    total_bytes_ -= it->second.bytes;
+    segments_.erase(it);
+    segments_collected_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DiskBlockStore::recoverSegments() {
+    std::vector<uint32_t> ids;
+    for (const auto& file : fs::directory_iterator(config_.directory)) {
+        std::string name = file.path().filename().string();
+        if (name.rfind("segment_", 0) == 0 && file.path().extension() == ".log") {
+            try {
+                ids.push_back(static_cast<uint32_t>(std::stoul(name.substr(8))));
+            } catch (const std::exception&) {
+                // 非本模块生成的文件，忽略
+            }
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (uint32_t id : ids) {
+        int fd = ::open(segmentPath(id).c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        struct stat st{};
+        ::fstat(fd, &st);
+        const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+        Segment segment;
+        segment.file = std::make_shared<SegmentFile>(fd);
+        segment.created = std::chrono::system_clock::from_time_t(st.st_mtime);
+
+        // 顺序扫描记录头，遇到不完整或损坏的记录即截断
+        uint64_t offset = 0;
+        RecordHeader header{};
+        while (offset + sizeof(header) <= file_size &&
+               preadAll(fd, reinterpret_cast<uint8_t*>(&header), sizeof(header), static_cast<off_t>(offset)) &&
+               header.magic == RECORD_MAGIC &&
+               offset + sizeof(header) + header.size <= file_size) {
+            const FrameKey frame{header.timestamp, header.level};
+            indexBlockLocked(frame, header.x, header.y, header.rows, header.cols,
+                             BEVBlockCodec{header.codec, header.rate},
+                             BlockLocation{id, static_cast<uint32_t>(offset + sizeof(header)), header.size});
+            if (segment.frames.empty() || !(segment.frames.back() == frame)) {
+                segment.frames.push_back(frame);
+            }
+            offset += sizeof(header) + header.size;
+        }
+        if (offset < file_size && ::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+            // 截断失败不影响已恢复的记录
+        }
+        ::lseek(fd, static_cast<off_t>(offset), SEEK_SET);
+
+        segment.bytes = offset;
+        total_bytes_ += offset;
+        segments_[id] = std::move(segment);
+    }
+}
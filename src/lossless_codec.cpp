@@ -0,0 +1,189 @@
+#include "lossless_codec.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr int MAX_HASH_BITS = 14;
+
+uint32_t load32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+[[noreturn]] void corrupt(const char* what) {
+    throw std::runtime_error(std::string("无损块数据损坏：") + what);
+}
+
+// 长度字段：token中的4位取15时，后续字节逐个累加，直到遇到小于255的字节
+void put_length(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+size_t read_length(const uint8_t*& p, const uint8_t* end, size_t length) {
+    if (length == 15) {
+        uint8_t byte;
+        do {
+            if (p >= end) corrupt("长度字段不完整");
+            byte = *p++;
+            length += byte;
+        } while (byte == 255);
+    }
+    return length;
+}
+
+}  // namespace
+
+size_t ShuffleLZCodec::lz_compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+
+    // 哈希表大小随输入增长（小块不必清空大表），记录每个4字节序列最近出现的位置
+    int hash_bits = 8;
+    while ((size_t{1} << hash_bits) < size && hash_bits < MAX_HASH_BITS) ++hash_bits;
+    thread_local std::array<int32_t, size_t{1} << MAX_HASH_BITS> table;
+    std::fill_n(table.begin(), size_t{1} << hash_bits, -1);
+
+    size_t anchor = 0;
+    auto emit = [&](size_t literal_end, size_t match_length, size_t offset) {
+        const size_t literals = literal_end - anchor;
+        const size_t extra = match_length ? match_length - MIN_MATCH : 0;
+        out.push_back(static_cast<uint8_t>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(extra, 15)));
+        if (literals >= 15) put_length(out, literals - 15);
+        out.insert(out.end(), src + anchor, src + literal_end);
+        if (match_length) {
+            out.push_back(static_cast<uint8_t>(offset & 0xFF));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (extra >= 15) put_length(out, extra - 15);
+        }
+    };
+
+    size_t i = 0;
+    while (i + MIN_MATCH <= size) {
+        const uint32_t sequence = load32(src + i);
+        const uint32_t h = (sequence * 2654435761u) >> (32 - hash_bits);
+        const int32_t candidate = table[h];
+        table[h] = static_cast<int32_t>(i);
+        if (candidate >= 0 && i - candidate <= MAX_OFFSET && load32(src + candidate) == sequence) {
+            size_t length = MIN_MATCH;
+            while (i + length < size && src[candidate + length] == src[i + length]) ++length;
+            emit(i, length, i - candidate);
+            i += length;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    // 最后一条序列只有字面量（解码端在输出写满时结束）
+    if (anchor < size) {
+        emit(size, 0, 0);
+    }
+    return out.size() - start;
+}
+
+void ShuffleLZCodec::lz_decompress(const uint8_t* data, size_t data_size, uint8_t* dst, size_t size) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + data_size;
+    size_t o = 0;
+    while (o < size) {
+        if (p >= end) corrupt("数据提前结束");
+        const uint8_t token = *p++;
+        const size_t literals = read_length(p, end, token >> 4);
+        if (literals > static_cast<size_t>(end - p) || literals > size - o) corrupt("字面量越界");
+        std::memcpy(dst + o, p, literals);
+        p += literals;
+        o += literals;
+        if (o == size) {
+            break;
+        }
+
+        if (end - p < 2) corrupt("缺少匹配偏移");
+        const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        if (offset == 0 || offset > o) corrupt("匹配偏移越界");
+        const size_t length = read_length(p, end, token & 15) + MIN_MATCH;
+        if (length > size - o) corrupt("匹配长度越界");
+        const uint8_t* match = dst + o - offset;
+        if (offset >= length) {
+            std::memcpy(dst + o, match, length);
+        } else {
+            // 与输出重叠（重复串）：逐字节复制
+            for (size_t k = 0; k < length; ++k) dst[o + k] = match[k];
+        }
+        o += length;
+    }
+    if (p != end) corrupt("尾部有多余数据");
+}
+
+size_t ShuffleLZCodec::encode(const Eigen::Ref<const Eigen::MatrixXf>& block, std::vector<uint8_t>& out) {
+    const Eigen::Index rows = block.rows();
+    const size_t n = static_cast<size_t>(block.size());
+    thread_local std::vector<uint8_t> planes;
+    planes.resize(4 * n);
+
+    // 与前一个值异或后拆成字节平面
+    uint32_t prev = 0;
+    size_t k = 0;
+    for (Eigen::Index c = 0; c < block.cols(); ++c) {
+        const float* column = block.data() + c * block.outerStride();
+        for (Eigen::Index r = 0; r < rows; ++r, ++k) {
+            uint32_t value;
+            std::memcpy(&value, column + r, sizeof(value));
+            const uint32_t delta = value ^ prev;
+            prev = value;
+            planes[k] = static_cast<uint8_t>(delta);
+            planes[n + k] = static_cast<uint8_t>(delta >> 8);
+            planes[2 * n + k] = static_cast<uint8_t>(delta >> 16);
+            planes[3 * n + k] = static_cast<uint8_t>(delta >> 24);
+        }
+    }
+
+    const size_t offset = out.size();
+    out.push_back(MODE_LZ);
+    if (lz_compress(planes.data(), planes.size(), out) >= planes.size()) {
+        out.resize(offset);
+        out.push_back(MODE_STORED);
+        out.insert(out.end(), planes.begin(), planes.end());
+    }
+    return out.size() - offset;
+}
+
+void ShuffleLZCodec::decode(const uint8_t* data, size_t size, Eigen::Ref<Eigen::MatrixXf> block) {
+    const Eigen::Index rows = block.rows();
+    const size_t n = static_cast<size_t>(block.size());
+    if (size == 0) corrupt("缺少模式字节");
+
+    const uint8_t* planes = data + 1;
+    thread_local std::vector<uint8_t> buffer;
+    if (data[0] == MODE_STORED) {
+        if (size - 1 != 4 * n) corrupt("长度与块尺寸不符");
+    } else if (data[0] == MODE_LZ) {
+        buffer.resize(4 * n);
+        lz_decompress(data + 1, size - 1, buffer.data(), buffer.size());
+        planes = buffer.data();
+    } else {
+        corrupt("未知的模式");
+    }
+
+    uint32_t prev = 0;
+    size_t k = 0;
+    for (Eigen::Index c = 0; c < block.cols(); ++c) {
+        float* column = block.data() + c * block.outerStride();
+        for (Eigen::Index r = 0; r < rows; ++r, ++k) {
+            const uint32_t delta = planes[k] | (static_cast<uint32_t>(planes[n + k]) << 8) |
+                                   (static_cast<uint32_t>(planes[2 * n + k]) << 16) |
+                                   (static_cast<uint32_t>(planes[3 * n + k]) << 24);
+            prev ^= delta;
+            std::memcpy(column + r, &prev, sizeof(prev));
+        }
+    }
+}
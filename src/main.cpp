@@ -1,65 +1,27 @@
 #include "compressor.h"
 #include "cache_system.h"
+#include "utils.h"
+#include "stats_reporter.h"
+#include "GenerateData.h"
+#include "tuner.h"
 #include <iostream>
 #include <fstream>
 #include <eigen3/Eigen/Dense>
 
 // 读取并解析数据（配套解析函数）
 std::vector<BEVFeaturePacket> read_multi_frames(const std::string& file_path) {
-    std::ifstream in(file_path, std::ios::binary);
-    if (!in) {
-        throw std::runtime_error("无法打开文件读取: " + file_path);
-    }
-
-    // 读取总帧数
-    uint32_t num_packets;
-    in.read(reinterpret_cast<char*>(&num_packets), sizeof(num_packets));
-
+    BEVFrameReader reader(file_path);
     std::vector<BEVFeaturePacket> packets;
-    packets.reserve(num_packets);
-
-    // 逐帧读取
-    for (uint32_t i = 0; i < num_packets; ++i) {
-        BEVFeaturePacket packet;
-
-        // 读取时间戳
-        in.read(reinterpret_cast<char*>(&packet.timestamp), sizeof(packet.timestamp));
-        
-        // 读取传感器上下文
-        in.read(reinterpret_cast<char*>(&packet.sensor_ctx.ego_speed), sizeof(packet.sensor_ctx.ego_speed));
-        in.read(reinterpret_cast<char*>(&packet.sensor_ctx.health), sizeof(packet.sensor_ctx.health));
-        in.read(reinterpret_cast<char*>(packet.sensor_ctx.ego_pose.data()), 
-                  packet.sensor_ctx.ego_pose.size() * sizeof(float));
-        
-        // 读取特征元数据
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.rows), sizeof(packet.feature_meta.rows));
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.cols), sizeof(packet.feature_meta.cols));
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.value_min), sizeof(packet.feature_meta.value_min));
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.value_max), sizeof(packet.feature_meta.value_max));
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.channel), sizeof(packet.feature_meta.channel));
-        in.read(reinterpret_cast<char*>(&packet.feature_meta.is_normalized), sizeof(packet.feature_meta.is_normalized));
-        
-        // 读取矩阵数据
-        packet.feature = Eigen::MatrixXf(packet.feature_meta.rows, packet.feature_meta.cols);
-        size_t data_size = packet.feature.size() * sizeof(float);
-        in.read(reinterpret_cast<char*>(packet.feature.data()), data_size);
-
-        if (!in) {
-            throw std::runtime_error("读取第 " + std::to_string(i) + " 帧失败");
-        }
+    packets.reserve(reader.num_frames());
 
+    BEVFeaturePacket packet;
+    while (reader.next(packet)) {
         packets.push_back(std::move(packet));
     }
-
     return packets;
 }
 
-void test_compression(const std::string& filename) {
-    BEVCompressor::Config config;
-    config.compression_ratio = 16.0f;
-    config.block_size = 16;
-    config.lossless = false;
-    
+void test_compression(const std::string& filename, const BEVCompressor::Config& config) {
     BEVCompressor compressor(config);
 
     // 从文件读取数据包
@@ -79,6 +41,11 @@ void test_compression(const std::string& filename) {
     // 压缩数据包
     std::vector<uint8_t> compressed = compressor.compress(packets);
     std::cout << "compressed.size():" << compressed.size() << std::endl;
+    if (config.verify) {
+        const BEVCompressor::QualityStats& quality = compressor.run_quality();
+        std::cout << "重建质量: 最大绝对误差 " << quality.max_abs_error << "  RMSE " << quality.rmse()
+                  << "  PSNR " << quality.psnr_db() << " dB  重编码块 " << quality.reencoded_blocks << std::endl;
+    }
     for (int i = 0; i < 10; ++i) {
         for (int j = 0; j < 10; ++j) {
             // 设置固定宽度（如8字符），右对齐，保留3位小数
@@ -108,7 +75,19 @@ void test_compression(const std::string& filename) {
     // 缓存压缩结果（注意：这里缓存的是压缩后的数据，而非原始数据包）
     BEVCache::BEVCacheConfig cache_config;
     cache_config.max_cache_size = 2048; // 最多缓存2048个块
+    auto memory_pool = std::make_shared<SimpleMemoryPool>(1024);
+    cache_config.memory_pool = memory_pool;
     BEVCache cache(cache_config);
+
+    // 后台统计日志：周期性输出压缩/缓存/内存池统计（NDJSON）
+    StatsReporter::Config reporter_config;
+    reporter_config.path = "bev_stats.jsonl";
+    reporter_config.interval_ms = 500;
+    StatsReporter reporter(reporter_config);
+    reporter.addSource("metrics", [] { return BEVMetrics::snapshot().toJSON(); });
+    reporter.addSource("cache", [&cache] { return cache.getStats(); });
+    reporter.addSource("memory_pool", [memory_pool] { return memory_pool->getStats(); });
+    reporter.start();
     
     // 将压缩数据插入缓存
     cache.insertPackets(compressed);
@@ -138,6 +117,9 @@ void test_compression(const std::string& filename) {
     // 导出统计信息到JSON
     std::string stats = cache.getStatsAsJSON();
     std::cout << "Cache stats: " << stats << std::endl;
+    // 导出各阶段延迟直方图与吞吐指标
+    Json::FastWriter metrics_writer;
+    std::cout << "Runtime metrics: " << metrics_writer.write(BEVMetrics::snapshot().toJSON());
 
     // // 从缓存读取原始数据包（如果需要使用原始数据）
 
@@ -160,19 +142,79 @@ void test_compression(const std::string& filename) {
     // }
 }
 
+// 标定模式：在样本帧上遍历压缩参数，写出params.json
+int calibrate(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "用法: " << argv[0] << " --calibrate <bin文件路径> [--frames N] [--max-latency-ms X] "
+                  << "[--max-rmse X] [--max-abs-error X] [--threads N] [--out params.json]" << std::endl;
+        return 1;
+    }
+    CompressorTuner::Options options;
+    uint32_t max_frames = 16;
+    std::string output = "params.json";
+    for (int i = 3; i + 1 < argc; i += 2) {
+        const std::string arg = argv[i];
+        const std::string value = argv[i + 1];
+        if (arg == "--frames") max_frames = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--max-latency-ms") options.max_frame_latency_ms = std::stod(value);
+        else if (arg == "--max-rmse") options.max_rmse = std::stod(value);
+        else if (arg == "--max-abs-error") options.max_abs_error = std::stod(value);
+        else if (arg == "--threads") options.threads = std::stoi(value);
+        else if (arg == "--out") output = value;
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<BEVFeaturePacket> samples = CompressorTuner::sample_frames(argv[2], max_frames);
+    std::cout << "标定样本: " << samples.size() << " 帧" << std::endl;
+    CompressorTuner::Result result = CompressorTuner::tune(samples, options);
+
+    std::cout << "Pareto最优组合：" << std::endl;
+    for (const CompressorTuner::Candidate& c : result.candidates) {
+        if (!c.pareto) continue;
+        std::cout << "  block=" << c.config.block_size << " rate=" << c.config.compression_ratio
+                  << (c.config.lossless ? " lossless" : "") << "  ratio=" << c.ratio << "  rmse=" << c.rmse
+                  << "  帧耗时=" << c.frame_ms() << "ms" << (c.feasible ? "" : "（不满足约束）") << std::endl;
+    }
+    if (result.best < 0) {
+        std::cerr << "错误: 没有满足约束的参数组合" << std::endl;
+        return 1;
+    }
+    CompressorTuner::write_params(output, result, options);
+    const CompressorTuner::Candidate& best = result.candidates[result.best];
+    std::cout << "选定: block=" << best.config.block_size << " rate=" << best.config.compression_ratio
+              << (best.config.lossless ? " lossless" : "") << "，已写入 " << output << std::endl;
+    return 0;
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
         std::cerr << "错误：缺少输入文件路径" << std::endl;
-        std::cerr << "用法示例：" << argv[0] << " <bin文件路径>" << std::endl;
+        std::cerr << "用法示例：" << argv[0] << " <bin文件路径> [--params params.json]" << std::endl;
+        std::cerr << "          " << argv[0] << " --calibrate <bin文件路径> [选项]" << std::endl;
         return 1;
     }
     
     try {
-        test_compression(argv[1]);
+        if (std::string(argv[1]) == "--calibrate") {
+            return calibrate(argc, argv);
+        }
+
+        BEVCompressor::Config config;
+        config.compression_ratio = 16.0f;
+        config.block_size = 16;
+        config.lossless = false;
+        config.verify = true;  // 影子模式：只统计重建误差，不改变输出
+        if (argc >= 4 && std::string(argv[2]) == "--params") {
+            config = BEVCompressor::load_config(argv[3]);
+        }
+        test_compression(argv[1], config);
     } catch (const std::exception& e) {
         std::cerr << "错误: " << e.what() << std::endl;
         return 1;
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,222 @@
+#include "prefetcher.h"
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+const double FETCH_COST_EWMA_ALPHA = 0.1;  // 读取+解码耗时估计的平滑系数
+}
+
+BEVPrefetcher::BEVPrefetcher(BEVCache& cache, const BEVCompressor& compressor, const Config& config)
+    : cache_(cache), compressor_(compressor), config_(config)
+{
+    worker_ = std::thread(&BEVPrefetcher::workerLoop, this);
+}
+
+BEVPrefetcher::~BEVPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stop_ = true;
+    }
+    queue_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool BEVPrefetcher::get(uint64_t timestamp, uint16_t x, uint16_t y, Eigen::MatrixXf& block) {
+    Key key{timestamp, x, y};
+
+    // 1. 解码缓冲区命中：直接交出已解码的块
+    //    （先取走再更新访问模式：否则本次触发的预取可能在取走之前把该块挤出缓冲区）
+    bool buffered = false;
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        auto it = decoded_.find(key);
+        if (it != decoded_.end()) {
+            block = std::move(it->second.data);
+            generation = it->second.generation;
+            decoded_.erase(it);  // decoded_order_中的残留键在淘汰时跳过
+            buffered = true;
+        }
+    }
+    observe(key);
+    // 预取走的是peek：在缓存中补记这次访问，保持LRU顺序与命中统计和同步读取一致。
+    // 解码之后该块已被淘汰或被新内容替换时，缓冲的结果作废，按未命中同步读取
+    if (buffered) {
+        if (cache_.touch(key.timestamp, key.x, key.y, generation)) {
+            useful_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        wasted_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 2. 未命中：同步检索并解码
+    demand_fetches_.fetch_add(1, std::memory_order_relaxed);
+    return fetchAndDecode(key, block, true);
+}
+
+BEVPrefetcher::Stats BEVPrefetcher::getStats() const {
+    Stats stats;
+    stats.issued = issued_.load(std::memory_order_relaxed);
+    stats.useful = useful_.load(std::memory_order_relaxed);
+    stats.wasted = wasted_.load(std::memory_order_relaxed);
+    stats.demand_fetches = demand_fetches_.load(std::memory_order_relaxed);
+    uint64_t resolved = stats.useful + stats.wasted;
+    stats.accuracy = resolved > 0 ? static_cast<double>(stats.useful) / resolved : 0.0;
+    stats.latency_saved_ms = stats.useful * fetch_cost_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void BEVPrefetcher::observe(const Key& key) {
+    std::lock_guard<std::mutex> lock(pattern_mutex_);
+
+    if (has_last_) {
+        // 时间方向：帧切换时统计连续前进次数，回退则重置
+        if (key.timestamp > last_key_.timestamp) {
+            ++sequential_count_;
+        } else if (key.timestamp < last_key_.timestamp) {
+            sequential_count_ = 0;
+        }
+
+        if (sequential_count_ >= config_.min_confidence) {
+            uint64_t ts = key.timestamp;
+            for (int i = 0; i < config_.lookahead_frames; ++i) {
+                uint64_t next;
+                if (!cache_.nextTimestamp(ts, next)) {
+                    break;
+                }
+                enqueue(Key{next, key.x, key.y});
+                ts = next;
+            }
+        }
+
+        // 空间方向：同一帧内沿上一步的方向预取相邻块
+        if (config_.prefetch_neighbors && key.timestamp == last_key_.timestamp) {
+            int dx = static_cast<int>(key.x) - static_cast<int>(last_key_.x);
+            int dy = static_cast<int>(key.y) - static_cast<int>(last_key_.y);
+            bool adjacent = std::abs(dx) <= config_.block_size && std::abs(dy) <= config_.block_size;
+            if (adjacent && (dx != 0 || dy != 0)) {
+                int nx = key.x + dx;
+                int ny = key.y + dy;
+                const int max_coord = std::numeric_limits<uint16_t>::max();
+                if (nx >= 0 && ny >= 0 && nx <= max_coord && ny <= max_coord) {
+                    enqueue(Key{key.timestamp, static_cast<uint16_t>(nx), static_cast<uint16_t>(ny)});
+                }
+            }
+        }
+    }
+
+    last_key_ = key;
+    has_last_ = true;
+}
+
+void BEVPrefetcher::enqueue(const Key& key) {
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        if (decoded_.count(key)) {
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (!pending_set_.insert(key).second) {
+            return;
+        }
+        pending_.push_back(key);
+        // 请求过多时丢弃最旧的预测，它们最不可能仍然有用
+        if (pending_.size() > config_.max_pending_requests) {
+            pending_set_.erase(pending_.front());
+            pending_.pop_front();
+        }
+    }
+    queue_cv_.notify_one();
+}
+
+void BEVPrefetcher::workerLoop() {
+    for (;;) {
+        Key key;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+            if (stop_) {
+                return;
+            }
+            key = pending_.front();
+            pending_.pop_front();
+            pending_set_.erase(key);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            if (decoded_.count(key)) {
+                continue;
+            }
+        }
+
+        Eigen::MatrixXf block;
+        uint64_t generation = 0;
+        bool ok = false;
+        try {
+            ok = fetchAndDecode(key, block, false, &generation);
+        } catch (const std::exception&) {
+            ok = false;  // 损坏的块交给同步路径报告错误
+        }
+        if (!ok) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        decoded_[key] = DecodedBlock{std::move(block), generation};
+        decoded_order_.push_back(key);
+        issued_.fetch_add(1, std::memory_order_relaxed);
+
+        // 缓冲区超限：按插入顺序淘汰，跳过已被读取的键
+        while (decoded_.size() > config_.max_decoded_blocks && !decoded_order_.empty()) {
+            auto it = decoded_.find(decoded_order_.front());
+            decoded_order_.pop_front();
+            if (it != decoded_.end()) {
+                decoded_.erase(it);
+                wasted_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        // 防止残留键无限增长
+        if (decoded_order_.size() > 2 * config_.max_decoded_blocks + 1) {
+            std::deque<Key> compacted;
+            for (const Key& k : decoded_order_) {
+                if (decoded_.count(k)) {
+                    compacted.push_back(k);
+                }
+            }
+            decoded_order_.swap(compacted);
+        }
+    }
+}
+
+bool BEVPrefetcher::fetchAndDecode(const Key& key, Eigen::MatrixXf& block, bool demand, uint64_t* generation) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    BEVBlockCodec codec;
+    bool found = demand
+        ? cache_.retrieve(key.timestamp, key.x, key.y, data, rows, cols, &codec)
+        : cache_.peek(key.timestamp, key.x, key.y, data, rows, cols, &codec, generation);
+    if (!found) {
+        return false;
+    }
+
+    block.resize(rows, cols);
+    compressor_.decode_block(codec, data.data(), data.size(), block);
+
+    double cost_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    double old_cost = fetch_cost_ms_.load(std::memory_order_relaxed);
+    double new_cost = old_cost == 0.0 ? cost_ms : old_cost + FETCH_COST_EWMA_ALPHA * (cost_ms - old_cost);
+    while (!fetch_cost_ms_.compare_exchange_weak(old_cost, new_cost, std::memory_order_relaxed)) {
+        new_cost = old_cost + FETCH_COST_EWMA_ALPHA * (cost_ms - old_cost);
+    }
+    return true;
+}
@@ -0,0 +1,227 @@
+#include "compressor.h"
+#include "utils.h"
+#include <cstring>
+#include <stdexcept>
+
+// 渐进式流布局：
+//   uint32 magic, uint64 timestamp, uint32 rows, uint32 cols, uint16 block_size,
+//   uint8 codec, uint8 reserved, uint16 num_layers
+//   float    layer_rates[num_layers]
+//   uint32   layer_end[num_layers]     各层结束位置（相对流起始），便于发送端按层截断
+//   各层依次排列，层内按块的行优先顺序存放记录：uint16 压缩大小 + 压缩数据
+// 各层固定以CODEC_ZFP_RATE编码并写入流头，解码端不依赖自身配置的无损模式
+namespace {
+
+const uint32_t PROGRESSIVE_MAGIC = 0x32505642;  // "BVP2"（v2起流头带codec）
+const size_t PROGRESSIVE_FIXED_HEADER = 4 + 8 + 4 + 4 + 2 + 1 + 1 + 2;
+const uint8_t PROGRESSIVE_CODEC = BEVCompressor::CODEC_ZFP_RATE;
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+size_t header_size(size_t num_layers) {
+    return PROGRESSIVE_FIXED_HEADER + num_layers * (sizeof(float) + sizeof(uint32_t));
+}
+
+}  // namespace
+
+std::vector<uint8_t> BEVCompressor::compress_progressive(const BEVFeaturePacket& packet,
+                                                         const std::vector<float>& layer_rates) {
+    ScopedTimer frame_timer(MetricStage::FRAME_COMPRESS);
+    if (layer_rates.empty() || layer_rates.size() > UINT16_MAX) {
+        throw std::invalid_argument("渐进式压缩的层数无效");
+    }
+    const Eigen::MatrixXf& matrix = packet.feature;
+    const int bs = config_.block_size;
+    const int grid_rows = (matrix.rows() + bs - 1) / bs;
+    const int grid_cols = (matrix.cols() + bs - 1) / bs;
+
+    std::vector<uint8_t> out;
+    append(out, PROGRESSIVE_MAGIC);
+    append(out, static_cast<uint64_t>(packet.timestamp));
+    append(out, static_cast<uint32_t>(matrix.rows()));
+    append(out, static_cast<uint32_t>(matrix.cols()));
+    append(out, static_cast<uint16_t>(bs));
+    append(out, PROGRESSIVE_CODEC);
+    append(out, static_cast<uint8_t>(0));
+    append(out, static_cast<uint16_t>(layer_rates.size()));
+    for (float rate : layer_rates) {
+        append(out, rate);
+    }
+    const size_t layer_end_pos = out.size();
+    out.resize(out.size() + layer_rates.size() * sizeof(uint32_t));
+
+    // 残差矩阵：每编码一层，减去该层的重建结果，下一层编码剩余误差
+    Eigen::MatrixXf residual = matrix;
+    Eigen::MatrixXf decoded;
+    for (size_t layer = 0; layer < layer_rates.size(); ++layer) {
+        for (int bi = 0; bi < grid_rows; ++bi) {
+            for (int bj = 0; bj < grid_cols; ++bj) {
+                const int i = bi * bs, j = bj * bs;
+                const int block_rows = std::min<int>(bs, matrix.rows() - i);
+                const int block_cols = std::min<int>(bs, matrix.cols() - j);
+                std::vector<uint8_t> payload =
+                    compress_block(residual.block(i, j, block_rows, block_cols), layer_rates[layer],
+                                   Config::ZFP_MODE_DEFAULT);
+                if (payload.size() > UINT16_MAX) {
+                    throw std::runtime_error("渐进式压缩块过大");
+                }
+                append(out, static_cast<uint16_t>(payload.size()));
+                out.insert(out.end(), payload.begin(), payload.end());
+
+                if (layer + 1 < layer_rates.size()) {
+                    decoded.resize(block_rows, block_cols);
+                    decode_block(PROGRESSIVE_CODEC, payload.data(), payload.size(), decoded, layer_rates[layer]);
+                    residual.block(i, j, block_rows, block_cols) -= decoded;
+                }
+            }
+        }
+        if (out.size() > UINT32_MAX) {
+            throw std::runtime_error("渐进式压缩流过大");
+        }
+        uint32_t layer_end = static_cast<uint32_t>(out.size());
+        std::memcpy(out.data() + layer_end_pos + layer * sizeof(uint32_t), &layer_end, sizeof(layer_end));
+    }
+
+    BEVMetrics::recordBytes(MetricStage::FRAME_COMPRESS, matrix.size() * sizeof(float), out.size());
+    return out;
+}
+
+size_t BEVCompressor::progressive_truncate_size(const std::vector<uint8_t>& stream, size_t byte_budget) {
+    if (stream.size() < PROGRESSIVE_FIXED_HEADER ||
+        load<uint32_t>(stream.data()) != PROGRESSIVE_MAGIC) {
+        throw std::runtime_error("不是渐进式压缩流");
+    }
+    const size_t num_layers = load<uint16_t>(stream.data() + PROGRESSIVE_FIXED_HEADER - 2);
+    if (stream.size() < header_size(num_layers)) {
+        throw std::runtime_error("渐进式压缩流头不完整");
+    }
+
+    // 按层结束位置截断：取不超过预算的最后一个完整层，基础层都放不下时返回0
+    const uint8_t* layer_end = stream.data() + PROGRESSIVE_FIXED_HEADER + num_layers * sizeof(float);
+    const size_t limit = std::min(byte_budget, stream.size());
+    size_t cut = 0;
+    size_t previous = header_size(num_layers);
+    for (size_t layer = 0; layer < num_layers; ++layer) {
+        const size_t end = load<uint32_t>(layer_end + layer * sizeof(uint32_t));
+        if (end < previous || end > stream.size()) {
+            throw std::runtime_error("渐进式压缩流的层结束位置无效");
+        }
+        if (end > limit) {
+            break;
+        }
+        cut = end;
+        previous = end;
+    }
+    return cut;
+}
+
+// ---------------- ProgressiveDecoder ----------------
+
+ProgressiveDecoder::ProgressiveDecoder(const BEVCompressor& compressor) : compressor_(compressor) {}
+
+void ProgressiveDecoder::reset() {
+    buffer_.clear();
+    consumed_ = 0;
+    header_ready_ = false;
+    frame_ = BEVFeaturePacket();
+    block_size_ = 0;
+    codec_ = 0;
+    layer_rates_.clear();
+    layer_ = 0;
+    block_index_ = 0;
+}
+
+bool ProgressiveDecoder::parse_header() {
+    const uint8_t* p = buffer_.data() + consumed_;
+    const size_t available = buffer_.size() - consumed_;
+    if (available < PROGRESSIVE_FIXED_HEADER) {
+        return false;
+    }
+    if (load<uint32_t>(p) != PROGRESSIVE_MAGIC) {
+        throw std::runtime_error("不是渐进式压缩流");
+    }
+    const uint16_t num_layers = load<uint16_t>(p + 24);
+    if (available < header_size(num_layers)) {
+        return false;
+    }
+    const uint32_t rows = load<uint32_t>(p + 12);
+    const uint32_t cols = load<uint32_t>(p + 16);
+    block_size_ = load<uint16_t>(p + 20);
+    codec_ = p[22];
+    if (block_size_ == 0 || num_layers == 0) {
+        throw std::runtime_error("渐进式压缩流头无效");
+    }
+    if (codec_ != PROGRESSIVE_CODEC) {
+        throw std::runtime_error("渐进式压缩流的编码方式不受支持");
+    }
+    frame_.timestamp = load<uint64_t>(p + 4);
+    frame_.feature = Eigen::MatrixXf::Zero(rows, cols);
+    layer_rates_.resize(num_layers);
+    for (uint16_t k = 0; k < num_layers; ++k) {
+        layer_rates_[k] = load<float>(p + PROGRESSIVE_FIXED_HEADER + k * sizeof(float));
+    }
+    consumed_ += header_size(num_layers);
+    header_ready_ = true;
+    return true;
+}
+
+size_t ProgressiveDecoder::feed(const uint8_t* data, size_t size) {
+    ScopedTimer timer(MetricStage::DECOMPRESS);
+    buffer_.insert(buffer_.end(), data, data + size);
+    if (!header_ready_ && !parse_header()) {
+        return 0;
+    }
+
+    const Eigen::Index rows = frame_.feature.rows();
+    const Eigen::Index cols = frame_.feature.cols();
+    const size_t grid_rows = (rows + block_size_ - 1) / block_size_;
+    const size_t grid_cols = (cols + block_size_ - 1) / block_size_;
+    const size_t blocks_per_layer = grid_rows * grid_cols;
+
+    size_t decoded = 0;
+    const size_t start = consumed_;
+    while (layer_ < num_layers() && consumed_ + sizeof(uint16_t) <= buffer_.size()) {
+        const size_t payload_size = load<uint16_t>(buffer_.data() + consumed_);
+        if (consumed_ + sizeof(uint16_t) + payload_size > buffer_.size()) {
+            break;  // 块记录尚未完整到达
+        }
+        const uint8_t* payload = buffer_.data() + consumed_ + sizeof(uint16_t);
+
+        const Eigen::Index i = static_cast<Eigen::Index>(block_index_ / grid_cols) * block_size_;
+        const Eigen::Index j = static_cast<Eigen::Index>(block_index_ % grid_cols) * block_size_;
+        const Eigen::Index block_rows = std::min<Eigen::Index>(block_size_, rows - i);
+        const Eigen::Index block_cols = std::min<Eigen::Index>(block_size_, cols - j);
+        tile_.resize(block_rows, block_cols);
+        compressor_.decode_block(codec_, payload, payload_size, tile_, layer_rates_[layer_]);
+        if (layer_ == 0) {
+            frame_.feature.block(i, j, block_rows, block_cols) = tile_;
+        } else {
+            frame_.feature.block(i, j, block_rows, block_cols) += tile_;
+        }
+
+        consumed_ += sizeof(uint16_t) + payload_size;
+        ++decoded;
+        if (++block_index_ == blocks_per_layer) {
+            block_index_ = 0;
+            ++layer_;
+        }
+    }
+    BEVMetrics::recordBytes(MetricStage::DECOMPRESS, consumed_ - start,
+                            decoded * block_size_ * block_size_ * sizeof(float));
+
+    // 丢弃已消费的字节，缓冲区只保留未完整的尾部
+    buffer_.erase(buffer_.begin(), buffer_.begin() + consumed_);
+    consumed_ = 0;
+    return decoded;
+}
@@ -0,0 +1,221 @@
+#include "replay.h"
+#include "GenerateData.h"
+#include <random>
+#include <thread>
+
+namespace {
+
+Json::Value latencyJSON(const std::array<uint64_t, BEVMetrics::NUM_BUCKETS>& buckets, uint64_t count,
+                        uint64_t total_ns, uint64_t max_ns, double unit_ns) {
+    // 分位数取所在桶的上界，不超过实测最大值
+    auto quantile = [&](double q) { return std::min(BEVMetrics::percentile(buckets, count, q), max_ns) / unit_ns; };
+    Json::Value root;
+    root["mean"] = count > 0 ? total_ns / unit_ns / count : 0.0;
+    root["p50"] = quantile(0.50);
+    root["p99"] = quantile(0.99);
+    root["p999"] = quantile(0.999);
+    root["max"] = max_ns / unit_ns;
+    return root;
+}
+
+}  // namespace
+
+void ReplayHarness::ReaderStats::merge(const ReaderStats& other) {
+    reads += other.reads;
+    total_ns += other.total_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+    blocks_hit += other.blocks_hit;
+    blocks_missed += other.blocks_missed;
+    for (int b = 0; b < BEVMetrics::NUM_BUCKETS; ++b) {
+        buckets[b] += other.buckets[b];
+    }
+}
+
+ReplayHarness::ReplayHarness(const Config& config) : config_(config) {
+    if (config_.input_path.empty()) {
+        throw std::invalid_argument("回放文件路径为空");
+    }
+    config_.window_frames = std::max<uint32_t>(config_.window_frames, 1);
+}
+
+const char* ReplayHarness::patternName(AccessPattern pattern) {
+    switch (pattern) {
+        case AccessPattern::LATEST:         return "latest";
+        case AccessPattern::SLIDING_WINDOW: return "sliding_window";
+        case AccessPattern::RANDOM_HISTORY: return "random_history";
+        default:                            return "unknown";
+    }
+}
+
+void ReplayHarness::readerLoop(AccessPattern pattern, int thread_index, BEVCache& cache,
+                               const BEVCompressor& compressor) {
+    ReaderStats local;
+    std::mt19937_64 rng(config_.seed + static_cast<uint64_t>(pattern) * 1000003 + thread_index);
+    Eigen::MatrixXf frame;
+    std::vector<BEVCache::CacheKey> misses;
+    uint64_t cursor = 0;
+
+    while (!done_.load(std::memory_order_acquire)) {
+        const uint32_t available = ingested_.load(std::memory_order_acquire);
+        if (available == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+
+        uint32_t index = available - 1;
+        switch (pattern) {
+            case AccessPattern::LATEST:
+                break;
+            case AccessPattern::SLIDING_WINDOW: {
+                const uint32_t window = std::min(available, config_.window_frames);
+                index = available - 1 - static_cast<uint32_t>(cursor++ % window);
+                break;
+            }
+            case AccessPattern::RANDOM_HISTORY:
+                index = static_cast<uint32_t>(rng() % available);
+                break;
+            default:
+                break;
+        }
+
+        const FrameInfo& info = frames_[index];
+        if (frame.rows() != info.rows || frame.cols() != info.cols) {
+            frame.resize(info.rows, info.cols);
+        }
+        misses.clear();
+        const auto start = Clock::now();
+        const size_t hits = cache.retrieveFrame(info.timestamp, compressor, frame, &misses);
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+        ++local.reads;
+        local.total_ns += ns;
+        local.max_ns = std::max(local.max_ns, ns);
+        ++local.buckets[BEVMetrics::bucketIndex(ns)];
+        local.blocks_hit += hits;
+        local.blocks_missed += misses.size();
+
+        if (config_.read_interval_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(config_.read_interval_us));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    reader_stats_[static_cast<size_t>(pattern)].merge(local);
+}
+
+Json::Value ReplayHarness::run() {
+    BEVFrameReader reader(config_.input_path);
+    const uint32_t total = config_.max_frames > 0 ? std::min(config_.max_frames, reader.num_frames())
+                                                  : reader.num_frames();
+
+    BEVCompressor compressor(config_.compressor);
+    BEVCache::BEVCacheConfig cache_config;
+    cache_config.max_cache_size = config_.cache_size;
+    cache_config.memory_pool = std::make_shared<SimpleMemoryPool>(1024);
+    BEVCache cache(cache_config);
+
+    frames_.assign(total, FrameInfo());
+    ingested_.store(0, std::memory_order_relaxed);
+    done_.store(false, std::memory_order_relaxed);
+    reader_stats_ = {};
+
+    std::vector<std::thread> readers;
+    for (size_t p = 0; p < NUM_PATTERNS; ++p) {
+        for (int t = 0; t < config_.reader_threads[p]; ++t) {
+            readers.emplace_back(&ReplayHarness::readerLoop, this, static_cast<AccessPattern>(p), t,
+                                 std::ref(cache), std::cref(compressor));
+        }
+    }
+
+    // 摄入：按帧时间戳相对首帧的间隔/倍速确定每帧的计划时刻，提前到达则等待，
+    // 插入完成时刻与计划时刻之差即为相对实时的滞后
+    std::array<uint64_t, BEVMetrics::NUM_BUCKETS> lag_buckets{};
+    uint64_t lag_total_ns = 0, lag_max_ns = 0, lag_final_ns = 0;
+    uint64_t raw_bytes = 0, compressed_bytes = 0;
+    uint64_t first_timestamp = 0, last_timestamp = 0;
+    const bool paced = config_.speed > 0;
+
+    std::vector<BEVFeaturePacket> batch(1);
+    const auto start = Clock::now();
+    try {
+        for (uint32_t i = 0; i < total && reader.next(batch[0]); ++i) {
+            const BEVFeaturePacket& packet = batch[0];
+            if (i == 0) {
+                first_timestamp = packet.timestamp;
+            }
+            last_timestamp = std::max(last_timestamp, packet.timestamp);
+
+            Clock::time_point scheduled = Clock::now();
+            if (paced) {
+                const uint64_t offset_ns = packet.timestamp > first_timestamp ? packet.timestamp - first_timestamp : 0;
+                scheduled = start + std::chrono::nanoseconds(static_cast<int64_t>(offset_ns / config_.speed));
+                std::this_thread::sleep_until(scheduled);
+            }
+
+            std::vector<uint8_t> compressed = compressor.compress(batch);
+            cache.insertPackets(compressed);
+            raw_bytes += static_cast<uint64_t>(packet.feature.size()) * sizeof(float);
+            compressed_bytes += compressed.size();
+
+            frames_[i] = {packet.timestamp, static_cast<uint32_t>(packet.feature.rows()),
+                          static_cast<uint32_t>(packet.feature.cols())};
+            ingested_.store(i + 1, std::memory_order_release);
+
+            if (paced) {
+                const uint64_t lag = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled).count();
+                ++lag_buckets[BEVMetrics::bucketIndex(lag)];
+                lag_total_ns += lag;
+                lag_max_ns = std::max(lag_max_ns, lag);
+                lag_final_ns = lag;
+            }
+        }
+    } catch (...) {
+        done_.store(true, std::memory_order_release);
+        for (std::thread& t : readers) t.join();
+        throw;
+    }
+    const double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+    done_.store(true, std::memory_order_release);
+    for (std::thread& t : readers) {
+        t.join();
+    }
+
+    const uint32_t frames = ingested_.load(std::memory_order_relaxed);
+    const double media_s = (last_timestamp - first_timestamp) * 1e-9;
+    const double mb = 1024.0 * 1024.0;
+
+    Json::Value report;
+    report["input"] = config_.input_path;
+    report["frames"] = frames;
+    report["speed"] = paced ? config_.speed : 0.0;
+    report["wall_s"] = wall_s;
+    report["media_s"] = media_s;
+
+    Json::Value& ingest = report["ingest"];
+    ingest["fps"] = wall_s > 0 ? frames / wall_s : 0.0;
+    ingest["raw_mb_per_s"] = wall_s > 0 ? raw_bytes / mb / wall_s : 0.0;
+    ingest["compressed_mb_per_s"] = wall_s > 0 ? compressed_bytes / mb / wall_s : 0.0;
+    ingest["realtime_factor"] = wall_s > 0 ? media_s / wall_s : 0.0;  // 每秒墙钟时间回放的数据秒数
+    if (paced) {
+        Json::Value lag = latencyJSON(lag_buckets, frames, lag_total_ns, lag_max_ns, 1e6);
+        lag["final"] = lag_final_ns / 1e6;
+        report["lag_ms"] = lag;
+    }
+
+    Json::Value& readers_json = report["readers"];
+    for (size_t p = 0; p < NUM_PATTERNS; ++p) {
+        const ReaderStats& stats = reader_stats_[p];
+        Json::Value entry;
+        entry["threads"] = config_.reader_threads[p];
+        entry["reads"] = static_cast<Json::UInt64>(stats.reads);
+        entry["reads_per_s"] = wall_s > 0 ? stats.reads / wall_s : 0.0;
+        const uint64_t blocks = stats.blocks_hit + stats.blocks_missed;
+        entry["block_hit_rate"] = blocks > 0 ? static_cast<double>(stats.blocks_hit) / blocks : 0.0;
+        entry["latency_us"] = latencyJSON(stats.buckets, stats.reads, stats.total_ns, stats.max_ns, 1e3);
+        readers_json[patternName(static_cast<AccessPattern>(p))] = entry;
+    }
+
+    report["cache"] = cache.getStats();
+    report["metrics"] = BEVMetrics::snapshot().toJSON();
+    return report;
+}
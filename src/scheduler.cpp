@@ -0,0 +1,191 @@
+#include "scheduler.h"
+#include <stdexcept>
+
+namespace {
+BEVCompressor::Config makeReducedConfig(const CompressionScheduler::Config& config) {
+    BEVCompressor::Config reduced = config.compressor;
+    reduced.compression_ratio = config.compressor.compression_ratio * config.reduced_rate_scale;
+    // 无损编码不受码率影响，校验模式会逐块提升码率，金字塔粗层额外增加编码量：降级档位一律关闭
+    reduced.lossless = false;
+    reduced.verify = false;
+    reduced.error_bound = 0.0f;
+    reduced.pyramid_levels = 1;
+    return reduced;
+}
+}
+
+CompressionScheduler::CompressionScheduler(const Config& config, ResultCallback callback)
+    : config_(config),
+      callback_(std::move(callback)),
+      full_compressor_(config.compressor),
+      reduced_compressor_(makeReducedConfig(config))
+{
+    if (config_.target_fps <= 0) {
+        throw std::invalid_argument("target_fps必须大于0");
+    }
+    if (config_.max_pending_frames == 0) {
+        throw std::invalid_argument("max_pending_frames必须大于0");
+    }
+    if (config_.key_frame_interval <= 0) {
+        config_.key_frame_interval = 1;
+    }
+    frame_period_ = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / config_.target_fps));
+
+    worker_ = std::thread(&CompressionScheduler::workerLoop, this);
+}
+
+CompressionScheduler::~CompressionScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stop_ = true;
+    }
+    queue_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool CompressionScheduler::submit(BEVFeaturePacket packet) {
+    return submit(std::move(packet), Clock::now() + frame_period_);
+}
+
+bool CompressionScheduler::submit(BEVFeaturePacket packet, Clock::time_point deadline) {
+    bool accepted = true;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        // 队列已满：丢弃最旧帧，新帧永远比旧帧更有价值
+        if (pending_.size() >= config_.max_pending_frames) {
+            pending_.pop_front();
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            accepted = false;
+        }
+        pending_.push_back(Job{std::move(packet), deadline});
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    queue_cv_.notify_one();
+    return accepted;
+}
+
+void CompressionScheduler::flush() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    idle_cv_.wait(lock, [this] { return pending_.empty() && !busy_; });
+}
+
+CompressionScheduler::Stats CompressionScheduler::getStats() const {
+    Stats stats;
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.compressed = compressed_.load(std::memory_order_relaxed);
+    stats.late_frames = late_frames_.load(std::memory_order_relaxed);
+    stats.degraded_frames = degraded_frames_.load(std::memory_order_relaxed);
+    stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+    stats.failed_frames = failed_frames_.load(std::memory_order_relaxed);
+    stats.est_full_cost_ms = est_full_cost_ms_.load(std::memory_order_relaxed);
+    stats.est_reduced_cost_ms = est_reduced_cost_ms_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+BEVCompressor& CompressionScheduler::compressorFor(DegradeLevel level) {
+    return level == DegradeLevel::FULL ? full_compressor_ : reduced_compressor_;
+}
+
+CompressionScheduler::DegradeLevel CompressionScheduler::chooseLevel(
+    Clock::time_point now, Clock::time_point deadline) const
+{
+    if (now >= deadline) {
+        return DegradeLevel::KEY_FRAME_ONLY;
+    }
+    double slack_ms = std::chrono::duration<double, std::milli>(deadline - now).count();
+    if (slack_ms >= est_full_cost_ms_.load(std::memory_order_relaxed)) {
+        return DegradeLevel::FULL;
+    }
+    if (slack_ms >= est_reduced_cost_ms_.load(std::memory_order_relaxed)) {
+        return DegradeLevel::REDUCED_RATE;
+    }
+    // 降级档位也来不及完成，直接按迟到处理
+    return DegradeLevel::KEY_FRAME_ONLY;
+}
+
+void CompressionScheduler::updateCostEstimate(std::atomic<double>& estimate, double cost_ms, bool replace) {
+    double old_value = estimate.load(std::memory_order_relaxed);
+    double new_value = replace || old_value == 0.0
+        ? cost_ms
+        : old_value + config_.cost_ewma_alpha * (cost_ms - old_value);
+    estimate.store(new_value, std::memory_order_relaxed);
+}
+
+void CompressionScheduler::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return;  // stop_且队列已空
+            }
+            job = std::move(pending_.front());
+            pending_.pop_front();
+            busy_ = true;
+        }
+
+        Clock::time_point start = Clock::now();
+        bool late = start >= job.deadline;
+        DegradeLevel level = chooseLevel(start, job.deadline);
+        if (late) {
+            late_frames_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // 试探FULL：裕量最多一个帧周期，一帧偶发的慢帧会使估计一直大于裕量；
+        // 试探帧的实测耗时直接取代陈旧的估计
+        bool probe = false;
+        if (!late && level != DegradeLevel::FULL && config_.full_probe_interval > 0 &&
+            frames_since_full_ >= config_.full_probe_interval) {
+            level = DegradeLevel::FULL;
+            probe = true;
+        }
+        frames_since_full_ = level == DegradeLevel::FULL ? 0 : frames_since_full_ + 1;
+
+        bool keep = true;
+        if (level == DegradeLevel::KEY_FRAME_ONLY) {
+            keep = (key_frame_counter_++ % static_cast<uint64_t>(config_.key_frame_interval)) == 0;
+        } else {
+            key_frame_counter_ = 0;  // 恢复正常后，下一次进入关键帧模式时首帧即为关键帧
+        }
+
+        if (keep) {
+            // 异常不能逃出工作线程（否则进程终止，flush也永远等不到busy_复位），只计数
+            try {
+                BEVCompressor& compressor = compressorFor(level);
+                Result result;
+                result.timestamp = job.packet.timestamp;
+                result.level = level;
+                result.rate = level == DegradeLevel::FULL
+                    ? config_.compressor.compression_ratio
+                    : config_.compressor.compression_ratio * config_.reduced_rate_scale;
+                result.late = late;
+                result.data = compressor.compress({job.packet});
+
+                double cost_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                updateCostEstimate(level == DegradeLevel::FULL ? est_full_cost_ms_ : est_reduced_cost_ms_, cost_ms,
+                                   probe);
+
+                compressed_.fetch_add(1, std::memory_order_relaxed);
+                if (level != DegradeLevel::FULL) {
+                    degraded_frames_.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (callback_) {
+                    callback_(std::move(result));
+                }
+            } catch (...) {
+                failed_frames_.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            busy_ = false;
+        }
+        idle_cv_.notify_all();
+    }
+}
@@ -0,0 +1,681 @@
+#include "shm_cache.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char SHM_MAGIC[8] = {'B', 'E', 'V', 'S', 'H', 'M', 'C', '\0'};
+const uint32_t SHM_VERSION = 3;
+const uint32_t NIL = UINT32_MAX;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "共享内存中的原子计数需要无锁实现");
+static_assert(std::atomic<uint8_t>::is_always_lock_free, "共享内存中的原子标志需要无锁实现");
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t mixKey(const BEVBlockKey& key) {
+    uint64_t h = key.timestamp * 0x9E3779B97F4A7C15ULL;
+    h ^= (static_cast<uint64_t>(key.x) << 24) ^ (static_cast<uint64_t>(key.y) << 8) ^ key.level;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 块大小对应的尺寸类别：64B << class，超过最大类别返回-1
+int sizeClass(size_t size) {
+    int c = 0;
+    size_t chunk = SharedBEVCache::MIN_CHUNK;
+    while (chunk < size) {
+        chunk <<= 1;
+        ++c;
+    }
+    return c < SharedBEVCache::NUM_CLASSES ? c : -1;
+}
+
+// [offset, offset + count * elem_size) 是否落在长度为length的区域内（不溢出）
+bool fits(uint64_t offset, uint64_t count, uint64_t elem_size, uint64_t length) {
+    return offset <= length && count <= (length - offset) / elem_size;
+}
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+struct SharedBEVCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t region_size;
+    uint32_t max_items;
+    uint32_t num_buckets;                 // 2的幂
+    uint32_t num_pages;
+    uint32_t reserved;
+    uint64_t buckets_offset;              // 以下偏移均相对区域起点
+    uint64_t entries_offset;
+    uint64_t pages_offset;
+    uint64_t data_offset;
+    pthread_rwlock_t lock;                // PTHREAD_PROCESS_SHARED
+
+    // 以下受写锁保护
+    uint32_t free_entry;                  // 空闲条目链表
+    uint32_t free_page;                   // 空闲页链表
+    uint32_t free_page_count;
+    uint32_t clock_hand;
+    uint32_t item_count;
+    uint32_t partial[NUM_CLASSES];        // 各尺寸类别中还有空闲块的页（双向链表）
+    uint64_t stored_bytes;                // 块数据字节数
+    uint64_t slab_bytes;                  // 已分配的slab块字节数（含尺寸类别取整）
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t alloc_failures;
+
+    // 读者并发更新
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> decode_errors;  // retrieveFrame中解码失败（按未命中处理）的块数
+    std::atomic<uint32_t> ready;          // 创建者初始化完成后置1
+};
+
+struct SharedBEVCache::Entry {
+    uint64_t timestamp;
+    uint64_t data_offset;                 // 相对数据区
+    uint32_t size;
+    uint32_t next;                        // 哈希链或空闲链的后继
+    float rate;                           // 块的编码方式（BEVBlockCodec）
+    uint16_t x;
+    uint16_t y;
+    uint16_t rows;
+    uint16_t cols;
+    uint8_t level;
+    uint8_t codec;
+    uint8_t size_class;
+    uint8_t in_use;
+    std::atomic<uint8_t> referenced;      // CLOCK引用位（读者置位，淘汰时清除）
+};
+
+struct SharedBEVCache::Page {
+    int32_t size_class;                   // -1表示空闲页
+    uint32_t used;                        // 已分配的块数
+    uint32_t free_chunk;                  // 页内第一个空闲块的偏移，NIL表示已满
+    uint32_t prev;                        // partial链表
+    uint32_t next;                        // partial链表或空闲页链表
+};
+
+namespace {
+
+class ReadLock {
+public:
+    explicit ReadLock(pthread_rwlock_t* lock) : lock_(lock) {
+        if (pthread_rwlock_rdlock(lock_) != 0) throw std::runtime_error("共享缓存加读锁失败");
+    }
+    ~ReadLock() { pthread_rwlock_unlock(lock_); }
+    ReadLock(const ReadLock&) = delete;
+    ReadLock& operator=(const ReadLock&) = delete;
+
+private:
+    pthread_rwlock_t* lock_;
+};
+
+class WriteLock {
+public:
+    explicit WriteLock(pthread_rwlock_t* lock) : lock_(lock) {
+        if (pthread_rwlock_wrlock(lock_) != 0) throw std::runtime_error("共享缓存加写锁失败");
+    }
+    ~WriteLock() { pthread_rwlock_unlock(lock_); }
+    WriteLock(const WriteLock&) = delete;
+    WriteLock& operator=(const WriteLock&) = delete;
+
+private:
+    pthread_rwlock_t* lock_;
+};
+
+}  // namespace
+
+SharedBEVCache::SharedBEVCache(int fd, void* base, size_t length, bool owner, std::string name, bool unlink_on_close)
+    : fd_(fd), base_(base), length_(length), owner_(owner), name_(std::move(name)),
+      unlink_on_close_(unlink_on_close), header_(static_cast<Header*>(base)) {}
+
+SharedBEVCache::~SharedBEVCache() {
+    ::munmap(base_, length_);
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (owner_ && unlink_on_close_ && !name_.empty()) {
+        ::shm_unlink(name_.c_str());
+    }
+}
+
+uint32_t* SharedBEVCache::buckets() const {
+    return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(base_) + header_->buckets_offset);
+}
+
+SharedBEVCache::Entry* SharedBEVCache::entries() const {
+    return reinterpret_cast<Entry*>(static_cast<uint8_t*>(base_) + header_->entries_offset);
+}
+
+SharedBEVCache::Page* SharedBEVCache::pages() const {
+    return reinterpret_cast<Page*>(static_cast<uint8_t*>(base_) + header_->pages_offset);
+}
+
+uint8_t* SharedBEVCache::data() const {
+    return static_cast<uint8_t*>(base_) + header_->data_offset;
+}
+
+std::unique_ptr<SharedBEVCache> SharedBEVCache::create(const Config& config) {
+    if (config.max_items == 0 || config.data_bytes == 0) {
+        throw std::invalid_argument("共享缓存的容量不能为0");
+    }
+    uint32_t num_buckets = 1;
+    while (num_buckets < 2ull * config.max_items) num_buckets <<= 1;
+    const size_t pages = (config.data_bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (pages >= NIL) {
+        throw std::invalid_argument("共享缓存的数据区过大");
+    }
+    const uint32_t num_pages = static_cast<uint32_t>(pages);
+
+    const size_t buckets_offset = alignUp(sizeof(Header), 64);
+    const size_t entries_offset = alignUp(buckets_offset + sizeof(uint32_t) * num_buckets, 64);
+    const size_t pages_offset = alignUp(entries_offset + sizeof(Entry) * config.max_items, 64);
+    const size_t data_offset = alignUp(pages_offset + sizeof(Page) * num_pages, PAGE_SIZE);
+    const size_t length = data_offset + static_cast<size_t>(num_pages) * PAGE_SIZE;
+
+    int fd = config.name.empty() ? ::memfd_create("bev_shm_cache", 0)
+                                 : ::shm_open(config.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw systemError("无法创建共享内存" + (config.name.empty() ? std::string() : ": " + config.name));
+    }
+    auto fail = [&](const std::string& what) {
+        const std::runtime_error error = systemError(what);
+        ::close(fd);
+        if (!config.name.empty()) ::shm_unlink(config.name.c_str());
+        return error;
+    };
+    if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        throw fail("无法设置共享内存大小");
+    }
+    void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        throw fail("无法映射共享内存");
+    }
+
+    // 初始化区域（新建的对象全为0，只需写入非0字段）
+    Header* header = new (base) Header();
+    std::memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    header->version = SHM_VERSION;
+    header->page_size = PAGE_SIZE;
+    header->region_size = length;
+    header->max_items = config.max_items;
+    header->num_buckets = num_buckets;
+    header->num_pages = num_pages;
+    header->buckets_offset = buckets_offset;
+    header->entries_offset = entries_offset;
+    header->pages_offset = pages_offset;
+    header->data_offset = data_offset;
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    // 写者优先：读者持续读取时插入不会饿死
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    const int rc = pthread_rwlock_init(&header->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (rc != 0) {
+        ::munmap(base, length);
+        errno = rc;
+        throw fail("无法初始化进程间读写锁");
+    }
+
+    auto* bytes = static_cast<uint8_t*>(base);
+    std::memset(bytes + buckets_offset, 0xFF, sizeof(uint32_t) * num_buckets);
+    auto* entry_table = reinterpret_cast<Entry*>(bytes + entries_offset);
+    for (uint32_t i = 0; i < config.max_items; ++i) {
+        Entry* entry = new (&entry_table[i]) Entry();
+        entry->next = i + 1 < config.max_items ? i + 1 : NIL;
+    }
+    auto* page_table = reinterpret_cast<Page*>(bytes + pages_offset);
+    for (uint32_t p = 0; p < num_pages; ++p) {
+        page_table[p] = Page{-1, 0, NIL, NIL, p + 1 < num_pages ? p + 1 : NIL};
+    }
+    header->free_entry = 0;
+    header->free_page = 0;
+    header->free_page_count = num_pages;
+    std::fill(std::begin(header->partial), std::end(header->partial), NIL);
+    header->ready.store(1, std::memory_order_release);
+
+    return std::unique_ptr<SharedBEVCache>(
+        new SharedBEVCache(fd, base, length, true, config.name, config.unlink_on_close));
+}
+
+std::unique_ptr<SharedBEVCache> SharedBEVCache::open(const std::string& name) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw systemError("无法打开共享内存: " + name);
+    }
+    try {
+        return map(fd, false, name, false);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+std::unique_ptr<SharedBEVCache> SharedBEVCache::openFd(int fd) {
+    int own = ::dup(fd);
+    if (own < 0) {
+        throw systemError("无法复制共享内存描述符");
+    }
+    try {
+        return map(own, false, std::string(), false);
+    } catch (...) {
+        ::close(own);
+        throw;
+    }
+}
+
+std::unique_ptr<SharedBEVCache> SharedBEVCache::map(int fd, bool owner, const std::string& name,
+                                                    bool unlink_on_close) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        throw systemError("无法读取共享内存大小");
+    }
+    const size_t length = static_cast<size_t>(st.st_size);
+    if (length < sizeof(Header)) {
+        throw std::runtime_error("共享内存区域格式错误：大小不足");
+    }
+    void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        throw systemError("无法映射共享内存");
+    }
+    const Header* header = static_cast<const Header*>(base);
+    if (std::memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 || header->version != SHM_VERSION ||
+        header->region_size != length || header->page_size != PAGE_SIZE ||
+        header->ready.load(std::memory_order_acquire) != 1) {
+        ::munmap(base, length);
+        throw std::runtime_error("共享内存区域格式错误或尚未初始化");
+    }
+    // 各表的偏移与容量来自共享区域本身，解引用前确认都落在映射范围内
+    const bool tables_fit =
+        header->max_items > 0 && header->max_items < NIL && header->num_buckets > 0 &&
+        (header->num_buckets & (header->num_buckets - 1)) == 0 && header->num_pages < NIL &&
+        header->buckets_offset >= sizeof(Header) && header->buckets_offset % alignof(uint32_t) == 0 &&
+        header->entries_offset % alignof(Entry) == 0 && header->pages_offset % alignof(Page) == 0 &&
+        header->data_offset % PAGE_SIZE == 0 &&
+        fits(header->buckets_offset, header->num_buckets, sizeof(uint32_t), length) &&
+        fits(header->entries_offset, header->max_items, sizeof(Entry), length) &&
+        fits(header->pages_offset, header->num_pages, sizeof(Page), length) &&
+        fits(header->data_offset, header->num_pages, PAGE_SIZE, length);
+    if (!tables_fit) {
+        ::munmap(base, length);
+        throw std::runtime_error("共享内存区域格式错误：表超出区域范围");
+    }
+    return std::unique_ptr<SharedBEVCache>(new SharedBEVCache(fd, base, length, owner, name, unlink_on_close));
+}
+
+void SharedBEVCache::unlink(const std::string& name) {
+    ::shm_unlink(name.c_str());
+}
+
+uint32_t SharedBEVCache::findLocked(const CacheKey& key) const {
+    const Entry* table = entries();
+    for (uint32_t i = buckets()[mixKey(key) & (header_->num_buckets - 1)]; i != NIL; i = table[i].next) {
+        const Entry& entry = table[i];
+        if (entry.timestamp == key.timestamp && entry.x == key.x && entry.y == key.y && entry.level == key.level) {
+            return i;
+        }
+    }
+    return NIL;
+}
+
+void SharedBEVCache::removeLocked(uint32_t index) {
+    Entry* table = entries();
+    Entry& entry = table[index];
+    const CacheKey key{entry.timestamp, entry.x, entry.y, entry.level};
+    uint32_t* link = &buckets()[mixKey(key) & (header_->num_buckets - 1)];
+    while (*link != index) {
+        link = &table[*link].next;
+    }
+    *link = entry.next;
+
+    freeLocked(entry.data_offset, entry.size_class);
+    header_->stored_bytes -= entry.size;
+    --header_->item_count;
+    entry.in_use = 0;
+    entry.next = header_->free_entry;
+    header_->free_entry = index;
+}
+
+bool SharedBEVCache::evictLocked(int size_class) {
+    if (header_->item_count == 0) {
+        return false;
+    }
+    // CLOCK：有引用位的条目清除后跳过（第二次机会），至多转两圈
+    Entry* table = entries();
+    const uint32_t n = header_->max_items;
+    for (uint64_t step = 0; step < 2ull * n; ++step) {
+        const uint32_t i = header_->clock_hand;
+        header_->clock_hand = i + 1 < n ? i + 1 : 0;
+        if (!table[i].in_use) continue;
+        if (table[i].referenced.exchange(0, std::memory_order_relaxed)) continue;
+        if (size_class < 0 || table[i].size_class == size_class) {
+            // 空出的条目或同尺寸类别的块可以直接复用
+            removeLocked(i);
+            ++header_->evictions;
+        } else {
+            // 尺寸类别不同：逐个淘汰条目要等到某页恰好清空，可能先淘汰掉大半个缓存；
+            // 改为淘汰该条目所在页的全部条目，整页回到空闲页链表
+            evictPageLocked(static_cast<uint32_t>(table[i].data_offset / PAGE_SIZE));
+        }
+        return true;
+    }
+    return false;
+}
+
+void SharedBEVCache::evictPageLocked(uint32_t page) {
+    // 条目表中不记录页到条目的反向索引，扫描一遍条目表（只在缺少所需尺寸类别的页时发生）
+    Entry* table = entries();
+    const uint32_t n = header_->max_items;
+    for (uint32_t i = 0; i < n && pages()[page].size_class >= 0; ++i) {
+        if (table[i].in_use && table[i].data_offset / PAGE_SIZE == page) {
+            removeLocked(i);
+            ++header_->evictions;
+        }
+    }
+}
+
+uint64_t SharedBEVCache::allocateLocked(int size_class) {
+    Page* table = pages();
+    const uint32_t chunk = MIN_CHUNK << size_class;
+    uint32_t p = header_->partial[size_class];
+    if (p == NIL) {
+        // 从空闲页切出新的slab页，页内空闲链表的后继偏移写在空闲块开头
+        p = header_->free_page;
+        if (p == NIL) {
+            return UINT64_MAX;
+        }
+        header_->free_page = table[p].next;
+        --header_->free_page_count;
+        uint8_t* page_data = data() + static_cast<uint64_t>(p) * PAGE_SIZE;
+        for (uint32_t off = 0; off < PAGE_SIZE; off += chunk) {
+            const uint32_t next = off + chunk < PAGE_SIZE ? off + chunk : NIL;
+            std::memcpy(page_data + off, &next, sizeof(next));
+        }
+        table[p] = Page{size_class, 0, 0, NIL, NIL};
+        header_->partial[size_class] = p;
+    }
+
+    Page& page = table[p];
+    const uint32_t off = page.free_chunk;
+    std::memcpy(&page.free_chunk, data() + static_cast<uint64_t>(p) * PAGE_SIZE + off, sizeof(uint32_t));
+    ++page.used;
+    header_->slab_bytes += chunk;
+    if (page.free_chunk == NIL) {
+        // 页已满：移出partial链表
+        header_->partial[size_class] = page.next;
+        if (page.next != NIL) table[page.next].prev = NIL;
+        page.next = page.prev = NIL;
+    }
+    return static_cast<uint64_t>(p) * PAGE_SIZE + off;
+}
+
+void SharedBEVCache::freeLocked(uint64_t offset, int size_class) {
+    Page* table = pages();
+    const uint32_t p = static_cast<uint32_t>(offset / PAGE_SIZE);
+    const uint32_t off = static_cast<uint32_t>(offset % PAGE_SIZE);
+    Page& page = table[p];
+    const bool was_full = page.free_chunk == NIL;
+    std::memcpy(data() + offset, &page.free_chunk, sizeof(uint32_t));
+    page.free_chunk = off;
+    --page.used;
+    header_->slab_bytes -= MIN_CHUNK << size_class;
+
+    if (page.used == 0) {
+        // 整页空闲：移出partial链表，还给空闲页链表供任意尺寸类别使用
+        if (!was_full) {
+            if (page.prev != NIL) table[page.prev].next = page.next;
+            else header_->partial[size_class] = page.next;
+            if (page.next != NIL) table[page.next].prev = page.prev;
+        }
+        page = Page{-1, 0, NIL, NIL, header_->free_page};
+        header_->free_page = p;
+        ++header_->free_page_count;
+    } else if (was_full) {
+        page.prev = NIL;
+        page.next = header_->partial[size_class];
+        if (page.next != NIL) table[page.next].prev = p;
+        header_->partial[size_class] = p;
+    }
+}
+
+bool SharedBEVCache::insertLocked(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                                  const uint8_t* block, size_t size) {
+    const int size_class = sizeClass(size);
+    if (size == 0 || size_class < 0) {
+        ++header_->alloc_failures;
+        return false;
+    }
+
+    const uint32_t existing = findLocked(key);
+    if (existing != NIL) {
+        removeLocked(existing);
+    }
+    bool ok = true;
+    while (ok && header_->free_entry == NIL) ok = evictLocked(-1);
+    uint64_t offset = ok ? allocateLocked(size_class) : UINT64_MAX;
+    while (ok && offset == UINT64_MAX) {
+        ok = evictLocked(size_class);
+        if (ok) offset = allocateLocked(size_class);
+    }
+    if (!ok) {
+        ++header_->alloc_failures;
+        return false;
+    }
+
+    const uint32_t index = header_->free_entry;
+    Entry& entry = entries()[index];
+    header_->free_entry = entry.next;
+    entry.timestamp = key.timestamp;
+    entry.x = key.x;
+    entry.y = key.y;
+    entry.level = key.level;
+    entry.rows = rows;
+    entry.cols = cols;
+    entry.codec = codec.codec;
+    entry.rate = codec.rate;
+    entry.size = static_cast<uint32_t>(size);
+    entry.size_class = static_cast<uint8_t>(size_class);
+    entry.data_offset = offset;
+    entry.in_use = 1;
+    // 新条目带引用位，未被读过也能躲过一轮CLOCK扫描
+    entry.referenced.store(1, std::memory_order_relaxed);
+    std::memcpy(data() + offset, block, size);
+
+    uint32_t& bucket = buckets()[mixKey(key) & (header_->num_buckets - 1)];
+    entry.next = bucket;
+    bucket = index;
+    ++header_->item_count;
+    header_->stored_bytes += size;
+    ++header_->inserts;
+    return true;
+}
+
+size_t SharedBEVCache::insertPackets(const std::vector<uint8_t>& compressed_data) {
+    ScopedTimer timer(MetricStage::CACHE_INSERT);
+    BEVMetrics::recordBytes(MetricStage::CACHE_INSERT, compressed_data.size(), 0);
+    CompressedStreamView view(compressed_data);
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block block;
+    const BEVBlockCodec codec = view.header().block_codec();
+    size_t inserted = 0;
+
+    // 整批只加一次写锁
+    WriteLock lock(&header_->lock);
+    while (view.next_frame(frame)) {
+        while (view.next_block(block)) {
+            const BEVCompressor::BlockHeader& h = block.header;
+            if (h.row_offset > UINT16_MAX || h.col_offset > UINT16_MAX ||
+                h.block_rows > UINT16_MAX || h.block_cols > UINT16_MAX) {
+                throw std::out_of_range("块偏移超出缓存键范围");
+            }
+            const CacheKey key{frame.header.timestamp, static_cast<uint16_t>(h.row_offset),
+                               static_cast<uint16_t>(h.col_offset), static_cast<uint8_t>(frame.level)};
+            inserted += insertLocked(key, static_cast<uint16_t>(h.block_rows), static_cast<uint16_t>(h.block_cols),
+                                     codec, block.data, h.compressed_size);
+        }
+    }
+    return inserted;
+}
+
+bool SharedBEVCache::insert(const CacheKey& key, uint16_t rows, uint16_t cols, const BEVBlockCodec& codec,
+                            const uint8_t* block, size_t size) {
+    ScopedTimer timer(MetricStage::CACHE_INSERT);
+    WriteLock lock(&header_->lock);
+    return insertLocked(key, rows, cols, codec, block, size);
+}
+
+bool SharedBEVCache::visit(const CacheKey& key, const BlockVisitor& fn) {
+    ReadLock lock(&header_->lock);
+    const uint32_t index = findLocked(key);
+    if (index == NIL) {
+        header_->misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Entry& entry = entries()[index];
+    // 引用位已置位时不再写，避免读者之间争用缓存行
+    if (!entry.referenced.load(std::memory_order_relaxed)) {
+        entry.referenced.store(1, std::memory_order_relaxed);
+    }
+    header_->hits.fetch_add(1, std::memory_order_relaxed);
+    fn(data() + entry.data_offset, entry.size, entry.rows, entry.cols, BEVBlockCodec{entry.codec, entry.rate});
+    return true;
+}
+
+bool SharedBEVCache::retrieve(uint64_t timestamp, uint16_t x, uint16_t y,
+                              std::vector<uint8_t>& out, uint16_t& rows, uint16_t& cols, BEVBlockCodec* codec) {
+    ScopedTimer timer(MetricStage::CACHE_RETRIEVE);
+    return visit(CacheKey{timestamp, x, y}, [&](const uint8_t* p, size_t size, uint16_t r, uint16_t c,
+                                                const BEVBlockCodec& block_codec) {
+        out.assign(p, p + size);
+        rows = r;
+        cols = c;
+        if (codec) *codec = block_codec;
+        BEVMetrics::recordBytes(MetricStage::CACHE_RETRIEVE, 0, size);
+    });
+}
+
+size_t SharedBEVCache::retrieveFrame(uint64_t timestamp, const BEVCompressor& compressor,
+                                     Eigen::MatrixXf& frame, std::vector<CacheKey>* misses) {
+    ScopedTimer timer(MetricStage::CACHE_RETRIEVE);
+    const int bs = compressor.get_config().block_size;
+    std::vector<CacheKey> keys;
+    keys.reserve(((frame.rows() + bs - 1) / bs) * ((frame.cols() + bs - 1) / bs));
+    for (int i = 0; i < frame.rows(); i += bs) {
+        for (int j = 0; j < frame.cols(); j += bs) {
+            keys.push_back(CacheKey{timestamp, static_cast<uint16_t>(i), static_cast<uint16_t>(j)});
+        }
+    }
+
+    // 整帧只加一次读锁，锁内只查找条目并拷出块数据；解码（并行、可能因数据损坏抛出异常）在
+    // 释放锁之后进行，不占用进程间共享的锁，也不在持锁时进入OpenMP并行区
+    struct Located {
+        size_t key;                       // keys中的下标
+        uint16_t rows;
+        uint16_t cols;
+        BEVBlockCodec codec;
+        size_t offset;                    // 在buffer中的位置
+        size_t size;
+    };
+    std::vector<Located> located;
+    std::vector<uint8_t> buffer;
+    {
+        ReadLock lock(&header_->lock);
+        for (size_t k = 0; k < keys.size(); ++k) {
+            const uint32_t index = findLocked(keys[k]);
+            if (index == NIL) continue;
+            Entry& entry = entries()[index];
+            if (entry.x + entry.rows > frame.rows() || entry.y + entry.cols > frame.cols()) continue;
+            if (!entry.referenced.load(std::memory_order_relaxed)) {
+                entry.referenced.store(1, std::memory_order_relaxed);
+            }
+            located.push_back(Located{k, entry.rows, entry.cols, BEVBlockCodec{entry.codec, entry.rate},
+                                      buffer.size(), entry.size});
+            const uint8_t* p = data() + entry.data_offset;
+            buffer.insert(buffer.end(), p, p + entry.size);
+        }
+    }
+
+    // 解码失败的块按未命中处理（异常不能跨出并行区）
+    std::vector<uint8_t> decoded(keys.size(), 0);
+    const int num_located = static_cast<int>(located.size());
+    #pragma omp parallel for schedule(dynamic, 8)
+    for (int n = 0; n < num_located; ++n) {
+        const Located& block = located[n];
+        const CacheKey& key = keys[block.key];
+        try {
+            compressor.decode_block(block.codec, buffer.data() + block.offset, block.size,
+                                    frame.block(key.x, key.y, block.rows, block.cols));
+            decoded[block.key] = 1;
+        } catch (const std::exception&) {
+        }
+    }
+
+    size_t hits = 0;
+    for (size_t k = 0; k < keys.size(); ++k) {
+        if (decoded[k]) {
+            ++hits;
+        } else if (misses) {
+            misses->push_back(keys[k]);
+        }
+    }
+    header_->hits.fetch_add(hits, std::memory_order_relaxed);
+    header_->misses.fetch_add(keys.size() - hits, std::memory_order_relaxed);
+    header_->decode_errors.fetch_add(located.size() - hits, std::memory_order_relaxed);
+    BEVMetrics::recordBytes(MetricStage::CACHE_RETRIEVE, 0, buffer.size());
+    return hits;
+}
+
+bool SharedBEVCache::contains(const CacheKey& key) {
+    ReadLock lock(&header_->lock);
+    return findLocked(key) != NIL;
+}
+
+size_t SharedBEVCache::size() const {
+    ReadLock lock(&header_->lock);
+    return header_->item_count;
+}
+
+Json::Value SharedBEVCache::getStats() const {
+    ReadLock lock(&header_->lock);
+    const uint64_t hits = header_->hits.load(std::memory_order_relaxed);
+    const uint64_t misses = header_->misses.load(std::memory_order_relaxed);
+    Json::Value root;
+    root["name"] = name_;
+    root["region_bytes"] = static_cast<Json::UInt64>(header_->region_size);
+    root["data_bytes"] = static_cast<Json::UInt64>(static_cast<uint64_t>(header_->num_pages) * PAGE_SIZE);
+    root["max_items"] = header_->max_items;
+    root["items"] = header_->item_count;
+    root["stored_bytes"] = static_cast<Json::UInt64>(header_->stored_bytes);
+    root["slab_bytes"] = static_cast<Json::UInt64>(header_->slab_bytes);
+    root["pages_in_use"] = header_->num_pages - header_->free_page_count;
+    root["inserts"] = static_cast<Json::UInt64>(header_->inserts);
+    root["evictions"] = static_cast<Json::UInt64>(header_->evictions);
+    root["alloc_failures"] = static_cast<Json::UInt64>(header_->alloc_failures);
+    root["hits"] = static_cast<Json::UInt64>(hits);
+    root["misses"] = static_cast<Json::UInt64>(misses);
+    root["decode_errors"] = static_cast<Json::UInt64>(header_->decode_errors.load(std::memory_order_relaxed));
+    root["hit_rate"] = hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    return root;
+}
@@ -0,0 +1,198 @@
+#include "stats_reporter.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+// ---------------- SpscQueue ----------------
+
+StatsReporter::SpscQueue::SpscQueue(size_t capacity)
+    : slots_(capacity + 1)  // 预留一个空位区分队满与队空
+{
+}
+
+bool StatsReporter::SpscQueue::push(std::string&& line) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % slots_.size();
+    if (next == head_.load(std::memory_order_acquire)) {
+        return false;  // 队满
+    }
+    slots_[tail] = std::move(line);
+    tail_.store(next, std::memory_order_release);
+    return true;
+}
+
+bool StatsReporter::SpscQueue::pop(std::string& line) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return false;  // 队空
+    }
+    line = std::move(slots_[head]);
+    slots_[head].clear();
+    head_.store((head + 1) % slots_.size(), std::memory_order_release);
+    return true;
+}
+
+// ---------------- StatsReporter ----------------
+
+StatsReporter::StatsReporter(const Config& config)
+    : config_(config), queue_(config.queue_capacity > 0 ? config.queue_capacity : 1)
+{
+    if (config_.interval_ms == 0) {
+        throw std::invalid_argument("interval_ms必须大于0");
+    }
+}
+
+StatsReporter::~StatsReporter() {
+    stop();
+}
+
+void StatsReporter::addSource(const std::string& name, Source source) {
+    if (running_.load()) {
+        throw std::logic_error("统计源须在start()之前注册");
+    }
+    sources_.emplace_back(name, std::move(source));
+}
+
+void StatsReporter::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    fs::path path(config_.path);
+    if (!path.parent_path().empty()) {
+        fs::create_directories(path.parent_path());
+    }
+    file_.open(config_.path, std::ios::app);
+    if (!file_) {
+        running_ = false;
+        throw std::runtime_error("无法打开统计日志文件: " + config_.path);
+    }
+    std::error_code ec;
+    file_bytes_ = fs::exists(path, ec) ? static_cast<size_t>(fs::file_size(path, ec)) : 0;
+
+    sampler_done_ = false;
+    sampler_ = std::thread(&StatsReporter::samplerLoop, this);
+    writer_ = std::thread(&StatsReporter::writerLoop, this);
+}
+
+void StatsReporter::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    sampler_wake_.notify_all();
+    if (sampler_.joinable()) {
+        sampler_.join();
+    }
+    writer_wake_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    file_.close();
+}
+
+void StatsReporter::requestSnapshot() {
+    snapshot_requested_.store(true, std::memory_order_relaxed);
+    sampler_wake_.notify_one();
+}
+
+void StatsReporter::samplerLoop() {
+    auto next_tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.interval_ms);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(sampler_wake_mutex_);
+            sampler_wake_.wait_until(lock, next_tick, [this] {
+                return !running_.load(std::memory_order_relaxed) ||
+                       snapshot_requested_.load(std::memory_order_relaxed);
+            });
+        }
+        bool stopping = !running_.load(std::memory_order_relaxed);
+        snapshot_requested_.store(false, std::memory_order_relaxed);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_tick) {
+            next_tick += std::chrono::milliseconds(config_.interval_ms);
+            if (next_tick <= now) {
+                next_tick = now + std::chrono::milliseconds(config_.interval_ms);  // 落后太多时不补采
+            }
+        }
+
+        // 停止时再采样一次，保证最后的状态落盘
+        if (!queue_.push(takeSnapshot())) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        writer_wake_.notify_one();
+
+        if (stopping) {
+            break;
+        }
+    }
+    sampler_done_.store(true, std::memory_order_release);
+    writer_wake_.notify_one();
+}
+
+void StatsReporter::writerLoop() {
+    std::string line;
+    for (;;) {
+        while (queue_.pop(line)) {
+            writeLine(line);
+        }
+        if (sampler_done_.load(std::memory_order_acquire)) {
+            // 采样线程已退出，清空残留后结束
+            while (queue_.pop(line)) {
+                writeLine(line);
+            }
+            break;
+        }
+        std::unique_lock<std::mutex> lock(writer_wake_mutex_);
+        writer_wake_.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    file_.flush();
+}
+
+std::string StatsReporter::takeSnapshot() {
+    Json::Value root;
+    root["seq"] = static_cast<Json::UInt64>(sequence_++);
+    root["unix_ms"] = static_cast<Json::UInt64>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    for (const auto& source : sources_) {
+        try {
+            root[source.first] = source.second();
+        } catch (const std::exception& e) {
+            root[source.first]["error"] = e.what();
+        }
+    }
+    Json::FastWriter writer;  // 单行输出，末尾带换行
+    return writer.write(root);
+}
+
+void StatsReporter::writeLine(const std::string& line) {
+    if (file_bytes_ > 0 && file_bytes_ + line.size() > config_.max_file_bytes) {
+        rotate();
+    }
+    file_ << line;
+    file_.flush();
+    file_bytes_ += line.size();
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StatsReporter::rotate() {
+    file_.close();
+
+    // path.(N-1) -> path.N, ..., path -> path.1
+    if (config_.max_files > 0) {
+        std::string oldest = config_.path + "." + std::to_string(config_.max_files);
+        std::remove(oldest.c_str());
+        for (int i = config_.max_files - 1; i >= 1; --i) {
+            std::string from = config_.path + "." + std::to_string(i);
+            std::string to = config_.path + "." + std::to_string(i + 1);
+            std::rename(from.c_str(), to.c_str());
+        }
+        std::rename(config_.path.c_str(), (config_.path + ".1").c_str());
+    }
+
+    file_.open(config_.path, std::ios::trunc);
+    file_bytes_ = 0;
+}
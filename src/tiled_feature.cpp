@@ -0,0 +1,104 @@
+#include "tiled_feature.h"
+#include <stdexcept>
+
+namespace {
+
+// 整块拷贝：固定尺寸让Eigen展开为对齐的SIMD加载/存储
+template <int N>
+void copy_full_tiles(const Eigen::MatrixXf& matrix, TiledFeature& tiled) {
+    #pragma omp parallel for schedule(static)
+    for (int ti = 0; ti < tiled.grid_rows(); ++ti) {
+        for (int tj = 0; tj < tiled.grid_cols(); ++tj) {
+            const int rows = tiled.tile_rows(ti), cols = tiled.tile_cols(tj);
+            if (rows == N && cols == N) {
+                Eigen::Map<Eigen::Matrix<float, N, N>, Eigen::Aligned16>(tiled.tile(ti, tj).data()) =
+                    matrix.block<N, N>(ti * N, tj * N);
+            } else {
+                tiled.tile(ti, tj) = matrix.block(ti * N, tj * N, rows, cols);
+            }
+        }
+    }
+}
+
+template <int N>
+void copy_full_tiles(const TiledFeature& tiled, Eigen::MatrixXf& matrix) {
+    #pragma omp parallel for schedule(static)
+    for (int tj = 0; tj < tiled.grid_cols(); ++tj) {
+        for (int ti = 0; ti < tiled.grid_rows(); ++ti) {
+            const int rows = tiled.tile_rows(ti), cols = tiled.tile_cols(tj);
+            if (rows == N && cols == N) {
+                matrix.block<N, N>(ti * N, tj * N) =
+                    Eigen::Map<const Eigen::Matrix<float, N, N>, Eigen::Aligned16>(tiled.tile(ti, tj).data());
+            } else {
+                matrix.block(ti * N, tj * N, rows, cols) = tiled.tile(ti, tj);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+TiledFeature::TiledFeature(int rows, int cols, int tile_size)
+    : rows_(rows), cols_(cols), tile_size_(tile_size)
+{
+    if (rows < 0 || cols < 0 || tile_size <= 0) {
+        throw std::invalid_argument("分块特征图尺寸无效");
+    }
+    grid_rows_ = (rows + tile_size - 1) / tile_size;
+    grid_cols_ = (cols + tile_size - 1) / tile_size;
+    data_.assign(static_cast<size_t>(grid_rows_) * grid_cols_ * tile_size * tile_size, 0.0f);
+}
+
+TiledFeature TiledFeature::from_matrix(const Eigen::MatrixXf& matrix, int tile_size) {
+    TiledFeature tiled(static_cast<int>(matrix.rows()), static_cast<int>(matrix.cols()), tile_size);
+    tiled.assign(matrix);
+    return tiled;
+}
+
+void TiledFeature::assign(const Eigen::MatrixXf& matrix) {
+    if (matrix.rows() != rows_ || matrix.cols() != cols_) {
+        *this = TiledFeature(static_cast<int>(matrix.rows()), static_cast<int>(matrix.cols()), tile_size_);
+    }
+    switch (tile_size_) {
+        case 8:  copy_full_tiles<8>(matrix, *this); break;
+        case 16: copy_full_tiles<16>(matrix, *this); break;
+        case 32: copy_full_tiles<32>(matrix, *this); break;
+        default:
+            for (int ti = 0; ti < grid_rows_; ++ti) {
+                for (int tj = 0; tj < grid_cols_; ++tj) {
+                    tile(ti, tj) = matrix.block(ti * tile_size_, tj * tile_size_, tile_rows(ti), tile_cols(tj));
+                }
+            }
+    }
+}
+
+void TiledFeature::to_matrix(Eigen::MatrixXf& matrix) const {
+    matrix.resize(rows_, cols_);
+    switch (tile_size_) {
+        case 8:  copy_full_tiles<8>(*this, matrix); break;
+        case 16: copy_full_tiles<16>(*this, matrix); break;
+        case 32: copy_full_tiles<32>(*this, matrix); break;
+        default:
+            for (int ti = 0; ti < grid_rows_; ++ti) {
+                for (int tj = 0; tj < grid_cols_; ++tj) {
+                    matrix.block(ti * tile_size_, tj * tile_size_, tile_rows(ti), tile_cols(tj)) = tile(ti, tj);
+                }
+            }
+    }
+}
+
+Eigen::MatrixXf TiledFeature::to_matrix() const {
+    Eigen::MatrixXf matrix;
+    to_matrix(matrix);
+    return matrix;
+}
+
+TiledFeature::TileMap TiledFeature::tile(int ti, int tj) {
+    return TileMap(data_.data() + tile_offset(ti, tj), tile_rows(ti), tile_cols(tj),
+                   Eigen::OuterStride<>(tile_size_));
+}
+
+TiledFeature::ConstTileMap TiledFeature::tile(int ti, int tj) const {
+    return ConstTileMap(data_.data() + tile_offset(ti, tj), tile_rows(ti), tile_cols(tj),
+                        Eigen::OuterStride<>(tile_size_));
+}
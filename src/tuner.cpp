@@ -0,0 +1,219 @@
+#include "tuner.h"
+#include "GenerateData.h"
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <tuple>
+#include <omp.h>
+
+namespace {
+
+// 当前线程的CPU时间（毫秒）
+double thread_cpu_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+// a在（压缩比高、误差小、耗时短）三个方向上都不差于b，且至少一项更好
+bool dominates(const CompressorTuner::Candidate& a, const CompressorTuner::Candidate& b) {
+    const bool no_worse = a.ratio >= b.ratio && a.rmse <= b.rmse && a.frame_ms() <= b.frame_ms();
+    const bool better = a.ratio > b.ratio || a.rmse < b.rmse || a.frame_ms() < b.frame_ms();
+    return no_worse && better;
+}
+
+void evaluate(CompressorTuner::Candidate& candidate, const std::vector<BEVFeaturePacket>& samples,
+              uint64_t raw_bytes, float peak, int repeats) {
+    BEVCompressor compressor(candidate.config);
+    std::vector<uint8_t> compressed;
+    std::vector<BEVFeaturePacket> decoded;
+    double compress_ms = std::numeric_limits<double>::infinity();
+    double decompress_ms = std::numeric_limits<double>::infinity();
+
+    for (int r = 0; r < repeats; ++r) {
+        const double t0 = thread_cpu_ms();
+        compressed = compressor.compress(samples);
+        const double t1 = thread_cpu_ms();
+        decoded = compressor.decompress(compressed);
+        const double t2 = thread_cpu_ms();
+        compress_ms = std::min(compress_ms, t1 - t0);
+        decompress_ms = std::min(decompress_ms, t2 - t1);
+    }
+
+    double max_abs = 0.0, sum_squared = 0.0;
+    uint64_t values = 0;
+    for (size_t k = 0; k < samples.size(); ++k) {
+        const Eigen::ArrayXXf diff = decoded[k].feature.array() - samples[k].feature.array();
+        max_abs = std::max<double>(max_abs, diff.abs().maxCoeff());
+        sum_squared += diff.square().cast<double>().sum();
+        values += diff.size();
+    }
+
+    const double frames = static_cast<double>(samples.size());
+    const double mb = raw_bytes / (1024.0 * 1024.0);
+    candidate.compress_ms = compress_ms / frames;
+    candidate.decompress_ms = decompress_ms / frames;
+    candidate.compress_mb_per_s = compress_ms > 0 ? mb / (compress_ms * 1e-3) : 0.0;
+    candidate.decompress_mb_per_s = decompress_ms > 0 ? mb / (decompress_ms * 1e-3) : 0.0;
+    candidate.ratio = static_cast<double>(raw_bytes) / compressed.size();
+    candidate.max_abs_error = max_abs;
+    candidate.rmse = values > 0 ? std::sqrt(sum_squared / values) : 0.0;
+    candidate.psnr_db = candidate.rmse > 0 ? 20.0 * std::log10(peak / candidate.rmse)
+                                           : std::numeric_limits<double>::infinity();
+    candidate.valid = std::isfinite(candidate.rmse);
+}
+
+}  // namespace
+
+Json::Value CompressorTuner::Candidate::to_json() const {
+    Json::Value json = BEVCompressor::config_to_json(config);
+    json["compress_ms"] = compress_ms;
+    json["decompress_ms"] = decompress_ms;
+    json["compress_mb_per_s"] = compress_mb_per_s;
+    json["decompress_mb_per_s"] = decompress_mb_per_s;
+    json["ratio"] = ratio;
+    json["rmse"] = rmse;
+    json["max_abs_error"] = max_abs_error;
+    json["psnr_db"] = std::isfinite(psnr_db) ? Json::Value(psnr_db) : Json::Value();
+    json["feasible"] = feasible;
+    json["pareto"] = pareto;
+    return json;
+}
+
+CompressorTuner::Result CompressorTuner::tune(const std::vector<BEVFeaturePacket>& samples,
+                                              const Options& options) {
+    if (samples.empty()) {
+        throw std::invalid_argument("调优样本为空");
+    }
+    uint64_t raw_bytes = 0;
+    float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+    for (const BEVFeaturePacket& packet : samples) {
+        raw_bytes += static_cast<uint64_t>(packet.feature.size()) * sizeof(float);
+        if (packet.feature.size() > 0) {
+            lo = std::min(lo, packet.feature.minCoeff());
+            hi = std::max(hi, packet.feature.maxCoeff());
+        }
+    }
+    const float peak = hi > lo ? hi - lo : 1.0f;
+
+    Result result;
+    result.num_samples = samples.size();
+    for (int block_size : options.block_sizes) {
+        for (float rate : options.rates) {
+            Candidate candidate;
+            candidate.config.block_size = block_size;
+            candidate.config.compression_ratio = rate;
+            result.candidates.push_back(candidate);
+        }
+        if (options.include_lossless) {
+            Candidate candidate;
+            candidate.config.block_size = block_size;
+            candidate.config.compression_ratio = 32.0f;
+            candidate.config.lossless = true;
+            result.candidates.push_back(candidate);
+        }
+    }
+
+    // 每个组合在单个线程内完成全部测量；异常不能跨出OpenMP区域，失败的组合标记为无效
+    const int threads = options.threads > 0 ? options.threads : omp_get_max_threads();
+    const int count = static_cast<int>(result.candidates.size());
+    const int repeats = std::max(1, options.repeats);
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (int c = 0; c < count; ++c) {
+        try {
+            evaluate(result.candidates[c], samples, raw_bytes, peak, repeats);
+        } catch (const std::exception&) {
+            result.candidates[c].valid = false;
+        }
+    }
+
+    for (Candidate& candidate : result.candidates) {
+        candidate.feasible = candidate.valid &&
+            (options.max_frame_latency_ms <= 0 || candidate.frame_ms() <= options.max_frame_latency_ms) &&
+            (options.max_rmse <= 0 || candidate.rmse <= options.max_rmse) &&
+            (options.max_abs_error <= 0 || candidate.max_abs_error <= options.max_abs_error);
+        candidate.pareto = candidate.valid;
+        for (const Candidate& other : result.candidates) {
+            if (other.valid && dominates(other, candidate)) {
+                candidate.pareto = false;
+                break;
+            }
+        }
+    }
+
+    // 满足约束的组合中压缩比最高者；压缩比相同时误差小者优先，再比较耗时
+    for (int c = 0; c < count; ++c) {
+        const Candidate& candidate = result.candidates[c];
+        if (!candidate.feasible) continue;
+        if (result.best < 0) {
+            result.best = c;
+            continue;
+        }
+        const Candidate& best = result.candidates[result.best];
+        if (std::make_tuple(candidate.ratio, -candidate.rmse, -candidate.frame_ms()) >
+            std::make_tuple(best.ratio, -best.rmse, -best.frame_ms())) {
+            result.best = c;
+        }
+    }
+    return result;
+}
+
+Json::Value CompressorTuner::params_json(const Result& result, const Options& options) {
+    if (result.best < 0) {
+        throw std::runtime_error("没有满足约束的压缩参数组合");
+    }
+    const Candidate& best = result.candidates[result.best];
+
+    Json::Value root;
+    root["compressor"] = BEVCompressor::config_to_json(best.config);
+
+    Json::Value& calibration = root["calibration"];
+    calibration["samples"] = static_cast<Json::UInt64>(result.num_samples);
+    Json::Value& constraints = calibration["constraints"];
+    constraints["max_frame_latency_ms"] = options.max_frame_latency_ms;
+    constraints["max_rmse"] = options.max_rmse;
+    constraints["max_abs_error"] = options.max_abs_error;
+    calibration["selected"] = best.to_json();
+    Json::Value& pareto = calibration["pareto"];
+    pareto = Json::Value(Json::arrayValue);
+    Json::Value& candidates = calibration["candidates"];
+    candidates = Json::Value(Json::arrayValue);
+    for (const Candidate& candidate : result.candidates) {
+        if (!candidate.valid) continue;
+        candidates.append(candidate.to_json());
+        if (candidate.pareto) {
+            pareto.append(candidate.to_json());
+        }
+    }
+    return root;
+}
+
+void CompressorTuner::write_params(const std::string& path, const Result& result, const Options& options) {
+    Json::Value root = params_json(result, options);
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("无法写入参数文件: " + path);
+    }
+    Json::StyledWriter writer;  // 参数文件需要人工查看、修改，使用缩进格式
+    out << writer.write(root);
+    if (!out) {
+        throw std::runtime_error("写入参数文件失败: " + path);
+    }
+}
+
+std::vector<BEVFeaturePacket> CompressorTuner::sample_frames(const std::string& path, uint32_t max_frames) {
+    BEVFrameReader reader(path);
+    const uint32_t total = reader.num_frames();
+    const uint32_t stride = max_frames > 0 && total > max_frames ? (total + max_frames - 1) / max_frames : 1;
+
+    std::vector<BEVFeaturePacket> samples;
+    BEVFeaturePacket packet;
+    for (uint32_t i = 0; reader.next(packet); ++i) {
+        if (i % stride == 0) {
+            samples.push_back(std::move(packet));
+            if (max_frames > 0 && samples.size() >= max_frames) break;
+        }
+    }
+    return samples;
+}
@@ -0,0 +1,406 @@
+#include "uplink.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T>
+void append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// 压缩流中的一个块
+struct StreamBlock {
+    BEVCompressor::BlockHeader header;
+    const uint8_t* data;
+    float priority;
+};
+
+}  // namespace
+
+// ---------------- 发送端 ----------------
+
+UdpUplinkSink::UdpUplinkSink(const std::string& host, uint16_t port) {
+    addr_.sin_family = AF_INET;
+    addr_.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr_.sin_addr) != 1) {
+        throw std::invalid_argument("无效的IPv4地址: " + host);
+    }
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error("无法创建UDP套接字");
+    }
+}
+
+UdpUplinkSink::~UdpUplinkSink() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool UdpUplinkSink::send(const uint8_t* data, size_t size) {
+    ssize_t n = ::sendto(fd_, data, size, 0, reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+    return n == static_cast<ssize_t>(size);
+}
+
+FileUplinkSink::FileUplinkSink(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("无法打开上行链路输出文件: " + path);
+    }
+}
+
+bool FileUplinkSink::send(const uint8_t* data, size_t size) {
+    uint32_t length = static_cast<uint32_t>(size);
+    out_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out_.write(reinterpret_cast<const char*>(data), size);
+    out_.flush();
+    return static_cast<bool>(out_);
+}
+
+// ---------------- UplinkPacketizer ----------------
+
+UplinkPacketizer::UplinkPacketizer(const Config& config, std::shared_ptr<UplinkSink> sink)
+    : config_(config), sink_(std::move(sink))
+{
+    if (!sink_) {
+        throw std::invalid_argument("上行链路发送端不能为空");
+    }
+    if (config_.bytes_per_second == 0) {
+        throw std::invalid_argument("bytes_per_second必须大于0");
+    }
+    if (config_.mtu_bytes < PACKET_HEADER_BYTES + BLOCK_HEADER_BYTES) {
+        throw std::invalid_argument("mtu_bytes过小");
+    }
+    tokens_ = static_cast<double>(std::max(config_.burst_bytes, config_.mtu_bytes));
+    last_refill_ = Clock::now();
+    sender_ = std::thread(&UplinkPacketizer::senderLoop, this);
+}
+
+UplinkPacketizer::~UplinkPacketizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    queue_cv_.notify_all();
+    if (sender_.joinable()) {
+        sender_.join();
+    }
+}
+
+size_t UplinkPacketizer::submit(const std::vector<uint8_t>& compressed) {
+    // 先完整解析，格式错误时不入队任何包
+    struct FrameBlocks {
+        uint64_t timestamp;
+        std::vector<StreamBlock> blocks;
+    };
+    CompressedStreamView view(compressed);
+    const BEVBlockCodec codec = view.header().block_codec();
+    std::vector<FrameBlocks> frames(view.num_frames());
+    CompressedStreamView::Frame header;
+    CompressedStreamView::Block record;
+    for (uint32_t f = 0; view.next_frame(header);) {
+        // 包格式不含金字塔层级，只发送原始分辨率层
+        if (header.level != 0) {
+            continue;
+        }
+        FrameBlocks& frame = frames[f++];
+        frame.timestamp = header.header.timestamp;
+        frame.blocks.reserve(header.header.nums_block);
+        while (view.next_block(record)) {
+            StreamBlock block;
+            block.header = record.header;
+            block.data = record.data;
+            block.priority = 0.0f;
+            frame.blocks.push_back(block);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    if (first_submit_ == Clock::time_point{}) {
+        first_submit_ = now;
+    }
+
+    size_t created = 0;
+    for (FrameBlocks& frame : frames) {
+        // 1. 计算块重要性
+        float max_distance = 1.0f;
+        for (const StreamBlock& block : frame.blocks) {
+            float dr = block.header.row_offset + block.header.block_rows * 0.5f - config_.ego_row;
+            float dc = block.header.col_offset + block.header.block_cols * 0.5f - config_.ego_col;
+            max_distance = std::max(max_distance, std::sqrt(dr * dr + dc * dc));
+        }
+        for (StreamBlock& block : frame.blocks) {
+            const BEVCompressor::BlockHeader& header = block.header;
+            float dr = header.row_offset + header.block_rows * 0.5f - config_.ego_row;
+            float dc = header.col_offset + header.block_cols * 0.5f - config_.ego_col;
+            float roi = 1.0f - std::sqrt(dr * dr + dc * dc) / max_distance;
+
+            // 活跃度：与上一帧同位置压缩数据的字节差异比例（无历史时视为完全变化）
+            float activity = 1.0f;
+            const size_t size = header.compressed_size;
+            std::vector<uint8_t>& last =
+                last_payload_[(static_cast<uint64_t>(header.row_offset) << 32) | header.col_offset];
+            if (!last.empty()) {
+                size_t common = std::min(last.size(), size);
+                size_t diff = std::max(last.size(), size) - common;
+                for (size_t k = 0; k < common; ++k) {
+                    diff += last[k] != block.data[k];
+                }
+                activity = static_cast<float>(diff) / std::max<size_t>(std::max(last.size(), size), 1);
+            }
+            last.assign(block.data, block.data + size);
+            block.priority = config_.roi_weight * roi + config_.activity_weight * activity;
+        }
+        std::stable_sort(frame.blocks.begin(), frame.blocks.end(),
+                         [](const StreamBlock& a, const StreamBlock& b) { return a.priority > b.priority; });
+
+        // 2. 按重要性顺序装包，每个包的重要性取其中的最大值（即第一个块）
+        const uint64_t frame_id = next_frame_id_++;
+        std::vector<PacketPtr> packets;
+        for (const StreamBlock& block : frame.blocks) {
+            const size_t record = BLOCK_HEADER_BYTES + block.header.compressed_size;
+            if (packets.empty() || packets.back()->bytes.size() + record > config_.mtu_bytes ||
+                load<uint16_t>(packets.back()->bytes.data() + 16) == UINT16_MAX) {
+                auto packet = std::make_shared<Packet>();
+                packet->sequence = next_sequence_++;
+                packet->frame_id = frame_id;
+                packet->priority = block.priority;
+                packet->payload_bytes = 0;
+                packet->retransmit = false;
+                // block_count装包时递增，flags初始为0
+                uint8_t header[PACKET_HEADER_BYTES] = {};
+                std::memcpy(header, &PACKET_MAGIC, sizeof(uint32_t));
+                std::memcpy(header + 4, &packet->sequence, sizeof(uint32_t));
+                std::memcpy(header + 8, &frame.timestamp, sizeof(uint64_t));
+                std::memcpy(header + 20, &codec.rate, sizeof(float));
+                header[24] = codec.codec;
+                packet->bytes.reserve(config_.mtu_bytes);
+                packet->bytes.assign(header, header + PACKET_HEADER_BYTES);
+                packets.push_back(std::move(packet));
+            }
+            Packet* current = packets.back().get();
+            append(current->bytes, block.header);
+            current->bytes.insert(current->bytes.end(), block.data, block.data + block.header.compressed_size);
+            current->payload_bytes += block.header.compressed_size;
+            uint16_t count = load<uint16_t>(current->bytes.data() + 16) + 1;
+            std::memcpy(current->bytes.data() + 16, &count, sizeof(count));
+        }
+        if (packets.empty()) {
+            continue;  // 空帧
+        }
+
+        // 3. 先登记帧状态再入队（入队可能因超限立即丢包并结束该帧）
+        FrameState& state = frames_[frame_id];
+        state.submitted = now;
+        state.remaining = static_cast<uint32_t>(packets.size());
+        for (PacketPtr& packet : packets) {
+            if (packet->bytes.size() > config_.mtu_bytes) {
+                ++oversize_packets_;  // 单块超过MTU时独占一个包
+            }
+            enqueueLocked(std::move(packet));
+        }
+        created += packets.size();
+    }
+    queue_cv_.notify_one();
+    return created;
+}
+
+void UplinkPacketizer::enqueueLocked(PacketPtr packet) {
+    queued_bytes_ += packet->bytes.size();
+    queue_.insert(std::move(packet));
+
+    // 超出上限时丢弃重要性最低的包
+    while (queued_bytes_ > config_.max_queued_bytes && queue_.size() > 1) {
+        auto last = std::prev(queue_.end());
+        PacketPtr dropped = *last;
+        queue_.erase(last);
+        queued_bytes_ -= dropped->bytes.size();
+        ++packets_dropped_;
+        finishPacketLocked(*dropped, false);
+    }
+}
+
+void UplinkPacketizer::finishPacketLocked(const Packet& packet, bool sent) {
+    if (packet.retransmit) {
+        return;  // 重传不参与帧送达统计
+    }
+    auto it = frames_.find(packet.frame_id);
+    if (it == frames_.end()) {
+        return;
+    }
+    FrameState& state = it->second;
+    state.sent_any |= sent;
+    state.dropped_any |= !sent;
+    if (--state.remaining > 0) {
+        return;
+    }
+    if (state.sent_any) {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - state.submitted).count();
+        latency_total_ns_ += ns;
+        latency_max_ns_ = std::max(latency_max_ns_, ns);
+        BEVMetrics::recordLatency(MetricStage::UPLINK_DELIVERY, ns);
+        if (state.dropped_any) {
+            ++frames_partial_;
+        } else {
+            ++frames_delivered_;
+        }
+    } else {
+        ++frames_partial_;
+    }
+    frames_.erase(it);
+}
+
+bool UplinkPacketizer::retransmit(uint32_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(history_.begin(), history_.end(),
+                           [sequence](const PacketPtr& p) { return p->sequence == sequence; });
+    if (it == history_.end()) {
+        return false;
+    }
+    auto packet = std::make_shared<Packet>(**it);
+    packet->retransmit = true;
+    uint16_t flags = load<uint16_t>(packet->bytes.data() + 18) | FLAG_RETRANSMIT;
+    std::memcpy(packet->bytes.data() + 18, &flags, sizeof(flags));
+    ++retransmissions_;
+    enqueueLocked(std::move(packet));
+    queue_cv_.notify_one();
+    return true;
+}
+
+void UplinkPacketizer::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_cv_.wait(lock, [this] { return (queue_.empty() && !sending_) || stop_; });
+}
+
+void UplinkPacketizer::senderLoop() {
+    const double capacity = static_cast<double>(std::max(config_.burst_bytes, config_.mtu_bytes));
+    const double rate = static_cast<double>(config_.bytes_per_second);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            break;
+        }
+
+        // 补充令牌
+        auto now = Clock::now();
+        tokens_ = std::min(capacity, tokens_ + std::chrono::duration<double>(now - last_refill_).count() * rate);
+        last_refill_ = now;
+
+        // 超过桶容量的包在桶满时发送，令牌允许透支
+        PacketPtr packet = *queue_.begin();
+        const double need = std::min(capacity, static_cast<double>(packet->bytes.size()));
+        if (tokens_ < need) {
+            auto wait = std::chrono::duration<double>((need - tokens_) / rate);
+            queue_cv_.wait_for(lock, std::chrono::duration_cast<std::chrono::nanoseconds>(wait));
+            continue;  // 期间可能有更重要的包入队，重新选择
+        }
+        queue_.erase(queue_.begin());
+        queued_bytes_ -= packet->bytes.size();
+        tokens_ -= static_cast<double>(packet->bytes.size());
+        sending_ = true;
+
+        lock.unlock();
+        bool ok = sink_->send(packet->bytes.data(), packet->bytes.size());
+        lock.lock();
+        sending_ = false;
+
+        if (ok) {
+            last_send_ = Clock::now();
+            ++packets_sent_;
+            bytes_sent_ += packet->bytes.size();
+            payload_bytes_sent_ += packet->payload_bytes;
+            BEVMetrics::recordBytes(MetricStage::UPLINK_DELIVERY, packet->payload_bytes, packet->bytes.size());
+            if (!packet->retransmit && config_.retransmit_history > 0) {
+                history_.push_back(packet);
+                if (history_.size() > config_.retransmit_history) {
+                    history_.pop_front();
+                }
+            }
+        } else {
+            ++send_failures_;
+        }
+        finishPacketLocked(*packet, ok);
+        if (queue_.empty()) {
+            drained_cv_.notify_all();
+        }
+    }
+    drained_cv_.notify_all();
+}
+
+Json::Value UplinkPacketizer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Json::Value stats;
+    double elapsed = 0.0;
+    if (first_submit_ != Clock::time_point{} && last_send_ > first_submit_) {
+        elapsed = std::chrono::duration<double>(last_send_ - first_submit_).count();
+    }
+    const uint64_t frames = frames_delivered_ + frames_partial_;
+    stats["packets_sent"] = static_cast<Json::UInt64>(packets_sent_);
+    stats["bytes_sent"] = static_cast<Json::UInt64>(bytes_sent_);
+    stats["payload_bytes_sent"] = static_cast<Json::UInt64>(payload_bytes_sent_);
+    stats["goodput_bps"] = elapsed > 0 ? payload_bytes_sent_ / elapsed : 0.0;
+    stats["throughput_bps"] = elapsed > 0 ? bytes_sent_ / elapsed : 0.0;
+    stats["packets_dropped"] = static_cast<Json::UInt64>(packets_dropped_);
+    stats["send_failures"] = static_cast<Json::UInt64>(send_failures_);
+    stats["retransmissions"] = static_cast<Json::UInt64>(retransmissions_);
+    stats["oversize_packets"] = static_cast<Json::UInt64>(oversize_packets_);
+    stats["frames_delivered"] = static_cast<Json::UInt64>(frames_delivered_);
+    stats["frames_partial"] = static_cast<Json::UInt64>(frames_partial_);
+    stats["avg_frame_latency_ms"] = frames ? latency_total_ns_ / 1e6 / frames : 0.0;
+    stats["max_frame_latency_ms"] = latency_max_ns_ / 1e6;
+    stats["queued_packets"] = static_cast<Json::UInt64>(queue_.size());
+    stats["queued_bytes"] = static_cast<Json::UInt64>(queued_bytes_);
+    return stats;
+}
+
+bool UplinkPacketizer::parsePacket(const uint8_t* data, size_t size, PacketHeader& header,
+                                   std::vector<PacketBlock>& blocks) {
+    blocks.clear();
+    if (size < PACKET_HEADER_BYTES) {
+        return false;
+    }
+    header.magic = load<uint32_t>(data);
+    header.sequence = load<uint32_t>(data + 4);
+    header.timestamp = load<uint64_t>(data + 8);
+    header.block_count = load<uint16_t>(data + 16);
+    header.flags = load<uint16_t>(data + 18);
+    header.rate = load<float>(data + 20);
+    header.codec = data[24];
+    if (header.magic != PACKET_MAGIC) {
+        return false;
+    }
+    size_t pos = PACKET_HEADER_BYTES;
+    for (uint16_t b = 0; b < header.block_count; ++b) {
+        if (pos + BLOCK_HEADER_BYTES > size) {
+            return false;
+        }
+        PacketBlock block;
+        block.header = load<BEVCompressor::BlockHeader>(data + pos);
+        pos += BLOCK_HEADER_BYTES;
+        if (block.header.compressed_size > size - pos) {
+            return false;
+        }
+        block.data = data + pos;
+        pos += block.header.compressed_size;
+        blocks.push_back(block);
+    }
+    return pos == size;
+}
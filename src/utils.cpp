@@ -0,0 +1,330 @@
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// 单线程私有计数器，只由所属线程写入
+struct StageCounters {
+    std::array<std::atomic<uint64_t>, BEVMetrics::NUM_BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+};
+
+struct ThreadMetrics {
+    std::array<StageCounters, BEVMetrics::NUM_STAGES> stages;
+    std::atomic<double> max_abs_error{0.0};
+    std::atomic<double> sum_squared_error{0.0};
+    std::atomic<uint64_t> error_samples{0};
+    std::atomic<double> value_range{0.0};
+    std::atomic<uint64_t> reencoded_blocks{0};
+    std::atomic<uint64_t> unresolved_blocks{0};
+    std::atomic<uint64_t> epoch{0};  // 计数所属的重置代次（只由所属线程在清零后更新）
+};
+
+// 单写者递增：无需带锁前缀的读改写指令
+inline void bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// 把src的计数累加到dst（调用时持有登记表的锁，dst只在锁内写入）
+void fold(const ThreadMetrics& src, ThreadMetrics& dst) {
+    for (size_t s = 0; s < BEVMetrics::NUM_STAGES; ++s) {
+        const StageCounters& from = src.stages[s];
+        StageCounters& to = dst.stages[s];
+        bump(to.count, from.count.load(std::memory_order_relaxed));
+        bump(to.total_ns, from.total_ns.load(std::memory_order_relaxed));
+        to.max_ns.store(std::max(to.max_ns.load(std::memory_order_relaxed),
+                                 from.max_ns.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        bump(to.bytes_in, from.bytes_in.load(std::memory_order_relaxed));
+        bump(to.bytes_out, from.bytes_out.load(std::memory_order_relaxed));
+        for (int b = 0; b < BEVMetrics::NUM_BUCKETS; ++b) {
+            bump(to.buckets[b], from.buckets[b].load(std::memory_order_relaxed));
+        }
+    }
+    dst.max_abs_error.store(std::max(dst.max_abs_error.load(std::memory_order_relaxed),
+                                     src.max_abs_error.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    dst.sum_squared_error.store(dst.sum_squared_error.load(std::memory_order_relaxed) +
+                                src.sum_squared_error.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bump(dst.error_samples, src.error_samples.load(std::memory_order_relaxed));
+    dst.value_range.store(std::max(dst.value_range.load(std::memory_order_relaxed),
+                                   src.value_range.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    bump(dst.reencoded_blocks, src.reencoded_blocks.load(std::memory_order_relaxed));
+    bump(dst.unresolved_blocks, src.unresolved_blocks.load(std::memory_order_relaxed));
+}
+
+void clear(ThreadMetrics& metrics) {
+    for (StageCounters& counters : metrics.stages) {
+        for (auto& bucket : counters.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        counters.count.store(0, std::memory_order_relaxed);
+        counters.total_ns.store(0, std::memory_order_relaxed);
+        counters.max_ns.store(0, std::memory_order_relaxed);
+        counters.bytes_in.store(0, std::memory_order_relaxed);
+        counters.bytes_out.store(0, std::memory_order_relaxed);
+    }
+    metrics.max_abs_error.store(0.0, std::memory_order_relaxed);
+    metrics.sum_squared_error.store(0.0, std::memory_order_relaxed);
+    metrics.error_samples.store(0, std::memory_order_relaxed);
+    metrics.value_range.store(0.0, std::memory_order_relaxed);
+    metrics.reencoded_blocks.store(0, std::memory_order_relaxed);
+    metrics.unresolved_blocks.store(0, std::memory_order_relaxed);
+}
+
+// 所有线程计数器的登记表（仅线程首次记录与退出时加锁）
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadMetrics>> threads;
+    ThreadMetrics retired;  // 已退出线程的累计计数
+    std::atomic<uint64_t> epoch{0};  // 重置代次：reset()时加一，代次落后的线程计数视为已清零
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // 不析构，避免退出时与仍在运行的线程竞争
+    return *instance;
+}
+
+// 线程私有计数器的登记与注销：线程退出时把计数并入retired并移出登记表，
+// 频繁创建销毁线程（如每帧一个的临时线程）时登记表不会无限增长
+struct LocalMetrics {
+    std::shared_ptr<ThreadMetrics> metrics = std::make_shared<ThreadMetrics>();
+
+    LocalMetrics() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        metrics->epoch.store(reg.epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        reg.threads.push_back(metrics);
+    }
+
+    ~LocalMetrics() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (metrics->epoch.load(std::memory_order_acquire) == reg.epoch.load(std::memory_order_relaxed)) {
+            fold(*metrics, reg.retired);
+        }
+        reg.threads.erase(std::remove(reg.threads.begin(), reg.threads.end(), metrics), reg.threads.end());
+    }
+};
+
+// reset()之后由所属线程在下次记录前自己清零：清零与递增都只由这一个线程写入，
+// 不会被并发的单写者递增覆盖；清零完成后才发布新代次，snapshot()据此跳过尚未清零的线程
+ThreadMetrics& localMetrics() {
+    thread_local LocalMetrics local;
+    ThreadMetrics& metrics = *local.metrics;
+    const uint64_t epoch = registry().epoch.load(std::memory_order_acquire);
+    if (metrics.epoch.load(std::memory_order_relaxed) != epoch) {
+        clear(metrics);
+        metrics.epoch.store(epoch, std::memory_order_release);
+    }
+    return metrics;
+}
+
+}  // namespace
+
+std::atomic<bool> BEVMetrics::enabled_{true};
+
+int BEVMetrics::bucketIndex(uint64_t value) {
+    if (value < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    int sub = static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t BEVMetrics::bucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = static_cast<uint64_t>(index % SUB_BUCKETS);
+    uint64_t lower = (static_cast<uint64_t>(SUB_BUCKETS) + sub) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+uint64_t BEVMetrics::percentile(const std::array<uint64_t, NUM_BUCKETS>& buckets, uint64_t count, double q) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(std::ceil(q * count));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(NUM_BUCKETS - 1);
+}
+
+const char* BEVMetrics::stageName(MetricStage stage) {
+    switch (stage) {
+        case MetricStage::BLOCK_COMPRESS:  return "block_compress";
+        case MetricStage::FRAME_COMPRESS:  return "frame_compress";
+        case MetricStage::DECOMPRESS:      return "decompress";
+        case MetricStage::CACHE_INSERT:    return "cache_insert";
+        case MetricStage::CACHE_RETRIEVE:  return "cache_retrieve";
+        case MetricStage::CACHE_EVICT:     return "cache_evict";
+        case MetricStage::UPLINK_DELIVERY: return "uplink_delivery";
+        case MetricStage::BLOCK_VERIFY:    return "block_verify";
+        default:                           return "unknown";
+    }
+}
+
+void BEVMetrics::recordLatency(MetricStage stage, uint64_t ns) {
+    if (!enabled()) {
+        return;
+    }
+    StageCounters& counters = localMetrics().stages[static_cast<size_t>(stage)];
+    bump(counters.buckets[bucketIndex(ns)], 1);
+    bump(counters.count, 1);
+    bump(counters.total_ns, ns);
+    if (ns > counters.max_ns.load(std::memory_order_relaxed)) {
+        counters.max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void BEVMetrics::recordBytes(MetricStage stage, uint64_t bytes_in, uint64_t bytes_out) {
+    if (!enabled()) {
+        return;
+    }
+    StageCounters& counters = localMetrics().stages[static_cast<size_t>(stage)];
+    bump(counters.bytes_in, bytes_in);
+    bump(counters.bytes_out, bytes_out);
+}
+
+void BEVMetrics::recordError(double max_abs_error, double sum_squared_error, uint64_t num_values,
+                             double value_range) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadMetrics& metrics = localMetrics();
+    if (max_abs_error > metrics.max_abs_error.load(std::memory_order_relaxed)) {
+        metrics.max_abs_error.store(max_abs_error, std::memory_order_relaxed);
+    }
+    metrics.sum_squared_error.store(
+        metrics.sum_squared_error.load(std::memory_order_relaxed) + sum_squared_error,
+        std::memory_order_relaxed);
+    bump(metrics.error_samples, num_values);
+    if (value_range > metrics.value_range.load(std::memory_order_relaxed)) {
+        metrics.value_range.store(value_range, std::memory_order_relaxed);
+    }
+}
+
+void BEVMetrics::recordReencode(uint64_t reencoded_blocks, uint64_t unresolved_blocks) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadMetrics& metrics = localMetrics();
+    bump(metrics.reencoded_blocks, reencoded_blocks);
+    bump(metrics.unresolved_blocks, unresolved_blocks);
+}
+
+BEVMetrics::Snapshot BEVMetrics::snapshot() {
+    Snapshot snap;
+    double sum_squared_error = 0.0;
+
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto accumulate = [&](const ThreadMetrics& thread) {
+            for (size_t s = 0; s < NUM_STAGES; ++s) {
+                const StageCounters& src = thread.stages[s];
+                StageSnapshot& dst = snap.stages[s];
+                dst.count += src.count.load(std::memory_order_relaxed);
+                dst.total_ns += src.total_ns.load(std::memory_order_relaxed);
+                dst.max_ns = std::max(dst.max_ns, src.max_ns.load(std::memory_order_relaxed));
+                dst.bytes_in += src.bytes_in.load(std::memory_order_relaxed);
+                dst.bytes_out += src.bytes_out.load(std::memory_order_relaxed);
+                for (int b = 0; b < NUM_BUCKETS; ++b) {
+                    dst.buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+                }
+            }
+            snap.max_abs_error = std::max(snap.max_abs_error, thread.max_abs_error.load(std::memory_order_relaxed));
+            sum_squared_error += thread.sum_squared_error.load(std::memory_order_relaxed);
+            snap.error_samples += thread.error_samples.load(std::memory_order_relaxed);
+            snap.value_range = std::max(snap.value_range, thread.value_range.load(std::memory_order_relaxed));
+            snap.reencoded_blocks += thread.reencoded_blocks.load(std::memory_order_relaxed);
+            snap.unresolved_blocks += thread.unresolved_blocks.load(std::memory_order_relaxed);
+        };
+        accumulate(reg.retired);
+        const uint64_t epoch = reg.epoch.load(std::memory_order_relaxed);
+        for (const auto& thread : reg.threads) {
+            if (thread->epoch.load(std::memory_order_acquire) == epoch) {
+                accumulate(*thread);
+            }
+        }
+    }
+
+    for (StageSnapshot& stage : snap.stages) {
+        // 直方图各桶与count并非原子地一起读取，以桶总数为准
+        uint64_t bucket_total = 0;
+        for (uint64_t c : stage.buckets) {
+            bucket_total += c;
+        }
+        stage.p50_ns = percentile(stage.buckets, bucket_total, 0.50);
+        stage.p99_ns = percentile(stage.buckets, bucket_total, 0.99);
+        stage.p999_ns = percentile(stage.buckets, bucket_total, 0.999);
+    }
+
+    const StageSnapshot& frame = snap.stage(MetricStage::FRAME_COMPRESS);
+    snap.compression_ratio = frame.bytes_out > 0
+        ? static_cast<double>(frame.bytes_in) / frame.bytes_out
+        : 0.0;
+    snap.rmse = snap.error_samples > 0
+        ? std::sqrt(sum_squared_error / snap.error_samples)
+        : 0.0;
+    snap.psnr_db = snap.rmse > 0
+        ? 20.0 * std::log10((snap.value_range > 0 ? snap.value_range : 1.0) / snap.rmse)
+        : std::numeric_limits<double>::infinity();
+    return snap;
+}
+
+void BEVMetrics::reset() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    clear(reg.retired);
+    // 存活线程的计数不在这里清零（与其所属线程的递增竞争会丢失重置），只推进代次
+    reg.epoch.fetch_add(1, std::memory_order_release);
+}
+
+size_t BEVMetrics::registeredThreads() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.threads.size();
+}
+
+Json::Value BEVMetrics::Snapshot::toJSON() const {
+    Json::Value root;
+    for (size_t s = 0; s < NUM_STAGES; ++s) {
+        const StageSnapshot& stage = stages[s];
+        Json::Value node;
+        node["count"] = static_cast<Json::UInt64>(stage.count);
+        node["mean_ns"] = stage.count > 0 ? static_cast<double>(stage.total_ns) / stage.count : 0.0;
+        node["p50_ns"] = static_cast<Json::UInt64>(stage.p50_ns);
+        node["p99_ns"] = static_cast<Json::UInt64>(stage.p99_ns);
+        node["p999_ns"] = static_cast<Json::UInt64>(stage.p999_ns);
+        node["max_ns"] = static_cast<Json::UInt64>(stage.max_ns);
+        node["bytes_in"] = static_cast<Json::UInt64>(stage.bytes_in);
+        node["bytes_out"] = static_cast<Json::UInt64>(stage.bytes_out);
+        root["stages"][stageName(static_cast<MetricStage>(s))] = node;
+    }
+    root["compression_ratio"] = compression_ratio;
+    root["max_abs_error"] = max_abs_error;
+    root["rmse"] = rmse;
+    root["error_samples"] = static_cast<Json::UInt64>(error_samples);
+    root["psnr_db"] = std::isfinite(psnr_db) ? Json::Value(psnr_db) : Json::Value();
+    root["reencoded_blocks"] = static_cast<Json::UInt64>(reencoded_blocks);
+    root["unresolved_blocks"] = static_cast<Json::UInt64>(unresolved_blocks);
+    return root;
+}
@@ -0,0 +1,337 @@
+#include "worker_pool.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+// 当前线程在所属池中的序号
+thread_local int tls_worker_index = -1;
+}
+
+void WorkerPool::Batch::finish(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e && !error) {
+        error = e;
+    }
+    if (--remaining == 0) {
+        done_cv.notify_all();
+    }
+}
+
+void WorkerPool::Batch::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return remaining == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::vector<int> WorkerPool::parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        if (range.empty()) continue;
+        const size_t dash = range.find('-');
+        try {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            throw std::invalid_argument("CPU列表格式错误: " + text);
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> WorkerPool::detectTopology() {
+    // 进程可用的CPU（受taskset/cpuset限制）
+    std::set<int> allowed;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &mask)) allowed.insert(cpu);
+        }
+    }
+    if (allowed.empty()) {
+        const int count = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < count; ++cpu) allowed.insert(cpu);
+    }
+
+    // 各NUMA节点的CPU，按节点编号排序
+    namespace fs = std::filesystem;
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator("/sys/devices/system/node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+            continue;
+        }
+        std::ifstream in(entry.path() / "cpulist");
+        std::string text;
+        if (!in || !std::getline(in, text)) continue;
+        std::vector<int> cpus;
+        try {
+            for (int cpu : parseCpuList(text)) {
+                if (allowed.count(cpu)) cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (!cpus.empty()) {
+            nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+
+    std::vector<std::vector<int>> topology;
+    for (auto& node : nodes) {
+        topology.push_back(std::move(node.second));
+    }
+    if (topology.empty()) {
+        topology.emplace_back(allowed.begin(), allowed.end());
+    }
+    return topology;
+}
+
+WorkerPool::WorkerPool(const Config& config) : config_(config) {
+    std::vector<std::vector<int>> nodes;
+    for (const std::vector<int>& cpus : config_.nodes.empty() ? detectTopology() : config_.nodes) {
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+    if (nodes.empty()) {
+        throw std::invalid_argument("工作线程池的节点拓扑为空");
+    }
+    size_t total_cpus = 0;
+    for (const std::vector<int>& cpus : nodes) total_cpus += cpus.size();
+    const int threads = config_.threads > 0 ? config_.threads : static_cast<int>(total_cpus);
+
+    // 线程在节点之间轮流分配（线程数少于CPU数时各节点也都有线程），节点内依次占用CPU
+    const int num_nodes = static_cast<int>(nodes.size());
+    for (int k = 0; k < threads; ++k) {
+        auto worker = std::make_unique<Worker>();
+        worker->index = k;
+        worker->node = k % num_nodes;
+        const std::vector<int>& cpus = nodes[worker->node];
+        worker->cpu = cpus[(k / num_nodes) % cpus.size()];
+        workers_.push_back(std::move(worker));
+    }
+
+    if (config_.numa_aware) {
+        groups_.resize(std::min(threads, num_nodes));
+        for (const auto& worker : workers_) groups_[worker->node].push_back(worker->index);
+    } else {
+        groups_.resize(1);
+        for (const auto& worker : workers_) groups_[0].push_back(worker->index);
+    }
+    for (const std::vector<int>& group : groups_) {
+        max_slots_ = std::max(max_slots_, static_cast<int>(group.size()));
+    }
+
+    // CPU到节点的映射（统计实际执行位置用）；同一CPU出现在多个节点中（模拟节点）时记为-2
+    for (int node = 0; node < num_nodes; ++node) {
+        for (int cpu : nodes[node]) {
+            if (cpu < 0) continue;
+            if (static_cast<size_t>(cpu) >= cpu_node_.size()) cpu_node_.resize(cpu + 1, -1);
+            cpu_node_[cpu] = cpu_node_[cpu] == -1 || cpu_node_[cpu] == node ? node : -2;
+        }
+    }
+
+    // 工作线程先绑定CPU再报告就绪：构造返回时所有线程都已在目标CPU上，首个任务的内存也按该节点首次触碰
+    Batch ready;
+    ready.remaining = threads;
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&WorkerPool::workerLoop, this, std::ref(*worker), &ready);
+    }
+    ready.wait();
+}
+
+WorkerPool::~WorkerPool() {
+    stop_.store(true, std::memory_order_relaxed);
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cv.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+int WorkerPool::currentWorker() {
+    return tls_worker_index;
+}
+
+int WorkerPool::currentNode(const Worker& worker) const {
+    const int cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_node_.size() && cpu_node_[cpu] >= 0) {
+        return cpu_node_[cpu];
+    }
+    return worker.node;  // CPU不在拓扑中或被多个模拟节点共用时，以线程所属节点为准
+}
+
+void WorkerPool::workerLoop(Worker& worker, Batch* ready) {
+    tls_worker_index = worker.index;
+    // 绑定失败（CPU不在cpuset中等）时线程照常运行，只是不固定CPU
+    if (config_.pin) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(worker.cpu, &mask);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0) {
+            worker.cpu = -1;
+        }
+    } else {
+        worker.cpu = -1;
+    }
+    ready->finish(nullptr);
+
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&] { return !worker.tasks.empty() || stop_.load(std::memory_order_relaxed); });
+            if (worker.tasks.empty()) {
+                return;
+            }
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        std::exception_ptr error;
+        try {
+            task.fn();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        task.batch->finish(error);
+    }
+}
+
+void WorkerPool::post(int worker, std::function<void()> fn, Batch& batch) {
+    Worker& target = *workers_[worker];
+    {
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.tasks.push_back(Task{std::move(fn), &batch});
+    }
+    target.cv.notify_one();
+}
+
+int WorkerPool::firstWorkerOfNode(int node) const {
+    for (const auto& worker : workers_) {
+        if (worker->node == node) return worker->index;
+    }
+    throw std::out_of_range("节点上没有工作线程: " + std::to_string(node));
+}
+
+void WorkerPool::runOn(int worker, const std::function<void()>& fn) {
+    if (worker < 0 || worker >= size()) {
+        throw std::out_of_range("工作线程序号无效: " + std::to_string(worker));
+    }
+    if (currentWorker() == worker) {
+        fn();
+        return;
+    }
+    Batch batch;
+    batch.remaining = 1;
+    post(worker, fn, batch);
+    batch.wait();
+}
+
+void WorkerPool::runPartitioned(const std::vector<size_t>& items_per_frame, const PartitionFn& fn) {
+    const size_t num_frames = items_per_frame.size();
+    if (num_frames == 0) return;
+
+    // 嵌套调用：工作线程等待自己队列中的任务会死锁，直接串行执行
+    if (currentWorker() >= 0) {
+        for (size_t f = 0; f < num_frames; ++f) {
+            if (items_per_frame[f] > 0) fn(f, 0, 0, items_per_frame[f]);
+        }
+        return;
+    }
+
+    // 帧轮转分配到各组，第f帧的项在组内按线程数均分为连续区间
+    const size_t num_groups = groups_.size();
+    const size_t first_group = next_group_.fetch_add(num_frames, std::memory_order_relaxed);
+    std::vector<std::vector<size_t>> group_frames(num_groups);
+    for (size_t f = 0; f < num_frames; ++f) {
+        group_frames[(first_group + f) % num_groups].push_back(f);
+    }
+    // 各帧实际执行所在的节点（位掩码，节点号超过63的归入第63位）：每段开始时按当前CPU采样
+    std::vector<std::atomic<uint64_t>> frame_nodes(num_frames);
+
+    Batch batch;
+    std::vector<std::pair<int, std::function<void()>>> tasks;
+    for (size_t g = 0; g < num_groups; ++g) {
+        if (group_frames[g].empty()) continue;
+        const std::vector<int>& group = groups_[g];
+        const size_t width = group.size();
+        for (size_t r = 0; r < width; ++r) {
+            bool has_work = false;
+            for (size_t f : group_frames[g]) {
+                has_work |= items_per_frame[f] * (r + 1) / width > items_per_frame[f] * r / width;
+            }
+            if (!has_work) continue;
+            tasks.emplace_back(group[r], [this, &items_per_frame, &fn, &frames = group_frames[g], &frame_nodes,
+                                          worker = group[r], r, width] {
+                for (size_t f : frames) {
+                    const size_t begin = items_per_frame[f] * r / width;
+                    const size_t end = items_per_frame[f] * (r + 1) / width;
+                    if (begin < end) {
+                        const int node = std::min(currentNode(*workers_[worker]), 63);
+                        frame_nodes[f].fetch_or(uint64_t{1} << node, std::memory_order_relaxed);
+                        fn(f, static_cast<int>(r), begin, end);
+                    }
+                }
+            });
+        }
+    }
+    frames_.fetch_add(num_frames, std::memory_order_relaxed);
+    if (tasks.empty()) return;
+    batch.remaining = static_cast<int>(tasks.size());
+    for (auto& task : tasks) {
+        post(task.first, std::move(task.second), batch);
+    }
+    // 异常时同样统计已执行的部分
+    struct CountCrossNode {
+        const std::vector<std::atomic<uint64_t>>& frame_nodes;
+        std::atomic<uint64_t>& counter;
+        ~CountCrossNode() {
+            uint64_t cross_node = 0;
+            for (const auto& mask : frame_nodes) {
+                cross_node += __builtin_popcountll(mask.load(std::memory_order_relaxed)) > 1;
+            }
+            counter.fetch_add(cross_node, std::memory_order_relaxed);
+        }
+    } count_cross_node{frame_nodes, cross_node_frames_};
+    batch.wait();
+}
+
+Json::Value WorkerPool::getStats() const {
+    Json::Value root;
+    root["threads"] = size();
+    root["groups"] = numGroups();
+    root["numa_aware"] = config_.numa_aware;
+    root["frames"] = static_cast<Json::UInt64>(frames_.load(std::memory_order_relaxed));
+    root["cross_node_frames"] = static_cast<Json::UInt64>(cross_node_frames_.load(std::memory_order_relaxed));
+    Json::Value& workers = root["workers"];
+    workers = Json::Value(Json::arrayValue);
+    for (const auto& worker : workers_) {
+        Json::Value entry;
+        entry["node"] = worker->node;
+        entry["cpu"] = worker->cpu;
+        workers.append(entry);
+    }
+    return root;
+}
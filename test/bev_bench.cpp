@@ -0,0 +1,672 @@
+#include "GenerateData.h"
+#include "cache_system.h"
+#include "compressor.h"
+#include "shm_cache.h"
+#include "utils.h"
+#include "worker_pool.h"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+
+// BEV压缩/缓存/内存池吞吐基准
+// 默认将JSON报告写入bev_bench.json，便于在版本间追踪性能回归；
+// 显式传入--benchmark_out等参数时以命令行为准。
+
+namespace {
+
+const int FRAME_ROWS = 256;
+const int FRAME_COLS = 256;
+const char* const DATA_TYPE_NAMES[] = {"random", "gradient", "obstacle", "grid"};
+
+// 每种数据类型只生成一次样本帧
+const BEVFeaturePacket& sample_frame(int data_type) {
+    static std::mutex mutex;
+    static std::map<int, BEVFeaturePacket> frames;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = frames.find(data_type);
+    if (it == frames.end()) {
+        BEVDataGenerator generator;
+        it = frames.emplace(data_type, generator.generate_bev_frame(FRAME_ROWS, FRAME_COLS, data_type, 0.2f)).first;
+    }
+    return it->second;
+}
+
+BEVCompressor::Config make_config(int block_size, float rate) {
+    BEVCompressor::Config config;
+    config.block_size = block_size;
+    config.compression_ratio = rate;
+    return config;
+}
+
+// 生成一帧压缩流（时间戳可指定）
+std::vector<uint8_t> compressed_frame(uint64_t timestamp, int data_type = 0) {
+    BEVCompressor compressor(make_config(16, 16.0f));
+    BEVFeaturePacket packet = sample_frame(data_type);
+    packet.timestamp = timestamp;
+    return compressor.compress({packet});
+}
+
+const size_t RAW_FRAME_BYTES = FRAME_ROWS * FRAME_COLS * sizeof(float);
+
+}  // namespace
+
+// ---------------- 压缩 / 解压 ----------------
+// 参数：数据类型、块大小、码率
+
+static void BM_Compress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    BEVCompressor compressor(make_config(static_cast<int>(state.range(1)), static_cast<float>(state.range(2))));
+    std::vector<BEVFeaturePacket> packets{sample_frame(data_type)};
+
+    size_t compressed_size = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        compressed_size = compressed.size();
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["ratio"] = static_cast<double>(RAW_FRAME_BYTES) / compressed_size;
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_Compress)
+    ->ArgNames({"type", "block", "rate"})
+    ->ArgsProduct({{0, 1, 2, 3}, {4, 8, 16, 32}, {4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_Decompress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    BEVCompressor compressor(make_config(static_cast<int>(state.range(1)), static_cast<float>(state.range(2))));
+    std::vector<uint8_t> compressed = compressor.compress({sample_frame(data_type)});
+
+    for (auto _ : state) {
+        std::vector<BEVFeaturePacket> packets = compressor.decompress(compressed);
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["ratio"] = static_cast<double>(RAW_FRAME_BYTES) / compressed.size();
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_Decompress)
+    ->ArgNames({"type", "block", "rate"})
+    ->ArgsProduct({{0, 1, 2, 3}, {4, 8, 16, 32}, {4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond);
+
+// 无损编码：参数为数据类型与编码方式（0-ZFP可逆模式，1-字节平面重排+LZ），对比压缩比与编解码吞吐
+static BEVCompressor::Config lossless_config(int codec) {
+    BEVCompressor::Config config = make_config(16, 32.0f);
+    config.lossless = true;
+    config.lossless_codec = codec;
+    return config;
+}
+
+static void BM_LosslessCompress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    BEVCompressor compressor(lossless_config(static_cast<int>(state.range(1))));
+    std::vector<BEVFeaturePacket> packets{sample_frame(data_type)};
+
+    size_t compressed_size = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        compressed_size = compressed.size();
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["ratio"] = static_cast<double>(RAW_FRAME_BYTES) / compressed_size;
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_LosslessCompress)
+    ->ArgNames({"type", "codec"})
+    ->ArgsProduct({{0, 1, 2, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_LosslessDecompress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    BEVCompressor compressor(lossless_config(static_cast<int>(state.range(1))));
+    std::vector<uint8_t> compressed = compressor.compress({sample_frame(data_type)});
+
+    for (auto _ : state) {
+        std::vector<BEVFeaturePacket> packets = compressor.decompress(compressed);
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["ratio"] = static_cast<double>(RAW_FRAME_BYTES) / compressed.size();
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_LosslessDecompress)
+    ->ArgNames({"type", "codec"})
+    ->ArgsProduct({{0, 1, 2, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// 固定尺寸内核与通用路径对比：kernel=1为按块大小特化的内核，0为动态尺寸路径；
+// per_block为每块压缩/解压的平均耗时
+static void BM_BlockKernelCompress(benchmark::State& state) {
+    const int block_size = static_cast<int>(state.range(0));
+    BEVCompressor::Config config = make_config(block_size, 8.0f);
+    config.fixed_kernels = state.range(1) != 0;
+    BEVCompressor compressor(config);
+    std::vector<BEVFeaturePacket> packets{sample_frame(0)};
+    const double blocks = static_cast<double>(FRAME_ROWS / block_size) * (FRAME_COLS / block_size);
+
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["per_block"] = benchmark::Counter(
+        state.iterations() * blocks, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_BlockKernelCompress)
+    ->ArgNames({"block", "kernel"})
+    ->ArgsProduct({{4, 8, 16, 32}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_BlockKernelDecompress(benchmark::State& state) {
+    const int block_size = static_cast<int>(state.range(0));
+    BEVCompressor::Config config = make_config(block_size, 8.0f);
+    config.fixed_kernels = state.range(1) != 0;
+    BEVCompressor compressor(config);
+    std::vector<uint8_t> compressed = compressor.compress({sample_frame(0)});
+    const double blocks = static_cast<double>(FRAME_ROWS / block_size) * (FRAME_COLS / block_size);
+
+    for (auto _ : state) {
+        std::vector<BEVFeaturePacket> packets = compressor.decompress(compressed);
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.counters["per_block"] = benchmark::Counter(
+        state.iterations() * blocks, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_BlockKernelDecompress)
+    ->ArgNames({"block", "kernel"})
+    ->ArgsProduct({{4, 8, 16, 32}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// 分块存储：与BM_Compress/BM_Decompress同参数对比，块在连续内存上压缩/解压
+static void BM_TiledCompress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    const int block_size = static_cast<int>(state.range(1));
+    BEVCompressor compressor(make_config(block_size, static_cast<float>(state.range(2))));
+    std::vector<TiledFeaturePacket> packets(1);
+    packets[0].feature = TiledFeature::from_matrix(sample_frame(data_type).feature, block_size);
+
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_TiledCompress)
+    ->ArgNames({"type", "block", "rate"})
+    ->ArgsProduct({{0, 1, 2, 3}, {8, 16, 32}, {4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_TiledDecompress(benchmark::State& state) {
+    const int data_type = static_cast<int>(state.range(0));
+    const int block_size = static_cast<int>(state.range(1));
+    BEVCompressor compressor(make_config(block_size, static_cast<float>(state.range(2))));
+    std::vector<uint8_t> compressed = compressor.compress({sample_frame(data_type)});
+
+    for (auto _ : state) {
+        std::vector<TiledFeaturePacket> packets = compressor.decompress_tiled(compressed);
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    state.SetLabel(DATA_TYPE_NAMES[data_type]);
+}
+BENCHMARK(BM_TiledDecompress)
+    ->ArgNames({"type", "block", "rate"})
+    ->ArgsProduct({{0, 1, 2, 3}, {8, 16, 32}, {4, 8, 16}})
+    ->Unit(benchmark::kMicrosecond);
+
+// MatrixXf与分块存储互转的带宽：参数为块大小、方向（0: 转为分块，1: 转回矩阵）
+static void BM_TileConversion(benchmark::State& state) {
+    const int block_size = static_cast<int>(state.range(0));
+    const Eigen::MatrixXf& matrix = sample_frame(0).feature;
+    TiledFeature tiled = TiledFeature::from_matrix(matrix, block_size);
+    Eigen::MatrixXf out(matrix.rows(), matrix.cols());
+
+    for (auto _ : state) {
+        if (state.range(1) == 0) {
+            tiled.assign(matrix);
+            benchmark::DoNotOptimize(tiled.data());
+        } else {
+            tiled.to_matrix(out);
+            benchmark::DoNotOptimize(out.data());
+        }
+        benchmark::ClobberMemory();
+    }
+    // 读+写
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES * 2));
+}
+BENCHMARK(BM_TileConversion)
+    ->ArgNames({"block", "to_matrix"})
+    ->ArgsProduct({{8, 12, 16, 32}, {0, 1}});
+
+// 大尺寸网格：参数为边长（方形帧），每字节耗时应与帧大小无关（线性扩展）
+const BEVFeaturePacket& grid_frame(int size) {
+    static std::mutex mutex;
+    static std::map<int, BEVFeaturePacket> frames;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = frames.find(size);
+    if (it == frames.end()) {
+        BEVFeaturePacket packet;
+        packet.feature = Eigen::MatrixXf::Random(size, size);
+        packet.timestamp = 1000;
+        it = frames.emplace(size, std::move(packet)).first;
+    }
+    return it->second;
+}
+
+static void BM_CompressGrid(benchmark::State& state) {
+    BEVCompressor compressor(make_config(16, 8.0f));
+    std::vector<BEVFeaturePacket> packets{grid_frame(static_cast<int>(state.range(0)))};
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * packets[0].feature.size() * sizeof(float)));
+}
+BENCHMARK(BM_CompressGrid)->ArgName("size")->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_DecompressGrid(benchmark::State& state) {
+    BEVCompressor compressor(make_config(16, 8.0f));
+    const BEVFeaturePacket& frame = grid_frame(static_cast<int>(state.range(0)));
+    std::vector<uint8_t> compressed = compressor.compress({frame});
+    for (auto _ : state) {
+        std::vector<BEVFeaturePacket> packets = compressor.decompress(compressed);
+        benchmark::DoNotOptimize(packets.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.feature.size() * sizeof(float)));
+}
+BENCHMARK(BM_DecompressGrid)->ArgName("size")->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)
+    ->Unit(benchmark::kMillisecond);
+
+// 指标埋点开销：参数为是否开启BEVMetrics
+static void BM_CompressMetricsOverhead(benchmark::State& state) {
+    const bool was_enabled = BEVMetrics::enabled();
+    BEVMetrics::setEnabled(state.range(0) != 0);
+    BEVCompressor compressor(make_config(16, 16.0f));
+    std::vector<BEVFeaturePacket> packets{sample_frame(0)};
+
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+    BEVMetrics::setEnabled(was_enabled);
+}
+BENCHMARK(BM_CompressMetricsOverhead)->ArgName("metrics")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// 在线校验开销：参数为校验间隔（0为关闭，1为逐块校验，N为每N块抽样一个）
+static void BM_CompressVerifyOverhead(benchmark::State& state) {
+    BEVCompressor::Config config = make_config(16, 16.0f);
+    config.verify = state.range(0) > 0;
+    config.verify_interval = std::max<int>(1, static_cast<int>(state.range(0)));
+    BEVCompressor compressor(config);
+    std::vector<BEVFeaturePacket> packets{sample_frame(0)};
+
+    for (auto _ : state) {
+        std::vector<uint8_t> compressed = compressor.compress(packets);
+        benchmark::DoNotOptimize(compressed.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+}
+BENCHMARK(BM_CompressVerifyOverhead)->ArgName("interval")->Arg(0)->Arg(1)->Arg(8)->Unit(benchmark::kMicrosecond);
+
+// 工作线程池解码：8帧512x512，参数为是否按节点分组。只有一个NUMA节点时把可用CPU拆成两半模拟两个节点；
+// cross_node_frames为块被分到多个节点上解码的帧所占比例（按节点分组时为0），
+// 在真实多节点机器上对照吞吐即可看到跨节点访存减少的效果
+static void BM_PoolDecompress(benchmark::State& state) {
+    std::vector<std::vector<int>> nodes = WorkerPool::detectTopology();
+    if (nodes.size() == 1) {
+        std::vector<int> cpus = nodes[0];
+        const size_t half = std::max<size_t>(1, cpus.size() / 2);
+        nodes = {std::vector<int>(cpus.begin(), cpus.begin() + half),
+                 cpus.size() > 1 ? std::vector<int>(cpus.begin() + half, cpus.end()) : cpus};
+    }
+    WorkerPool::Config pool_config;
+    pool_config.nodes = nodes;
+    pool_config.threads = std::max<int>(2, static_cast<int>(nodes[0].size() + nodes[1].size()));
+    pool_config.numa_aware = state.range(0) != 0;
+    auto pool = std::make_shared<WorkerPool>(pool_config);
+
+    BEVCompressor compressor(make_config(16, 8.0f));
+    compressor.set_worker_pool(pool);
+    std::vector<BEVFeaturePacket> packets(8, grid_frame(512));
+    const std::vector<uint8_t> stream = compressor.compress(packets);
+    const uint64_t frames_before = pool->getStats()["frames"].asUInt64();
+    const uint64_t cross_before = pool->getStats()["cross_node_frames"].asUInt64();
+
+    for (auto _ : state) {
+        std::vector<BEVFeaturePacket> decoded = compressor.decompress(stream);
+        benchmark::DoNotOptimize(decoded.data());
+    }
+    const Json::Value stats = pool->getStats();
+    const uint64_t frames = stats["frames"].asUInt64() - frames_before;
+    state.counters["threads"] = pool->size();
+    state.counters["cross_node_frames"] =
+        frames > 0 ? static_cast<double>(stats["cross_node_frames"].asUInt64() - cross_before) / frames : 0.0;
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * packets.size() * 512 * 512 * sizeof(float)));
+}
+BENCHMARK(BM_PoolDecompress)->ArgName("numa_aware")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// ---------------- 缓存 ----------------
+
+// 多线程插入：每个线程反复插入自己的一帧（256块），线程间竞争同一个缓存
+static void BM_CacheInsert(benchmark::State& state) {
+    static BEVCache* cache = nullptr;
+    if (state.thread_index() == 0) {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 4096;
+        cache = new BEVCache(config);
+    }
+    std::vector<uint8_t> stream = compressed_frame(1000 + state.thread_index() * 40);
+
+    for (auto _ : state) {
+        cache->insertPackets(stream);
+    }
+    state.SetItemsProcessed(state.iterations() * FRAME_ROWS * FRAME_COLS / (16 * 16));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * stream.size()));
+
+    if (state.thread_index() == 0) {
+        delete cache;
+        cache = nullptr;
+    }
+}
+BENCHMARK(BM_CacheInsert)->ThreadRange(1, 8)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// 零拷贝插入：参数为是否共享持有整批缓冲区（0为逐块拷贝），一批8帧、关闭去重，
+// 对比逐块分配拷贝与只记录块位置的插入吞吐
+static void BM_CacheInsertShared(benchmark::State& state) {
+    const bool shared = state.range(0) != 0;
+    std::vector<BEVFeaturePacket> packets;
+    for (int i = 0; i < 8; ++i) {
+        BEVFeaturePacket packet = sample_frame(0);
+        packet.timestamp = 1000 + i * 40;
+        packets.push_back(std::move(packet));
+    }
+    BEVCompressor compressor(make_config(16, 16.0f));
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(compressor.compress(packets));
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 8 * 256 + 1;
+    config.dedup = false;
+    BEVCache cache(config);
+
+    for (auto _ : state) {
+        if (shared) {
+            cache.insertPackets(buffer);
+        } else {
+            cache.insertPackets(*buffer);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 8 * 256);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * buffer->size()));
+}
+BENCHMARK(BM_CacheInsertShared)->ArgName("shared")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// 稀疏场景的内容去重：连续32帧无噪声场景（障碍物与自车运动），参数为背景类型（2-空，3-道路网格）
+// 与是否去重，报告去重比与实际存储字节数
+static void BM_CacheInsertDedup(benchmark::State& state) {
+    const int num_frames = 32;
+    BEVDataGenerator generator;
+    BEVDataGenerator::ScenarioConfig scenario;
+    scenario.rows = FRAME_ROWS;
+    scenario.cols = FRAME_COLS;
+    scenario.data_type = static_cast<int>(state.range(0));
+    scenario.noise_level = 0.0f;
+    BEVCompressor compressor(make_config(16, 16.0f));
+    std::vector<std::vector<uint8_t>> streams;
+    for (int f = 0; f < num_frames; ++f) {
+        streams.push_back(compressor.compress({generator.generate_scenario_frame(scenario, f)}));
+    }
+
+    Json::Value stats;
+    for (auto _ : state) {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = num_frames * 256;
+        config.dedup = state.range(1) != 0;
+        BEVCache cache(config);
+        for (const std::vector<uint8_t>& stream : streams) {
+            cache.insertPackets(stream);
+        }
+        state.PauseTiming();
+        stats = cache.getStats();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_frames * 256);
+    state.counters["dedup_ratio"] = stats["dedup_ratio"].asDouble();
+    state.counters["stored_KB"] = stats["stored_bytes"].asDouble() / 1024.0;
+    state.SetLabel(DATA_TYPE_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_CacheInsertDedup)
+    ->ArgNames({"type", "dedup"})
+    ->ArgsProduct({{2, 3}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// 多线程检索：参数为命中率百分比
+static void BM_CacheRetrieve(benchmark::State& state) {
+    const int num_frames = 16;
+    static BEVCache* cache = []() {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = num_frames * 256;
+        BEVCache* c = new BEVCache(config);
+        for (int f = 0; f < num_frames; ++f) {
+            c->insertPackets(compressed_frame(1000 + f * 40));
+        }
+        return c;
+    }();
+
+    const int hit_percent = static_cast<int>(state.range(0));
+    std::mt19937 gen(1234 + state.thread_index());
+    std::uniform_int_distribution<int> frame_dist(0, num_frames - 1);
+    std::uniform_int_distribution<int> block_dist(0, 15);
+    std::uniform_int_distribution<int> percent_dist(0, 99);
+
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    int64_t hits = 0;
+    for (auto _ : state) {
+        // 未命中的请求使用缓存中不存在的时间戳
+        uint64_t timestamp = percent_dist(gen) < hit_percent
+            ? 1000 + frame_dist(gen) * 40
+            : 1 + frame_dist(gen);
+        uint16_t x = static_cast<uint16_t>(block_dist(gen) * 16);
+        uint16_t y = static_cast<uint16_t>(block_dist(gen) * 16);
+        hits += cache->retrieve(timestamp, x, y, data, rows, cols);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hit_ratio"] = benchmark::Counter(
+        state.iterations() ? static_cast<double>(hits) / state.iterations() : 0.0,
+        benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_CacheRetrieve)
+    ->ArgName("hit_pct")
+    ->Arg(0)->Arg(50)->Arg(90)->Arg(100)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// 整帧批量检索+并行解码
+static void BM_CacheRetrieveFrame(benchmark::State& state) {
+    BEVCompressor compressor(make_config(16, 16.0f));
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache cache(config);
+    cache.insertPackets(compressed_frame(1000));
+
+    Eigen::MatrixXf frame(FRAME_ROWS, FRAME_COLS);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.retrieveFrame(1000, compressor, frame));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+}
+BENCHMARK(BM_CacheRetrieveFrame)->Unit(benchmark::kMicrosecond);
+
+static void BM_CacheRetrieveFrameGrid(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    BEVCompressor compressor(make_config(16, 8.0f));
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = static_cast<size_t>(size / 16) * (size / 16);
+    BEVCache cache(config);
+    cache.insertPackets(compressor.compress({grid_frame(size)}));
+
+    Eigen::MatrixXf frame(size, size);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.retrieveFrame(1000, compressor, frame));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.size() * sizeof(float)));
+}
+BENCHMARK(BM_CacheRetrieveFrameGrid)->ArgName("size")->Arg(256)->Arg(512)->Arg(1024)->Arg(2048)
+    ->Unit(benchmark::kMillisecond);
+
+// 跨进程共享内存缓存的多线程检索（线程代表各读进程）：参数为是否零拷贝访问（0为拷贝出块数据），
+// 与BM_CacheRetrieve的100%命中对比
+static void BM_SharedCacheRetrieve(benchmark::State& state) {
+    const int num_frames = 16;
+    static SharedBEVCache* cache = []() {
+        SharedBEVCache::Config config;
+        config.data_bytes = 16 << 20;
+        config.max_items = num_frames * 256;
+        SharedBEVCache* c = SharedBEVCache::create(config).release();
+        for (int f = 0; f < num_frames; ++f) {
+            c->insertPackets(compressed_frame(1000 + f * 40));
+        }
+        return c;
+    }();
+
+    const bool zero_copy = state.range(0) != 0;
+    std::mt19937 gen(1234 + state.thread_index());
+    std::uniform_int_distribution<int> frame_dist(0, num_frames - 1);
+    std::uniform_int_distribution<int> block_dist(0, 15);
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    size_t checksum = 0;
+    for (auto _ : state) {
+        const SharedBEVCache::CacheKey key{static_cast<uint64_t>(1000 + frame_dist(gen) * 40),
+                                           static_cast<uint16_t>(block_dist(gen) * 16),
+                                           static_cast<uint16_t>(block_dist(gen) * 16)};
+        if (zero_copy) {
+            cache->visit(key, [&](const uint8_t* p, size_t size, uint16_t, uint16_t, const BEVBlockCodec&) {
+                checksum += p[size - 1];
+            });
+        } else {
+            cache->retrieve(key.timestamp, key.x, key.y, data, rows, cols);
+        }
+    }
+    benchmark::DoNotOptimize(checksum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedCacheRetrieve)->ArgName("zero_copy")->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+// 从共享内存直接解码整帧，与BM_CacheRetrieveFrame对比
+static void BM_SharedCacheRetrieveFrame(benchmark::State& state) {
+    BEVCompressor compressor(make_config(16, 16.0f));
+    SharedBEVCache::Config config;
+    config.data_bytes = 4 << 20;
+    config.max_items = 1024;
+    auto cache = SharedBEVCache::create(config);
+    cache->insertPackets(compressed_frame(1000));
+
+    Eigen::MatrixXf frame(FRAME_ROWS, FRAME_COLS);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache->retrieveFrame(1000, compressor, frame));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * RAW_FRAME_BYTES));
+}
+BENCHMARK(BM_SharedCacheRetrieveFrame)->Unit(benchmark::kMicrosecond);
+
+// 金字塔概览：2048x2048帧，参数为检索的层级（0为整帧，5为64x64概览），对比只解码粗层与解码整帧
+static void BM_CacheRetrieveOverview(benchmark::State& state) {
+    const int size = 2048;
+    const int level = static_cast<int>(state.range(0));
+    BEVCompressor::Config compressor_config = make_config(16, 8.0f);
+    compressor_config.pyramid_levels = 6;
+    BEVCompressor compressor(compressor_config);
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 32768;
+    BEVCache cache(config);
+    cache.insertPackets(compressor.compress({grid_frame(size)}));
+
+    const int extent = BEVCompressor::level_extent(size, level);
+    Eigen::MatrixXf overview(extent, extent);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.retrieveRegion(1000, static_cast<uint8_t>(level), 0, 0, compressor, overview));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * overview.size()));
+}
+BENCHMARK(BM_CacheRetrieveOverview)->ArgName("level")->Arg(0)->Arg(5)->Unit(benchmark::kMicrosecond);
+
+// ---------------- 内存池 vs malloc ----------------
+// 参数：每轮连续分配的块数
+
+static void BM_SimpleMemoryPool(benchmark::State& state) {
+    static SimpleMemoryPool* pool = nullptr;
+    if (state.thread_index() == 0) {
+        pool = new SimpleMemoryPool(1024);
+    }
+    const size_t batch = static_cast<size_t>(state.range(0));
+    std::vector<void*> ptrs(batch);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            ptrs[i] = pool->allocate(1024);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        for (size_t i = 0; i < batch; ++i) {
+            pool->deallocate(ptrs[i]);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+
+    if (state.thread_index() == 0) {
+        delete pool;
+        pool = nullptr;
+    }
+}
+BENCHMARK(BM_SimpleMemoryPool)->Arg(64)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_Malloc(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    std::vector<void*> ptrs(batch);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            ptrs[i] = std::malloc(1024);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        for (size_t i = 0; i < batch; ++i) {
+            std::free(ptrs[i]);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+}
+BENCHMARK(BM_Malloc)->Arg(64)->ThreadRange(1, 8)->UseRealTime();
+
+// 默认输出JSON报告
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            has_out = true;
+        }
+    }
+    static char default_out[] = "--benchmark_out=bev_bench.json";
+    static char default_format[] = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(default_out);
+        args.push_back(default_format);
+    }
+    int new_argc = static_cast<int>(args.size());
+
+    benchmark::Initialize(&new_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(new_argc, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
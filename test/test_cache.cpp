@@ -0,0 +1,1208 @@
+#include "cache_system.h"
+#include "compressor.h"
+#include "GenerateData.h"
+#include "prefetcher.h"
+#include "replay.h"
+#include "shm_cache.h"
+#include "stats_reporter.h"
+#include "uplink.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <tuple>
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 简单断言：失败时打印位置并计数
+static int g_failures = 0;
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << " 检查失败: " #cond << std::endl; \
+            ++g_failures;                                                        \
+        }                                                                        \
+    } while (0)
+
+// 生成若干帧常量特征并压缩
+static std::vector<uint8_t> make_stream(BEVCompressor& compressor, int num_frames, uint64_t first_ts) {
+    std::vector<BEVFeaturePacket> packets;
+    for (int i = 0; i < num_frames; ++i) {
+        BEVFeaturePacket packet;
+        packet.feature = Eigen::MatrixXf::Constant(256, 256, 0.25f * (i + 1));
+        packet.timestamp = first_ts + i * 40;
+        packets.push_back(std::move(packet));
+    }
+    return compressor.compress(packets);
+}
+
+static void test_insert_and_retrieve() {
+    BEVCompressor compressor(BEVCompressor::Config{});
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache cache(config);
+    cache.insertPackets(make_stream(compressor, 2, 1000));
+
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    CHECK(cache.retrieve(1000, 0, 0, data, rows, cols));
+    CHECK(!data.empty());
+    CHECK(rows == 16);
+    CHECK(cache.retrieve(1040, 240, 240, data, rows, cols));
+    CHECK(!cache.retrieve(2000, 0, 0, data, rows, cols));
+    CHECK(cache.getHitRate() > 0.6 && cache.getHitRate() < 0.7);
+
+    uint64_t next = 0;
+    CHECK(cache.nextTimestamp(1000, next) && next == 1040);
+    CHECK(!cache.nextTimestamp(1040, next));
+
+    // 边缘块返回实际的行列数
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Constant(40, 300, 1.0f);
+    packet.timestamp = 5000;
+    cache.insertPackets(compressor.compress({packet}));
+    CHECK(cache.retrieve(5000, 32, 288, data, rows, cols));
+    CHECK(rows == 8 && cols == 12);
+    CHECK(cache.retrieve(5000, 0, 16, data, rows, cols));
+    CHECK(rows == 16 && cols == 16);
+}
+
+static void test_capacity_eviction() {
+    BEVCompressor compressor(BEVCompressor::Config{});
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 256;
+    BEVCache cache(config);
+    cache.insertPackets(make_stream(compressor, 2, 1000));
+
+    // 容量只够一帧：第一帧应被全部淘汰
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    CHECK(!cache.peek(1000, 0, 0, data, rows, cols));
+    CHECK(cache.peek(1040, 0, 0, data, rows, cols));
+}
+
+static void test_batch_and_frame() {
+    BEVCompressor::Config compressor_config;
+    compressor_config.compression_ratio = 32.0f;
+    BEVCompressor compressor(compressor_config);
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache cache(config);
+    cache.insertPackets(make_stream(compressor, 1, 1000));
+
+    std::vector<BEVCache::BatchEntry> results;
+    size_t hits = cache.retrieveBatch(1000, {{0, 0}, {16, 32}, {999, 0}}, results);
+    CHECK(hits == 2);
+    CHECK(results.size() == 3);
+    CHECK(results[0].hit && results[1].hit && !results[2].hit);
+
+    Eigen::MatrixXf frame = Eigen::MatrixXf::Zero(256, 256);
+    std::vector<BEVCache::CacheKey> misses;
+    CHECK(cache.retrieveFrame(1000, compressor, frame, &misses) == 256);
+    CHECK(misses.empty());
+    CHECK((frame.array() - 0.25f).abs().maxCoeff() < 1e-4f);
+
+    // 工作线程池解码与OpenMP路径结果一致
+    WorkerPool::Config pool_config;
+    pool_config.threads = 3;
+    config.decode_pool = std::make_shared<WorkerPool>(pool_config);
+    BEVCache pooled(config);
+    pooled.insertPackets(make_stream(compressor, 1, 1000));
+    Eigen::MatrixXf pooled_frame = Eigen::MatrixXf::Zero(256, 256);
+    CHECK(pooled.retrieveFrame(1000, compressor, pooled_frame) == 256);
+    CHECK(pooled_frame == frame);
+    CHECK(config.decode_pool->getStats()["frames"].asUInt64() == 1);
+
+    // 损坏的块：解码失败不终止进程，按未命中返回并计入统计（OpenMP与线程池两条路径）
+    BEVCompressor::Config shuffle_config;
+    shuffle_config.lossless = true;
+    shuffle_config.lossless_codec = BEVCompressor::Config::LOSSLESS_SHUFFLE;
+    BEVCompressor shuffle(shuffle_config);
+    std::vector<uint8_t> stream = make_stream(shuffle, 1, 3000);
+    {
+        CompressedStreamView view(stream);
+        CompressedStreamView::Frame frame_record;
+        CompressedStreamView::Block block_record;
+        CHECK(view.next_frame(frame_record));
+        CHECK(view.next_block(block_record) && view.next_block(block_record));
+        stream[block_record.offset] = 0xEE;  // 第2块(0, 16)的模式字节改为未知值
+    }
+    for (bool use_pool : {false, true}) {
+        BEVCache::BEVCacheConfig corrupt_config;
+        corrupt_config.max_cache_size = 1024;
+        if (use_pool) {
+            corrupt_config.decode_pool = config.decode_pool;
+        }
+        BEVCache corrupt(corrupt_config);
+        corrupt.insertPackets(stream);
+        Eigen::MatrixXf corrupt_frame = Eigen::MatrixXf::Zero(256, 256);
+        std::vector<BEVCache::CacheKey> corrupt_misses;
+        CHECK(corrupt.retrieveFrame(3000, shuffle, corrupt_frame, &corrupt_misses) == 255);
+        CHECK(corrupt_misses.size() == 1);
+        CHECK(corrupt_misses.size() == 1 && corrupt_misses[0].x == 0 && corrupt_misses[0].y == 16);
+        CHECK(corrupt_frame.block(0, 0, 16, 16).isConstant(0.25f));
+        CHECK(corrupt_frame.block(240, 240, 16, 16).isConstant(0.25f));
+        Json::Value corrupt_stats = corrupt.getStats();
+        CHECK(corrupt_stats["decode_errors"].asUInt64() == 1);
+        CHECK(corrupt_stats["total_hits"].asUInt64() == 255);
+        CHECK(corrupt_stats["total_misses"].asUInt64() == 1);
+    }
+}
+
+static void test_stats_reporter() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "bev_stats_reporter_test";
+    fs::remove_all(dir);
+
+    BEVCache::BEVCacheConfig cache_config;
+    BEVCache cache(cache_config);
+    // 统计读取不得与统计锁自身死锁
+    CHECK(!cache.getStatsAsJSON().empty());
+
+    StatsReporter::Config config;
+    config.path = (dir / "stats.jsonl").string();
+    config.interval_ms = 5;
+    config.max_file_bytes = 512;
+    config.max_files = 2;
+    {
+        StatsReporter reporter(config);
+        reporter.addSource("cache", [&cache] { return cache.getStats(); });
+        reporter.start();
+        for (int i = 0; i < 20; ++i) {
+            reporter.requestSnapshot();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        reporter.stop();
+        CHECK(reporter.writtenSnapshots() > 0);
+    }
+
+    // 小文件上限应触发轮转，且每行都是独立的JSON对象
+    CHECK(fs::exists(dir / "stats.jsonl"));
+    CHECK(fs::exists(dir / "stats.jsonl.1"));
+    CHECK(!fs::exists(dir / "stats.jsonl.3"));
+    std::ifstream in(dir / "stats.jsonl");
+    std::string line;
+    Json::Reader reader;
+    int lines = 0;
+    while (std::getline(in, line)) {
+        Json::Value value;
+        CHECK(reader.parse(line, value));
+        CHECK(value.isMember("cache"));
+        ++lines;
+    }
+    CHECK(lines > 0);
+    fs::remove_all(dir);
+}
+
+static void test_disk_tier() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "bev_disk_tier_test";
+    fs::remove_all(dir);
+
+    BEVCompressor compressor(BEVCompressor::Config{});
+    DiskBlockStore::Config disk_config;
+    disk_config.directory = dir.string();
+    disk_config.segment_bytes = 64 << 10;
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 256;
+        config.disk_tier = std::make_shared<DiskBlockStore>(disk_config);
+        BEVCache cache(config);
+        cache.insertPackets(make_stream(compressor, 3, 1000));
+        config.disk_tier->flush();
+
+        // 前两帧已被淘汰到磁盘，检索时应从二级缓存命中
+        std::vector<uint8_t> data;
+        uint16_t rows = 0, cols = 0;
+        CHECK(!cache.peek(1000, 16, 16, data, rows, cols));
+        CHECK(cache.retrieve(1000, 16, 16, data, rows, cols));
+        CHECK(rows == 16 && !data.empty());
+        CHECK(cache.getStats()["disk_tier_hits"].asUInt64() == 1);
+        // 提升后应已回到内存
+        CHECK(cache.peek(1000, 16, 16, data, rows, cols));
+    }
+
+    // 重启后从段文件恢复索引；总大小上限触发GC删除最旧段
+    disk_config.max_total_bytes = 128 << 10;
+    DiskBlockStore store(disk_config);
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    CHECK(store.get(BEVBlockKey{1040, 240, 240}, data, rows, cols));
+    CHECK(rows == 16 && cols == 16);
+    store.collectGarbage();
+    CHECK(store.getStats()["total_bytes"].asUInt64() <= (128u << 10) + (64u << 10));
+
+    // 按时间GC由后台定时执行：没有新段创建时过期数据同样被删除
+    fs::path aged_dir = dir / "aged";
+    DiskBlockStore::Config aged_config;
+    aged_config.directory = aged_dir.string();
+    aged_config.max_age_seconds = 1;
+    aged_config.gc_interval_ms = 50;
+    aged_config.recover_existing = false;
+    DiskBlockStore aged(aged_config);
+    aged.put(BEVBlockKey{7000, 0, 0}, 16, 16, BEVBlockCodec{}, std::vector<uint8_t>(100, 7));
+    aged.flush();
+    CHECK(aged.get(BEVBlockKey{7000, 0, 0}, data, rows, cols));
+    CHECK(data == std::vector<uint8_t>(100, 7));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (aged.getStats()["segments_collected"].asUInt64() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(aged.getStats()["segments_collected"].asUInt64() == 1);
+    CHECK(!aged.get(BEVBlockKey{7000, 0, 0}, data, rows, cols));
+    CHECK(aged.getStats()["indexed_blocks"].asUInt64() == 0);
+
+    // 索引只存块位置：边缘块的行列数由帧范围推出，与写入顺序无关；同位置不同层级的块互不覆盖
+    fs::path grid_dir = dir / "grid";
+    DiskBlockStore::Config grid_config;
+    grid_config.directory = grid_dir.string();
+    std::vector<BEVBlockKey> keys;
+    for (int i = 0; i < 100; i += 16) {
+        for (int j = 0; j < 72; j += 16) {
+            keys.push_back(BEVBlockKey{8000, static_cast<uint16_t>(i), static_cast<uint16_t>(j)});
+        }
+    }
+    std::reverse(keys.begin(), keys.end());  // 先写入右下角的边缘块
+    std::swap(keys[3], keys[20]);
+    {
+        DiskBlockStore grid(grid_config);
+        for (const BEVBlockKey& key : keys) {
+            const uint16_t r = static_cast<uint16_t>(std::min(16, 100 - key.x));
+            const uint16_t c = static_cast<uint16_t>(std::min(16, 72 - key.y));
+            grid.put(key, r, c, compressor.block_codec(), std::vector<uint8_t>(8, static_cast<uint8_t>(key.x + key.y)));
+        }
+        grid.put(BEVBlockKey{8000, 0, 0, 1}, 16, 16, compressor.block_codec(), std::vector<uint8_t>(8, 0xAB));
+        grid.flush();
+        CHECK(grid.getStats()["indexed_blocks"].asUInt64() == keys.size() + 1);
+    }
+    DiskBlockStore grid(grid_config);
+    for (const BEVBlockKey& key : keys) {
+        BEVBlockCodec codec;
+        CHECK(grid.get(key, data, rows, cols, &codec));
+        CHECK(rows == std::min(16, 100 - key.x) && cols == std::min(16, 72 - key.y));
+        CHECK(codec == compressor.block_codec());
+        CHECK(data == std::vector<uint8_t>(8, static_cast<uint8_t>(key.x + key.y)));
+    }
+    CHECK(grid.get(BEVBlockKey{8000, 0, 0, 1}, data, rows, cols) && data[0] == 0xAB);
+    CHECK(!grid.get(BEVBlockKey{8000, 8, 0}, data, rows, cols));
+    CHECK(!grid.get(BEVBlockKey{8000, 112, 0}, data, rows, cols));
+    Json::Value grid_stats = grid.getStats();
+    CHECK(grid_stats["indexed_frames"].asUInt64() == 2);
+    CHECK(grid_stats["index_bytes"].asUInt64() < (keys.size() + 1) * 28);
+    fs::remove_all(dir);
+}
+
+static void test_snapshot() {
+    namespace fs = std::filesystem;
+    fs::path path = fs::temp_directory_path() / "bev_cache_test.snap";
+    fs::remove(path);
+
+    BEVCompressor compressor(BEVCompressor::Config{});
+    std::vector<uint8_t> original;
+    uint16_t rows = 0, cols = 0;
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 512;
+        config.snapshot_path = path.string();
+        config.snapshot_on_shutdown = true;
+        BEVCache cache(config);
+        cache.insertPackets(make_stream(compressor, 2, 2000));
+        CHECK(cache.peek(2040, 32, 48, original, rows, cols));
+    }
+    CHECK(fs::exists(path));
+
+    // 重启后首次访问直接从映射的快照命中并提升到内存
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 400;
+        config.snapshot_path = path.string();
+        BEVCache cache(config);
+        std::vector<uint8_t> data;
+        CHECK(!cache.peek(2040, 32, 48, data, rows, cols));
+        CHECK(cache.retrieve(2040, 32, 48, data, rows, cols));
+        CHECK(data == original && rows == 16);
+        CHECK(cache.getStats()["snapshot_hits"].asUInt64() == 1);
+        CHECK(cache.peek(2040, 32, 48, data, rows, cols));
+
+        // 预热只填充剩余容量，优先最近使用的块
+        CHECK(cache.warmFromSnapshot(1000) == 399);
+        CHECK(cache.peek(2040, 240, 240, data, rows, cols));
+        CHECK(!cache.peek(2000, 0, 0, data, rows, cols));
+    }
+
+    // 快照之后重新插入内容不同的块：淘汰后不再从快照取回旧数据；磁盘中较新的数据优先于快照
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 256;
+        config.snapshot_path = path.string();
+        BEVCache cache(config);
+        BEVFeaturePacket packet;
+        packet.feature = Eigen::MatrixXf::Constant(256, 256, -7.0f);
+        packet.timestamp = 2040;
+        std::vector<uint8_t> stream = compressor.compress({packet});
+        cache.insertPackets(stream);
+        std::vector<uint8_t> replaced;
+        CHECK(cache.peek(2040, 32, 48, replaced, rows, cols));
+        CHECK(replaced != original);
+        cache.insertPackets(make_stream(compressor, 1, 3000));  // 淘汰2040帧
+        std::vector<uint8_t> data;
+        CHECK(!cache.peek(2040, 32, 48, data, rows, cols));
+        CHECK(!cache.retrieve(2040, 32, 48, data, rows, cols));
+        CHECK(cache.retrieve(2000, 32, 48, data, rows, cols));  // 未被取代的条目仍可命中
+
+        fs::path dir = fs::temp_directory_path() / "bev_snapshot_disk_test";
+        fs::remove_all(dir);
+        DiskBlockStore::Config disk_config;
+        disk_config.directory = dir.string();
+        config.disk_tier = std::make_shared<DiskBlockStore>(disk_config);
+        config.disk_tier->put(BEVBlockKey{2040, 32, 48}, 16, 16, compressor.block_codec(), std::vector<uint8_t>(replaced));
+        config.disk_tier->flush();
+        BEVCache tiered(config);
+        CHECK(tiered.retrieve(2040, 32, 48, data, rows, cols));
+        CHECK(data == replaced);
+        CHECK(tiered.getStats()["disk_tier_hits"].asUInt64() == 1);
+        CHECK(tiered.getStats()["snapshot_hits"].asUInt64() == 0);
+        fs::remove_all(dir);
+    }
+
+    // 快照写入期间被淘汰的块：数据被钉住，写出的快照内容完整
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 256;
+        BEVCache cache(config);
+        cache.insertPackets(make_stream(compressor, 1, 4000));
+        fs::path saved = fs::temp_directory_path() / "bev_cache_test_pinned.snap";
+        std::thread writer([&] { cache.saveSnapshot(saved.string()); });
+        cache.insertPackets(make_stream(compressor, 2, 5000));
+        writer.join();
+        // 解除钉住后被淘汰的数据随之释放：只剩最后一帧的一份去重数据
+        CHECK(cache.getStats()["unique_payloads"].asUInt64() == 1);
+        BEVCache reloaded(config);
+        CHECK(reloaded.loadSnapshot(saved.string()));
+        CHECK(reloaded.warmFromSnapshot(1000) == 256);
+        fs::remove(saved);
+    }
+
+    // 替换失败（目标是非空目录）时抛出异常，不留下临时文件
+    {
+        BEVCache::BEVCacheConfig config;
+        BEVCache cache(config);
+        cache.insertPackets(make_stream(compressor, 1, 6000));
+        fs::path blocked = fs::temp_directory_path() / "bev_cache_test_blocked.snap";
+        fs::remove_all(blocked);
+        fs::create_directories(blocked / "occupied");
+        bool threw = false;
+        try {
+            cache.saveSnapshot(blocked.string());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(!fs::exists(blocked.string() + ".tmp"));
+        fs::remove_all(blocked);
+    }
+
+    // 损坏的快照被忽略
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not a snapshot";
+    }
+    BEVCache::BEVCacheConfig config;
+    config.snapshot_path = path.string();
+    BEVCache cache(config);
+    CHECK(!cache.loadSnapshot(path.string()));
+    CHECK(cache.warmFromSnapshot(10) == 0);
+    fs::remove(path);
+}
+
+static void test_uplink() {
+    namespace fs = std::filesystem;
+    fs::path path = fs::temp_directory_path() / "bev_uplink_test.bin";
+
+    BEVCompressor compressor(BEVCompressor::Config{});
+    std::vector<uint8_t> stream = make_stream(compressor, 2, 3000);
+
+    UplinkPacketizer::Config config;
+    config.bytes_per_second = 256 << 10;
+    config.burst_bytes = 8 << 10;
+    config.ego_row = 128.0f;
+    config.ego_col = 128.0f;
+    config.activity_weight = 0.0f;  // 只按ROI排序
+    Json::Value stats;
+    auto start = std::chrono::steady_clock::now();
+    {
+        UplinkPacketizer uplink(config, std::make_shared<FileUplinkSink>(path.string()));
+        CHECK(uplink.submit(stream) > 0);
+        uplink.flush();
+        CHECK(uplink.retransmit(0));
+        CHECK(!uplink.retransmit(1u << 30));
+        uplink.flush();
+        stats = uplink.getStats();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 令牌桶限速：扣除突发量后发送时间不少于 字节数/速率
+    const double bytes_sent = stats["bytes_sent"].asDouble();
+    CHECK(elapsed >= (bytes_sent - config.burst_bytes) / config.bytes_per_second * 0.9);
+    CHECK(stats["frames_delivered"].asUInt64() == 2);
+    CHECK(stats["retransmissions"].asUInt64() == 1);
+    CHECK(stats["goodput_bps"].asDouble() <= config.bytes_per_second * 1.5);
+
+    // 接收端：所有包不超过MTU且自包含，按序号去重后恰好覆盖全部块；自车附近的块最先发出
+    std::ifstream in(path, std::ios::binary);
+    std::set<uint32_t> sequences;
+    std::set<std::tuple<uint64_t, uint32_t, uint32_t>> blocks;
+    size_t packets = 0, duplicates = 0;
+    bool first = true;
+    uint32_t length = 0;
+    while (in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        std::vector<uint8_t> packet(length);
+        in.read(reinterpret_cast<char*>(packet.data()), length);
+        UplinkPacketizer::PacketHeader header;
+        std::vector<UplinkPacketizer::PacketBlock> parsed;
+        CHECK(UplinkPacketizer::parsePacket(packet.data(), packet.size(), header, parsed));
+        CHECK(packet.size() <= config.mtu_bytes);
+        ++packets;
+        if (!sequences.insert(header.sequence).second) {
+            ++duplicates;
+            CHECK(header.flags & UplinkPacketizer::FLAG_RETRANSMIT);
+            continue;
+        }
+        if (first) {
+            CHECK(parsed.front().header.row_offset == 112 || parsed.front().header.row_offset == 128);
+            CHECK(parsed.front().header.col_offset == 112 || parsed.front().header.col_offset == 128);
+            first = false;
+        }
+        for (const auto& block : parsed) {
+            blocks.emplace(header.timestamp, block.header.row_offset, block.header.col_offset);
+        }
+    }
+    CHECK(duplicates == 1);
+    CHECK(packets == stats["packets_sent"].asUInt64());
+    CHECK(blocks.size() == 2u * 256);
+    fs::remove(path);
+
+    // UDP回环
+    int rx = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (rx >= 0 && ::bind(rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        ::getsockname(rx, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0) {
+        int rcvbuf = 4 << 20;
+        ::setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        UplinkPacketizer::Config udp_config;
+        udp_config.bytes_per_second = 4 << 20;
+        UplinkPacketizer uplink(udp_config, std::make_shared<UdpUplinkSink>("127.0.0.1", ntohs(addr.sin_port)));
+        size_t sent = uplink.submit(make_stream(compressor, 1, 5000));
+        uplink.flush();
+        size_t received = 0;
+        std::vector<uint8_t> buffer(65536);
+        while (::recv(rx, buffer.data(), buffer.size(), MSG_DONTWAIT) > 0) {
+            ++received;
+        }
+        CHECK(received == sent);
+    }
+    if (rx >= 0) {
+        ::close(rx);
+    }
+}
+
+static void test_replay() {
+    // 40帧@25fps（1.6秒数据）以20倍速回放，缓存足够大时最新帧与历史帧都应全部命中
+    BEVDataGenerator generator;
+    BEVDataGenerator::ScenarioConfig scenario;
+    scenario.rows = 64;
+    scenario.cols = 64;
+    const std::string path = "test_replay_frames.bin";
+    generator.generate_to_file(scenario, 40, path);
+
+    ReplayHarness::Config config;
+    config.input_path = path;
+    config.speed = 20.0;
+    config.compressor.block_size = 16;
+    config.compressor.compression_ratio = 4.0f;
+    config.cache_size = 4096;
+    config.reader_threads = {{1, 1, 1}};
+    config.window_frames = 5;
+    Json::Value report = ReplayHarness(config).run();
+
+    CHECK(report["frames"].asUInt() == 40);
+    CHECK(report["media_s"].asDouble() > 1.5 && report["media_s"].asDouble() < 1.6);
+    CHECK(report["ingest"]["realtime_factor"].asDouble() > 10.0);
+    CHECK(report["ingest"]["realtime_factor"].asDouble() < 21.0);
+    CHECK(report["lag_ms"]["p50"].asDouble() >= 0.0);
+    for (const char* name : {"latest", "sliding_window", "random_history"}) {
+        const Json::Value& reader = report["readers"][name];
+        CHECK(reader["reads"].asUInt64() > 0);
+        CHECK(reader["block_hit_rate"].asDouble() == 1.0);
+        CHECK(reader["latency_us"]["p50"].asDouble() <= reader["latency_us"]["p99"].asDouble());
+        CHECK(reader["latency_us"]["p99"].asDouble() <= reader["latency_us"]["max"].asDouble());
+    }
+
+    // 不限速、只回放一部分帧时没有滞后统计
+    config.speed = 0.0;
+    config.max_frames = 10;
+    config.reader_threads = {{0, 0, 1}};
+    report = ReplayHarness(config).run();
+    CHECK(report["frames"].asUInt() == 10);
+    CHECK(!report.isMember("lag_ms"));
+    CHECK(report["readers"]["latest"]["reads"].asUInt64() == 0);
+    std::filesystem::remove(path);
+}
+
+static void test_dedup() {
+    // 常量帧：每帧256个块内容相同，每帧只存一份（码率32保证不同帧的数据不同）
+    BEVCompressor::Config compressor_config;
+    compressor_config.compression_ratio = 32.0f;
+    BEVCompressor compressor(compressor_config);
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache cache(config);
+    const std::vector<uint8_t> stream = make_stream(compressor, 2, 1000);
+    cache.insertPackets(stream);
+
+    Json::Value stats = cache.getStats();
+    CHECK(stats["cache_size"].asUInt64() == 512);
+    CHECK(stats["unique_payloads"].asUInt64() == 2);
+    CHECK(stats["dedup_hits"].asUInt64() == 510);
+    CHECK(stats["dedup_ratio"].asDouble() == 256.0);
+    const uint64_t logical = stats["logical_bytes"].asUInt64();
+
+    std::vector<uint8_t> a, b;
+    uint16_t rows = 0, cols = 0;
+    CHECK(cache.retrieve(1000, 0, 0, a, rows, cols));
+    CHECK(cache.retrieve(1000, 240, 16, b, rows, cols));
+    CHECK(!a.empty() && a == b);
+    CHECK(cache.retrieve(1040, 0, 0, b, rows, cols) && a != b);
+
+    // 重复插入同键：替换旧项，引用计数不增长
+    cache.insertPackets(stream);
+    stats = cache.getStats();
+    CHECK(stats["unique_payloads"].asUInt64() == 2);
+    CHECK(stats["logical_bytes"].asUInt64() == logical);
+
+    // 按字节限容：去重后同样的内存能容纳多得多的块
+    const uint64_t payload_bytes = a.size();
+    for (bool dedup : {true, false}) {
+        BEVCache::BEVCacheConfig limited;
+        limited.max_cache_size = 1 << 20;
+        limited.max_cache_bytes = 4 * payload_bytes;
+        limited.dedup = dedup;
+        BEVCache bounded(limited);
+        bounded.insertPackets(make_stream(compressor, 6, 5000));
+        Json::Value s = bounded.getStats();
+        CHECK(s["stored_bytes"].asUInt64() <= 4 * payload_bytes);
+        CHECK(s["cache_size"].asUInt64() == (dedup ? 4u * 256 : 4u));
+        CHECK(bounded.peek(5200, 240, 240, a, rows, cols));
+        CHECK(!bounded.peek(5000, 0, 0, a, rows, cols));
+    }
+
+    // 淘汰到磁盘二级缓存时共享数据被复制出来，其余引用不受影响
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "bev_cache_dedup_test";
+    fs::remove_all(dir);
+    DiskBlockStore::Config disk_config;
+    disk_config.directory = dir.string();
+    {
+        BEVCache::BEVCacheConfig tiered;
+        tiered.max_cache_size = 300;
+        tiered.disk_tier = std::make_shared<DiskBlockStore>(disk_config);
+        BEVCache cache2(tiered);
+        cache2.insertPackets(make_stream(compressor, 2, 1000));
+        tiered.disk_tier->flush();
+        std::vector<uint8_t> evicted, resident;
+        CHECK(cache2.retrieve(1000, 0, 0, evicted, rows, cols));
+        CHECK(cache2.peek(1000, 240, 240, resident, rows, cols));
+        CHECK(evicted == resident);
+    }
+    fs::remove_all(dir);
+}
+
+static void test_pyramid_levels() {
+    BEVCompressor::Config compressor_config;
+    compressor_config.compression_ratio = 32.0f;
+    compressor_config.pyramid_levels = 3;
+    BEVCompressor compressor(compressor_config);
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(256, 256);
+    packet.timestamp = 1000;
+    const std::vector<uint8_t> stream = compressor.compress({packet});
+
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache cache(config);
+    cache.insertPackets(stream);
+    CHECK(cache.getStats()["cache_size"].asUInt64() == 256 + 64 + 16);
+
+    // 粗层的概览只检索该层的块
+    Eigen::MatrixXf overview(64, 64);
+    std::vector<BEVCache::CacheKey> misses;
+    CHECK(cache.retrieveRegion(1000, 2, 0, 0, compressor, overview, &misses) == 16);
+    CHECK(misses.empty());
+    CHECK(overview == compressor.decompress_level(stream, 2)[0].feature);
+
+    // 原始分辨率下的任意区域
+    Eigen::MatrixXf region(20, 40);
+    CHECK(cache.retrieveRegion(1000, 0, 10, 100, compressor, region) == 2 * 3);
+    CHECK(region == compressor.decompress(stream)[0].feature.block(10, 100, 20, 40));
+
+    // 容量紧张时粗层驻留更久：旧帧的原始分辨率块先被挤掉，之后宁可淘汰新帧最久未用的
+    // 原始分辨率块，也保留旧帧的粗层
+    BEVCache::BEVCacheConfig small;
+    small.max_cache_size = 400;
+    BEVCache bounded(small);
+    bounded.insertPackets(stream);
+    packet.timestamp = 2000;
+    bounded.insertPackets(compressor.compress({packet}));
+    CHECK(bounded.retrieveRegion(1000, 2, 0, 0, compressor, overview) == 16);
+    std::vector<uint8_t> data;
+    uint16_t rows = 0, cols = 0;
+    CHECK(!bounded.peek(1000, 240, 240, data, rows, cols));
+    CHECK(bounded.peek(2000, 240, 240, data, rows, cols));
+    CHECK(bounded.getStats()["cache_size"].asUInt64() == 400);
+}
+
+static void test_shared_insert() {
+    BEVCompressor::Config compressor_config;
+    compressor_config.compression_ratio = 32.0f;
+    BEVCompressor compressor(compressor_config);
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(256, 256);
+    packet.timestamp = 1000;
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(compressor.compress({packet}));
+
+    BEVCache::BEVCacheConfig config;
+    config.max_cache_size = 1024;
+    BEVCache copied(config);
+    copied.insertPackets(*buffer);
+    {
+        BEVCache shared(config);
+        shared.insertPackets(buffer);
+        CHECK(buffer.use_count() == 1 + 256);
+        Json::Value stats = shared.getStats();
+        CHECK(stats["shared_payloads"].asUInt64() == 256);
+        CHECK(stats["stored_bytes"].asUInt64() == copied.getStats()["stored_bytes"].asUInt64());
+
+        // 与拷贝插入的读取结果逐字节一致
+        std::vector<uint8_t> a, b;
+        uint16_t rows = 0, cols = 0;
+        CHECK(shared.retrieve(1000, 128, 64, a, rows, cols) && rows == 16 && cols == 16);
+        CHECK(copied.retrieve(1000, 128, 64, b, rows, cols) && a == b);
+        Eigen::MatrixXf frame(256, 256);
+        CHECK(shared.retrieveFrame(1000, compressor, frame) == 256);
+        CHECK(frame == compressor.decompress(*buffer)[0].feature);
+
+        // 别的时间戳拷贝插入相同内容：复用共享数据，不新增引用
+        std::vector<uint8_t> other = *buffer;
+        std::memcpy(other.data() + BEVCompressor::STREAM_HEADER_BYTES, "\x01\x02", 2);  // 改写帧时间戳
+        shared.insertPackets(other);
+        CHECK(shared.getStats()["shared_payloads"].asUInt64() == 256);
+        CHECK(shared.getStats()["dedup_hits"].asUInt64() == 256);
+        CHECK(buffer.use_count() == 1 + 256);
+    }
+    CHECK(buffer.use_count() == 1);
+
+    // 缓冲区中不属于存活块的字节（流头、块头）计入pinned_buffer_bytes
+    config.max_cache_size = 300;
+    BEVCache evicting(config);
+    evicting.insertPackets(buffer);
+    Json::Value stats = evicting.getStats();
+    CHECK(stats["stored_bytes"].asUInt64() + stats["pinned_buffer_bytes"].asUInt64() == buffer->size());
+
+    // 大部分块被淘汰后拷出剩余的块，被淘汰批次的缓冲区随即释放
+    packet.timestamp = 2000;
+    packet.feature = Eigen::MatrixXf::Random(256, 256);
+    evicting.insertPackets(compressor.compress({packet}));
+    stats = evicting.getStats();
+    CHECK(buffer.use_count() == 1);
+    CHECK(stats["compacted_buffers"].asUInt64() == 1);
+    CHECK(stats["shared_payloads"].asUInt64() == 0);
+    CHECK(stats["pinned_buffer_bytes"].asUInt64() == 0);
+    std::vector<uint8_t> survivor, expected;
+    uint16_t rows = 0, cols = 0;
+    CHECK(evicting.peek(1000, 240, 240, survivor, rows, cols));
+    CHECK(copied.peek(1000, 240, 240, expected, rows, cols) && survivor == expected);
+
+    // 字节上限同样计入被占住的缓冲区：放得下整个缓冲区时零拷贝并淘汰其他数据，放不下时退回拷贝插入
+    BEVCache::BEVCacheConfig bytes_config;
+    bytes_config.max_cache_bytes = buffer->size() + buffer->size() / 2;
+    BEVCache bounded(bytes_config);
+    bounded.insertPackets(compressor.compress({packet}));
+    bounded.insertPackets(buffer);
+    stats = bounded.getStats();
+    CHECK(stats["shared_payloads"].asUInt64() == 256);
+    CHECK(stats["stored_bytes"].asUInt64() + stats["pinned_buffer_bytes"].asUInt64() <= bytes_config.max_cache_bytes);
+    CHECK(stats["total_evictions"].asUInt64() > 0);
+    bytes_config.max_cache_bytes = buffer->size() / 2;
+    BEVCache small(bytes_config);
+    small.insertPackets(buffer);
+    stats = small.getStats();
+    CHECK(stats["shared_payloads"].asUInt64() == 0);
+    CHECK(stats["stored_bytes"].asUInt64() <= bytes_config.max_cache_bytes);
+    CHECK(stats["cache_size"].asUInt64() > 100);
+    CHECK(buffer.use_count() == 1 + 256);  // 只有bounded仍持有
+}
+
+static void test_shared_memory_cache() {
+    BEVCompressor::Config compressor_config;
+    compressor_config.compression_ratio = 32.0f;
+    BEVCompressor compressor(compressor_config);
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(256, 256);
+    packet.timestamp = 1000;
+
+    const std::string name = "/bev_test_shm_" + std::to_string(getpid());
+    SharedBEVCache::Config config;
+    config.name = name;
+    config.data_bytes = 4 << 20;
+    config.max_items = 4096;
+    auto cache = SharedBEVCache::create(config);
+    CHECK(cache->insertPackets(compressor.compress({packet})) == 256);
+    bool threw = false;
+    try {
+        SharedBEVCache::create(config);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // visit直接给出共享内存中的数据，retrieve拷贝出相同的字节
+    std::vector<uint8_t> seen;
+    CHECK(cache->visit({1000, 128, 64}, [&](const uint8_t* data, size_t size, uint16_t rows, uint16_t cols, const BEVBlockCodec&) {
+        seen.assign(data, data + size);
+        CHECK(rows == 16 && cols == 16);
+    }));
+    std::vector<uint8_t> copied;
+    uint16_t rows = 0, cols = 0;
+    CHECK(cache->retrieve(1000, 128, 64, copied, rows, cols) && copied == seen);
+    CHECK(!cache->visit({1000, 128, 65}, [](const uint8_t*, size_t, uint16_t, uint16_t, const BEVBlockCodec&) {}));
+
+    // 另一个进程按名称映射：读出本进程插入的帧，并插入新帧
+    BEVFeaturePacket second;
+    second.feature = Eigen::MatrixXf::Random(256, 256);
+    second.timestamp = 2000;
+    const pid_t pid = fork();
+    if (pid == 0) {
+        int code = 0;
+        try {
+            auto peer = SharedBEVCache::open(name);
+            // 子进程不进入OpenMP并行区（fork前父进程的线程组在子进程中不存在），逐块解码
+            Eigen::MatrixXf frame = Eigen::MatrixXf::Zero(256, 256);
+            for (int i = 0; i < 256; i += 16) {
+                for (int j = 0; j < 256; j += 16) {
+                    const SharedBEVCache::CacheKey key{1000, static_cast<uint16_t>(i), static_cast<uint16_t>(j)};
+                    peer->visit(key, [&](const uint8_t* data, size_t size, uint16_t r, uint16_t c,
+                                         const BEVBlockCodec& codec) {
+                        compressor.decode_block(codec, data, size, frame.block(i, j, r, c));
+                    });
+                }
+            }
+            if (frame != packet.feature) code = 1;
+            else if (peer->insertPackets(compressor.compress({second})) != 256) code = 2;
+        } catch (const std::exception&) {
+            code = 3;
+        }
+        _exit(code);
+    }
+    int status = 0;
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(cache->size() == 512);
+    Eigen::MatrixXf frame(256, 256);
+    CHECK(cache->retrieveFrame(2000, compressor, frame) == 256);
+    CHECK(frame == second.feature);
+    Json::Value stats = cache->getStats();
+    CHECK(stats["hits"].asUInt64() == 2 + 256 + 256);
+    CHECK(stats["inserts"].asUInt64() == 512);
+
+    // 损坏的块：释放读锁后解码失败，按未命中返回并计入decode_errors
+    BEVCompressor::Config shuffle_config;
+    shuffle_config.lossless = true;
+    shuffle_config.lossless_codec = BEVCompressor::Config::LOSSLESS_SHUFFLE;
+    BEVCompressor shuffle(shuffle_config);
+    packet.timestamp = 2500;
+    CHECK(cache->insertPackets(shuffle.compress({packet})) == 256);
+    const std::vector<uint8_t> garbage(64, 0xEE);
+    CHECK(cache->insert({2500, 0, 16}, 16, 16, shuffle.block_codec(), garbage.data(), garbage.size()));
+    Eigen::MatrixXf corrupt_frame = Eigen::MatrixXf::Zero(256, 256);
+    std::vector<SharedBEVCache::CacheKey> corrupt_misses;
+    CHECK(cache->retrieveFrame(2500, shuffle, corrupt_frame, &corrupt_misses) == 255);
+    CHECK(corrupt_misses.size() == 1 && corrupt_misses[0].x == 0 && corrupt_misses[0].y == 16);
+    CHECK(corrupt_frame.block(0, 0, 16, 16) == packet.feature.block(0, 0, 16, 16));
+    CHECK(corrupt_frame.block(0, 16, 16, 16).isZero());
+    stats = cache->getStats();
+    CHECK(stats["decode_errors"].asUInt64() == 1);
+    CHECK(stats["misses"].asUInt64() == 1 + 1);
+
+    // 创建者析构后命名对象被删除
+    cache.reset();
+    threw = false;
+    try {
+        SharedBEVCache::open(name);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // memfd匿名区域：第二个映射看到同一份数据；数据区只有两页时按CLOCK淘汰最早的块
+    SharedBEVCache::Config small;
+    small.data_bytes = 2 * SharedBEVCache::PAGE_SIZE;
+    small.max_items = 4096;
+    auto anon = SharedBEVCache::create(small);
+    auto mapped = SharedBEVCache::openFd(anon->fd());
+    for (int t = 0; t < 4; ++t) {
+        packet.timestamp = 3000 + t * 40;
+        anon->insertPackets(compressor.compress({packet}));
+    }
+    stats = mapped->getStats();
+    CHECK(stats["inserts"].asUInt64() == 1024);
+    CHECK(stats["evictions"].asUInt64() > 0);
+    CHECK(stats["items"].asUInt64() + stats["evictions"].asUInt64() == 1024);
+    CHECK(stats["alloc_failures"].asUInt64() == 0);
+    CHECK(stats["pages_in_use"].asUInt() <= 2);
+    CHECK(stats["slab_bytes"].asUInt64() <= small.data_bytes);
+    CHECK(mapped->contains({3120, 240, 240}));
+    CHECK(!mapped->contains({3000, 0, 0}));
+    anon.reset();
+    CHECK(mapped->size() == stats["items"].asUInt64());
+
+    // 超过最大尺寸类别的块被跳过
+    std::vector<uint8_t> huge(SharedBEVCache::PAGE_SIZE + 1);
+    CHECK(!mapped->insert({4000, 0, 0}, 16, 16, BEVBlockCodec{}, huge.data(), huge.size()));
+    CHECK(mapped->getStats()["alloc_failures"].asUInt64() == 1);
+    mapped.reset();
+
+    // 混合尺寸淘汰：四页全是64B小块时插入大块，只淘汰一页的小块，不会先淘汰掉大半个缓存
+    SharedBEVCache::Config mixed_config;
+    mixed_config.data_bytes = 4 * SharedBEVCache::PAGE_SIZE;
+    mixed_config.max_items = 8192;
+    auto mixed = SharedBEVCache::create(mixed_config);
+    const uint32_t per_page = SharedBEVCache::PAGE_SIZE / SharedBEVCache::MIN_CHUNK;
+    const std::vector<uint8_t> small_block(48, 1);
+    const std::vector<uint8_t> large_block(40000, 2);
+    for (uint32_t k = 0; k < 4 * per_page; ++k) {
+        CHECK(mixed->insert({5000, static_cast<uint16_t>(k), 0}, 4, 4, BEVBlockCodec{}, small_block.data(), small_block.size()));
+    }
+    CHECK(mixed->insert({6000, 0, 0}, 64, 64, BEVBlockCodec{}, large_block.data(), large_block.size()));
+    CHECK(mixed->getStats()["evictions"].asUInt64() == per_page);
+    // 读过奇数键后引用位交错分布在每一页上：逐条CLOCK淘汰要清掉所有偶数键后才能空出一页
+    for (uint32_t k = per_page; k < 4 * per_page; k += 2) {
+        mixed->visit({5000, static_cast<uint16_t>(k + 1), 0}, [](const uint8_t*, size_t, uint16_t, uint16_t, const BEVBlockCodec&) {});
+    }
+    CHECK(mixed->insert({6000, 1, 0}, 64, 64, BEVBlockCodec{}, large_block.data(), large_block.size()));
+    stats = mixed->getStats();
+    CHECK(stats["evictions"].asUInt64() == 2 * per_page);
+    CHECK(stats["items"].asUInt64() == 2 * per_page + 2);
+    CHECK(stats["pages_in_use"].asUInt() == 4);
+    // 同尺寸类别的块只淘汰一个条目
+    CHECK(mixed->insert({7000, 0, 0}, 4, 4, BEVBlockCodec{}, small_block.data(), small_block.size()));
+    CHECK(mixed->getStats()["evictions"].asUInt64() == 2 * per_page + 1);
+    CHECK(mixed->contains({6000, 0, 0}) && mixed->contains({6000, 1, 0}) && mixed->contains({7000, 0, 0}));
+
+    // 区域头中的表越界时拒绝映射（num_pages位于Header偏移32处）
+    const uint32_t bogus_pages = 1u << 20;
+    CHECK(::pwrite(mixed->fd(), &bogus_pages, sizeof(bogus_pages), 32) == sizeof(bogus_pages));
+    threw = false;
+    try {
+        SharedBEVCache::openFd(mixed->fd());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// 写入方与读取方的压缩配置不同：各级缓存与上行报文都按块自带的编码方式解码
+static void test_mixed_codecs() {
+    namespace fs = std::filesystem;
+    BEVCompressor::Config writer_config;
+    writer_config.lossless = true;
+    writer_config.lossless_codec = BEVCompressor::Config::LOSSLESS_SHUFFLE;
+    BEVCompressor writer(writer_config);
+    BEVCompressor reader(BEVCompressor::Config{});  // 默认有损ZFP配置
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(256, 256);
+    packet.timestamp = 6000;
+    const std::vector<uint8_t> stream = writer.compress({packet});
+    // 读取方配置写出的有损块，由写入方配置的压缩器解码，结果应与读取方自身解码相同
+    const std::vector<uint8_t> lossy = make_stream(reader, 1, 6040);
+    const Eigen::MatrixXf lossy_expected = reader.decompress(lossy)[0].feature;
+
+    fs::path dir = fs::temp_directory_path() / "bev_mixed_codec_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const std::string snapshot_path = (dir / "cache.snap").string();
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 512;
+        DiskBlockStore::Config disk_config;
+        disk_config.directory = (dir / "l2").string();
+        config.disk_tier = std::make_shared<DiskBlockStore>(disk_config);
+        BEVCache cache(config);
+        cache.insertPackets(stream);
+        cache.insertPackets(lossy);
+        Eigen::MatrixXf frame(256, 256);
+        CHECK(cache.retrieveFrame(6000, reader, frame) == 256);
+        CHECK(frame == packet.feature);
+        CHECK(cache.retrieveFrame(6040, writer, frame) == 256);
+        CHECK(frame == lossy_expected);
+        std::vector<uint8_t> data;
+        uint16_t rows = 0, cols = 0;
+        BEVBlockCodec codec;
+        CHECK(cache.peek(6000, 16, 32, data, rows, cols, &codec));
+        CHECK(codec == writer.block_codec() && codec.codec == BEVCompressor::CODEC_SHUFFLE_LZ);
+        cache.saveSnapshot(snapshot_path);
+
+        // 淘汰到磁盘后取回：编码方式随记录保存
+        cache.insertPackets(make_stream(reader, 1, 6080));
+        config.disk_tier->flush();
+        CHECK(cache.retrieveFrame(6000, reader, frame) == 256);
+        CHECK(frame == packet.feature);
+        CHECK(cache.getStats()["disk_tier_hits"].asUInt64() == 256);
+    }
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 512;
+        config.snapshot_path = snapshot_path;
+        BEVCache cache(config);
+        Eigen::MatrixXf frame(256, 256);
+        CHECK(cache.retrieveFrame(6000, reader, frame) == 256);
+        CHECK(frame == packet.feature);
+        CHECK(cache.getStats()["snapshot_hits"].asUInt64() == 256);
+    }
+    fs::remove_all(dir);
+
+    // 共享内存缓存
+    SharedBEVCache::Config shm_config;
+    shm_config.data_bytes = 4 << 20;
+    auto shm = SharedBEVCache::create(shm_config);
+    CHECK(shm->insertPackets(stream) == 256);
+    Eigen::MatrixXf frame(256, 256);
+    CHECK(shm->retrieveFrame(6000, reader, frame) == 256);
+    CHECK(frame == packet.feature);
+
+    // 上行报文：包头带编码方式，接收端不需要发送端的配置
+    class CaptureSink : public UplinkSink {
+    public:
+        bool send(const uint8_t* data, size_t size) override {
+            packets.emplace_back(data, data + size);
+            return true;
+        }
+        std::vector<std::vector<uint8_t>> packets;
+    };
+    auto sink = std::make_shared<CaptureSink>();
+    {
+        UplinkPacketizer::Config uplink_config;
+        uplink_config.bytes_per_second = 64 << 20;
+        uplink_config.burst_bytes = 1 << 20;
+        UplinkPacketizer uplink(uplink_config, sink);
+        uplink.submit(stream);
+        uplink.flush();
+    }
+    Eigen::MatrixXf received = Eigen::MatrixXf::Zero(256, 256);
+    size_t received_blocks = 0;
+    for (const std::vector<uint8_t>& bytes : sink->packets) {
+        UplinkPacketizer::PacketHeader header;
+        std::vector<UplinkPacketizer::PacketBlock> blocks;
+        CHECK(UplinkPacketizer::parsePacket(bytes.data(), bytes.size(), header, blocks));
+        CHECK(header.block_codec() == writer.block_codec());
+        for (const auto& block : blocks) {
+            reader.decode_block(header.block_codec(), block.data, block.header.compressed_size,
+                                received.block(block.header.row_offset, block.header.col_offset,
+                                               block.header.block_rows, block.header.block_cols));
+            ++received_blocks;
+        }
+    }
+    CHECK(received_blocks == 256);
+    CHECK(received == packet.feature);
+}
+
+// 等待预取线程把issued推进到目标值（超时返回false）
+static bool wait_issued(const BEVPrefetcher& prefetcher, uint64_t target) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (prefetcher.getStats().issued < target) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static void test_prefetcher() {
+    BEVCompressor compressor(BEVCompressor::Config{});
+    BEVCache::BEVCacheConfig cache_config;
+    cache_config.max_cache_size = 4096;
+
+    // 顺序访问：连续前进min_confidence次后才开始时间方向预取，缓冲区命中计入缓存命中
+    {
+        BEVCache cache(cache_config);
+        cache.insertPackets(make_stream(compressor, 6, 1000));
+        BEVPrefetcher::Config config;
+        config.lookahead_frames = 2;
+        config.prefetch_neighbors = false;
+        BEVPrefetcher prefetcher(cache, compressor, config);
+
+        Eigen::MatrixXf block;
+        CHECK(prefetcher.get(1000, 0, 0, block));
+        CHECK(prefetcher.get(1040, 0, 0, block));
+        CHECK(prefetcher.get(1080, 0, 0, block));  // 第2次前进：预取1120、1160
+        CHECK(wait_issued(prefetcher, 2));
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 3);
+
+        CHECK(prefetcher.get(1120, 0, 0, block));  // 缓冲区命中，继续预取1200
+        std::vector<uint8_t> data;
+        uint16_t rows = 0, cols = 0;
+        CHECK(cache.peek(1120, 0, 0, data, rows, cols));
+        Eigen::MatrixXf expected(rows, cols);
+        compressor.decompress_block(data.data(), data.size(), expected);
+        CHECK(block == expected);
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 4);
+        CHECK(wait_issued(prefetcher, 3));
+        CHECK(prefetcher.get(1160, 0, 0, block));
+        CHECK(prefetcher.get(1200, 0, 0, block));
+
+        BEVPrefetcher::Stats stats = prefetcher.getStats();
+        CHECK(stats.issued == 3);
+        CHECK(stats.useful == 3);
+        CHECK(stats.wasted == 0);
+        CHECK(stats.demand_fetches == 3);
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 6);
+        CHECK(cache.getStats()["total_misses"].asUInt64() == 0);
+    }
+
+    // 缓冲区上限：超出的预取块按插入顺序淘汰并计为浪费
+    {
+        BEVCache cache(cache_config);
+        cache.insertPackets(make_stream(compressor, 8, 1000));
+        BEVPrefetcher::Config config;
+        config.max_decoded_blocks = 2;
+        config.lookahead_frames = 4;
+        config.prefetch_neighbors = false;
+        BEVPrefetcher prefetcher(cache, compressor, config);
+
+        Eigen::MatrixXf block;
+        CHECK(prefetcher.get(1000, 0, 0, block));
+        CHECK(prefetcher.get(1040, 0, 0, block));
+        CHECK(prefetcher.get(1080, 0, 0, block));  // 预取1120~1240，缓冲区只留最后2块
+        CHECK(wait_issued(prefetcher, 4));
+        CHECK(prefetcher.getStats().wasted == 2);
+
+        CHECK(prefetcher.get(1200, 0, 0, block));  // 命中，并预取1280
+        CHECK(wait_issued(prefetcher, 5));
+        CHECK(prefetcher.get(1240, 0, 0, block));
+        CHECK(prefetcher.get(1280, 0, 0, block));
+        CHECK(prefetcher.get(1120, 0, 0, block));  // 已被淘汰：同步读取
+
+        BEVPrefetcher::Stats stats = prefetcher.getStats();
+        CHECK(stats.issued == 5);
+        CHECK(stats.useful == 3);
+        CHECK(stats.wasted == 2);
+        CHECK(stats.demand_fetches == 4);
+        CHECK(stats.accuracy > 0.59 && stats.accuracy < 0.61);
+    }
+
+    // 预取解码之后缓存中的块被新内容替换：缓冲的旧结果作废，按未命中同步读取新内容
+    {
+        BEVCache cache(cache_config);
+        cache.insertPackets(make_stream(compressor, 4, 1000));
+        BEVPrefetcher::Config config;
+        config.lookahead_frames = 1;
+        config.prefetch_neighbors = false;
+        BEVPrefetcher prefetcher(cache, compressor, config);
+
+        Eigen::MatrixXf block;
+        CHECK(prefetcher.get(1000, 0, 0, block));
+        CHECK(prefetcher.get(1040, 0, 0, block));
+        CHECK(prefetcher.get(1080, 0, 0, block));  // 预取1120
+        CHECK(wait_issued(prefetcher, 1));
+        BEVFeaturePacket replaced;
+        replaced.feature = Eigen::MatrixXf::Constant(256, 256, 7.0f);
+        replaced.timestamp = 1120;
+        cache.insertPackets(compressor.compress({replaced}));
+
+        CHECK(prefetcher.get(1120, 0, 0, block));
+        std::vector<uint8_t> data;
+        uint16_t rows = 0, cols = 0;
+        BEVBlockCodec codec;
+        CHECK(cache.peek(1120, 0, 0, data, rows, cols, &codec));
+        Eigen::MatrixXf expected(rows, cols);
+        compressor.decode_block(codec, data.data(), data.size(), expected);
+        CHECK(block == expected);
+        BEVPrefetcher::Stats stats = prefetcher.getStats();
+        CHECK(stats.useful == 0 && stats.wasted == 1);
+        CHECK(stats.demand_fetches == 4);
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 4);
+    }
+
+    // 空间方向：同一帧内沿移动方向预取下一个相邻块
+    {
+        BEVCache cache(cache_config);
+        cache.insertPackets(make_stream(compressor, 1, 1000));
+        BEVPrefetcher::Config config;
+        BEVPrefetcher prefetcher(cache, compressor, config);
+
+        Eigen::MatrixXf block;
+        CHECK(prefetcher.get(1000, 0, 0, block));
+        CHECK(prefetcher.get(1000, 0, 16, block));  // 预取(0, 32)
+        CHECK(wait_issued(prefetcher, 1));
+        CHECK(prefetcher.get(1000, 0, 32, block));
+        CHECK(prefetcher.getStats().useful == 1);
+    }
+
+    // touch只更新LRU位置：被触及的旧块在淘汰时保留；块仍在缓存中且代次相同时才计入命中
+    {
+        BEVCache::BEVCacheConfig config;
+        config.max_cache_size = 512;
+        BEVCache cache(config);
+        cache.insertPackets(make_stream(compressor, 2, 1000));
+        std::vector<uint8_t> data;
+        uint16_t rows = 0, cols = 0;
+        uint64_t generation = 0;
+        CHECK(cache.peek(1000, 0, 0, data, rows, cols, nullptr, &generation) && generation != 0);
+        CHECK(cache.touch(1000, 0, 0, generation));
+        CHECK(!cache.touch(9999, 0, 0));
+        cache.insertPackets(make_stream(compressor, 1, 1080));
+        CHECK(cache.peek(1000, 0, 0, data, rows, cols));
+        CHECK(!cache.peek(1000, 0, 16, data, rows, cols));
+        CHECK(!cache.touch(1000, 0, 16));  // 已被淘汰：不计入命中
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 1);
+
+        // 同一键重新插入后代次改变，按旧代次确认失败
+        cache.insertPackets(make_stream(compressor, 1, 1000));
+        CHECK(!cache.touch(1000, 0, 0, generation));
+        CHECK(cache.touch(1000, 0, 0));
+        CHECK(cache.getStats()["total_hits"].asUInt64() == 2);
+    }
+}
+
+int main() {
+    test_insert_and_retrieve();
+    test_capacity_eviction();
+    test_dedup();
+    test_pyramid_levels();
+    test_shared_insert();
+    test_shared_memory_cache();
+    test_mixed_codecs();
+    test_batch_and_frame();
+    test_prefetcher();
+    test_stats_reporter();
+    test_disk_tier();
+    test_snapshot();
+    test_uplink();
+    test_replay();
+
+    if (g_failures) {
+        std::cerr << g_failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "test_cache 全部通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,1015 @@
+#include "compressor.h"
+#include "GenerateData.h"
+#include "lossless_codec.h"
+#include "scheduler.h"
+#include "tuner.h"
+#include "utils.h"
+#include "worker_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <sched.h>
+
+// 简单断言：失败时打印位置并计数
+static int g_failures = 0;
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << " 检查失败: " #cond << std::endl; \
+            ++g_failures;                                                        \
+        }                                                                        \
+    } while (0)
+
+static void test_round_trip_shape() {
+    BEVCompressor::Config config;
+    config.block_size = 16;
+    config.compression_ratio = 16.0f;
+    BEVCompressor compressor(config);
+
+    std::vector<BEVFeaturePacket> packets(3);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        packets[i].feature = Eigen::MatrixXf::Constant(256, 256, 0.5f);
+        packets[i].timestamp = 1000 + i;
+    }
+
+    std::vector<uint8_t> compressed = compressor.compress(packets);
+    CHECK(!compressed.empty());
+    CHECK(compressed.size() < packets.size() * 256 * 256 * sizeof(float));
+
+    std::vector<BEVFeaturePacket> decompressed = compressor.decompress(compressed);
+    CHECK(decompressed.size() == packets.size());
+    for (size_t i = 0; i < decompressed.size(); ++i) {
+        CHECK(decompressed[i].timestamp == packets[i].timestamp);
+        CHECK(decompressed[i].feature.rows() == 256 && decompressed[i].feature.cols() == 256);
+    }
+}
+
+static void test_round_trip_values() {
+    // 块是大矩阵中的跨步视图，解压结果须与原始数据逐块对应
+    BEVCompressor::Config config;
+    config.block_size = 16;
+    config.compression_ratio = 32.0f;
+    BEVCompressor compressor(config);
+
+    std::vector<BEVFeaturePacket> packets(1);
+    packets[0].feature = Eigen::MatrixXf::Random(256, 256);
+    packets[0].timestamp = 7;
+    std::vector<BEVFeaturePacket> decompressed = compressor.decompress(compressor.compress(packets));
+    CHECK(decompressed.size() == 1);
+    CHECK((decompressed[0].feature - packets[0].feature).cwiseAbs().maxCoeff() < 1e-3f);
+}
+
+static void test_tiled_feature() {
+    // 非整块尺寸覆盖边缘块
+    Eigen::MatrixXf matrix = Eigen::MatrixXf::Random(100, 72);
+    TiledFeature tiled = TiledFeature::from_matrix(matrix, 16);
+    CHECK(tiled.grid_rows() == 7 && tiled.grid_cols() == 5);
+    CHECK(tiled.tile_rows(6) == 4 && tiled.tile_cols(4) == 8);
+    CHECK(tiled.tile(2, 3) == matrix.block(32, 48, 16, 16));
+    CHECK(tiled.to_matrix() == matrix);
+
+    // 分块路径与矩阵路径输出相同的字节流，解压结果一致
+    BEVCompressor::Config config;
+    config.compression_ratio = 32.0f;
+    BEVCompressor compressor(config);
+    std::vector<BEVFeaturePacket> packets(1);
+    packets[0].feature = Eigen::MatrixXf::Random(256, 256);
+    packets[0].timestamp = 11;
+    std::vector<TiledFeaturePacket> tiled_packets(1);
+    tiled_packets[0].feature = TiledFeature::from_matrix(packets[0].feature, config.block_size);
+    tiled_packets[0].timestamp = 11;
+
+    std::vector<uint8_t> compressed = compressor.compress(packets);
+    CHECK(compressor.compress(tiled_packets) == compressed);
+    std::vector<TiledFeaturePacket> decoded = compressor.decompress_tiled(compressed);
+    CHECK(decoded.size() == 1 && decoded[0].timestamp == 11);
+    CHECK(decoded[0].feature.to_matrix() == compressor.decompress(compressed)[0].feature);
+
+    BEVCompressor::Config mismatched;
+    mismatched.block_size = 8;
+    BEVCompressor other(mismatched);
+    bool threw = false;
+    try {
+        other.compress(tiled_packets);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_arbitrary_sizes() {
+    BEVCompressor::Config config;
+    config.compression_ratio = 32.0f;
+
+    // 非方形、非块大小整数倍的帧
+    {
+        BEVCompressor compressor(config);
+        std::vector<BEVFeaturePacket> packets(2);
+        packets[0].feature = Eigen::MatrixXf::Random(300, 520);
+        packets[1].feature = Eigen::MatrixXf::Random(40, 24);
+        std::vector<BEVFeaturePacket> decompressed = compressor.decompress(compressor.compress(packets));
+        CHECK(decompressed.size() == 2);
+        for (size_t i = 0; i < packets.size(); ++i) {
+            CHECK(decompressed[i].feature.rows() == packets[i].feature.rows());
+            CHECK(decompressed[i].feature.cols() == packets[i].feature.cols());
+            CHECK((decompressed[i].feature - packets[i].feature).cwiseAbs().maxCoeff() < 1e-3f);
+        }
+    }
+
+    // 块数量超过16位范围（4x4块，257x256=65792块）
+    {
+        config.block_size = 4;
+        BEVCompressor compressor(config);
+        std::vector<BEVFeaturePacket> packets(1);
+        packets[0].feature = Eigen::MatrixXf::Random(1028, 1024);
+        std::vector<BEVFeaturePacket> decompressed = compressor.decompress(compressor.compress(packets));
+        CHECK(decompressed[0].feature.rows() == 1028 && decompressed[0].feature.cols() == 1024);
+        CHECK((decompressed[0].feature - packets[0].feature).cwiseAbs().maxCoeff() < 1e-3f);
+    }
+
+    // 流头标识不符时拒绝解析
+    BEVCompressor compressor(BEVCompressor::Config{});
+    std::vector<uint8_t> bogus(64, 0);
+    bool threw = false;
+    try {
+        compressor.decompress(bogus);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_truncated_stream() {
+    BEVCompressor compressor(BEVCompressor::Config{});
+    std::vector<BEVFeaturePacket> packets(1);
+    packets[0].feature = Eigen::MatrixXf::Zero(256, 256);
+    packets[0].timestamp = 1;
+
+    std::vector<uint8_t> compressed = compressor.compress(packets);
+    compressed.resize(compressed.size() / 2);
+
+    bool threw = false;
+    try {
+        compressor.decompress(compressed);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_stream_view() {
+    BEVCompressor::Config config;
+    config.pyramid_levels = 2;
+    BEVCompressor compressor(config);
+    std::vector<BEVFeaturePacket> packets(2);
+    for (int i = 0; i < 2; ++i) {
+        packets[i].feature = Eigen::MatrixXf::Random(40, 33);
+        packets[i].timestamp = 100 + i;
+    }
+    const std::vector<uint8_t> stream = compressor.compress(packets);
+
+    CompressedStreamView view(stream);
+    CHECK(view.header().num_packets == 4 && view.num_frames() == 2);
+    CompressedStreamView::Frame frame;
+    CompressedStreamView::Block block;
+    std::vector<int> levels;
+    size_t blocks = 0;
+    while (view.next_frame(frame)) {
+        levels.push_back(frame.level);
+        CHECK(frame.header.timestamp == 100u + frame.record / 2);
+        // 原始分辨率层读完所有块，粗层一个块都不读（由next_frame跳过）
+        while (frame.level == 0 && view.next_block(block)) {
+            CHECK(block.data == stream.data() + block.offset);
+            CHECK(block.index == blocks % 9);
+            ++blocks;
+        }
+    }
+    CHECK((levels == std::vector<int>{0, 1, 0, 1}));
+    CHECK(blocks == 2 * 9);
+    CHECK(view.position() == stream.size());
+    CHECK(!view.next_block(block));
+
+    // 截断的流在遍历到缺失部分时抛出异常
+    std::vector<uint8_t> truncated(stream.begin(), stream.begin() + stream.size() / 2);
+    CompressedStreamView partial(truncated);
+    bool threw = false;
+    try {
+        while (partial.next_frame(frame)) {
+        }
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_metrics() {
+    // 分桶上界应覆盖取值，且相对误差不超过1/16
+    for (uint64_t v : {0ull, 15ull, 16ull, 1000ull, 123456789ull}) {
+        uint64_t upper = BEVMetrics::bucketUpperBound(BEVMetrics::bucketIndex(v));
+        CHECK(upper >= v);
+        CHECK(upper - v <= v / 16);
+    }
+
+    BEVMetrics::reset();
+    BEVCompressor compressor(BEVCompressor::Config{});
+    std::vector<BEVFeaturePacket> packets(2);
+    for (auto& packet : packets) {
+        packet.feature = Eigen::MatrixXf::Zero(256, 256);
+        packet.timestamp = 1;
+    }
+    compressor.decompress(compressor.compress(packets));
+
+    BEVMetrics::Snapshot snap = BEVMetrics::snapshot();
+    CHECK(snap.stage(MetricStage::FRAME_COMPRESS).count == 2);
+    CHECK(snap.stage(MetricStage::BLOCK_COMPRESS).count == 2 * 256);
+    CHECK(snap.stage(MetricStage::DECOMPRESS).count == 2);
+    CHECK(snap.stage(MetricStage::FRAME_COMPRESS).bytes_in == 2 * 256 * 256 * sizeof(float));
+    CHECK(snap.compression_ratio > 1.0);
+    CHECK(snap.stage(MetricStage::BLOCK_COMPRESS).p50_ns <= snap.stage(MetricStage::BLOCK_COMPRESS).p999_ns);
+
+    // 已退出线程的计数并入累计值，登记表不随线程数增长
+    const size_t registered = BEVMetrics::registeredThreads();
+    for (int i = 0; i < 8; ++i) {
+        std::thread([] {
+            BEVMetrics::recordLatency(MetricStage::CACHE_EVICT, 1000);
+            BEVMetrics::recordReencode(1, 0);
+        }).join();
+    }
+    CHECK(BEVMetrics::registeredThreads() == registered);
+    snap = BEVMetrics::snapshot();
+    CHECK(snap.stage(MetricStage::CACHE_EVICT).count == 8);
+    CHECK(snap.stage(MetricStage::CACHE_EVICT).max_ns >= 1000);
+    CHECK(snap.reencoded_blocks == 8);
+    CHECK(snap.stage(MetricStage::FRAME_COMPRESS).count == 2);
+    BEVMetrics::reset();
+    CHECK(BEVMetrics::snapshot().stage(MetricStage::CACHE_EVICT).count == 0);
+
+    // 与记录并发的reset不丢失：重置之后的计数不超过重置开始时尚未完成的记录数
+    const int total = 200000;
+    std::atomic<int> recorded{0};
+    std::thread recorder([&] {
+        for (int i = 0; i < total; ++i) {
+            BEVMetrics::recordLatency(MetricStage::CACHE_EVICT, 10);
+            recorded.store(i + 1, std::memory_order_release);
+        }
+    });
+    while (recorded.load(std::memory_order_acquire) < total / 2) {
+        std::this_thread::yield();
+    }
+    const int before_reset = recorded.load(std::memory_order_acquire);
+    BEVMetrics::reset();
+    recorder.join();
+    CHECK(BEVMetrics::snapshot().stage(MetricStage::CACHE_EVICT).count <= static_cast<uint64_t>(total - before_reset));
+    BEVMetrics::reset();
+}
+
+static void test_progressive() {
+    BEVCompressor::Config config;
+    config.block_size = 16;
+    BEVCompressor compressor(config);
+
+    // 非块大小整数倍的尺寸，覆盖边缘块
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(100, 72);
+    packet.timestamp = 4242;
+    const std::vector<float> rates = {8.0f, 8.0f, 16.0f};
+    std::vector<uint8_t> stream = compressor.compress_progressive(packet, rates);
+
+    // 完整流：逐层细化，误差单调下降
+    ProgressiveDecoder full(compressor);
+    CHECK(full.feed(stream.data(), stream.size()) == 3u * 7 * 5);
+    CHECK(full.layers_complete() == 3);
+    CHECK(full.frame().timestamp == 4242);
+    float full_error = (full.frame().feature - packet.feature).cwiseAbs().maxCoeff();
+
+    // 只收到基础层：帧完整但精度更低
+    size_t base_cut = BEVCompressor::progressive_truncate_size(stream, stream.size() / 3);
+    CHECK(base_cut > 0 && base_cut <= stream.size() / 3);
+    ProgressiveDecoder base(compressor);
+    base.feed(stream.data(), base_cut);
+    CHECK(base.layers_complete() >= 1);
+    CHECK(base.frame().feature.rows() == 100 && base.frame().feature.cols() == 72);
+    float base_error = (base.frame().feature - packet.feature).cwiseAbs().maxCoeff();
+    CHECK(full_error < base_error);
+
+    // 按层边界截断：预算落在基础层内时返回0，落在某层内部时退回上一层末尾
+    const size_t header_bytes = 26 + rates.size() * 8;
+    CHECK(BEVCompressor::progressive_truncate_size(stream, header_bytes) == 0);
+    const size_t layer1_end = BEVCompressor::progressive_truncate_size(stream, stream.size() - 1);
+    size_t layer0_end = 0;
+    for (size_t budget = header_bytes; budget <= stream.size(); ++budget) {
+        size_t cut = BEVCompressor::progressive_truncate_size(stream, budget);
+        CHECK(cut <= budget);
+        if (cut > 0 && layer0_end == 0) {
+            layer0_end = cut;
+            CHECK(budget == cut);
+        }
+    }
+    CHECK(layer0_end > header_bytes && layer0_end < layer1_end);
+    CHECK(BEVCompressor::progressive_truncate_size(stream, layer0_end - 1) == 0);
+    CHECK(BEVCompressor::progressive_truncate_size(stream, (layer0_end + layer1_end) / 2) == layer0_end);
+    CHECK(BEVCompressor::progressive_truncate_size(stream, stream.size()) == stream.size());
+    ProgressiveDecoder layered(compressor);
+    CHECK(layered.feed(stream.data(), layer0_end) == 7u * 5);
+    CHECK(layered.layers_complete() == 1);
+
+    // 按任意大小分片到达，结果与一次性解码一致
+    ProgressiveDecoder chunked(compressor);
+    for (size_t pos = 0; pos < stream.size(); pos += 37) {
+        chunked.feed(stream.data() + pos, std::min<size_t>(37, stream.size() - pos));
+    }
+    CHECK(chunked.layers_complete() == 3);
+    CHECK(chunked.frame().feature == full.frame().feature);
+
+    ProgressiveDecoder empty(compressor);
+    CHECK(empty.feed(stream.data(), 10) == 0 && !empty.header_ready());
+
+    // 各层编码方式写在流头，与双方的lossless配置无关：无损配置的发送端照常产出细化层，
+    // 有损/无损（含字节平面重排）配置的接收端解出相同的帧
+    BEVCompressor::Config lossless_config = config;
+    lossless_config.lossless = true;
+    BEVCompressor lossless_sender(lossless_config);
+    CHECK(lossless_sender.compress_progressive(packet, rates) == stream);
+    lossless_config.lossless_codec = BEVCompressor::Config::LOSSLESS_SHUFFLE;
+    BEVCompressor shuffle_sender(lossless_config);
+    CHECK(shuffle_sender.compress_progressive(packet, rates) == stream);
+    ProgressiveDecoder shuffle_receiver(shuffle_sender);
+    CHECK(shuffle_receiver.feed(stream.data(), stream.size()) == 3u * 7 * 5);
+    CHECK(shuffle_receiver.frame().feature == full.frame().feature);
+    lossless_config.lossless_codec = BEVCompressor::Config::LOSSLESS_ZFP;
+    BEVCompressor zfp_lossless(lossless_config);
+    ProgressiveDecoder reversible_receiver(zfp_lossless);
+    reversible_receiver.feed(stream.data(), stream.size());
+    CHECK(reversible_receiver.frame().feature == full.frame().feature);
+}
+
+static void test_fixed_kernels() {
+    // 固定尺寸内核与通用路径的输出逐字节一致（含边缘块），解压结果也一致
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(70, 45);
+    packet.timestamp = 42;
+
+    for (int bs : {4, 8, 16, 32}) {
+        for (float rate : {8.0f, 32.0f}) {
+            BEVCompressor::Config config;
+            config.block_size = bs;
+            config.compression_ratio = rate;
+            BEVCompressor fixed(config);
+            config.fixed_kernels = false;
+            BEVCompressor generic(config);
+            CHECK(fixed.has_fixed_kernel());
+            CHECK(!generic.has_fixed_kernel());
+
+            std::vector<uint8_t> a = fixed.compress({packet});
+            std::vector<uint8_t> b = generic.compress({packet});
+            CHECK(a == b);
+
+            std::vector<BEVFeaturePacket> da = fixed.decompress(a);
+            std::vector<BEVFeaturePacket> db = generic.decompress(b);
+            CHECK(da.size() == 1 && db.size() == 1);
+            CHECK(da[0].feature == db[0].feature);
+
+            std::vector<TiledFeaturePacket> tiled(1);
+            tiled[0].feature = TiledFeature::from_matrix(packet.feature, bs);
+            tiled[0].timestamp = packet.timestamp;
+            CHECK(fixed.compress(tiled) == a);
+            CHECK(fixed.decompress_tiled(a)[0].feature.to_matrix() == db[0].feature);
+        }
+
+        // 可逆模式下两条路径都精确还原原始数据
+        BEVCompressor::Config config;
+        config.block_size = bs;
+        config.lossless = true;
+        BEVCompressor fixed(config);
+        config.fixed_kernels = false;
+        BEVCompressor generic(config);
+        std::vector<uint8_t> a = fixed.compress({packet});
+        CHECK(generic.compress({packet}) == a);
+        CHECK(fixed.decompress(a)[0].feature == packet.feature);
+        CHECK(generic.decompress(a)[0].feature == packet.feature);
+    }
+
+    BEVCompressor::Config config;
+    config.block_size = 12;
+    CHECK(!BEVCompressor(config).has_fixed_kernel());
+}
+
+static void test_verify_mode() {
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(70, 45);
+    packet.timestamp = 7;
+    const int blocks = 5 * 3;
+
+    BEVCompressor::Config config;
+    config.block_size = 16;
+    config.compression_ratio = 4.0f;
+    BEVCompressor plain(config);
+    const std::vector<uint8_t> reference = plain.compress({packet});
+    CHECK(plain.last_frame_quality().empty());
+
+    // 影子模式：输出与关闭校验时逐字节一致，统计值与实际解压误差一致
+    config.verify = true;
+    BEVCompressor shadow(config);
+    CHECK(shadow.compress({packet}) == reference);
+    CHECK(shadow.last_frame_quality().size() == 1);
+    const BEVCompressor::QualityStats& frame = shadow.last_frame_quality()[0];
+    const Eigen::ArrayXXf diff = plain.decompress(reference)[0].feature.array() - packet.feature.array();
+    CHECK(frame.blocks == static_cast<uint64_t>(blocks));
+    CHECK(frame.values == static_cast<uint64_t>(packet.feature.size()));
+    CHECK(frame.reencoded_blocks == 0);
+    CHECK(std::abs(frame.max_abs_error - diff.abs().maxCoeff()) < 1e-6);
+    CHECK(std::abs(frame.rmse() - std::sqrt(diff.square().cast<double>().mean())) < 1e-6);
+    CHECK(frame.value_min == packet.feature.minCoeff() && frame.value_max == packet.feature.maxCoeff());
+    CHECK(std::isfinite(frame.psnr_db()) && frame.psnr_db() > 0);
+    shadow.compress({packet, packet});
+    CHECK(shadow.last_frame_quality().size() == 2);
+    CHECK(shadow.run_quality().blocks == 3u * blocks);
+
+    // 抽样校验
+    config.verify_interval = 4;
+    BEVCompressor sampled(config);
+    sampled.compress({packet});
+    CHECK(sampled.last_frame_quality()[0].blocks == (blocks + 3) / 4);
+
+    // 误差上限：超限块提高码率重新编码，解压后满足上限
+    BEVMetrics::reset();
+    config.verify_interval = 1;
+    config.error_bound = 0.05f;
+    BEVCompressor bounded(config);
+    const std::vector<uint8_t> stream = bounded.compress({packet});
+    CHECK(stream[6] == BEVCompressor::CODEC_ZFP_BLOCK_RATE);
+    const BEVCompressor::QualityStats& quality = bounded.last_frame_quality()[0];
+    CHECK(quality.blocks == static_cast<uint64_t>(blocks));
+    CHECK(quality.reencoded_blocks > 0 && quality.unresolved_blocks == 0);
+    CHECK(quality.max_abs_error <= config.error_bound);
+    const std::vector<BEVFeaturePacket> decoded = bounded.decompress(stream);
+    CHECK((decoded[0].feature - packet.feature).cwiseAbs().maxCoeff() <= config.error_bound);
+    CHECK(bounded.decompress_tiled(stream)[0].feature.to_matrix() == decoded[0].feature);
+    // 其他压缩器也能按流头中的编码方式解码
+    CHECK(plain.decompress(stream)[0].feature == decoded[0].feature);
+
+    // 单块解压（缓存路径）：块数据自带码率前缀
+    const uint8_t* ptr = stream.data();
+    const uint8_t* end = ptr + stream.size();
+    BEVCompressor::read_stream_header(ptr, end);
+    BEVCompressor::FrameHeader frame_header = BEVCompressor::read_frame_header(ptr, end);
+    BEVCompressor::BlockHeader block_header = BEVCompressor::read_block_header(ptr, end, frame_header);
+    Eigen::MatrixXf block(block_header.block_rows, block_header.block_cols);
+    bounded.decompress_block(ptr, block_header.compressed_size, block);
+    CHECK(block == decoded[0].feature.block(0, 0, 16, 16));
+
+    BEVMetrics::Snapshot snap = BEVMetrics::snapshot();
+    CHECK(snap.reencoded_blocks == quality.reencoded_blocks);
+    CHECK(snap.error_samples == static_cast<uint64_t>(packet.feature.size()));
+    CHECK(snap.stage(MetricStage::BLOCK_VERIFY).count == static_cast<uint64_t>(blocks));
+    CHECK(snap.toJSON()["stages"].isMember("block_verify"));
+
+    // 校验参数的读写
+    Json::Value json = BEVCompressor::config_to_json(config);
+    BEVCompressor::Config loaded = BEVCompressor::config_from_json(json);
+    CHECK(loaded.verify && loaded.error_bound == config.error_bound && loaded.verify_interval == 1);
+    json["verify_interval"] = 0;
+    bool threw = false;
+    try {
+        BEVCompressor::config_from_json(json);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    CHECK(BEVCompressor::escalated_rate(4.0, 0) == 4.0);
+    CHECK(BEVCompressor::escalated_rate(4.0, 2) == 16.0);
+    CHECK(BEVCompressor::escalated_rate(4.0, 5) == BEVCompressor::MAX_BLOCK_RATE);
+}
+
+static void test_pyramid() {
+    BEVCompressor::Config config;
+    config.block_size = 16;
+    config.lossless = true;  // 无损编码，各层可与参考降采样逐值比较
+    config.pyramid_levels = 3;
+    BEVCompressor compressor(config);
+
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(101, 70);
+    packet.timestamp = 77;
+    std::vector<uint8_t> stream = compressor.compress({packet});
+    const uint8_t* ptr = stream.data();
+    BEVCompressor::StreamHeader header = BEVCompressor::read_stream_header(ptr, stream.data() + stream.size());
+    CHECK(header.pyramid_levels == 3 && header.num_packets == 3);
+
+    // 默认解码只返回原始分辨率层
+    std::vector<BEVFeaturePacket> full = compressor.decompress(stream);
+    CHECK(full.size() == 1 && full[0].feature == packet.feature);
+
+    Eigen::MatrixXf expected = packet.feature;
+    for (int level = 1; level < 3; ++level) {
+        expected = BEVCompressor::downsample(expected, false);
+        CHECK(expected.rows() == BEVCompressor::level_extent(101, level));
+        CHECK(expected.cols() == BEVCompressor::level_extent(70, level));
+        std::vector<BEVFeaturePacket> coarse = compressor.decompress_level(stream, level);
+        CHECK(coarse.size() == 1 && coarse[0].timestamp == 77);
+        CHECK(coarse[0].feature == expected);
+    }
+    // 平均降采样：奇数边复制边缘
+    CHECK(std::abs(expected(0, 0) - packet.feature.topLeftCorner(4, 4).mean()) < 1e-5f);
+
+    // 区域解码：跨块边界的区域，以及被帧边界裁掉的区域
+    std::vector<BEVFeaturePacket> region = compressor.decompress_region(stream, 0, 10, 20, 30, 40);
+    CHECK(region.size() == 1 && region[0].feature == packet.feature.block(10, 20, 30, 40));
+    region = compressor.decompress_region(stream, 1, 40, 30, 100, 100);
+    CHECK(region[0].feature == BEVCompressor::downsample(packet.feature, false).bottomRightCorner(11, 5));
+
+    // 不带金字塔的流没有粗层
+    bool threw = false;
+    config.pyramid_levels = 1;
+    BEVCompressor flat(config);
+    try {
+        flat.decompress_level(flat.compress({packet}), 1);
+    } catch (const std::exception&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // 最大池化：占据栅格降采样后不丢失孤立的占据格
+    Eigen::MatrixXf occupancy = Eigen::MatrixXf::Zero(64, 64);
+    occupancy(13, 41) = 1.0f;
+    Eigen::MatrixXf pooled = BEVCompressor::downsample(occupancy, true);
+    CHECK(pooled.rows() == 32 && pooled(6, 20) == 1.0f && pooled.sum() == 1.0f);
+    CHECK(BEVCompressor::downsample(occupancy, false)(6, 20) == 0.25f);
+}
+
+static void test_worker_pool() {
+    CHECK((WorkerPool::parseCpuList("0-3,8, 10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    CHECK(!WorkerPool::detectTopology().empty());
+
+    // 用同一个CPU模拟两个节点：每帧的块只交给一个节点，轮流使用两个节点
+    WorkerPool::Config pool_config;
+    pool_config.threads = 4;
+    pool_config.nodes = {{0}, {0}};
+    auto pool = std::make_shared<WorkerPool>(pool_config);
+    CHECK(pool->size() == 4 && pool->numGroups() == 2 && pool->maxSlots() == 2);
+    CHECK(pool->nodeOf(0) == 0 && pool->nodeOf(1) == 1);
+
+    std::vector<std::atomic<int>> owner(2 * 100);
+    for (auto& o : owner) o = -1;
+    pool->runPartitioned({100, 100}, [&](size_t frame, int, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) owner[frame * 100 + k] = pool->nodeOf(WorkerPool::currentWorker());
+    });
+    for (size_t frame = 0; frame < 2; ++frame) {
+        for (size_t k = 0; k < 100; ++k) CHECK(owner[frame * 100 + k] == owner[frame * 100]);
+    }
+    CHECK(owner[0] != owner[100]);
+    CHECK(pool->getStats()["cross_node_frames"].asUInt64() == 0);
+
+    // 工作线程中的异常在调用方重新抛出，池仍可继续使用
+    bool threw = false;
+    try {
+        pool->runPartitioned({8}, [](size_t, int, size_t begin, size_t) {
+            if (begin == 0) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(pool->constructOnNode<std::vector<int>>(1, 3, 7)->size() == 3);
+
+    // 构造返回时工作线程已绑定到各自的CPU
+    for (int w = 0; w < pool->size(); ++w) {
+        CHECK(pool->cpuOf(w) == 0);
+        bool pinned = false;
+        pool->runOn(w, [&] {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            pinned = sched_getaffinity(0, sizeof(mask), &mask) == 0 && CPU_COUNT(&mask) == 1 && CPU_ISSET(0, &mask);
+        });
+        CHECK(pinned);
+    }
+
+    // 池化压缩/解压与串行逐字节一致（含校验模式的抽样与重编码、金字塔）
+    BEVFeaturePacket packet;
+    packet.feature = Eigen::MatrixXf::Random(150, 70);
+    packet.timestamp = 9;
+    for (int mode = 0; mode < 3; ++mode) {
+        BEVCompressor::Config config;
+        config.compression_ratio = 6.0f;
+        config.verify = mode > 0;
+        config.verify_interval = 3;
+        config.error_bound = mode == 2 ? 0.05f : 0.0f;
+        config.pyramid_levels = 2;
+        BEVCompressor serial(config);
+        BEVCompressor pooled(config);
+        pooled.set_worker_pool(pool);
+        std::vector<uint8_t> a = serial.compress({packet, packet});
+        std::vector<uint8_t> b = pooled.compress({packet, packet});
+        CHECK(a == b);
+        if (config.verify) {
+            CHECK(serial.run_quality().blocks == pooled.run_quality().blocks);
+            CHECK(serial.run_quality().max_abs_error == pooled.run_quality().max_abs_error);
+        }
+        std::vector<BEVFeaturePacket> da = serial.decompress(a);
+        std::vector<BEVFeaturePacket> db = pooled.decompress(a);
+        CHECK(da.size() == 2 && db.size() == 2);
+        CHECK(da[0].feature == db[0].feature && da[1].feature == db[1].feature && db[1].timestamp == 9);
+    }
+
+    // 不按节点分组时，一帧的块会分散到两个节点上
+    pool_config.numa_aware = false;
+    WorkerPool flat(pool_config);
+    CHECK(flat.numGroups() == 1 && flat.maxSlots() == 4);
+    flat.runPartitioned({100}, [](size_t, int, size_t, size_t) {});
+    CHECK(flat.getStats()["cross_node_frames"].asUInt64() == 1);
+}
+
+static void test_tuner_and_params() {
+    // 稀疏占据栅格：高码率误差更小但压缩比更低，Pareto前沿上应同时存在两端
+    std::vector<BEVFeaturePacket> samples(2);
+    for (size_t k = 0; k < samples.size(); ++k) {
+        samples[k].feature = Eigen::MatrixXf::Zero(64, 64);
+        samples[k].feature.block(10 + k, 20, 12, 8).setConstant(0.75f);
+        samples[k].feature += 0.01f * Eigen::MatrixXf::Random(64, 64);
+        samples[k].timestamp = 100 + k;
+    }
+
+    CompressorTuner::Options options;
+    options.block_sizes = {8, 16};
+    options.rates = {4, 8, 16};
+    options.repeats = 1;
+    CompressorTuner::Result result = CompressorTuner::tune(samples, options);
+    CHECK(result.candidates.size() == 8);
+    CHECK(result.best >= 0);
+    int pareto = 0;
+    for (const CompressorTuner::Candidate& c : result.candidates) {
+        CHECK(c.valid && c.feasible);
+        CHECK(c.ratio > 0 && c.compress_ms >= 0);
+        pareto += c.pareto;
+    }
+    CHECK(pareto >= 2);
+    // 不加约束时选压缩比最高的组合
+    CHECK(result.candidates[result.best].config.compression_ratio == 4.0f);
+
+    // 误差约束：选出的组合满足约束
+    options.max_rmse = 1e-6;
+    result = CompressorTuner::tune(samples, options);
+    CHECK(result.best >= 0);
+    CHECK(result.candidates[result.best].rmse <= 1e-6);
+
+    // 写出参数文件后可被压缩器加载
+    const std::string path = "test_params.json";
+    CompressorTuner::write_params(path, result, options);
+    BEVCompressor::Config loaded = BEVCompressor::load_config(path);
+    const BEVCompressor::Config& best = result.candidates[result.best].config;
+    CHECK(loaded.block_size == best.block_size);
+    CHECK(loaded.compression_ratio == best.compression_ratio);
+    CHECK(loaded.lossless == best.lossless);
+    std::remove(path.c_str());
+
+    // 没有满足约束的组合
+    options.max_frame_latency_ms = 1e-9;
+    result = CompressorTuner::tune(samples, options);
+    CHECK(result.best < 0);
+    bool threw = false;
+    try {
+        CompressorTuner::params_json(result, options);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // 缺省字段取默认值，无效参数抛出异常
+    Json::Value partial;
+    partial["compressor"]["block_size"] = 8;
+    BEVCompressor::Config config = BEVCompressor::config_from_json(partial);
+    CHECK(config.block_size == 8 && config.compression_ratio == BEVCompressor::Config().compression_ratio);
+    partial["compressor"]["block_size"] = 0;
+    threw = false;
+    try {
+        BEVCompressor::config_from_json(partial);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// 逐位比较（NaN、±0也要一致）
+static bool bit_equal(const Eigen::MatrixXf& a, const Eigen::MatrixXf& b) {
+    return a.rows() == b.rows() && a.cols() == b.cols() &&
+           std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+static void test_lossless() {
+    // 生成器的各种数据类型，加上特殊值帧（NaN、±0、±inf、非规格化数）；尺寸不是块大小的整数倍
+    BEVDataGenerator generator;
+    std::vector<BEVFeaturePacket> packets;
+    for (int type = 0; type <= 3; ++type) {
+        BEVDataGenerator::ScenarioConfig scenario;
+        scenario.rows = 100;
+        scenario.cols = 75;
+        scenario.data_type = type;
+        packets.push_back(generator.generate_scenario_frame(scenario, 3));
+    }
+    for (int type = 0; type <= 2; ++type) {
+        packets.push_back(generator.generate_bev_frame(64, 64, type, 0.05f));
+    }
+    BEVFeaturePacket special;
+    special.feature = Eigen::MatrixXf::Random(33, 17);
+    const uint32_t patterns[] = {0x7FC00000u, 0x7FA00001u, 0xFFC12345u, 0x80000000u,
+                                 0x7F800000u, 0xFF800000u, 0x00000001u, 0x807FFFFFu};
+    for (int k = 0; k < 8; ++k) {
+        std::memcpy(&special.feature(k, k), &patterns[k], sizeof(float));
+    }
+    packets.push_back(special);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        packets[i].timestamp = 1000 + i;
+    }
+
+    for (int codec : {BEVCompressor::Config::LOSSLESS_ZFP, BEVCompressor::Config::LOSSLESS_SHUFFLE}) {
+        const uint8_t stream_codec = codec == BEVCompressor::Config::LOSSLESS_ZFP ? BEVCompressor::CODEC_ZFP_REVERSIBLE
+                                                                                : BEVCompressor::CODEC_SHUFFLE_LZ;
+        for (int bs : {16, 12}) {
+            // 码率设得很低、开启误差上限都不影响无损编码
+            BEVCompressor::Config config;
+            config.block_size = bs;
+            config.compression_ratio = 2.0f;
+            config.lossless = true;
+            config.lossless_codec = codec;
+            config.verify = true;
+            config.error_bound = 1e-3f;
+            BEVCompressor compressor(config);
+            const std::vector<uint8_t> stream = compressor.compress(packets);
+            CHECK(stream[6] == stream_codec);
+
+            std::vector<BEVFeaturePacket> decoded = compressor.decompress(stream);
+            CHECK(decoded.size() == packets.size());
+            for (size_t i = 0; i < decoded.size() && i < packets.size(); ++i) {
+                CHECK(decoded[i].timestamp == packets[i].timestamp);
+                CHECK(bit_equal(decoded[i].feature, packets[i].feature));
+            }
+            // 除特殊值帧外校验误差为0，没有块提高码率
+            for (size_t i = 0; i + 1 < packets.size(); ++i) {
+                CHECK(compressor.last_frame_quality()[i].max_abs_error == 0.0);
+                CHECK(compressor.last_frame_quality()[i].reencoded_blocks == 0);
+            }
+
+            // 按流头的编码方式解码：有损配置的压缩器也能还原
+            BEVCompressor lossy(BEVCompressor::Config{});
+            CHECK(bit_equal(lossy.decompress(stream).back().feature, special.feature));
+            CHECK(bit_equal(compressor.decompress_tiled(stream)[0].feature.to_matrix(), packets[0].feature));
+
+            // 缓存路径：按压缩器配置解码单个块
+            CompressedStreamView view(stream);
+            CompressedStreamView::Frame frame;
+            CompressedStreamView::Block block;
+            CHECK(view.next_frame(frame) && view.next_frame(frame) && view.next_block(block));
+            Eigen::MatrixXf tile(block.header.block_rows, block.header.block_cols);
+            compressor.decompress_block(block.data, block.header.compressed_size, tile);
+            CHECK(bit_equal(tile, packets[1].feature.block(block.header.row_offset, block.header.col_offset,
+                                                           tile.rows(), tile.cols())));
+        }
+    }
+
+    // 空背景（稀疏）帧：字节平面重排后大段为0，压缩比远高于原始大小
+    BEVCompressor::Config config;
+    config.lossless = true;
+    config.lossless_codec = BEVCompressor::Config::LOSSLESS_SHUFFLE;
+    BEVCompressor shuffle(config);
+    CHECK(BEVCompressor::config_from_json(BEVCompressor::config_to_json(config)).lossless_codec ==
+          BEVCompressor::Config::LOSSLESS_SHUFFLE);
+    BEVFeaturePacket sparse = generator.generate_bev_frame(256, 256, 2, 0.0f);
+    CHECK(shuffle.compress({sparse}).size() * 8 < 256 * 256 * sizeof(float));
+
+    // LZ的边界情况：空输入、单字节、长串（长度扩展）、短周期重复、随机数据
+    std::vector<std::vector<uint8_t>> inputs = {{}, {7}, std::vector<uint8_t>(100000, 0)};
+    std::vector<uint8_t> periodic(5000), noise(5000);
+    for (size_t k = 0; k < periodic.size(); ++k) {
+        periodic[k] = static_cast<uint8_t>(k % 3);
+        noise[k] = static_cast<uint8_t>(std::rand());
+    }
+    inputs.push_back(periodic);
+    inputs.push_back(noise);
+    for (const std::vector<uint8_t>& input : inputs) {
+        std::vector<uint8_t> packed;
+        ShuffleLZCodec::lz_compress(input.data(), input.size(), packed);
+        std::vector<uint8_t> unpacked(input.size());
+        ShuffleLZCodec::lz_decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+        CHECK(unpacked == input);
+    }
+    std::vector<uint8_t> packed;
+    CHECK(ShuffleLZCodec::lz_compress(inputs[2].data(), inputs[2].size(), packed) < 1000);
+
+    // 损坏的数据抛出异常
+    std::vector<uint8_t> out(inputs[2].size());
+    int threw = 0;
+    try {
+        ShuffleLZCodec::lz_decompress(packed.data(), packed.size() - 1, out.data(), out.size());
+    } catch (const std::runtime_error&) {
+        ++threw;
+    }
+    try {
+        ShuffleLZCodec::lz_decompress(packed.data(), packed.size(), out.data(), out.size() + 1);
+    } catch (const std::runtime_error&) {
+        ++threw;
+    }
+    const uint8_t bad_offset[] = {0x10, 0xAA, 0x05, 0x00};  // 1个字面量后偏移5超出已输出长度
+    try {
+        ShuffleLZCodec::lz_decompress(bad_offset, sizeof(bad_offset), out.data(), 8);
+    } catch (const std::runtime_error&) {
+        ++threw;
+    }
+    try {
+        Eigen::MatrixXf tile(4, 4);
+        const uint8_t stored[] = {ShuffleLZCodec::MODE_STORED, 0, 0};
+        ShuffleLZCodec::decode(stored, sizeof(stored), tile);
+    } catch (const std::runtime_error&) {
+        ++threw;
+    }
+    Json::Value params = BEVCompressor::config_to_json(config);
+    params["lossless_codec"] = "lz4";
+    try {
+        BEVCompressor::config_from_json(params);
+    } catch (const std::runtime_error&) {
+        ++threw;
+    }
+    CHECK(threw == 5);
+}
+
+static void test_scheduler() {
+    using Clock = CompressionScheduler::Clock;
+    CompressionScheduler::Config config;
+    config.max_pending_frames = 3;
+    config.key_frame_interval = 2;
+    config.compressor.block_size = 16;
+    config.compressor.compression_ratio = 16.0f;
+
+    // 回调在工作线程上执行：gate关闭时阻塞工作线程，时间戳99的帧回调抛出异常
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool gate_open = true;
+    bool entered = false;
+    std::vector<CompressionScheduler::Result> results;
+    CompressionScheduler scheduler(config, [&](CompressionScheduler::Result&& result) {
+        std::unique_lock<std::mutex> lock(mutex);
+        entered = true;
+        cv.notify_all();
+        cv.wait(lock, [&] { return gate_open; });
+        if (result.timestamp == 99) {
+            throw std::runtime_error("回调失败");
+        }
+        results.push_back(std::move(result));
+    });
+    const Eigen::MatrixXf feature = Eigen::MatrixXf::Random(512, 512);
+    auto frame = [&](uint64_t timestamp) {
+        BEVFeaturePacket packet;
+        packet.feature = feature;
+        packet.timestamp = timestamp;
+        return packet;
+    };
+    const Clock::time_point far = Clock::now() + std::chrono::hours(1);
+
+    // 截止时间充裕：正常档位，得到正常档位的耗时估计
+    CHECK(scheduler.submit(frame(1), far));
+    scheduler.flush();
+    const double full_ms = scheduler.getStats().est_full_cost_ms;
+    CHECK(full_ms > 0);
+
+    // 裕量不足正常档位的耗时估计：降低码率（降级档位尚无耗时估计）
+    CHECK(scheduler.submit(frame(2), Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                      std::chrono::duration<double, std::milli>(full_ms / 2))));
+    scheduler.flush();
+
+    // 已错过截止时间：迟到，关键帧模式下每2帧保留1帧
+    const Clock::time_point past = Clock::now() - std::chrono::milliseconds(1);
+    for (uint64_t ts : {3, 4, 5}) {
+        CHECK(scheduler.submit(frame(ts), past));
+    }
+    scheduler.flush();
+
+    // 工作线程阻塞时提交超出队列上限的帧：丢弃最旧的两帧
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        gate_open = false;
+        entered = false;
+    }
+    CHECK(scheduler.submit(frame(10), far));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return entered; });
+    }
+    int accepted = 0;
+    for (uint64_t ts : {11, 12, 13, 14, 15}) {
+        accepted += scheduler.submit(frame(ts), far);
+    }
+    CHECK(accepted == 3);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        gate_open = true;
+    }
+    cv.notify_all();
+    scheduler.flush();
+
+    // 回调抛出异常：计为失败帧，工作线程继续处理后续帧
+    CHECK(scheduler.submit(frame(99), far));
+    CHECK(scheduler.submit(frame(100), far));
+    scheduler.flush();
+
+    const CompressionScheduler::Stats stats = scheduler.getStats();
+    CHECK(stats.submitted == 13);
+    CHECK(stats.compressed == 10);
+    CHECK(stats.late_frames == 3);
+    CHECK(stats.degraded_frames == 3);
+    CHECK(stats.dropped_frames == 3);
+    CHECK(stats.failed_frames == 1);
+
+    std::vector<uint64_t> timestamps;
+    for (const CompressionScheduler::Result& result : results) timestamps.push_back(result.timestamp);
+    CHECK((timestamps == std::vector<uint64_t>{1, 2, 3, 5, 10, 13, 14, 15, 100}));
+    if (results.size() == 9) {
+        using Level = CompressionScheduler::DegradeLevel;
+        CHECK(results[0].level == Level::FULL && !results[0].late);
+        CHECK(results[1].level == Level::REDUCED_RATE && !results[1].late && results[1].rate == 8.0f);
+        CHECK(results[2].level == Level::KEY_FRAME_ONLY && results[2].late);
+        CHECK(results[3].level == Level::KEY_FRAME_ONLY && results[3].late);
+        CHECK(results[5].level == Level::FULL);
+        // 降级帧用对应档位的压缩器解码
+        std::vector<BEVFeaturePacket> decoded = scheduler.compressorFor(Level::REDUCED_RATE).decompress(results[1].data);
+        CHECK(decoded.size() == 1 && decoded[0].timestamp == 2);
+    }
+
+    // 一帧慢帧之后全是快帧：降级若干帧后试探FULL，估计随之恢复；
+    // 无损、校验与金字塔配置只用于正常档位，降级档位为单层有损固定码率
+    CompressionScheduler::Config probe_config;
+    probe_config.target_fps = 200;
+    probe_config.full_probe_interval = 3;
+    probe_config.compressor.lossless = true;
+    probe_config.compressor.verify = true;
+    probe_config.compressor.error_bound = 0.01f;
+    probe_config.compressor.pyramid_levels = 2;
+    std::vector<CompressionScheduler::Result> probe_results;
+    CompressionScheduler probing(probe_config, [&](CompressionScheduler::Result&& result) {
+        probe_results.push_back(std::move(result));
+    });
+    const BEVCompressor::Config& reduced_config =
+        probing.compressorFor(CompressionScheduler::DegradeLevel::REDUCED_RATE).get_config();
+    CHECK(!reduced_config.lossless && !reduced_config.verify && reduced_config.error_bound == 0.0f);
+    CHECK(reduced_config.pyramid_levels == 1);
+    BEVFeaturePacket slow;
+    slow.feature = Eigen::MatrixXf::Random(2048, 2048);
+    slow.timestamp = 0;
+    CHECK(probing.submit(slow, Clock::now() + std::chrono::hours(1)));
+    probing.flush();
+    CHECK(probing.getStats().est_full_cost_ms > 5.0);  // 超过一个帧周期
+    for (uint64_t ts = 1; ts <= 12; ++ts) {
+        BEVFeaturePacket fast;
+        fast.feature = Eigen::MatrixXf::Random(16, 16);
+        fast.timestamp = ts;
+        probing.submit(fast);
+        probing.flush();
+    }
+    using Level = CompressionScheduler::DegradeLevel;
+    size_t reduced = 0, recovered = 0;
+    for (size_t k = 1; k < probe_results.size(); ++k) {
+        const CompressionScheduler::Result& result = probe_results[k];
+        CompressedStreamView view(result.data);
+        if (result.level == Level::REDUCED_RATE) {
+            ++reduced;
+            CHECK(view.header().codec == BEVCompressor::CODEC_ZFP_RATE && view.header().pyramid_levels == 1);
+        } else if (result.level == Level::FULL) {
+            ++recovered;
+            CHECK(view.header().codec == BEVCompressor::CODEC_ZFP_REVERSIBLE);
+        }
+    }
+    CHECK(reduced > 0);
+    CHECK(recovered > 0);
+    CHECK(!probe_results.empty() && probe_results.back().level == Level::FULL);
+    CHECK(probing.getStats().est_full_cost_ms < 5.0);
+}
+
+int main() {
+    test_round_trip_shape();
+    test_round_trip_values();
+    test_tiled_feature();
+    test_arbitrary_sizes();
+    test_truncated_stream();
+    test_stream_view();
+    test_metrics();
+    test_progressive();
+    test_fixed_kernels();
+    test_verify_mode();
+    test_lossless();
+    test_pyramid();
+    test_worker_pool();
+    test_tuner_and_params();
+    test_scheduler();
+
+    if (g_failures) {
+        std::cerr << g_failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "test_compressor 全部通过" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "GenerateData.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+// 简单断言：失败时打印位置并计数
+static int g_failures = 0;
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << " 检查失败: " #cond << std::endl; \
+            ++g_failures;                                                        \
+        }                                                                        \
+    } while (0)
+
+static std::vector<char> read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void test_deterministic_frames() {
+    BEVDataGenerator generator;
+    BEVDataGenerator::ScenarioConfig config;
+    config.seed = 7;
+    config.rows = 128;
+    config.cols = 96;
+    config.noise_level = 0.1f;
+
+    for (int type = 0; type <= 3; ++type) {
+        config.data_type = type;
+        BEVFeaturePacket a = generator.generate_scenario_frame(config, 123);
+        BEVFeaturePacket b = generator.generate_scenario_frame(config, 123);
+        CHECK(a.feature.rows() == 128 && a.feature.cols() == 96);
+        CHECK(a.feature == b.feature);
+        CHECK(a.timestamp == b.timestamp);
+        CHECK(a.sensor_ctx.ego_pose == b.sensor_ctx.ego_pose);
+        CHECK(a.feature.minCoeff() >= a.feature_meta.value_min);
+        CHECK(a.feature.maxCoeff() <= a.feature_meta.value_max);
+    }
+
+    // 换种子后数据不同；时间戳按帧率等间隔
+    BEVDataGenerator::ScenarioConfig other = config;
+    other.seed = 8;
+    CHECK(!(generator.generate_scenario_frame(other, 123).feature ==
+            generator.generate_scenario_frame(config, 123).feature));
+    CHECK(generator.generate_scenario_frame(config, 25).timestamp -
+          generator.generate_scenario_frame(config, 0).timestamp == 1000000000ULL);
+
+    config.data_type = 9;
+    bool threw = false;
+    try {
+        generator.generate_scenario_frame(config, 0);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+static void test_temporal_coherence() {
+    // 无噪声时相邻两帧只有少量像素变化（障碍物随相对位姿平移），自车沿轨迹前进
+    BEVDataGenerator generator;
+    BEVDataGenerator::ScenarioConfig config;
+    config.seed = 3;
+    config.data_type = 2;
+    config.noise_level = 0.0f;
+    config.num_obstacles = 20;
+
+    auto changed_fraction = [](const BEVFeaturePacket& a, const BEVFeaturePacket& b) {
+        return ((a.feature - b.feature).array().abs() > 1e-6f).cast<float>().mean();
+    };
+    BEVFeaturePacket prev = generator.generate_scenario_frame(config, 1000);
+    BEVFeaturePacket next = generator.generate_scenario_frame(config, 1001);
+    CHECK(changed_fraction(prev, next) > 0.0f);
+    CHECK(changed_fraction(prev, next) < 0.02f);
+    CHECK(next.sensor_ctx.ego_pose[0] > prev.sensor_ctx.ego_pose[0]);
+    CHECK(next.sensor_ctx.ego_speed > 5.0f && next.sensor_ctx.ego_speed < 30.0f);
+
+    // 道路网格固定在世界坐标系中：自车移动后网格线整体平移，但仍是同一组网格
+    config.data_type = 3;
+    prev = generator.generate_scenario_frame(config, 1000);
+    next = generator.generate_scenario_frame(config, 1001);
+    const float line_ratio = (prev.feature.array() > 0.5f).cast<float>().mean();
+    CHECK(std::abs((next.feature.array() > 0.5f).cast<float>().mean() - line_ratio) < 0.02f);
+    CHECK(changed_fraction(prev, next) < 3 * line_ratio);
+
+    // 视野内应能看到障碍物
+    config.data_type = 2;
+    int visible = 0;
+    for (uint64_t k = 0; k < 50; ++k) {
+        visible += generator.generate_scenario_frame(config, k * 25).feature.maxCoeff() > 0.5f;
+    }
+    CHECK(visible > 25);
+}
+
+static void test_stream_to_file() {
+    // 输出与线程数、批大小无关，格式与save_multi_frames一致
+    BEVDataGenerator generator;
+    BEVDataGenerator::ScenarioConfig config;
+    config.seed = 11;
+    config.rows = 64;
+    config.cols = 48;
+    const uint32_t num_frames = 37;
+
+    config.threads = 1;
+    config.batch_frames = 5;
+    const uint64_t bytes = generator.generate_to_file(config, num_frames, "test_generator_a.bin");
+    config.threads = 4;
+    config.batch_frames = 8;
+    generator.generate_to_file(config, num_frames, "test_generator_b.bin");
+
+    std::vector<BEVFeaturePacket> frames;
+    for (uint32_t k = 0; k < num_frames; ++k) {
+        frames.push_back(generator.generate_scenario_frame(config, k));
+    }
+    generator.save_multi_frames("test_generator_c.bin", frames);
+
+    std::vector<char> a = read_file("test_generator_a.bin");
+    CHECK(a.size() == bytes);
+    CHECK(a.size() == 4 + num_frames * (43 + 64 * 48 * sizeof(float)));
+    CHECK(a == read_file("test_generator_b.bin"));
+    CHECK(a == read_file("test_generator_c.bin"));
+
+    // 流式读取与生成结果一致；截断的文件读到截断处时抛出异常
+    BEVFrameReader reader("test_generator_a.bin");
+    CHECK(reader.num_frames() == num_frames);
+    BEVFeaturePacket packet;
+    uint32_t read = 0;
+    while (reader.next(packet)) {
+        CHECK(packet.timestamp == frames[read].timestamp);
+        CHECK(packet.feature == frames[read].feature);
+        CHECK(packet.sensor_ctx.ego_pose == frames[read].sensor_ctx.ego_pose);
+        ++read;
+    }
+    CHECK(read == num_frames);
+
+    {
+        std::ofstream out("test_generator_b.bin", std::ios::binary | std::ios::trunc);
+        out.write(a.data(), a.size() / 2);
+    }
+    BEVFrameReader truncated("test_generator_b.bin");
+    bool threw = false;
+    try {
+        while (truncated.next(packet)) {}
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(truncated.frames_read() < num_frames);
+
+    std::remove("test_generator_a.bin");
+    std::remove("test_generator_b.bin");
+    std::remove("test_generator_c.bin");
+}
+
+int main() {
+    test_deterministic_frames();
+    test_temporal_coherence();
+    test_stream_to_file();
+
+    if (g_failures) {
+        std::cerr << g_failures << " 项检查失败" << std::endl;
+        return 1;
+    }
+    std::cout << "test_generator 全部通过" << std::endl;
+    return 0;
+}